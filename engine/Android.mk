@@ -86,11 +86,15 @@ LOCAL_SRC_FILES := \
            client/s_stream.c \
            client/s_utils.c \
            client/s_vox.c \
+           common/assetcache.c \
            common/avikit.c \
            common/build.c \
 		   common/cfgscript.c \
            common/cmd.c \
            common/common.c \
+           common/compress.c \
+           common/mapcat.c \
+           common/precache.c \
            common/touch.c \
            common/con_utils.c \
            common/console.c \
@@ -121,12 +125,14 @@ LOCAL_SRC_FILES := \
            common/random.c \
            common/sys_con.c \
            common/sys_win.c \
+           common/sys_thread.c \
            common/titles.c \
            common/world.c \
            common/zone.c \
            server/sv_client.c \
            server/sv_cmds.c \
            server/sv_custom.c \
+           server/sv_entcache.c \
            server/sv_frame.c \
            server/sv_game.c \
            server/sv_init.c \
@@ -136,6 +142,8 @@ LOCAL_SRC_FILES := \
            server/sv_phys.c \
            server/sv_pmove.c \
            server/sv_save.c \
+           server/sv_multicast.c \
+           server/sv_strings.c \
            server/sv_world.c \
            client/vgui/vgui_draw.c \
            common/imagelib/img_bmp.c \
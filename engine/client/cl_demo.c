@@ -82,6 +82,29 @@ struct
 	int		entryIndex;
 } demo;
 
+static const char *timedemo_stages[TD_NUMSTAGES] =
+{
+	"parse",
+	"interp",
+	"bones",
+	"world",
+	"studio",
+	"particles",
+	"sound",
+	"swap",
+};
+
+// timedemo benchmark
+struct
+{
+	double		stage[TD_NUMSTAGES];	// current frame
+	double		total[TD_NUMSTAGES];	// all measured frames
+	double		lastframe;	// end of previous measured frame, 0 after loading
+	float		*frametimes;	// msec
+	int		numframes;
+	int		maxframes;
+} timedemo;
+
 /*
 ====================
 CL_StartupDemoHeader
@@ -771,6 +794,214 @@ qboolean CL_DemoReadMessage( byte *buffer, size_t *length )
 	return CL_ReadRawNetworkData( buffer, length );
 }
 
+/*
+====================
+CL_TimeDemoFrameTime
+
+fixed simulation step while timedemo
+is running, 0 otherwise
+====================
+*/
+float CL_TimeDemoFrameTime( void )
+{
+	if( !cls.timedemo ) return 0.0f;
+	return 1.0f / bound( MIN_FPS, cl_timedemo_fps->value, MAX_FPS );
+}
+
+/*
+====================
+CL_TimeDemoBegin
+
+returns start time for CL_TimeDemoEnd
+====================
+*/
+double CL_TimeDemoBegin( void )
+{
+	if( !cls.timedemo ) return 0.0;
+	return Sys_DoubleTime();
+}
+
+/*
+====================
+CL_TimeDemoEnd
+
+add time spent since CL_TimeDemoBegin to the stage
+====================
+*/
+void CL_TimeDemoEnd( int stage, double start )
+{
+	if( !cls.timedemo || start == 0.0 )
+		return;
+
+	timedemo.stage[stage] += Sys_DoubleTime() - start;
+}
+
+/*
+====================
+CL_TimeDemoFrame
+
+store the frame time and stage times of
+the finished frame. Loading frames and
+the first frame after them are not counted
+====================
+*/
+void CL_TimeDemoFrame( void )
+{
+	double	now;
+	int	i;
+
+	if( !cls.timedemo ) return;
+
+	now = Sys_DoubleTime();
+
+	if( cls.state != ca_active || timedemo.lastframe == 0.0 )
+	{
+		Q_memset( timedemo.stage, 0, sizeof( timedemo.stage ));
+		timedemo.lastframe = ( cls.state == ca_active ) ? now : 0.0;
+		return;
+	}
+
+	if( timedemo.numframes == timedemo.maxframes )
+	{
+		timedemo.maxframes += 4096;
+		timedemo.frametimes = Z_Realloc( timedemo.frametimes, timedemo.maxframes * sizeof( float ));
+	}
+
+	timedemo.frametimes[timedemo.numframes++] = ( now - timedemo.lastframe ) * 1000.0;
+	timedemo.lastframe = now;
+
+	for( i = 0; i < TD_NUMSTAGES; i++ )
+	{
+		timedemo.total[i] += timedemo.stage[i];
+		timedemo.stage[i] = 0.0;
+	}
+}
+
+static int CL_CompareFrameTimes( const void *a, const void *b )
+{
+	float	fa = *(const float *)a;
+	float	fb = *(const float *)b;
+
+	return ( fa > fb ) - ( fa < fb );
+}
+
+/*
+=================
+CL_JSONString
+
+escape string for the timedemo report
+=================
+*/
+static const char *CL_JSONString( const char *in )
+{
+	static char	out[MAX_SYSPATH * 2];
+	char		*p = out;
+
+	for( ; *in && p < out + sizeof( out ) - 7; in++ )
+	{
+		byte	c = *in;
+
+		if( c == '"' || c == '\\' )
+		{
+			*p++ = '\\';
+			*p++ = c;
+		}
+		else if( c < 0x20 )
+		{
+			Q_snprintf( p, 7, "\\u%04x", c );
+			p += 6;
+		}
+		else *p++ = c;
+	}
+
+	*p = '\0';
+
+	return out;
+}
+
+static float CL_FrameTimePercentile( const float *sorted, int count, float frac )
+{
+	int	i = (int)( frac * ( count - 1 ) + 0.5f );
+
+	return sorted[bound( 0, i, count - 1 )];
+}
+
+/*
+====================
+CL_FinishTimeDemo
+
+print timedemo results and write
+them into demos/<demoname>_timedemo.json
+====================
+*/
+static void CL_FinishTimeDemo( void )
+{
+	float	*sorted = timedemo.frametimes;
+	int	i, count = timedemo.numframes;
+	double	total = 0.0;
+	file_t	*f;
+
+	cls.timedemo = false;
+
+	if( count < 1 )
+	{
+		Msg( "timedemo %s: no frames measured\n", cls.demoname );
+		goto cleanup;
+	}
+
+	for( i = 0; i < count; i++ )
+		total += sorted[i];
+
+	qsort( sorted, count, sizeof( float ), CL_CompareFrameTimes );
+
+	Msg( "timedemo %s: %i frames %.2f seconds %.1f fps\n", cls.demoname, count, total * 0.001, count * 1000.0 / total );
+	Msg( "frame ms: avg %.2f, p50 %.2f, p90 %.2f, p95 %.2f, p99 %.2f, max %.2f\n", total / count,
+		CL_FrameTimePercentile( sorted, count, 0.5f ), CL_FrameTimePercentile( sorted, count, 0.9f ),
+		CL_FrameTimePercentile( sorted, count, 0.95f ), CL_FrameTimePercentile( sorted, count, 0.99f ),
+		sorted[count - 1] );
+
+	for( i = 0; i < TD_NUMSTAGES; i++ )
+		Msg( "%12s: %.3f ms\n", timedemo_stages[i], timedemo.total[i] * 1000.0 / count );
+
+	f = FS_Open( va( "demos/%s_timedemo.json", cls.demoname ), "w", true );
+
+	if( !f )
+	{
+		MsgDev( D_ERROR, "CL_FinishTimeDemo: couldn't write demos/%s_timedemo.json\n", cls.demoname );
+		goto cleanup;
+	}
+
+	FS_Printf( f, "{\n\t\"demo\": \"%s\",\n", CL_JSONString( cls.demoname ));
+	FS_Printf( f, "\t\"frames\": %i,\n", count );
+	FS_Printf( f, "\t\"timestep\": %f,\n", 1.0f / bound( MIN_FPS, cl_timedemo_fps->value, MAX_FPS ));
+	FS_Printf( f, "\t\"seconds\": %f,\n", total * 0.001 );
+	FS_Printf( f, "\t\"fps\": %f,\n", count * 1000.0 / total );
+	FS_Printf( f, "\t\"frame_ms\": {\n" );
+	FS_Printf( f, "\t\t\"min\": %f,\n", sorted[0] );
+	FS_Printf( f, "\t\t\"avg\": %f,\n", total / count );
+	FS_Printf( f, "\t\t\"p50\": %f,\n", CL_FrameTimePercentile( sorted, count, 0.5f ));
+	FS_Printf( f, "\t\t\"p90\": %f,\n", CL_FrameTimePercentile( sorted, count, 0.9f ));
+	FS_Printf( f, "\t\t\"p95\": %f,\n", CL_FrameTimePercentile( sorted, count, 0.95f ));
+	FS_Printf( f, "\t\t\"p99\": %f,\n", CL_FrameTimePercentile( sorted, count, 0.99f ));
+	FS_Printf( f, "\t\t\"max\": %f\n", sorted[count - 1] );
+	FS_Printf( f, "\t},\n\t\"stage_ms\": {\n" );
+
+	for( i = 0; i < TD_NUMSTAGES; i++ )
+	{
+		FS_Printf( f, "\t\t\"%s\": %f%s\n", timedemo_stages[i], timedemo.total[i] * 1000.0 / count,
+			( i < TD_NUMSTAGES - 1 ) ? "," : "" );
+	}
+
+	FS_Printf( f, "\t}\n}\n" );
+	FS_Close( f );
+
+	Msg( "timedemo report written to demos/%s_timedemo.json\n", cls.demoname );
+cleanup:
+	if( timedemo.frametimes )
+		Mem_Free( timedemo.frametimes );
+	Q_memset( &timedemo, 0, sizeof( timedemo ));
+}
+
 /*
 ==============
 CL_StopPlayback
@@ -782,6 +1013,9 @@ void CL_StopPlayback( void )
 {
 	if( !cls.demoplayback ) return;
 
+	if( cls.timedemo )
+		CL_FinishTimeDemo();
+
 	// release demofile
 	FS_Close( cls.demofile );
 	cls.demoplayback = false;
@@ -1157,6 +1391,33 @@ void CL_PlayDemo_f( void )
 	// begin a playback demo
 }
 
+/*
+====================
+CL_TimeDemo_f
+
+timedemo <demoname>
+====================
+*/
+void CL_TimeDemo_f( void )
+{
+	if( Cmd_Argc() != 2 )
+	{
+		Msg( "Usage: timedemo <demoname>\n" );
+		return;
+	}
+
+	cls.demonum = -1; // stop demo loop
+	CL_PlayDemo_f ();
+
+	if( !cls.demoplayback )
+		return;
+
+	// run as fast as possible with a fixed step, so each run
+	// reads the same demo messages on the same frames
+	Q_memset( &timedemo, 0, sizeof( timedemo ));
+	cls.timedemo = true;
+}
+
 /*
 ==================
 CL_StartDemos_f
@@ -67,17 +67,10 @@ CL_EventIndex
 */
 word CL_EventIndex( const char *name )
 {
-	int	i;
-	
 	if( !name || !name[0] )
 		return 0;
 
-	for( i = 1; i < MAX_EVENTS && cl.event_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( cl.event_precache[i], name ))
-			return i;
-	}
-	return 0;
+	return Precache_Find( &cl.event_hash, cl.event_precache, name );
 }
 
 /*
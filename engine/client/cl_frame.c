@@ -104,20 +104,236 @@ qboolean CL_FindInterpolationUpdates( cl_entity_t *ent, float targettime, positi
 	return extrapolate;
 }
 
-int CL_InterpolateModel( cl_entity_t *e )
+/*
+=========================================================================
+
+BATCHED INTERPOLATION
+
+Update times of every entity are also kept in a contiguous ring
+(cl_lerp.times), so search for bracketing updates doesn't walk through
+position_history_t. Packet entities are interpolated in one pass before
+they are added, CL_InterpolateModel picks up the result for each entity
+at the same point as before, so client dll sees the same values.
+
+=========================================================================
+*/
+
+#define LERP_CURSTATE	0	// keep current state
+#define LERP_HISTORY	1	// newest update as is
+#define LERP_BLEND		2	// blend between two updates
+
+typedef struct
+{
+	int		sequence;		// batch which computed it
+	int		position;		// ent->current_position at that time
+	int		mode;
+	int		result;		// CL_InterpolateModel return value
+	vec3_t		origin;
+	vec3_t		angles;
+} lerpresult_t;
+
+static struct
+{
+	float		*times;		// [maxentities][HISTORY_MAX]
+	lerpresult_t	*results;
+	int		maxentities;
+	int		sequence;
+
+	// packed input of blend pass
+	int		*blendents;
+	float		(*from)[6];	// older update, origin and angles
+	float		(*to)[6];		// newer update
+	float		*frac;
+} cl_lerp;
+
+/*
+==================
+CL_InitInterpolation
+
+allocated along with clgame.entities
+==================
+*/
+void CL_InitInterpolation( void )
+{
+	int	count = clgame.maxEntities;
+
+	CL_FreeInterpolation();
+
+	cl_lerp.times = Mem_Alloc( clgame.mempool, sizeof( float ) * count * HISTORY_MAX );
+	cl_lerp.results = Mem_Alloc( clgame.mempool, sizeof( lerpresult_t ) * count );
+	cl_lerp.blendents = Mem_Alloc( clgame.mempool, sizeof( int ) * count );
+	cl_lerp.from = Mem_Alloc( clgame.mempool, sizeof( *cl_lerp.from ) * count );
+	cl_lerp.to = Mem_Alloc( clgame.mempool, sizeof( *cl_lerp.to ) * count );
+	cl_lerp.frac = Mem_Alloc( clgame.mempool, sizeof( float ) * count );
+	cl_lerp.maxentities = count;
+}
+
+/*
+==================
+CL_FreeInterpolation
+==================
+*/
+void CL_FreeInterpolation( void )
+{
+	if( cl_lerp.times ) Mem_Free( cl_lerp.times );
+	if( cl_lerp.results ) Mem_Free( cl_lerp.results );
+	if( cl_lerp.blendents ) Mem_Free( cl_lerp.blendents );
+	if( cl_lerp.from ) Mem_Free( cl_lerp.from );
+	if( cl_lerp.to ) Mem_Free( cl_lerp.to );
+	if( cl_lerp.frac ) Mem_Free( cl_lerp.frac );
+	Q_memset( &cl_lerp, 0, sizeof( cl_lerp ));
+}
+
+/*
+==================
+CL_FindInterpolationTimes
+
+same search as CL_FindInterpolationUpdates
+==================
+*/
+static qboolean CL_FindInterpolationTimes( const float *times, int current, float targettime, int *i0, int *i1 )
+{
+	int	i, imod;
+	float	at;
+
+	imod = current - 1;
+	*i0 = (imod + 1) & HISTORY_MASK;
+	*i1 = imod & HISTORY_MASK;
+
+	if( times[*i0] < targettime )
+		return true;
+
+	for( i = 0; i < HISTORY_MAX - 2; i++ )
+	{
+		at = times[imod & HISTORY_MASK];
+		if( at == 0.0f ) break;
+
+		if( at < targettime )
+		{
+			*i0 = (imod + 1) & HISTORY_MASK;
+			*i1 = imod & HISTORY_MASK;
+			return false;
+		}
+		imod--;
+	}
+
+	return true;
+}
+
+/*
+==================
+CL_InterpolateBatch
+
+interpolate all packet entities of the frame
+==================
+*/
+static void CL_InterpolateBatch( frame_t *frame, float t )
 {
 	position_history_t	*ph0, *ph1;
-	vec3_t		origin, angles, delta;
-	float		t, t1, t2, frac;
-	int		i;
+	lerpresult_t	*res;
+	cl_entity_t	*ent;
+	float		t1, t2, frac;
+	int		i, j, e, i0, i1;
+	int		numblends = 0;
 
-	VectorCopy( e->curstate.origin, e->origin );
-	VectorCopy( e->curstate.angles, e->angles );
+	cl_lerp.sequence++;
 
-	if( e->model == NULL )
-		return 1;
+	for( i = 0; i < frame->num_entities; i++ )
+	{
+		e = cls.packet_entities[(frame->first_entity + i) % cls.num_client_entities].number;
+		ent = CL_GetEntityByIndex( e );
+
+		if( !ent || ent == clgame.entities || e >= cl_lerp.maxentities )
+			continue;
+
+		res = &cl_lerp.results[e];
+		res->sequence = cl_lerp.sequence;
+		res->position = ent->current_position;
+		res->mode = LERP_CURSTATE;
+		res->result = 0;
+
+		if( CL_FindInterpolationTimes( cl_lerp.times + e * HISTORY_MAX, ent->current_position, t, &i0, &i1 ))
+			continue;
+
+		t1 = cl_lerp.times[e * HISTORY_MAX + i0];
+		t2 = cl_lerp.times[e * HISTORY_MAX + i1];
+
+		if( t - t2 < 0.0f )
+			continue;
+
+		ph0 = &ent->ph[i0];
+		ph1 = &ent->ph[i1];
+
+		if( t2 == 0.0f || ( VectorIsNull( ph1->origin ) && !VectorIsNull( ph0->origin )) || t2 == t1 )
+		{
+			res->mode = LERP_HISTORY;
+			res->result = ( t2 != 0.0f && t2 == t1 );
+			VectorCopy( ph0->origin, res->origin );
+			VectorCopy( ph0->angles, res->angles );
+			continue;
+		}
 
-	t = cl.time - cl_interp->value;
+		frac = (t - t2) / (t1 - t2);
+
+		if( frac < 0.0f )
+			continue;
+
+		if( frac > 1.0f )
+			frac = 1.0f;
+
+		VectorCopy( ph1->origin, &cl_lerp.from[numblends][0] );
+		VectorCopy( ph1->angles, &cl_lerp.from[numblends][3] );
+		VectorCopy( ph0->origin, &cl_lerp.to[numblends][0] );
+		VectorCopy( ph0->angles, &cl_lerp.to[numblends][3] );
+		cl_lerp.frac[numblends] = frac;
+		cl_lerp.blendents[numblends] = e;
+		numblends++;
+	}
+
+	// straight loops over packed data, same arithmetic as CL_InterpolateModel
+	for( i = 0; i < numblends; i++ )
+	{
+		float	*from = cl_lerp.from[i];
+		float	*to = cl_lerp.to[i];
+		vec3_t	delta;
+		float	d;
+
+		res = &cl_lerp.results[cl_lerp.blendents[i]];
+		res->mode = LERP_BLEND;
+		res->result = 1;
+
+		for( j = 0; j < 3; j++ )
+			delta[j] = to[j] - from[j];
+
+		for( j = 0; j < 3; j++ )
+			res->origin[j] = from[j] + cl_lerp.frac[i] * delta[j];
+
+		for( j = 0; j < 3; j++ )
+		{
+			d = to[j+3] - from[j+3];
+
+			if( d > 180.0f ) d -= 360.0f;
+			else if( d < -180.0f ) d += 360.0f;
+
+			res->angles[j] = from[j+3] + d * cl_lerp.frac[i];
+		}
+	}
+}
+
+/*
+==================
+CL_LerpEntity
+
+scalar interpolation, writes origin
+and angles only if they were changed
+==================
+*/
+static int CL_LerpEntity( cl_entity_t *e, float t, vec3_t outorigin, vec3_t outangles )
+{
+	position_history_t	*ph0, *ph1;
+	vec3_t		origin, angles, delta;
+	float		t1, t2, frac;
+	int		i;
 
 	if( !CL_FindInterpolationUpdates( e, t, &ph0, &ph1, NULL ))
 		return 0;
@@ -133,15 +349,15 @@ int CL_InterpolateModel( cl_entity_t *e )
 
 	if( t2 == 0.0f || ( VectorIsNull( ph1->origin ) && !VectorIsNull( ph0->origin ) ) )
 	{
-		VectorCopy( ph0->origin, e->origin );
-		VectorCopy( ph0->angles, e->angles );
+		VectorCopy( ph0->origin, outorigin );
+		VectorCopy( ph0->angles, outangles );
 		return 0;
 	}
 
 	if( t2 == t1 )
 	{
-		VectorCopy( ph0->origin, e->origin );
-		VectorCopy( ph0->angles, e->angles );
+		VectorCopy( ph0->origin, outorigin );
+		VectorCopy( ph0->angles, outangles );
 		return 1;
 	}
 
@@ -170,12 +386,122 @@ int CL_InterpolateModel( cl_entity_t *e )
 		angles[i] = ang2 + d * frac;
 	}
 
-	VectorCopy( origin, e->origin );
-	VectorCopy( angles, e->angles );
+	VectorCopy( origin, outorigin );
+	VectorCopy( angles, outangles );
 
 	return 1;
 }
 
+int CL_InterpolateModel( cl_entity_t *e )
+{
+	lerpresult_t	*res;
+	int		index;
+
+	VectorCopy( e->curstate.origin, e->origin );
+	VectorCopy( e->curstate.angles, e->angles );
+
+	if( e->model == NULL )
+		return 1;
+
+	index = e - clgame.entities;
+
+	// computed by CL_InterpolateBatch this frame
+	if( index > 0 && index < cl_lerp.maxentities )
+	{
+		res = &cl_lerp.results[index];
+
+		if( res->sequence == cl_lerp.sequence && res->position == e->current_position )
+		{
+			if( res->mode != LERP_CURSTATE )
+			{
+				VectorCopy( res->origin, e->origin );
+				VectorCopy( res->angles, e->angles );
+			}
+			return res->result;
+		}
+	}
+
+	return CL_LerpEntity( e, cl.time - cl_interp->value, e->origin, e->angles );
+}
+
+/*
+==================
+CL_InterpBench_f
+
+compare batched interpolation with scalar one
+on current entities, e.g. while demo is playing
+==================
+*/
+void CL_InterpBench_f( void )
+{
+	vec3_t		origin, angles;
+	double		start, scalar = 0.0, batched = 0.0;
+	int		i, j, e, iterations, count;
+	int		mismatches = 0, blends = 0;
+	lerpresult_t	*res;
+	cl_entity_t	*ent;
+	float		t;
+
+	if( cls.state != ca_active || !cl.frame.valid || !cl_lerp.times )
+	{
+		Msg( "cl_interpbench: no entities, start a demo or connect to a server\n" );
+		return;
+	}
+
+	iterations = ( Cmd_Argc() > 1 ) ? Q_atoi( Cmd_Argv( 1 )) : 1000;
+	iterations = bound( 1, iterations, 1000000 );
+	count = cl.frame.num_entities;
+
+	for( i = 0; i < iterations; i++ )
+	{
+		// step through the recorded history
+		t = cl.time - cl_interp->value - ( i % 64 ) * 0.005;
+
+		start = Sys_DoubleTime();
+		for( j = 0; j < count; j++ )
+		{
+			e = cls.packet_entities[(cl.frame.first_entity + j) % cls.num_client_entities].number;
+			ent = CL_GetEntityByIndex( e );
+			if( !ent || ent == clgame.entities ) continue;
+			CL_LerpEntity( ent, t, origin, angles );
+		}
+		scalar += Sys_DoubleTime() - start;
+
+		start = Sys_DoubleTime();
+		CL_InterpolateBatch( &cl.frame, t );
+		batched += Sys_DoubleTime() - start;
+
+		// results must be the same bit to bit
+		for( j = 0; j < count; j++ )
+		{
+			e = cls.packet_entities[(cl.frame.first_entity + j) % cls.num_client_entities].number;
+			ent = CL_GetEntityByIndex( e );
+			if( !ent || ent == clgame.entities || e >= cl_lerp.maxentities ) continue;
+
+			VectorCopy( ent->curstate.origin, origin );
+			VectorCopy( ent->curstate.angles, angles );
+			res = &cl_lerp.results[e];
+
+			if( CL_LerpEntity( ent, t, origin, angles ) != res->result )
+				mismatches++;
+			else if( res->mode != LERP_CURSTATE && ( memcmp( origin, res->origin, sizeof( vec3_t )) || memcmp( angles, res->angles, sizeof( vec3_t ))))
+				mismatches++;
+			else if( res->mode == LERP_CURSTATE && ( memcmp( origin, ent->curstate.origin, sizeof( vec3_t )) || memcmp( angles, ent->curstate.angles, sizeof( vec3_t ))))
+				mismatches++;
+
+			if( res->mode == LERP_BLEND ) blends++;
+		}
+	}
+
+	// don't let bench results leak into the next frame
+	cl_lerp.sequence++;
+
+	Msg( "%i entities, %i iterations, %.1f%% blended\n", count, iterations, blends * 100.0 / max( count * iterations, 1 ));
+	Msg( "scalar: %.3f ms, batched: %.3f ms\n", scalar * 1000.0, batched * 1000.0 );
+	if( mismatches ) Msg( "^1%i results differ^7\n", mismatches );
+	else Msg( "results are identical\n" );
+}
+
 void CL_UpdateEntityFields( cl_entity_t *ent )
 {
 	// parametric rockets code
@@ -648,6 +974,7 @@ Store another position into interpolation circular buffer
 void CL_UpdatePositions( cl_entity_t *ent )
 {
 	position_history_t	*ph;
+	int		index;
 
 	ent->current_position = (ent->current_position + 1) & HISTORY_MASK;
 
@@ -656,6 +983,10 @@ void CL_UpdatePositions( cl_entity_t *ent )
 	VectorCopy( ent->curstate.origin, ph->origin );
 	VectorCopy( ent->curstate.angles, ph->angles );
 	ph->animtime = ent->curstate.animtime;
+
+	index = ent - clgame.entities;
+	if( index >= 0 && index < cl_lerp.maxentities )
+		cl_lerp.times[index * HISTORY_MAX + ent->current_position] = ph->animtime;
 }
 
 void CL_DeltaEntity( sizebuf_t *msg, frame_t *frame, int newnum, entity_state_t *old, qboolean unchanged )
@@ -1073,6 +1404,9 @@ void CL_AddPacketEntities( frame_t *frame )
 	clent = CL_GetLocalPlayer();
 	if( !clent ) return;
 
+	if( cl_lerpbatch->integer && cl_lerp.times )
+		CL_InterpolateBatch( frame, cl.time - cl_interp->value );
+
 	for( i = 0; i < cl.frame.num_entities; i++ )
 	{
 		e = cls.packet_entities[(cl.frame.first_entity + i) % cls.num_client_entities].number;
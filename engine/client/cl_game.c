@@ -1105,6 +1105,7 @@ void CL_InitEdicts( void )
 	clgame.entities = Mem_Alloc( clgame.mempool, sizeof( cl_entity_t ) * clgame.maxEntities );
 	clgame.static_entities = Mem_Alloc( clgame.mempool, sizeof( cl_entity_t ) * MAX_STATIC_ENTITIES );
 	clgame.numStatics = 0;
+	CL_InitInterpolation();
 
 	if(( clgame.maxRemapInfos - 1 ) != clgame.maxEntities )
 	{
@@ -1122,6 +1123,8 @@ void CL_FreeEdicts( void )
 	Z_Free( clgame.static_entities );
 	clgame.static_entities = NULL;
 
+	CL_FreeInterpolation();
+
 	Z_Free( cls.packet_entities );
 	cls.packet_entities = NULL;
 
@@ -2185,11 +2188,8 @@ int CL_FindModelIndex( const char *m )
 	if( !m || !m[0] )
 		return 0;
 
-	for( i = 1; i < MAX_MODELS && cl.model_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( cl.model_precache[i], m ))
-			return i;
-	}
+	if(( i = Precache_Find( &cl.model_hash, cl.model_precache, m )) != 0 )
+		return i;
 
 	if( cls.state == ca_active && Q_strnicmp( m, "models/player/", 14 ))
 	{
@@ -39,6 +39,7 @@ convar_t	*cl_smooth;
 convar_t	*cl_timeout;
 convar_t	*cl_predict;
 convar_t	*cl_showfps;
+convar_t	*cl_timedemo_fps;
 convar_t	*cl_showpos;
 convar_t	*cl_nodelta;
 convar_t	*cl_crosshair;
@@ -50,6 +51,8 @@ convar_t	*cl_solid_players;
 convar_t	*cl_draw_beams;
 convar_t	*cl_cmdrate;
 convar_t	*cl_interp;
+convar_t	*cl_lerpbatch;
+convar_t	*cl_tent_engineupdate;
 convar_t	*cl_allow_fragment;
 convar_t	*cl_lw;
 convar_t	*cl_trace_events;
@@ -1190,6 +1193,9 @@ void CL_PrepVideo( void )
 	Cvar_SetFloat( "scr_loading", 0.0f ); // reset progress bar
 	MsgDev( D_NOTE, "CL_PrepVideo: %s\n", clgame.mapname );
 
+	// process level textures on worker threads
+	GL_BeginUploadQueue();
+
 	// let the render dll load the map
 	Q_strncpy( mapname, cl.model_precache[1], MAX_STRING ); 
 	Mod_LoadWorld( mapname, (uint *)&map_checksum, false );
@@ -1215,6 +1221,8 @@ void CL_PrepVideo( void )
 			SCR_UpdateScreen();
 	}
 
+	GL_EndUploadQueue();
+
 	// update right muzzleflash indexes
 	CL_RegisterMuzzleFlashes ();
 
@@ -1649,6 +1657,8 @@ void CL_InitLocal( void )
 	cl_idealpitchscale = Cvar_Get( "cl_idealpitchscale", "0.8", 0, "how much to look up/down slopes and stairs when not using freelook" );
 	cl_solid_players = Cvar_Get( "cl_solid_players", "1", 0, "make all players non-solid (can't traceline them)" );
 	cl_interp = Cvar_Get( "ex_interp", "0.1", 0, "interpolate object positions starting this many seconds in past" );
+	cl_lerpbatch = Cvar_Get( "cl_lerpbatch", "1", CVAR_ARCHIVE, "interpolate all entities in one pass before adding them" );
+	cl_tent_engineupdate = Cvar_Get( "cl_tent_engineupdate", "0", 0, "update temp entities with common flags in engine, set by client dll or game config" );
 	//Cvar_Get( "ex_maxerrordistance", "0", 0, "" );
 	cl_allow_fragment = Cvar_Get( "cl_allow_fragment", "0", CVAR_ARCHIVE, "allow downloading files directly from game server" ); 
 	cl_timeout = Cvar_Get( "cl_timeout", "60", 0, "connect timeout (in seconds)" );
@@ -1675,6 +1685,7 @@ void CL_InitLocal( void )
 	rate = Cvar_Get( "rate", "25000", CVAR_USERINFO|CVAR_ARCHIVE, "player network rate" );
 	hltv = Cvar_Get( "hltv", "0", CVAR_USERINFO|CVAR_LATCH, "HLTV mode" );
 	cl_showfps = Cvar_Get( "cl_showfps", "1", CVAR_ARCHIVE, "show client fps" );
+	cl_timedemo_fps = Cvar_Get( "cl_timedemo_fps", "60", CVAR_ARCHIVE, "fixed simulation rate used by timedemo" );
 	cl_showpos = Cvar_Get( "cl_showpos", "0", CVAR_ARCHIVE, "show local player position and velocity" );
 	cl_smooth = Cvar_Get ("cl_smooth", "0", CVAR_ARCHIVE, "smooth up stair climbing and interpolate position in multiplayer" );
 	cl_cmdbackup = Cvar_Get( "cl_cmdbackup", "10", CVAR_ARCHIVE, "how many additional history commands are sent" );
@@ -1724,6 +1735,7 @@ void CL_InitLocal( void )
 	Cmd_AddCommand ("disconnect", CL_Disconnect_f, "disconnect from server" );
 	Cmd_AddCommand ("record", CL_Record_f, "record a demo" );
 	Cmd_AddCommand ("playdemo", CL_PlayDemo_f, "play a demo" );
+	Cmd_AddCommand ("timedemo", CL_TimeDemo_f, "play a demo as fast as possible and write a frame time report" );
 	Cmd_AddCommand ("killdemo", CL_DeleteDemo_f, "delete a specified demo file and demoshot" );
 	Cmd_AddCommand ("startdemos", CL_StartDemos_f, "start playing back the selected demos sequentially" );
 	Cmd_AddCommand ("demos", CL_Demos_f, "restart looping demos defined by the last startdemos command" );
@@ -1754,6 +1766,8 @@ void CL_InitLocal( void )
 // 	Cmd_AddCommand ("packet", CL_Packet_f, "send a packet with custom contents" );
 
 	Cmd_AddCommand ("precache", CL_Precache_f, "precache specified resource (by index)" );
+	Cmd_AddCommand ("cl_interpbench", CL_InterpBench_f, "compare speed and results of batched and scalar entity interpolation" );
+	Cmd_AddCommand ("tempents_info", CL_TempEntsInfo_f, "show temp entity allocations, evictions and update time" );
 }
 
 //============================================================================
@@ -1781,6 +1795,8 @@ Host_ClientFrame
 */
 void Host_ClientFrame( void )
 {
+	double	start;
+
 	// if client is not active, skip render functions
 
 	// decide the simulation time
@@ -1805,7 +1821,9 @@ void Host_ClientFrame( void )
 		clgame.dllFuncs.pfnFrame( host.frametime );
 
 		// fetch results from server
+		start = CL_TimeDemoBegin();
 		CL_ReadPackets();
+		CL_TimeDemoEnd( TD_PARSE, start );
 
 		VID_CheckChanges();
 
@@ -1822,7 +1840,9 @@ void Host_ClientFrame( void )
 	if( cls.initialized )
 	{
 		// update audio
+		start = CL_TimeDemoBegin();
 		S_RenderFrame( &cl.refdef );
+		CL_TimeDemoEnd( TD_SOUND, start );
 
 		// send a new command message to the server
 		CL_SendCommand();
@@ -1838,6 +1858,7 @@ void Host_ClientFrame( void )
 
 	Con_RunConsole();
 
+	CL_TimeDemoFrame();
 	cls.framecount++;
 }
 
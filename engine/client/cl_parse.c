@@ -948,6 +948,7 @@ void CL_PrecacheModel( sizebuf_t *msg )
 		Host_Error( "CL_PrecacheModel: bad modelindex %i\n", modelIndex );
 
 	Q_strncpy( cl.model_precache[modelIndex], BF_ReadString( msg ), sizeof( cl.model_precache[0] ));
+	Precache_Add( &cl.model_hash, cl.model_precache, modelIndex );
 
 	// when we loading map all resources is precached sequentially
 	if( !cl.video_prepped ) return;
@@ -996,6 +997,7 @@ void CL_PrecacheEvent( sizebuf_t *msg )
 		Host_Error( "CL_PrecacheEvent: bad eventindex %i\n", eventIndex );
 
 	Q_strncpy( cl.event_precache[eventIndex], BF_ReadString( msg ), sizeof( cl.event_precache[0] ));
+	Precache_Add( &cl.event_hash, cl.event_precache, eventIndex );
 
 	// can be set now
 	CL_SetEventIndex( cl.event_precache[eventIndex], eventIndex );
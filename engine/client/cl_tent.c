@@ -43,6 +43,44 @@ TEMPENTITY	*cl_free_tents;
 TEMPENTITY	*cl_tempents = NULL;		// entities pool
 int		cl_muzzleflash[MAX_MUZZLEFLASH];	// muzzle flashes
 
+/*
+Side data for each tent lives in a parallel array, because TEMPENTITY
+is shared with client dll. Active list gets back links and low priority
+tents are chained from newest to oldest, so victim for high priority
+allocation is taken without a scan. Client dll unlinks dead tents by
+itself in pfnTempEntUpdate, so links are rebuilt after each update.
+*/
+typedef struct
+{
+	int		prev;		// active list, -1 for head
+	int		newer;		// low priority list
+	int		older;
+	uint		serial;		// allocation order
+} tentlink_t;
+
+static struct
+{
+	tentlink_t	*links;
+	int		newest;		// low priority list
+	int		oldest;
+	uint		serial;
+	qboolean		updating;		// links are not valid while lists are updated
+
+	int		numactive[2];	// by priority, after last update
+	int		allocs[2];
+	int		evictions;
+	int		failures;
+	int		frames;
+	int		engineupdated;
+	double		enginetime;
+	double		dlltime;
+} cl_tents;
+
+// flags which CL_UpdateTempEntsEngine handles in the same way as client dll does
+#define FTENT_ENGINEUPDATE	(FTENT_GRAVITY|FTENT_SLOWGRAVITY|FTENT_ROTATE|FTENT_FADEOUT|FTENT_SPRANIMATE|FTENT_SPRANIMATELOOP|\
+			FTENT_SPRCYCLE|FTENT_COLLIDEWORLD|FTENT_COLLIDEKILL|FTENT_HITSOUND|FTENT_PERSIST|FTENT_NOMODEL|\
+			FTENT_SMOKETRAIL|FTENT_SCALE)
+
 /*
 ================
 CL_InitTempents
@@ -52,6 +90,7 @@ CL_InitTempents
 void CL_InitTempEnts( void )
 {
 	cl_tempents = Mem_Alloc( cls.mempool, sizeof( TEMPENTITY ) * GI->max_tents );
+	cl_tents.links = Mem_Alloc( cls.mempool, sizeof( tentlink_t ) * GI->max_tents );
 	CL_ClearTempEnts();
 }
 
@@ -94,6 +133,10 @@ void CL_ClearTempEnts( void )
 	cl_tempents[GI->max_tents-1].next = NULL;
 	cl_free_tents = cl_tempents;
 	cl_active_tents = NULL;
+
+	cl_tents.newest = cl_tents.oldest = -1;
+	cl_tents.numactive[0] = cl_tents.numactive[1] = 0;
+	cl_tents.updating = false;
 }
 
 /*
@@ -106,7 +149,96 @@ void CL_FreeTempEnts( void )
 {
 	if( cl_tempents )
 		Mem_Free( cl_tempents );
+	if( cl_tents.links )
+		Mem_Free( cl_tents.links );
 	cl_tempents = NULL;
+	cl_tents.links = NULL;
+}
+
+/*
+================
+CL_LinkTempEnt
+
+tent was just pushed onto the head of active list
+================
+*/
+static void CL_LinkTempEnt( TEMPENTITY *pTemp )
+{
+	int		index = pTemp - cl_tempents;
+	tentlink_t	*link = &cl_tents.links[index];
+
+	link->serial = ++cl_tents.serial;
+	cl_tents.allocs[pTemp->priority]++;
+
+	// will be relinked after update
+	if( cl_tents.updating ) return;
+
+	link->prev = -1;
+	if( pTemp->next ) cl_tents.links[pTemp->next - cl_tempents].prev = index;
+
+	if( pTemp->priority != TENTPRIORITY_LOW )
+		return;
+
+	link->newer = -1;
+	link->older = cl_tents.newest;
+	if( cl_tents.newest != -1 ) cl_tents.links[cl_tents.newest].newer = index;
+	else cl_tents.oldest = index;
+	cl_tents.newest = index;
+}
+
+/*
+================
+CL_RelinkTempEnts
+
+rebuild links from active list, tents which were
+updated by engine are merged back in allocation order
+================
+*/
+static void CL_RelinkTempEnts( TEMPENTITY *pMerge )
+{
+	TEMPENTITY	*pTemp, **ppLink = &cl_active_tents;
+	TEMPENTITY	*pActive = cl_active_tents;
+	tentlink_t	*link;
+	int		index, prev = -1;
+
+	cl_tents.newest = cl_tents.oldest = -1;
+	cl_tents.numactive[0] = cl_tents.numactive[1] = 0;
+
+	// both lists go from newest to oldest
+	while( pActive || pMerge )
+	{
+		if( !pActive || ( pMerge && (int)( cl_tents.links[pMerge - cl_tempents].serial - cl_tents.links[pActive - cl_tempents].serial ) > 0 ))
+		{
+			pTemp = pMerge;
+			pMerge = pMerge->next;
+		}
+		else
+		{
+			pTemp = pActive;
+			pActive = pActive->next;
+		}
+
+		*ppLink = pTemp;
+		ppLink = &pTemp->next;
+
+		index = pTemp - cl_tempents;
+		link = &cl_tents.links[index];
+		link->prev = prev;
+		prev = index;
+
+		if( pTemp->priority == TENTPRIORITY_LOW )
+		{
+			link->newer = cl_tents.oldest;
+			link->older = -1;
+			if( cl_tents.oldest != -1 ) cl_tents.links[cl_tents.oldest].older = index;
+			else cl_tents.newest = index;
+			cl_tents.oldest = index;
+			cl_tents.numactive[TENTPRIORITY_LOW]++;
+		}
+		else cl_tents.numactive[TENTPRIORITY_HIGH]++;
+	}
+
+	*ppLink = NULL;
 }
 
 /*
@@ -258,35 +390,234 @@ int CL_TEntAddEntity( cl_entity_t *pEntity )
 
 /*
 ==============
-CL_TEntAddEntity
+CL_FreeLowPriorityTempEnt
 
-free the first low priority tempent it finds.
+free the oldest low priority tempent
 ==============
 */
 qboolean CL_FreeLowPriorityTempEnt( void )
 {
-	TEMPENTITY	*pActive = cl_active_tents;
-	TEMPENTITY	*pPrev = NULL;
+	TEMPENTITY	*pTemp;
+	tentlink_t	*link;
+	int		index;
+
+	// client dll may unlink tents while it updates them,
+	// priority can be changed after allocation
+	if( cl_tents.updating || ( cl_tents.oldest != -1 && cl_tempents[cl_tents.oldest].priority != TENTPRIORITY_LOW ))
+		CL_RelinkTempEnts( NULL );
+
+	if(( index = cl_tents.oldest ) == -1 )
+		return false;
+
+	pTemp = &cl_tempents[index];
+	link = &cl_tents.links[index];
+
+	// remove from the active list.
+	if( link->prev != -1 ) cl_tempents[link->prev].next = pTemp->next;
+	else cl_active_tents = pTemp->next;
+	if( pTemp->next ) cl_tents.links[pTemp->next - cl_tempents].prev = link->prev;
+
+	// remove from the low priority list.
+	cl_tents.oldest = link->newer;
+	if( cl_tents.oldest != -1 ) cl_tents.links[cl_tents.oldest].older = -1;
+	else cl_tents.newest = -1;
+
+	// add to the free list.
+	pTemp->next = cl_free_tents;
+	cl_free_tents = pTemp;
+	cl_tents.evictions++;
+
+	return true;
+}
+
+/*
+==============
+CL_UpdateTempEntsEngine
+
+update tents which use only common flags, same as
+client dll does it. Returns list of tents which are
+still alive, client dll doesn't see them this frame
+==============
+*/
+static TEMPENTITY *CL_UpdateTempEntsEngine( double frametime, double client_time, double cl_gravity )
+{
+	TEMPENTITY	*pTemp, *pNext, **ppActive;
+	TEMPENTITY	*pEngine = NULL, **ppEngine = &pEngine;
+	TEMPENTITY	*pKept = NULL, **ppKept = &pKept;
+	float		gravity, gravitySlow, life;
+	pmtrace_t		trace;
+
+	// move out tents which don't need client dll
+	for( ppActive = &cl_active_tents; *ppActive; )
+	{
+		pTemp = *ppActive;
+
+		if(( pTemp->flags & ~FTENT_ENGINEUPDATE ) || pTemp->hitcallback )
+		{
+			ppActive = &pTemp->next;
+			continue;
+		}
 
-	while( pActive )
+		*ppActive = pTemp->next;
+		*ppEngine = pTemp;
+		ppEngine = &pTemp->next;
+	}
+	*ppEngine = NULL;
+
+	gravity = -frametime * cl_gravity;
+	gravitySlow = gravity * 0.5f;
+
+	for( pTemp = pEngine; pTemp; pTemp = pNext )
 	{
-		if( pActive->priority == TENTPRIORITY_LOW )
+		pNext = pTemp->next;
+		cl_tents.engineupdated++;
+
+		// don't simulate while paused
+		if( frametime <= 0.0 )
+		{
+			if( !( pTemp->flags & FTENT_NOMODEL ))
+				CL_TEntAddEntity( &pTemp->entity );
+			*ppKept = pTemp;
+			ppKept = &pTemp->next;
+			continue;
+		}
+
+		life = pTemp->die - client_time;
+
+		if( life < 0.0f )
+		{
+			qboolean	active = false;
+
+			if( pTemp->flags & FTENT_FADEOUT )
+			{
+				if( pTemp->entity.curstate.rendermode == kRenderNormal )
+					pTemp->entity.curstate.rendermode = kRenderTransTexture;
+				pTemp->entity.curstate.renderamt = pTemp->entity.baseline.renderamt * ( 1.0f + life * pTemp->fadeSpeed );
+				if( pTemp->entity.curstate.renderamt > 0 ) active = true;
+			}
+
+			if( !active )
+			{
+				// kill it
+				pTemp->next = cl_free_tents;
+				cl_free_tents = pTemp;
+				continue;
+			}
+		}
+
+		*ppKept = pTemp;
+		ppKept = &pTemp->next;
+
+		VectorCopy( pTemp->entity.origin, pTemp->entity.prevstate.origin );
+		VectorMA( pTemp->entity.origin, frametime, pTemp->entity.baseline.origin, pTemp->entity.origin );
+
+		if( pTemp->flags & FTENT_SPRANIMATE )
+		{
+			pTemp->entity.curstate.frame += frametime * pTemp->entity.curstate.framerate;
+			if( pTemp->entity.curstate.frame >= pTemp->frameMax )
+			{
+				pTemp->entity.curstate.frame = pTemp->entity.curstate.frame - (int)pTemp->entity.curstate.frame;
+
+				if( !( pTemp->flags & FTENT_SPRANIMATELOOP ))
+				{
+					// this animating sprite isn't set to loop, so destroy it.
+					pTemp->die = client_time;
+					continue;
+				}
+			}
+		}
+		else if( pTemp->flags & FTENT_SPRCYCLE )
 		{
-			// remove from the active list.
-			if( pPrev ) pPrev->next = pActive->next;
-			else cl_active_tents = pActive->next;
+			pTemp->entity.curstate.frame += frametime * 10;
+			if( pTemp->entity.curstate.frame >= pTemp->frameMax )
+				pTemp->entity.curstate.frame = pTemp->entity.curstate.frame - (int)pTemp->entity.curstate.frame;
+		}
+
+		if( pTemp->flags & FTENT_ROTATE )
+		{
+			VectorMA( pTemp->entity.angles, frametime, pTemp->entity.baseline.angles, pTemp->entity.angles );
+			VectorCopy( pTemp->entity.angles, pTemp->entity.latched.prevangles );
+		}
+
+		if( pTemp->flags & FTENT_COLLIDEWORLD )
+		{
+			trace = CL_TraceLine( pTemp->entity.prevstate.origin, pTemp->entity.origin, PM_STUDIO_BOX|PM_WORLD_ONLY );
+
+			if( trace.fraction != 1.0f )
+			{
+				float	proj, damp;
 
-			// add to the free list.
-			pActive->next = cl_free_tents;
-			cl_free_tents = pActive;
+				// place at contact point
+				VectorMA( pTemp->entity.prevstate.origin, trace.fraction * frametime, pTemp->entity.baseline.origin, pTemp->entity.origin );
 
-			return true;
+				// damp velocity
+				damp = pTemp->bounceFactor;
+
+				if( pTemp->flags & ( FTENT_GRAVITY|FTENT_SLOWGRAVITY ))
+				{
+					damp *= 0.5f;
+
+					// hit floor?
+					if( trace.plane.normal[2] > 0.9f && pTemp->entity.baseline.origin[2] <= 0 && pTemp->entity.baseline.origin[2] >= gravity * 3 )
+					{
+						damp = 0.0f; // stop
+						pTemp->flags &= ~(FTENT_ROTATE|FTENT_GRAVITY|FTENT_SLOWGRAVITY|FTENT_COLLIDEWORLD|FTENT_SMOKETRAIL);
+						pTemp->entity.angles[0] = 0.0f;
+						pTemp->entity.angles[2] = 0.0f;
+					}
+				}
+
+				if( pTemp->hitSound )
+					CL_TEntPlaySound( pTemp, damp );
+
+				if( pTemp->flags & FTENT_COLLIDEKILL )
+				{
+					// die on impact
+					pTemp->flags &= ~FTENT_FADEOUT;
+					pTemp->die = client_time;
+				}
+				else
+				{
+					// reflect velocity
+					if( damp != 0.0f )
+					{
+						proj = DotProduct( pTemp->entity.baseline.origin, trace.plane.normal );
+						VectorMA( pTemp->entity.baseline.origin, -proj * 2, trace.plane.normal, pTemp->entity.baseline.origin );
+						pTemp->entity.angles[1] = -pTemp->entity.angles[1];
+					}
+
+					if( damp != 1.0f )
+					{
+						VectorScale( pTemp->entity.baseline.origin, damp, pTemp->entity.baseline.origin );
+						VectorScale( pTemp->entity.angles, 0.9f, pTemp->entity.angles );
+					}
+				}
+			}
 		}
 
-		pPrev = pActive;
-		pActive = pActive->next;
+		if( pTemp->flags & FTENT_SMOKETRAIL )
+			CL_RocketTrail( pTemp->entity.prevstate.origin, pTemp->entity.origin, 1 );
+
+		if( pTemp->flags & FTENT_GRAVITY )
+			pTemp->entity.baseline.origin[2] += gravity;
+		else if( pTemp->flags & FTENT_SLOWGRAVITY )
+			pTemp->entity.baseline.origin[2] += gravitySlow;
+
+		// cull to PVS
+		if( !( pTemp->flags & FTENT_NOMODEL ) && !CL_TEntAddEntity( &pTemp->entity ))
+		{
+			if( !( pTemp->flags & FTENT_PERSIST ))
+			{
+				// if we can't draw it this frame, just dump it.
+				pTemp->die = client_time;
+				pTemp->flags &= ~FTENT_FADEOUT;
+			}
+		}
 	}
-	return false;
+
+	*ppKept = NULL;
+
+	return pKept;
 }
 
 
@@ -300,10 +631,45 @@ setup client callback
 */
 void CL_AddTempEnts( void )
 {
-	double	ft = cl.time - cl.oldtime;
-	float	gravity = clgame.movevars.gravity;
+	double		ft = cl.time - cl.oldtime;
+	float		gravity = clgame.movevars.gravity;
+	TEMPENTITY	*pEngine = NULL;
+	double		start, middle;
+
+	start = Sys_DoubleTime();
+	cl_tents.updating = true;
+
+	// client dll allows engine to update simple tents
+	if( cl_tent_engineupdate->integer )
+		pEngine = CL_UpdateTempEntsEngine( ft, cl.time, gravity );
 
+	middle = Sys_DoubleTime();
 	clgame.dllFuncs.pfnTempEntUpdate( ft, cl.time, gravity, &cl_free_tents, &cl_active_tents, CL_TEntAddEntity, CL_TEntPlaySound );	// callbacks
+
+	cl_tents.updating = false;
+	CL_RelinkTempEnts( pEngine );
+
+	cl_tents.enginetime += middle - start;
+	cl_tents.dlltime += Sys_DoubleTime() - middle;
+	cl_tents.frames++;
+}
+
+/*
+==============
+CL_TempEntsInfo_f
+
+==============
+*/
+void CL_TempEntsInfo_f( void )
+{
+	int	frames = max( cl_tents.frames, 1 );
+
+	Msg( "%i of %i tents active, %i low and %i high priority\n", cl_tents.numactive[0] + cl_tents.numactive[1],
+		GI->max_tents, cl_tents.numactive[TENTPRIORITY_LOW], cl_tents.numactive[TENTPRIORITY_HIGH] );
+	Msg( "%i low and %i high priority allocations, %i evicted, %i failed\n", cl_tents.allocs[TENTPRIORITY_LOW],
+		cl_tents.allocs[TENTPRIORITY_HIGH], cl_tents.evictions, cl_tents.failures );
+	Msg( "%i frames, update %.3f ms engine (%i tents), %.3f ms client dll per frame\n", cl_tents.frames,
+		cl_tents.enginetime * 1000.0 / frames, cl_tents.engineupdated / frames, cl_tents.dlltime * 1000.0 / frames );
 }
 
 /*
@@ -320,6 +686,7 @@ TEMPENTITY *CL_TempEntAlloc( const vec3_t org, model_t *pmodel )
 	if( !cl_free_tents )
 	{
 		MsgDev( D_NOTE, "Overflow %d temporary ents!\n", GI->max_tents );
+		cl_tents.failures++;
 		return NULL;
 	}
 
@@ -333,6 +700,7 @@ TEMPENTITY *CL_TempEntAlloc( const vec3_t org, model_t *pmodel )
 
 	pTemp->next = cl_active_tents;
 	cl_active_tents = pTemp;
+	CL_LinkTempEnt( pTemp );
 
 	return pTemp;
 }
@@ -350,7 +718,7 @@ TEMPENTITY *CL_TempEntAllocHigh( const vec3_t org, model_t *pmodel )
 
 	if( !cl_free_tents )
 	{
-		// no temporary ents free, so find the first active low-priority temp ent 
+		// no temporary ents free, so find the oldest active low-priority temp ent 
 		// and overwrite it.
 		CL_FreeLowPriorityTempEnt();
 	}
@@ -360,6 +728,7 @@ TEMPENTITY *CL_TempEntAllocHigh( const vec3_t org, model_t *pmodel )
 		// didn't find anything? The tent list is either full of high-priority tents
 		// or all tents in the list are still due to live for > 10 seconds. 
 		MsgDev( D_INFO, "Couldn't alloc a high priority TENT!\n" );
+		cl_tents.failures++;
 		return NULL;
 	}
 
@@ -374,6 +743,7 @@ TEMPENTITY *CL_TempEntAllocHigh( const vec3_t org, model_t *pmodel )
 
 	pTemp->next = cl_active_tents;
 	cl_active_tents = pTemp;
+	CL_LinkTempEnt( pTemp );
 
 	return pTemp;
 }
@@ -2370,6 +2740,7 @@ void CL_ClearDlights( void )
 {
 	Q_memset( cl_dlights, 0, sizeof( cl_dlights ));
 	Q_memset( cl_elights, 0, sizeof( cl_elights ));
+	R_InvalidateLightGrid();
 }
 
 /*
@@ -2393,6 +2764,7 @@ dlight_t *CL_AllocDlight( int key )
 				// reuse this light
 				Q_memset( dl, 0, sizeof( *dl ));
 				dl->key = key;
+				R_InvalidateLightGrid();
 				return dl;
 			}
 		}
@@ -2405,6 +2777,7 @@ dlight_t *CL_AllocDlight( int key )
 		{
 			Q_memset( dl, 0, sizeof( *dl ));
 			dl->key = key;
+			R_InvalidateLightGrid();
 			return dl;
 		}
 	}
@@ -2413,6 +2786,7 @@ dlight_t *CL_AllocDlight( int key )
 	dl = &cl_dlights[0];
 	Q_memset( dl, 0, sizeof( *dl ));
 	dl->key = key;
+	R_InvalidateLightGrid();
 
 	return dl;
 }
@@ -2438,6 +2812,7 @@ dlight_t *CL_AllocElight( int key )
 				// reuse this light
 				Q_memset( dl, 0, sizeof( *dl ));
 				dl->key = key;
+				R_InvalidateLightGrid();
 				return dl;
 			}
 		}
@@ -2450,6 +2825,7 @@ dlight_t *CL_AllocElight( int key )
 		{
 			Q_memset( dl, 0, sizeof( *dl ));
 			dl->key = key;
+			R_InvalidateLightGrid();
 			return dl;
 		}
 	}
@@ -2458,6 +2834,7 @@ dlight_t *CL_AllocElight( int key )
 	dl = &cl_elights[0];
 	Q_memset( dl, 0, sizeof( *dl ));
 	dl->key = key;
+	R_InvalidateLightGrid();
 
 	return dl;
 }
@@ -2649,18 +3026,11 @@ get decal global index from decalname
 */
 int CL_DecalIndexFromName( const char *name )
 {
-	int	i;
-
 	if( !name || !name[0] )
 		return 0;
 
-	// look through the loaded sprite name list for SpriteName
-	for( i = 0; i < MAX_DECALS && host.draw_decals[i+1][0]; i++ )
-	{
-		if( !Q_stricmp( name, (char *)host.draw_decals[i+1] ))
-			return i+1;
-	}
-	return 0; // invalid decal
+	// look through the loaded decal name list
+	return Precache_Find( &host.decal_hash, (char (*)[CS_SIZE])host.draw_decals, name );
 }
 
 /*
@@ -328,6 +328,8 @@ V_RenderView
 */
 void V_RenderView( void )
 {
+	double	start;
+
 	if( !cl.video_prepped || ( UI_IsVisible() && !cl.background ))
 		return; // still loading
 
@@ -336,7 +338,9 @@ void V_RenderView( void )
 		cl.force_refdef = false;
 
 		R_ClearScene ();
+		start = CL_TimeDemoBegin();
 		CL_AddEntities ();
+		CL_TimeDemoEnd( TD_INTERP, start );
 		V_SetupRefDef ();
 	}
 
@@ -386,6 +390,7 @@ V_PostRender
 void V_PostRender( void )
 {
 	qboolean	draw_2d = false;
+	double	start;
 
 	R_Set2DMode( true );
 
@@ -432,6 +437,9 @@ void V_PostRender( void )
 	}
 
 	SCR_MakeScreenShot();
+
+	start = CL_TimeDemoBegin();
 	R_EndFrame();
+	CL_TimeDemoEnd( TD_SWAP, start );
 }
 #endif // XASH_DEDICATED
@@ -150,6 +150,8 @@ typedef struct
 	char		model_precache[MAX_MODELS][CS_SIZE];
 	char		sound_precache[MAX_SOUNDS][CS_SIZE];
 	char		event_precache[MAX_EVENTS][CS_SIZE];
+	precache_t	model_hash;	// name lookup for precache tables
+	precache_t	event_hash;
 	lightstyle_t	lightstyles[MAX_LIGHTSTYLES];
 
 	int		sound_index[MAX_SOUNDS];
@@ -505,12 +507,15 @@ extern convar_t *r_oldparticles;
 extern convar_t	*cl_predict;
 extern convar_t	*cl_smooth;
 extern convar_t	*cl_showfps;
+extern convar_t	*cl_timedemo_fps;
 extern convar_t *cl_showpos;
 extern convar_t	*cl_envshot_size;
 extern convar_t	*cl_timeout;
 extern convar_t	*cl_charset;
 extern convar_t	*cl_nodelta;
 extern convar_t	*cl_interp;
+extern convar_t	*cl_lerpbatch;
+extern convar_t	*cl_tent_engineupdate;
 extern convar_t	*cl_crosshair;
 extern convar_t	*cl_testlights;
 extern convar_t	*cl_solid_players;
@@ -581,6 +586,19 @@ void CL_ClearState( void );
 //
 // cl_demo.c
 //
+typedef enum
+{
+	TD_PARSE = 0,	// CL_ReadPackets
+	TD_INTERP,	// entity interpolation
+	TD_BONES,		// studio bone setup
+	TD_WORLD,		// world surfaces
+	TD_STUDIO,	// studio models
+	TD_PARTICLES,
+	TD_SOUND,		// sound mixing
+	TD_SWAP,		// R_EndFrame
+	TD_NUMSTAGES
+} tdstage_t;
+
 void CL_StartupDemoHeader( void );
 void CL_DrawDemoRecording( void );
 void CL_WriteDemoUserCmd( int cmdnumber );
@@ -592,6 +610,10 @@ void CL_CloseDemoHeader( void );
 void CL_StopPlayback( void );
 void CL_StopRecord( void );
 void CL_PlayDemo_f( void );
+void CL_TimeDemo_f( void );
+double CL_TimeDemoBegin( void );
+void CL_TimeDemoEnd( int stage, double start );
+void CL_TimeDemoFrame( void );
 void CL_StartDemos_f( void );
 void CL_Demos_f( void );
 void CL_DeleteDemo_f( void );
@@ -730,6 +752,9 @@ qboolean CL_AddVisibleEntity( cl_entity_t *ent, int entityType );
 void CL_UpdateStudioVars( cl_entity_t *ent, entity_state_t *newstate, qboolean noInterp );
 qboolean CL_GetEntitySpatialization( int entnum, vec3_t origin, float *pradius );
 void CL_UpdateEntityFields( cl_entity_t *ent );
+void CL_InitInterpolation( void );
+void CL_FreeInterpolation( void );
+void CL_InterpBench_f( void );
 qboolean CL_IsPlayerIndex( int idx );
 
 //
@@ -762,6 +787,7 @@ void CL_InitTempEnts( void );
 void CL_ClearTempEnts( void );
 void CL_FreeTempEnts( void );
 void CL_AddTempEnts( void );
+void CL_TempEntsInfo_f( void );
 void CL_InitViewBeams( void );
 void CL_ClearViewBeams( void );
 void CL_FreeViewBeams( void );
@@ -95,6 +95,10 @@ void GL_BackendEndFrame( void )
 	case 6:
 		Q_snprintf( r_speeds_msg, sizeof( r_speeds_msg ), "%3i mirrors\n", r_stats.c_mirror_passes );
 		break;
+	case 7:
+		Q_snprintf( r_speeds_msg, sizeof( r_speeds_msg ), "%3i decals\n%3i decal batches",
+		r_stats.c_decals_drawn, r_stats.c_decal_batches );
+		break;
 	}
 
 	Q_memset( &r_stats, 0, sizeof( r_stats ));
@@ -25,6 +25,7 @@ GNU General Public License for more details.
 #define MAX_DECALCLIPVERT		32	// produced vertexes of fragmented decal
 #define DECAL_CACHEENTRY		256	// MUST BE POWER OF 2 or code below needs to change!
 #define DECAL_TRANSPARENT_THRESHOLD	230	// transparent decals draw with GL_MODULATE
+#define MAX_DECAL_BATCH_VERTS		4096	// flush batched decals when arrays are full
 
 // empirically determined constants for minimizing overalpping decals
 #define MAX_OVERLAP_DECALS		6
@@ -60,10 +61,30 @@ static float	g_DecalClipVerts2[MAX_DECALCLIPVERT][VERTEXSIZE];
 static decal_t	gDecalPool[MAX_RENDER_DECALS];
 static int	gDecalCount;
 
+// decals of visible surfaces, collected while drawing texture chains
+typedef struct
+{
+	decal_t		*decal;
+	int		sortkey;	// blend state and texture
+	int		layer;	// state changes before it in surface decal list
+	int		order;	// keep overlapping decals in the same order
+} drawdecal_t;
+
+static drawdecal_t	draw_decals[MAX_RENDER_DECALS];
+static int	num_draw_decals;
+static vec3_t	g_decalarrayverts[MAX_DECAL_BATCH_VERTS];
+static vec2_t	g_decalarraycoord[MAX_DECAL_BATCH_VERTS];
+static word	g_decalarrayelems[(MAX_DECAL_BATCH_VERTS-2)*3];
+static byte	*r_decalpool;	// decal meshes, emptied with each new level
+
 void R_ClearDecals( void )
 {
+	if( !r_decalpool ) r_decalpool = Mem_AllocPool( "Decal Meshes" );
+	else Mem_EmptyPool( r_decalpool );
+
 	Q_memset( gDecalPool, 0, sizeof( gDecalPool ));
 	gDecalCount = 0;
+	num_draw_decals = 0;
 }
 
 // unlink pdecal from any surface it's attached to
@@ -542,7 +563,7 @@ msurfmesh_t *R_DecalCreateMesh( decalinfo_t *decalinfo, decal_t *pdecal, msurfac
 	numElems = (numVerts - 2) * 3;
 
 	bufSize = sizeof( msurfmesh_t ) + numVerts * sizeof( glvert_t ) + numElems * sizeof( word );
-	buffer = Mem_Alloc( cls.mempool, bufSize );
+	buffer = Mem_Alloc( r_decalpool, bufSize );
 
 	mesh = (msurfmesh_t *)buffer;
 	buffer += sizeof( msurfmesh_t );
@@ -630,9 +651,8 @@ static void R_AddDecalToSurface( decal_t *pdecal, msurface_t *surf, decalinfo_t
 	// and will be culled, drawing and sorting
 	// together with surface
 
-	// build mesh for decal if allowed
-	if( host.features & ENGINE_BUILD_SURFMESHES )
-		pdecal->mesh = R_DecalCreateMesh( decalinfo, pdecal, surf );
+	// build mesh for decal once, so we don't need to clip it every frame
+	pdecal->mesh = R_DecalCreateMesh( decalinfo, pdecal, surf );
 }
 
 static void R_DecalCreate( decalinfo_t *decalinfo, msurface_t *surf, float x, float y )
@@ -958,6 +978,168 @@ float *R_DecalSetupVerts( decal_t *pDecal, msurface_t *surf, int texture, int *o
 	return v;
 }
 
+/*
+===============
+R_DecalSortKey
+
+decals are batched by blend mode first, then by texture
+===============
+*/
+static int R_DecalSortKey( decal_t *pDecal )
+{
+	gltexture_t	*glt = R_GetTexture( pDecal->texture );
+	int		mode;
+
+	if( glt->flags & TF_HAS_ALPHA )
+	{
+		// draw transparent decals with GL_MODULATE
+		if( glt->fogParams[3] > DECAL_TRANSPARENT_THRESHOLD )
+			mode = 0;
+		else mode = 1;
+	}
+	else mode = 2; // color decal like detail texture
+
+	return mode * MAX_TEXTURES + pDecal->texture;
+}
+
+/*
+===============
+R_DecalBatchCompare
+
+decals of one surface may overlap, so they are only moved
+across the other decals with the same state: decal goes to the
+next layer when its state differs from the previous one
+===============
+*/
+static int R_DecalBatchCompare( const drawdecal_t *a, const drawdecal_t *b )
+{
+	if( a->layer != b->layer )
+		return a->layer - b->layer;
+	if( a->sortkey != b->sortkey )
+		return a->sortkey - b->sortkey;
+	return a->order - b->order;
+}
+
+/*
+===============
+R_SetDecalBatchState
+
+setup texture and blending for a batch
+===============
+*/
+static void R_SetDecalBatchState( int sortkey )
+{
+	switch( sortkey / MAX_TEXTURES )
+	{
+	case 0:
+		pglTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+		pglBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+		break;
+	case 1:
+		pglTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE );
+		pglBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+		break;
+	default:
+		// base color is 127 127 127
+		pglTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE );
+		pglBlendFunc( GL_DST_COLOR, GL_SRC_COLOR );
+		break;
+	}
+
+	GL_Bind( XASH_TEXTURE0, sortkey % MAX_TEXTURES );
+}
+
+/*
+===============
+R_DrawDecalsBatch
+
+draw all decals collected by DrawSurfaceDecals,
+one glDrawElements call for each texture.
+Must be called before lightmaps are blended
+===============
+*/
+void R_DrawDecalsBatch( void )
+{
+	int	i, j, numVerts, numElems;
+	int	firstVert, lastkey = -1;
+	drawdecal_t	*dd;
+	decal_t	*p;
+	float	*v;
+
+	if( !num_draw_decals )
+		return;
+
+	qsort( draw_decals, num_draw_decals, sizeof( drawdecal_t ), (void *)R_DecalBatchCompare );
+
+	pglDepthMask( GL_FALSE );
+	pglEnable( GL_BLEND );
+	pglEnable( GL_POLYGON_OFFSET_FILL );
+
+	pglEnableClientState( GL_VERTEX_ARRAY );
+	pglVertexPointer( 3, GL_FLOAT, 12, g_decalarrayverts );
+	pglEnableClientState( GL_TEXTURE_COORD_ARRAY );
+	pglTexCoordPointer( 2, GL_FLOAT, 0, g_decalarraycoord );
+
+	numVerts = numElems = 0;
+
+	for( i = 0, dd = draw_decals; i < num_draw_decals; i++, dd++ )
+	{
+		p = dd->decal;
+
+		if( dd->sortkey != lastkey || numVerts + MAX_DECALCLIPVERT > MAX_DECAL_BATCH_VERTS )
+		{
+			if( numElems )
+			{
+				pglDrawElements( GL_TRIANGLES, numElems, GL_UNSIGNED_SHORT, g_decalarrayelems );
+				r_stats.c_decal_batches++;
+			}
+			numVerts = numElems = 0;
+
+			if( dd->sortkey != lastkey )
+				R_SetDecalBatchState( dd->sortkey );
+			lastkey = dd->sortkey;
+		}
+
+		v = R_DecalSetupVerts( p, p->psurface, p->texture, &j );
+		if( j < 3 ) continue;
+
+		firstVert = numVerts;
+
+		for( ; j > 0; j--, v += VERTEXSIZE, numVerts++ )
+		{
+			VectorCopy( v, g_decalarrayverts[numVerts] );
+			g_decalarraycoord[numVerts][0] = v[3];
+			g_decalarraycoord[numVerts][1] = v[4];
+		}
+
+		// decal is a convex polygon, make triangle fan
+		for( j = firstVert + 1; j < numVerts - 1; j++ )
+		{
+			g_decalarrayelems[numElems++] = firstVert;
+			g_decalarrayelems[numElems++] = j;
+			g_decalarrayelems[numElems++] = j + 1;
+		}
+	}
+
+	if( numElems )
+	{
+		pglDrawElements( GL_TRIANGLES, numElems, GL_UNSIGNED_SHORT, g_decalarrayelems );
+		r_stats.c_decal_batches++;
+	}
+
+	pglDisableClientState( GL_VERTEX_ARRAY );
+	pglDisableClientState( GL_TEXTURE_COORD_ARRAY );
+
+	pglTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+	pglBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+	pglDisable( GL_POLYGON_OFFSET_FILL );
+	pglDisable( GL_BLEND );
+	pglDepthMask( GL_TRUE );
+
+	r_stats.c_decals_drawn += num_draw_decals;
+	num_draw_decals = 0;
+}
+
 void DrawSingleDecal( decal_t *pDecal, msurface_t *fa )
 {
 	float	*v;
@@ -983,12 +1165,41 @@ void DrawSurfaceDecals( msurface_t *fa )
 {
 	decal_t		*p;
 	cl_entity_t	*e;
+	int		sortkey, lastkey, layer;
 
 	if( !fa->pdecals ) return;
 
 	e = RI.currententity;
 	ASSERT( e != NULL );
 
+	// decals on solid surfaces are collected here and drawn
+	// later with R_DrawDecalsBatch, sorted by state and texture
+	if( e->curstate.rendermode == kRenderNormal && !( fa->flags & SURF_TRANSPARENT && glState.stencilEnabled ))
+	{
+		lastkey = -1;
+		layer = 0;
+
+		for( p = fa->pdecals; p; p = p->pnext )
+		{
+			if( !p->texture ) continue;
+
+			if( num_draw_decals == MAX_RENDER_DECALS )
+				R_DrawDecalsBatch();
+
+			sortkey = R_DecalSortKey( p );
+			if( lastkey != -1 && sortkey != lastkey )
+				layer++;
+			lastkey = sortkey;
+
+			draw_decals[num_draw_decals].decal = p;
+			draw_decals[num_draw_decals].sortkey = sortkey;
+			draw_decals[num_draw_decals].layer = layer;
+			draw_decals[num_draw_decals].order = num_draw_decals;
+			num_draw_decals++;
+		}
+		return;
+	}
+
 	if( e->curstate.rendermode == kRenderNormal || e->curstate.rendermode == kRenderTransAlpha )
 	{
 		pglDepthMask( GL_FALSE );
@@ -1108,6 +1319,73 @@ void DrawSurfaceDecals( msurface_t *fa )
 		pglBlendFunc( GL_SRC_ALPHA, GL_ONE );
 }
 
+/*
+===============
+R_DecalStress_f
+
+r_decalstress [count]
+shoot random decals around the view and time the rendering
+===============
+*/
+void R_DecalStress_f( void )
+{
+	int	i, count, numDecals;
+	double	start, shoot, stop;
+	vec3_t	dir, end;
+	pmtrace_t	trace;
+
+	if( cls.state != ca_active || !cl.worldmodel )
+	{
+		Msg( "r_decalstress: not connected\n" );
+		return;
+	}
+
+	count = MAX_RENDER_DECALS;
+	if( Cmd_Argc() > 1 ) count = bound( 1, Q_atoi( Cmd_Argv( 1 )), MAX_RENDER_DECALS );
+
+	// count of decals from decals.wad
+	for( numDecals = 0; numDecals < MAX_DECALS - 1 && host.draw_decals[numDecals+1][0]; numDecals++ );
+
+	if( !numDecals )
+	{
+		Msg( "r_decalstress: no decals loaded\n" );
+		return;
+	}
+
+	start = Sys_DoubleTime();
+
+	for( i = 0; i < count; i++ )
+	{
+		dir[0] = Com_RandomFloat( -1.0f, 1.0f );
+		dir[1] = Com_RandomFloat( -1.0f, 1.0f );
+		dir[2] = Com_RandomFloat( -1.0f, 1.0f );
+		VectorNormalize( dir );
+		VectorMA( cl.refdef.vieworg, 2048.0f, dir, end );
+
+		trace = CL_TraceLine( cl.refdef.vieworg, end, PM_WORLD_ONLY );
+		if( trace.fraction == 1.0f || trace.allsolid )
+			continue;
+
+		R_DecalShoot( CL_DecalIndex( Com_RandomLong( 1, numDecals )), 0, 0, trace.endpos, 0, NULL, 1.0f );
+	}
+
+	shoot = Sys_DoubleTime();
+
+	R_BeginFrame( false );
+	for( i = 0; i < 128; i++ )
+	{
+		cl.refdef.viewangles[1] = i / 128.0 * 360.0f;
+		R_RenderFrame( &cl.refdef, true );
+	}
+	pglFinish();
+	R_EndFrame();
+
+	stop = Sys_DoubleTime();
+
+	Msg( "%i decals shot in %.2f ms, 128 frames in %f seconds (%f fps)\n",
+		count, ( shoot - start ) * 1000.0, stop - shoot, 128 / ( stop - shoot ));
+}
+
 /*
 =============================================================
 
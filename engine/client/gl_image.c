@@ -21,6 +21,37 @@ GNU General Public License for more details.
 #include "studio.h"
 
 #define TEXTURES_HASH_SIZE	64
+#define MAX_UPLOAD_QUEUE	512		// textures waiting for upload
+#define MAX_UPLOAD_QUEUE_SIZE	(64 * 1024 * 1024)	// pixel memory waiting for upload
+#define TEXTURE_CACHE_VERSION	1		// bump when resample, gamma or mips change
+
+// texture which processed by worker threads and uploaded later
+typedef struct
+{
+	gltexture_t	*tex;
+	byte		*buffer;		// base image followed by software mips
+	byte		*source;		// rgba source, same as buffer when no resample needed
+	int		numMips;		// software mip levels to build
+	qboolean		hwMips;		// driver builds the mips
+	qboolean		applyGamma;
+	size_t		size;		// base image and mips
+	assetkey_t	key;
+	assetfile_t	*cached;		// buffer points into asset cache
+	qboolean		store;		// save processed image into asset cache
+} texupload_t;
+
+// conversion settings which are hashed into the cache key
+typedef struct
+{
+	int		version;
+	int		srcWidth, srcHeight;
+	int		width, height;
+	int		numMips;
+	int		applyGamma;
+	int		isNormalMap;
+	float		gamma;
+	float		texgamma;
+} texcacheparms_t;
 
 static rgbdata_t	*R_LoadImage( char **buffer, const char *name, const byte *buf, size_t size, int *samples, texFlags_t *flags );
 static int	r_textureMinFilter = GL_LINEAR_MIPMAP_LINEAR;
@@ -32,6 +63,14 @@ static byte	*scaledImage = NULL;			// pointer to a scaled image
 static byte	data2D[BLOCK_SIZE_MAX*BLOCK_SIZE_MAX*4];	// intermediate texbuffer
 static rgbdata_t	r_image;					// generic pixelbuffer used for internal textures
 
+static struct
+{
+	texupload_t	queue[MAX_UPLOAD_QUEUE];
+	int		count;
+	size_t		size;
+	qboolean		active;
+} r_uploads;
+
 // internal tables
 static vec3_t	r_luminanceTable[256];	// RGB to luminance
 static byte	r_particleTexture[8][8] =
@@ -89,6 +128,9 @@ void GL_Bind( GLint tmu, GLenum texnum )
 	if( texnum <= 0 ) texnum = tr.defaultTexture;
 	ASSERT( texnum > 0 && texnum < MAX_TEXTURES );
 
+	// still waiting in upload queue
+	if( r_textures[texnum].pending ) texnum = tr.defaultTexture;
+
 	if( tmu != GL_KEEP_UNIT )
 		GL_SelectTexture( tmu );
 	else tmu = glState.activeTMU;
@@ -802,12 +844,13 @@ static GLenum GL_TextureFormat( gltexture_t *tex, int *samples )
 
 /*
 =================
-GL_ResampleTexture
+GL_ResampleTextureBuffer
 
-Assume input buffer is RGBA
+Assume input buffer is RGBA. Writes into given buffer
+so it can be called from worker threads
 =================
 */
-byte *GL_ResampleTexture( const byte *source, int inWidth, int inHeight, int outWidth, int outHeight, qboolean isNormalMap )
+static void GL_ResampleTextureBuffer( const byte *source, int inWidth, int inHeight, byte *dest, int outWidth, int outHeight, qboolean isNormalMap )
 {
 	uint		frac, fracStep;
 	uint		*in = (uint *)source;
@@ -817,11 +860,8 @@ byte *GL_ResampleTexture( const byte *source, int inWidth, int inHeight, int out
 	vec3_t		normal;
 	int		i, x, y;
 
-	if( !source ) return NULL;
-
-	scaledImage = Mem_Realloc( r_temppool, scaledImage, outWidth * outHeight * 4 );
 	fracStep = inWidth * 0x10000 / outWidth;
-	out = (uint *)scaledImage;
+	out = (uint *)dest;
 
 	frac = fracStep >> 2;
 	for( i = 0; i < outWidth; i++ )
@@ -886,6 +926,22 @@ byte *GL_ResampleTexture( const byte *source, int inWidth, int inHeight, int out
 			}
 		}
 	}
+}
+
+/*
+=================
+GL_ResampleTexture
+
+Assume input buffer is RGBA
+=================
+*/
+byte *GL_ResampleTexture( const byte *source, int inWidth, int inHeight, int outWidth, int outHeight, qboolean isNormalMap )
+{
+	if( !source ) return NULL;
+
+	scaledImage = Mem_Realloc( r_temppool, scaledImage, outWidth * outHeight * 4 );
+	GL_ResampleTextureBuffer( source, inWidth, inHeight, scaledImage, outWidth, outHeight, isNormalMap );
+
 	return scaledImage;
 }
 
@@ -918,12 +974,11 @@ byte *GL_ApplyGamma( const byte *source, int pixels, qboolean isNormalMap )
 =================
 GL_BuildMipMap
 
-Operates in place, quartering the size of the texture
+Quartering the size of the texture, out may be equal to in
 =================
 */
-static void GL_BuildMipMap( byte *in, int width, int height, qboolean isNormalMap )
+static void GL_BuildMipMap( byte *in, byte *out, int width, int height, qboolean isNormalMap )
 {
-	byte	*out = in;
 	vec3_t	normal;
 	int	x, y;
 
@@ -1002,7 +1057,7 @@ void GL_GenerateMipmaps( byte *buffer, rgbdata_t *pic, gltexture_t *tex, GLenum
 	{
 		// build the mipmap
 		if( tex->flags & TF_ALPHACONTRAST ) Q_memset( buffer, pic->width >> mipLevel, w * h * 4 );
-		else GL_BuildMipMap( buffer, w, h, ( tex->flags & TF_NORMALMAP ));
+		else GL_BuildMipMap( buffer, buffer, w, h, ( tex->flags & TF_NORMALMAP ));
 
 		w = (w+1)>>1;
 		h = (h+1)>>1;
@@ -1234,6 +1289,253 @@ static void GL_UploadTextureDXT( rgbdata_t *pic, gltexture_t *tex, qboolean subI
 }
 
 
+/*
+===============
+GL_ProcessUploadJob
+
+resample, gamma-correct and build software mips,
+runs on worker threads so it must not allocate anything
+===============
+*/
+static void GL_ProcessUploadJob( void *data, int index )
+{
+	texupload_t	*up = (texupload_t *)data + index;
+	gltexture_t	*tex = up->tex;
+	qboolean		isNormalMap = ( tex->flags & TF_NORMALMAP ) ? true : false;
+	byte		*in, *out;
+	int		i, w, h;
+
+	if( up->cached ) return; // already processed
+
+	if( up->source != up->buffer )
+		GL_ResampleTextureBuffer( up->source, tex->srcWidth, tex->srcHeight, up->buffer, tex->width, tex->height, isNormalMap );
+
+	if( up->applyGamma )
+		GL_ApplyGamma( up->buffer, tex->width * tex->height, isNormalMap );
+
+	// mip levels are stored one after another
+	w = tex->width;
+	h = tex->height;
+	in = up->buffer;
+
+	for( i = 0; i < up->numMips; i++ )
+	{
+		out = in + w * h * 4;
+		GL_BuildMipMap( in, out, w, h, isNormalMap );
+		w = (w+1)>>1;
+		h = (h+1)>>1;
+		in = out;
+	}
+}
+
+/*
+===============
+GL_OpenCachedUpload
+
+look for the processed image in asset cache,
+returns true if the upload may skip processing
+===============
+*/
+static qboolean GL_OpenCachedUpload( texupload_t *up, const byte *source )
+{
+	gltexture_t	*tex = up->tex;
+	texcacheparms_t	parms;
+	const byte	*data;
+	size_t		size;
+
+	Q_memset( &parms, 0, sizeof( parms ));
+	parms.version = TEXTURE_CACHE_VERSION;
+	parms.srcWidth = tex->srcWidth;
+	parms.srcHeight = tex->srcHeight;
+	parms.width = tex->width;
+	parms.height = tex->height;
+	parms.numMips = up->numMips;
+	parms.applyGamma = up->applyGamma;
+	parms.isNormalMap = ( tex->flags & TF_NORMALMAP ) ? true : false;
+
+	if( up->applyGamma )
+	{
+		parms.gamma = vid_gamma->value;
+		parms.texgamma = vid_texgamma->value;
+	}
+
+	Asset_MakeKey( &up->key, source, tex->srcWidth * tex->srcHeight * 4, &parms, sizeof( parms ));
+	up->cached = Asset_Open( "tex", &up->key, &data, &size );
+
+	if( up->cached && size == up->size )
+	{
+		// upload straight from the cache file
+		up->buffer = (byte *)data;
+		up->source = up->buffer;
+		return true;
+	}
+
+	Asset_Close( up->cached );
+	up->cached = NULL;
+	up->store = true;
+
+	return false;
+}
+
+/*
+===============
+GL_QueueUpload
+
+put the texture into upload queue, returns false if
+texture can't be processed by worker threads
+===============
+*/
+static qboolean GL_QueueUpload( rgbdata_t *pic, gltexture_t *tex, GLenum inFormat )
+{
+	texupload_t	*up;
+	size_t		size, srcSize;
+	int		w, h, numMips = 0;
+
+	if( !r_uploads.active || !pic->buffer || pic->type != PF_RGBA_32 || inFormat != GL_RGBA )
+		return false;
+
+	if( tex->target != GL_TEXTURE_2D || ( tex->flags & ( TF_NOMIPMAP|TF_DEPTHMAP|TF_FLOATDATA|TF_ALPHACONTRAST|TF_KEEP_RGBDATA )))
+		return false;
+
+	srcSize = tex->srcWidth * tex->srcHeight * 4;
+	size = tex->width * tex->height * 4;
+
+	if( pic->size < srcSize )
+		return false;
+
+	if( !GL_Support( GL_SGIS_MIPMAPS_EXT ) || ( tex->flags & TF_NORMALMAP ))
+	{
+		for( w = tex->width, h = tex->height; w > 1 || h > 1; numMips++ )
+		{
+			w = (w+1)>>1;
+			h = (h+1)>>1;
+			size += w * h * 4;
+		}
+	}
+
+	// keep source behind the mips if it will be resampled
+	if( tex->width != tex->srcWidth || tex->height != tex->srcHeight )
+		size += srcSize;
+	else srcSize = 0;
+
+	if( r_uploads.count == MAX_UPLOAD_QUEUE || r_uploads.size + size > MAX_UPLOAD_QUEUE_SIZE )
+		GL_FlushUploadQueue();
+
+	up = &r_uploads.queue[r_uploads.count++];
+	up->tex = tex;
+	up->numMips = numMips;
+	up->hwMips = ( numMips == 0 );
+	up->applyGamma = !glConfig.deviceSupportsGamma && !( tex->flags & TF_SKYSIDE );
+	up->size = size - srcSize;
+	up->cached = NULL;
+	up->store = false;
+	tex->pending = true;
+
+	if( Asset_CacheEnabled( ) && GL_OpenCachedUpload( up, pic->buffer ))
+		return true;
+
+	up->buffer = Mem_Alloc( r_temppool, size );
+
+	// source goes after the mips only when it will be resampled
+	if( srcSize ) up->source = up->buffer + size - srcSize;
+	else up->source = up->buffer;
+
+	Q_memcpy( up->source, pic->buffer, tex->srcWidth * tex->srcHeight * 4 );
+
+	r_uploads.size += size;
+
+	return true;
+}
+
+/*
+===============
+GL_FlushUploadQueue
+
+process all queued textures and upload them
+===============
+*/
+void GL_FlushUploadQueue( void )
+{
+	texupload_t	*up;
+	gltexture_t	*tex;
+	int		i, j, w, h;
+	byte		*buf;
+	uint		err;
+
+	if( !r_uploads.count )
+		return;
+
+	Sys_RunJobs( GL_ProcessUploadJob, r_uploads.queue, r_uploads.count );
+
+	for( i = 0, up = r_uploads.queue; i < r_uploads.count; i++, up++ )
+	{
+		tex = up->tex;
+		buf = up->buffer;
+		w = tex->width;
+		h = tex->height;
+
+		pglBindTexture( tex->target, tex->texnum );
+
+		if( up->hwMips ) GL_GenerateMipmaps( buf, NULL, tex, tex->target, GL_RGBA, 0, false );
+		pglTexImage2D( tex->target, 0, tex->format, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, buf );
+
+		for( j = 1; j <= up->numMips; j++ )
+		{
+			buf += w * h * 4;
+			w = (w+1)>>1;
+			h = (h+1)>>1;
+
+			pglTexImage2D( tex->target, j, tex->format, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, buf );
+			if( pglGetError( )) break; // can't create mip levels
+		}
+
+		// catch possible errors
+		err = pglGetError();
+
+		if( err != GL_NO_ERROR )
+			MsgDev( D_ERROR, "GL_FlushUploadQueue: error %x while uploading %s [%s]\n", err, tex->name, GL_Target( tex->target ));
+
+		tex->pending = false;
+
+		if( up->cached )
+		{
+			Asset_Close( up->cached );
+			continue;
+		}
+
+		if( up->store && err == GL_NO_ERROR )
+			Asset_Store( "tex", &up->key, up->buffer, up->size );
+		Mem_Free( up->buffer );
+	}
+
+	r_uploads.count = 0;
+	r_uploads.size = 0;
+}
+
+/*
+===============
+GL_BeginUploadQueue
+
+textures loaded from now are uploaded in batches,
+image processing is spread across worker threads
+===============
+*/
+void GL_BeginUploadQueue( void )
+{
+	r_uploads.active = true;
+}
+
+/*
+===============
+GL_EndUploadQueue
+===============
+*/
+void GL_EndUploadQueue( void )
+{
+	GL_FlushUploadQueue();
+	r_uploads.active = false;
+}
+
 /*
 ===============
 GL_UploadTexture
@@ -1241,7 +1543,7 @@ GL_UploadTexture
 upload texture into video memory
 ===============
 */
-static void GL_UploadTexture( rgbdata_t *pic, gltexture_t *tex, qboolean subImage, imgfilter_t *filter )
+static void GL_UploadTexture( rgbdata_t *pic, gltexture_t *tex, qboolean subImage, qboolean deferred, imgfilter_t *filter )
 {
 	byte		*buf, *data;
 	const byte	*bufend;
@@ -1252,6 +1554,10 @@ static void GL_UploadTexture( rgbdata_t *pic, gltexture_t *tex, qboolean subImag
 
 	ASSERT( pic != NULL && tex != NULL );
 
+	// queued image must be uploaded first
+	if( subImage && tex->pending )
+		GL_FlushUploadQueue();
+
 	if( pic->flags & IMAGE_DDS_FORMAT )
 	{
 		// special case for DDS textures
@@ -1386,6 +1692,13 @@ static void GL_UploadTexture( rgbdata_t *pic, gltexture_t *tex, qboolean subImag
 	else if(( tex->flags & TF_DECAL ) == TF_DECAL )
 		tex->texType = TEX_DECAL;
 
+	// let the worker threads do the rest
+	if( deferred && !subImage && GL_QueueUpload( pic, tex, inFormat ))
+	{
+		tex->size += texsize;
+		return;
+	}
+
 	// uploading texture into video memory
 	for( i = 0; i < numSides; i++ )
 	{
@@ -1551,7 +1864,7 @@ int GL_LoadTexture( const char *name, const byte *buf, size_t size, int flags, i
 		tex->texnum = tr.skyboxbasenum++;
 	else tex->texnum = i; // texnum is used for fast acess into r_textures array too
 
-	GL_UploadTexture( pic, tex, false, filter );
+	GL_UploadTexture( pic, tex, false, true, filter );
 	GL_TexFilter( tex, false ); // update texture filter, wrap etc
 
 	if(!( flags & ( TF_KEEP_8BIT|TF_KEEP_RGBDATA )))
@@ -1636,7 +1949,7 @@ int GL_LoadTextureInternal( const char *name, rgbdata_t *pic, texFlags_t flags,
 		tex->flags |= flags;
 	}
 
-	GL_UploadTexture( pic, tex, update, NULL );
+	GL_UploadTexture( pic, tex, update, false, NULL );
 	GL_TexFilter( tex, update ); // update texture filter, wrap etc
 
 	if( !update )
@@ -1745,7 +2058,7 @@ void GL_ProcessTexture( int texnum, float gamma, int topColor, int bottomColor )
 	pic = FS_CopyImage( image->original );
 	Image_Process( &pic, topColor, bottomColor, gamma, flags, NULL );
 
-	GL_UploadTexture( pic, image, true, NULL );
+	GL_UploadTexture( pic, image, true, false, NULL );
 	GL_TexFilter( image, true ); // update texture filter, wrap etc
 
 	FS_FreeImage( pic );
@@ -3826,6 +4139,9 @@ void R_FreeImage( gltexture_t *image )
 		prev = &cur->nextHash;
 	}
 
+	// queue is referencing this image
+	if( image->pending ) GL_FlushUploadQueue();
+
 	// release source
 	if( image->flags & (TF_KEEP_RGBDATA|TF_KEEP_8BIT) && image->original )
 		FS_FreeImage( image->original );
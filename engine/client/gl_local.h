@@ -84,6 +84,7 @@ typedef struct gltexture_s
 	// debug info
 	byte		texType;		// used for gl_showtextures
 	size_t		size;		// upload size for debug targets
+	qboolean		pending;		// waiting in upload queue
 
 	// detail textures stuff
 	float		xscale;
@@ -236,6 +237,9 @@ typedef struct
 
 	uint		c_mirror_passes;
 
+	uint		c_decals_drawn;
+	uint		c_decal_batches;	// glDrawElements calls for decals
+
 	uint		c_client_ents;	// entities that moved to client
 } ref_speeds_t;
 
@@ -292,6 +296,8 @@ qboolean R_CullSurface( msurface_t *surf, uint clipflags );
 void DrawSurfaceDecals( msurface_t *fa );
 float *R_DecalSetupVerts( decal_t *pDecal, msurface_t *surf, int texture, int *outCount );
 void DrawSingleDecal( decal_t *pDecal, msurface_t *fa );
+void R_DrawDecalsBatch( void );
+void R_DecalStress_f( void );
 void R_EntityRemoveDecals( model_t *mod );
 void R_ClearDecals( void );
 
@@ -320,6 +326,9 @@ void GL_FreeTexture( GLenum texnum );
 void GL_FreeImage( const char *name );
 const char *GL_Target( GLenum target );
 void R_TextureList_f( void );
+void GL_BeginUploadQueue( void );
+void GL_FlushUploadQueue( void );
+void GL_EndUploadQueue( void );
 void R_InitImages( void );
 void R_ShutdownImages( void );
 
@@ -340,6 +349,9 @@ void R_StoreEfrags( efrag_t **ppefrag, int framecount );
 // gl_rlight.c
 //
 void R_PushDlights( void );
+void R_PushBrushDlights( model_t *clmodel, const vec3_t origin, qboolean transform );
+void R_InvalidateLightGrid( void );
+int R_LightsInRadius( const vec3_t origin, float radius, qboolean entityLights, dlight_t **list );
 void R_AnimateLight( void );
 void R_GetLightSpot( vec3_t lightspot );
 void R_MarkLights( dlight_t *light, int bit, mnode_t *node );
@@ -421,6 +433,8 @@ void R_StudioInit( void );
 void Mod_LoadStudioModel( model_t *mod, const void *buffer, qboolean *loaded );
 struct mstudiotex_s *R_StudioGetTexture( cl_entity_t *e );
 void R_DrawStudioModel( cl_entity_t *e );
+void R_StudioPrepareEntities( void );
+void R_StudioClearPrepared( void );
 
 #include "wadfile.h"
 
@@ -151,6 +151,200 @@ void R_MarkLights( dlight_t *light, int bit, mnode_t *node )
 	R_MarkLights( light, bit, node->children[1] );
 }
 
+/*
+=============================================================================
+
+LIGHT GRID
+
+lights which are alive in this frame are sorted into the coarse grid
+around the view, so models and points are tested only against the
+lights from the cells they overlap instead of every light slot
+
+=============================================================================
+*/
+#define LIGHTGRID_CELLSIZE		256.0f
+#define LIGHTGRID_CELLS		16	// per axis, grid covers 4096 units around the view
+#define MAX_GRID_LIGHTS		(MAX_DLIGHTS + MAX_ELIGHTS)
+#define LIGHTMASK_WORDS		((MAX_GRID_LIGHTS + 31) >> 5)
+
+typedef struct
+{
+	uint		bits[LIGHTMASK_WORDS];
+} lightmask_t;
+
+static struct
+{
+	dlight_t		*lights[MAX_GRID_LIGHTS];	// alive lights, dlights go first
+	int		numdlights;
+	int		numlights;
+	vec3_t		origin;			// grid corner
+	lightmask_t	cells[LIGHTGRID_CELLS][LIGHTGRID_CELLS][LIGHTGRID_CELLS];
+	lightmask_t	outside;			// lights which reach out of grid
+	qboolean		valid;
+} r_lightgrid;
+
+/*
+=============
+R_LightGridRange
+
+returns false if bounds are completely outside of the grid
+=============
+*/
+static qboolean R_LightGridRange( const vec3_t origin, float radius, int lo[3], int hi[3], qboolean *outside )
+{
+	int	i;
+
+	*outside = false;
+
+	for( i = 0; i < 3; i++ )
+	{
+		lo[i] = (int)floor(( origin[i] - radius - r_lightgrid.origin[i] ) * ( 1.0f / LIGHTGRID_CELLSIZE ));
+		hi[i] = (int)floor(( origin[i] + radius - r_lightgrid.origin[i] ) * ( 1.0f / LIGHTGRID_CELLSIZE ));
+
+		if( lo[i] < 0 ) { lo[i] = 0; *outside = true; }
+		if( hi[i] > LIGHTGRID_CELLS - 1 ) { hi[i] = LIGHTGRID_CELLS - 1; *outside = true; }
+		if( lo[i] > hi[i] ) return false;
+	}
+
+	return true;
+}
+
+/*
+=============
+R_BuildLightGrid
+=============
+*/
+static void R_BuildLightGrid( void )
+{
+	int		i, x, y, z, lo[3], hi[3];
+	qboolean		outside;
+	dlight_t		*l;
+
+	Q_memset( r_lightgrid.cells, 0, sizeof( r_lightgrid.cells ));
+	Q_memset( &r_lightgrid.outside, 0, sizeof( r_lightgrid.outside ));
+	r_lightgrid.numlights = 0;
+
+	for( i = 0, l = cl_dlights; i < MAX_DLIGHTS; i++, l++ )
+	{
+		if( l->die < cl.time || !l->radius )
+			continue;
+		r_lightgrid.lights[r_lightgrid.numlights++] = l;
+	}
+
+	r_lightgrid.numdlights = r_lightgrid.numlights;
+
+	for( i = 0, l = cl_elights; i < MAX_ELIGHTS; i++, l++ )
+	{
+		if( l->die < cl.time || !l->radius )
+			continue;
+		r_lightgrid.lights[r_lightgrid.numlights++] = l;
+	}
+
+	for( i = 0; i < r_lightgrid.numlights; i++ )
+	{
+		uint	bit = BIT( i & 31 );
+		int	word = i >> 5;
+
+		l = r_lightgrid.lights[i];
+
+		if( !R_LightGridRange( l->origin, l->radius, lo, hi, &outside ))
+		{
+			r_lightgrid.outside.bits[word] |= bit;
+			continue;
+		}
+
+		if( outside ) r_lightgrid.outside.bits[word] |= bit;
+
+		for( x = lo[0]; x <= hi[0]; x++ )
+		{
+			for( y = lo[1]; y <= hi[1]; y++ )
+			{
+				for( z = lo[2]; z <= hi[2]; z++ )
+					r_lightgrid.cells[x][y][z].bits[word] |= bit;
+			}
+		}
+	}
+
+	r_lightgrid.valid = true;
+}
+
+/*
+=============
+R_InvalidateLightGrid
+
+call when lights was added or moved
+=============
+*/
+void R_InvalidateLightGrid( void )
+{
+	r_lightgrid.valid = false;
+}
+
+/*
+=============
+R_LightsInRadius
+
+collect dlights or elights which may reach the sphere,
+caller still must check the distance
+=============
+*/
+int R_LightsInRadius( const vec3_t origin, float radius, qboolean entityLights, dlight_t **list )
+{
+	int		i, x, y, z, lo[3], hi[3];
+	int		first, last, count = 0;
+	lightmask_t	mask;
+	qboolean		outside;
+
+	if( !r_lightgrid.valid )
+		R_BuildLightGrid();
+
+	if( entityLights )
+	{
+		first = r_lightgrid.numdlights;
+		last = r_lightgrid.numlights;
+	}
+	else
+	{
+		first = 0;
+		last = r_lightgrid.numdlights;
+	}
+
+	if( first == last )
+		return 0;
+
+	Q_memset( &mask, 0, sizeof( mask ));
+
+	if( R_LightGridRange( origin, radius, lo, hi, &outside ))
+	{
+		for( x = lo[0]; x <= hi[0]; x++ )
+		{
+			for( y = lo[1]; y <= hi[1]; y++ )
+			{
+				for( z = lo[2]; z <= hi[2]; z++ )
+				{
+					for( i = 0; i < LIGHTMASK_WORDS; i++ )
+						mask.bits[i] |= r_lightgrid.cells[x][y][z].bits[i];
+				}
+			}
+		}
+	}
+	else outside = true;
+
+	if( outside )
+	{
+		for( i = 0; i < LIGHTMASK_WORDS; i++ )
+			mask.bits[i] |= r_lightgrid.outside.bits[i];
+	}
+
+	for( i = first; i < last; i++ )
+	{
+		if( mask.bits[i >> 5] & BIT( i & 31 ))
+			list[count++] = r_lightgrid.lights[i];
+	}
+
+	return count;
+}
+
 /*
 =============
 R_PushDlights
@@ -162,20 +356,62 @@ void R_PushDlights( void )
 	int	i;
 
 	tr.dlightframecount = tr.framecount;
-	l = cl_dlights;
 
 	RI.currententity = clgame.entities;
 	RI.currentmodel = RI.currententity->model;
 
-	for( i = 0; i < MAX_DLIGHTS; i++, l++ )
+	// center the grid around the view
+	for( i = 0; i < 3; i++ )
+		r_lightgrid.origin[i] = RI.refdef.vieworg[i] - LIGHTGRID_CELLSIZE * ( LIGHTGRID_CELLS / 2 );
+	R_BuildLightGrid();
+
+	for( i = 0; i < r_lightgrid.numdlights; i++ )
+	{
+		l = r_lightgrid.lights[i];
+
+		if( R_CullSphere( l->origin, l->radius, 15 ))
+			continue;
+
+		R_MarkLights( l, 1U << ( l - cl_dlights ), RI.currentmodel->nodes );
+	}
+}
+
+/*
+=============
+R_PushBrushDlights
+
+mark lights which can reach the brush model,
+transformed models get light origins moved into model space
+=============
+*/
+void R_PushBrushDlights( model_t *clmodel, const vec3_t origin, qboolean transform )
+{
+	dlight_t	*l, *lights[MAX_DLIGHTS];
+	vec3_t	origin_l, oldorigin;
+	int	i, numLights;
+	mnode_t	*headnode;
+
+	headnode = clmodel->nodes + clmodel->hulls[0].firstclipnode;
+	numLights = R_LightsInRadius( origin, clmodel->radius, false, lights );
+
+	for( i = 0; i < numLights; i++ )
 	{
+		l = lights[i];
+
 		if( l->die < cl.time || !l->radius )
 			continue;
 
-		if( R_CullSphere( l->origin, l->radius, 15 ))
+		if( !transform )
+		{
+			R_MarkLights( l, 1U << ( l - cl_dlights ), headnode );
 			continue;
+		}
 
-		R_MarkLights( l, 1U << i, RI.currentmodel->nodes );
+		VectorCopy( l->origin, oldorigin ); // save lightorigin
+		Matrix4x4_VectorITransform( RI.objectMatrix, l->origin, origin_l );
+		VectorCopy( origin_l, l->origin ); // move light in bmodel space
+		R_MarkLights( l, 1U << ( l - cl_dlights ), headnode );
+		VectorCopy( oldorigin, l->origin ); // restore lightorigin
 	}
 }
 
@@ -443,13 +679,17 @@ get_light:
 	// add dynamic lights
 	if( radius && r_dynamic->integer )
 	{
-		int	lnum, total; 
+		dlight_t	*lights[MAX_DLIGHTS];
+		int	lnum, numLights, total;
 		float	f;
 
 		VectorClear( r_pointColor );
+		numLights = R_LightsInRadius( point, radius, false, lights );
 
-		for( total = lnum = 0, dl = cl_dlights; lnum < MAX_DLIGHTS; lnum++, dl++ )
+		for( total = lnum = 0; lnum < numLights; lnum++ )
 		{
+			dl = lights[lnum];
+
 			if( dl->die < cl.time || !dl->radius )
 				continue;
 
@@ -501,18 +741,22 @@ R_LightDir
 */
 void R_LightDir( const vec3_t origin, vec3_t lightDir, float radius )
 {
-	dlight_t	*dl;
+	dlight_t	*dl, *lights[MAX_GRID_LIGHTS];
 	vec3_t	dir, local;
 	float	dist;
-	int	lnum;
+	int	lnum, numLights;
 
 	VectorClear( local );
 
 	// add dynamic lights
 	if( radius > 0.0f && r_dynamic->integer )
 	{
-		for( lnum = 0, dl = cl_dlights; lnum < MAX_DLIGHTS; lnum++, dl++ )
+		numLights = R_LightsInRadius( origin, radius, false, lights );
+
+		for( lnum = 0; lnum < numLights; lnum++ )
 		{
+			dl = lights[lnum];
+
 			if( dl->die < cl.time || !dl->radius )
 				continue;
 
@@ -524,8 +768,12 @@ void R_LightDir( const vec3_t origin, vec3_t lightDir, float radius )
 			VectorAdd( local, dir, local );
 		}
 
-		for( lnum = 0, dl = cl_elights; lnum < MAX_ELIGHTS; lnum++, dl++ )
+		numLights = R_LightsInRadius( origin, radius, true, lights );
+
+		for( lnum = 0; lnum < numLights; lnum++ )
 		{
+			dl = lights[lnum];
+
 			if( dl->die < cl.time || !dl->radius )
 				continue;
 
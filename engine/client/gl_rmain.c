@@ -1087,10 +1087,16 @@ R_DrawEntitiesOnList
 */
 void R_DrawEntitiesOnList( void )
 {
+	double	start;
 	int	i;
 
 	glState.drawTrans = false;
 
+	// run CPU-side studio setup for whole list before drawing
+	start = CL_TimeDemoBegin();
+	R_StudioPrepareEntities();
+	CL_TimeDemoEnd( TD_BONES, start );
+
 	// draw the solid submodels fog
 	R_DrawFog ();
 
@@ -1112,7 +1118,9 @@ void R_DrawEntitiesOnList( void )
 			R_DrawBrushModel( RI.currententity );
 			break;
 		case mod_studio:
+			start = CL_TimeDemoBegin();
 			R_DrawStudioModel( RI.currententity );
+			CL_TimeDemoEnd( TD_STUDIO, start );
 			break;
 		case mod_sprite:
 			R_DrawSpriteModel( RI.currententity );
@@ -1158,7 +1166,9 @@ void R_DrawEntitiesOnList( void )
 			R_DrawBrushModel( RI.currententity );
 			break;
 		case mod_studio:
+			start = CL_TimeDemoBegin();
 			R_DrawStudioModel( RI.currententity );
+			CL_TimeDemoEnd( TD_STUDIO, start );
 			break;
 		case mod_sprite:
 			R_DrawSpriteModel( RI.currententity );
@@ -1174,7 +1184,10 @@ void R_DrawEntitiesOnList( void )
 	if( !RI.refdef.onlyClientDraw )
 	{
 		CL_DrawBeams( true );
+
+		start = CL_TimeDemoBegin();
 		CL_DrawParticles();
+		CL_TimeDemoEnd( TD_PARTICLES, start );
 	}
 
 	// NOTE: some mods with custom renderer may generate glErrors
@@ -1187,6 +1200,8 @@ void R_DrawEntitiesOnList( void )
 
 	R_DrawViewModel();
 
+	R_StudioClearPrepared();
+
 	CL_ExtraUpdate();
 }
 
@@ -1199,6 +1214,8 @@ RI.refdef must be set before the first call
 */
 void R_RenderScene( const ref_params_t *fd )
 {
+	double	start;
+
 	RI.refdef = *fd;
 
 	if( !cl.worldmodel && RI.drawWorld )
@@ -1213,7 +1230,10 @@ void R_RenderScene( const ref_params_t *fd )
 
 	R_MarkLeaves();
 	R_CheckFog();
+
+	start = CL_TimeDemoBegin();
 	R_DrawWorld();
+	CL_TimeDemoEnd( TD_WORLD, start );
 
 	CL_ExtraUpdate ();	// don't let sound get messed up if going slow
 
@@ -1233,6 +1253,9 @@ void R_BeginFrame( qboolean clearScene )
 {
 	glConfig.softwareGammaUpdate = false;	// in case of possible fails
 
+	// textures loaded between the frames
+	GL_FlushUploadQueue();
+
 	if(( gl_clear->integer || gl_overview->integer ) && clearScene && cls.state != ca_cinematic )
 	{
 		pglClear( GL_COLOR_BUFFER_BIT );
@@ -477,18 +477,19 @@ void R_AddDynamicLights( msurface_t *surf )
 	vec3_t		impact, origin_l;
 	mtexinfo_t	*tex;
 	dlight_t		*dl;
-	uint		*bl;
+	uint		*bl, bits;
 
 	// no dlighted surfaces here
-	if( !R_CountSurfaceDlights( surf )) return;
+	if( !surf->dlightbits ) return;
 
 	smax = (surf->extents[0] / LM_SAMPLE_SIZE) + 1;
 	tmax = (surf->extents[1] / LM_SAMPLE_SIZE) + 1;
 	tex = surf->texinfo;
 
-	for( lnum = 0; lnum < MAX_DLIGHTS; lnum++ )
+	// stop after the last light marked for this surface
+	for( lnum = 0, bits = surf->dlightbits; bits; lnum++, bits >>= 1 )
 	{
-		if(!( surf->dlightbits & BIT( lnum )))
+		if(!( bits & 1 ))
 			continue;	// not lit by this light
 
 		dl = &cl_dlights[lnum];
@@ -1291,6 +1292,7 @@ void R_DrawTextureChains( void )
 		t->texturechain = NULL;
 	}
 
+	R_DrawDecalsBatch();
 	GL_ResetFogColor();
 }
 
@@ -1391,14 +1393,12 @@ R_DrawBrushModel
 */
 void R_DrawBrushModel( cl_entity_t *e )
 {
-	int		i, k, num_sorted;
+	int		i, num_sorted;
 	qboolean		need_sort = false;
-	vec3_t		origin_l, oldorigin;
 	vec3_t		mins, maxs;
 	msurface_t	*psurf;
 	model_t		*clmodel;
 	qboolean		rotated;
-	dlight_t		*l;
 
 	if( !RI.drawWorld ) return;
 
@@ -1444,17 +1444,7 @@ void R_DrawBrushModel( cl_entity_t *e )
 	else VectorSubtract( RI.cullorigin, e->origin, tr.modelorg );
 
 	// calculate dynamic lighting for bmodel
-	for( k = 0, l = cl_dlights; k < MAX_DLIGHTS; k++, l++ )
-	{
-		if( l->die < cl.time || !l->radius )
-			continue;
-
-		VectorCopy( l->origin, oldorigin ); // save lightorigin
-		Matrix4x4_VectorITransform( RI.objectMatrix, l->origin, origin_l );
-		VectorCopy( origin_l, l->origin ); // move light in bmodel space
-		R_MarkLights( l, 1U << k, clmodel->nodes + clmodel->hulls[0].firstclipnode );
-		VectorCopy( oldorigin, l->origin ); // restore lightorigin
-	}
+	R_PushBrushDlights( clmodel, e->origin, true );
 
 	// setup the rendermode
 	GL_SetRenderMode( e->curstate.rendermode );
@@ -1515,6 +1505,8 @@ void R_DrawBrushModel( cl_entity_t *e )
 	for( i = 0; i < num_sorted; i++ )
 		R_RenderBrushPoly( world.draw_surfaces[i] );
 
+	R_DrawDecalsBatch();
+
 	if( e->curstate.rendermode == kRenderTransColor )
 		pglEnable( GL_TEXTURE_2D );
 
@@ -1542,22 +1534,16 @@ Merge static model brushes with world surfaces
 */
 void R_DrawStaticModel( cl_entity_t *e )
 {
-	int		i, k;
+	int		i;
 	model_t		*clmodel;
 	msurface_t	*psurf;
-	dlight_t		*l;
 	
 	clmodel = e->model;
 	if( R_CullBox( clmodel->mins, clmodel->maxs, RI.clipFlags ))
 		return;
 
 	// calculate dynamic lighting for bmodel
-	for( k = 0, l = cl_dlights; k < MAX_DLIGHTS; k++, l++ )
-	{
-		if( l->die < cl.time || !l->radius )
-			continue;
-		R_MarkLights( l, 1U << k, clmodel->nodes + clmodel->hulls[0].firstclipnode );
-	}
+	R_PushBrushDlights( clmodel, e->origin, false );
 
 	psurf = &clmodel->surfaces[clmodel->firstmodelsurface];
 	for( i = 0; i < clmodel->nummodelsurfaces; i++, psurf++ )
@@ -2000,9 +1986,7 @@ void R_MarkLeaves( void )
 
 		Q_memcpy( visbytes, vis, longs << 2 );
 		vis = Mod_LeafPVS( r_viewleaf2, cl.worldmodel );
-
-		for( i = 0; i < longs; i++ )
-			((int *)visbytes)[i] |= ((int *)vis)[i];
+		Mod_MergeVis( visbytes, vis, longs << 2 );
 
 		vis = visbytes;
 	}
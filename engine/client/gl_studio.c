@@ -79,6 +79,31 @@ typedef struct sortedmesh_s
 	int		flags;			// face flags
 } sortedmesh_t;
 
+typedef struct studiobones_s
+{
+	cl_entity_t	*entity;
+	studiohdr_t	*header;
+	player_info_t	*playerinfo;		// gait source, may be NULL
+	qboolean		interp;
+	matrix3x4		rotation;
+	matrix3x4		*bones;			// output bonetransform
+	matrix3x4		*lights;			// output lighttransform
+	float		frame;			// estimated frame
+	qboolean		storeframe;		// frame should be saved as latched.prevframe
+} studiobones_t;
+
+// bones computed by R_StudioPrepareEntities
+typedef struct studioprepared_s
+{
+	studiobones_t	b;
+	qboolean		valid;
+	matrix3x4		bones[MAXSTUDIOBONES];
+	matrix3x4		lights[MAXSTUDIOBONES];
+} studioprepared_t;
+
+#define STUDIO_PREPARED_HASHSIZE	2048	// must be power of two and greater than 2 * MAX_VISIBLE_PACKET
+#define STUDIO_PREPARED_HASH( e )	((((size_t)(e)) >> 4 ) * 2654435761U & ( STUDIO_PREPARED_HASHSIZE - 1 ))
+
 convar_t			*r_studio_lerping;
 convar_t			*r_studio_lambert;
 convar_t			*r_studio_lighting;
@@ -86,10 +111,12 @@ convar_t			*r_studio_sort_textures;
 convar_t			*r_studio_drawelements;
 convar_t			*r_drawviewmodel;
 convar_t			*r_customdraw_playermodel;
+convar_t			*r_studio_threads;
 convar_t			*cl_himodels;
 cvar_t			r_shadows = { "r_shadows", "0", 0, 0 };	// dead cvar. especially disabled
 cvar_t			r_shadowalpha = { "r_shadowalpha", "0.5", 0, 0.8f };
 static r_studio_interface_t	*pStudioDraw;
+static r_studio_interface_t	gStudioDraw;
 static float		aliasXscale, aliasYscale;	// software renderer scale
 static matrix3x4		g_aliastransform;		// software renderer transform
 static matrix3x4		g_rotationmatrix;
@@ -113,6 +140,10 @@ static uint		g_nNumArrayVerts;
 static uint		g_nNumArrayElems;
 static vec3_t		g_lightvalues[MAXSTUDIOVERTS];
 static studiolight_t	g_studiolight;
+static studioprepared_t	*g_prepared;
+static int		g_numPrepared;
+static int		g_maxPrepared;
+static int		g_preparedHash[STUDIO_PREPARED_HASHSIZE];	// index + 1 into g_prepared
 char			g_nCachedBoneNames[MAXSTUDIOBONES][32];
 int			g_nCachedBones;		// number of bones in cache
 int			g_nStudioCount;		// for chrome update
@@ -154,6 +185,7 @@ void R_StudioInit( void )
 	r_studio_drawelements = Cvar_Get( "r_studio_drawelements", "1", CVAR_ARCHIVE, "Use glDrawElements for studio render" );
 	// NOTE: some mods with custom studiomodel renderer may cause error when menu trying draw player model out of the loaded game
 	r_customdraw_playermodel = Cvar_Get( "r_customdraw_playermodel", "0", CVAR_ARCHIVE, "allow to drawing playermodel in menu with client renderer" );
+	r_studio_threads = Cvar_Get( "r_studio_threads", "1", CVAR_ARCHIVE, "compute bones of visible studio models on the worker threads" );
 
 	// recalc software X and Y alias scale (this stuff is used only by HL software renderer but who knews...)
 	pixelAspect = ((float)scr_height->integer / (float)scr_width->integer);
@@ -590,11 +622,11 @@ StudioEstimateFrame
 
 ====================
 */
-float R_StudioEstimateFrame( cl_entity_t *e, mstudioseqdesc_t *pseqdesc )
+float R_StudioEstimateFrame( cl_entity_t *e, mstudioseqdesc_t *pseqdesc, qboolean interp )
 {
 	double	dfdt, f;
 	
-	if( m_fDoInterp )
+	if( interp )
 	{
 		if( RI.refdef.time < e->curstate.animtime ) dfdt = 0.0;
 		else dfdt = (RI.refdef.time - e->curstate.animtime) * e->curstate.framerate * pseqdesc->fps;
@@ -627,11 +659,11 @@ StudioEstimateInterpolant
 
 ====================
 */
-float R_StudioEstimateInterpolant( cl_entity_t *e )
+float R_StudioEstimateInterpolant( cl_entity_t *e, qboolean interp )
 {
 	float	dadt = 1.0f;
 
-	if( m_fDoInterp && ( e->curstate.animtime >= e->latched.prevanimtime + 0.01f ))
+	if( interp && ( e->curstate.animtime >= e->latched.prevanimtime + 0.01f ))
 	{
 		dadt = ( RI.refdef.time - e->curstate.animtime ) / 0.1f;
 		if( dadt > 2.0f ) dadt = 2.0f;
@@ -645,7 +677,7 @@ StudioGetAnim
 
 ====================
 */
-mstudioanim_t *R_StudioGetAnim( model_t *m_pSubModel, mstudioseqdesc_t *pseqdesc )
+mstudioanim_t *R_StudioGetAnim( studiohdr_t *phdr, model_t *m_pSubModel, mstudioseqdesc_t *pseqdesc )
 {
 	mstudioseqgroup_t	*pseqgroup;
 	fs_offset_t		filesize;
@@ -654,12 +686,12 @@ mstudioanim_t *R_StudioGetAnim( model_t *m_pSubModel, mstudioseqdesc_t *pseqdesc
 
 	ASSERT( m_pSubModel );	
 
-	pseqgroup = (mstudioseqgroup_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqgroupindex) + pseqdesc->seqgroup;
+	pseqgroup = (mstudioseqgroup_t *)((byte *)phdr + phdr->seqgroupindex) + pseqdesc->seqgroup;
 	if( pseqdesc->seqgroup == 0 )
 #ifdef __amd64__
-		return (mstudioanim_t *)((byte *)m_pStudioHeader + pseqdesc->animindex);
+		return (mstudioanim_t *)((byte *)phdr + pseqdesc->animindex);
 #else
-		return (mstudioanim_t *)((byte *)m_pStudioHeader + pseqgroup->data + pseqdesc->animindex);
+		return (mstudioanim_t *)((byte *)phdr + pseqgroup->data + pseqdesc->animindex);
 #endif
 
 	paSequences = (cache_user_t *)m_pSubModel->submodels;
@@ -747,15 +779,15 @@ StudioCalcBoneAdj
 
 ====================
 */
-void R_StudioCalcBoneAdj( float dadt, float *adj, const byte *pcontroller1, const byte *pcontroller2, byte mouthopen )
+void R_StudioCalcBoneAdj( studiohdr_t *phdr, float dadt, float *adj, const byte *pcontroller1, const byte *pcontroller2, byte mouthopen )
 {
 	mstudiobonecontroller_t	*pbonecontroller;
 	float			value = 0.0f;
 	int			i, j;
 
-	pbonecontroller = (mstudiobonecontroller_t *)((byte *)m_pStudioHeader + m_pStudioHeader->bonecontrollerindex);
+	pbonecontroller = (mstudiobonecontroller_t *)((byte *)phdr + phdr->bonecontrollerindex);
 
-	for (j = 0; j < m_pStudioHeader->numbonecontrollers; j++)
+	for (j = 0; j < phdr->numbonecontrollers; j++)
 	{
 		i = pbonecontroller[j].index;
 
@@ -962,7 +994,7 @@ StudioSlerpBones
 
 ====================
 */
-void R_StudioSlerpBones( vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s )
+void R_StudioSlerpBones( int numbones, vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[][3], float s )
 {
 	int	i;
 	vec4_t	q3;
@@ -971,7 +1003,7 @@ void R_StudioSlerpBones( vec4_t q1[], float pos1[][3], vec4_t q2[], float pos2[]
 	s = bound( 0.0f, s, 1.0f );
 	s1 = 1.0f - s; // backlerp
 
-	for( i = 0; i < m_pStudioHeader->numbones; i++ )
+	for( i = 0; i < numbones; i++ )
 	{
 		QuaternionSlerp( q1[i], q2[i], s, q3 );
 		q1[i][0] = q3[0];
@@ -990,7 +1022,7 @@ StudioCalcRotations
 
 ====================
 */
-void R_StudioCalcRotations( cl_entity_t *e, float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f )
+void R_StudioCalcRotations( studiohdr_t *phdr, qboolean interp, cl_entity_t *e, float pos[][3], vec4_t *q, mstudioseqdesc_t *pseqdesc, mstudioanim_t *panim, float f )
 {
 	int		i, frame;
 	mstudiobone_t	*pbone;
@@ -1011,15 +1043,15 @@ void R_StudioCalcRotations( cl_entity_t *e, float pos[][3], vec4_t *q, mstudiose
 
 	frame = (int)f;
 
-	dadt = R_StudioEstimateInterpolant( e );
+	dadt = R_StudioEstimateInterpolant( e, interp );
 	s = (f - frame);
 
 	// add in programtic controllers
-	pbone = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
+	pbone = (mstudiobone_t *)((byte *)phdr + phdr->boneindex);
 
-	R_StudioCalcBoneAdj( dadt, adj, e->curstate.controller, e->latched.prevcontroller, e->mouth.mouthopen );
+	R_StudioCalcBoneAdj( phdr, dadt, adj, e->curstate.controller, e->latched.prevcontroller, e->mouth.mouthopen );
 
-	for( i = 0; i < m_pStudioHeader->numbones; i++, pbone++, panim++ ) 
+	for( i = 0; i < phdr->numbones; i++, pbone++, panim++ ) 
 	{
 		R_StudioCalcBoneQuaterion( frame, s, pbone, panim, adj, q[i] );
 		R_StudioCalcBonePosition( frame, s, pbone, panim, adj, pos[i] );
@@ -1059,10 +1091,10 @@ void R_StudioMergeBones( cl_entity_t *e, model_t *m_pSubModel )
 
 	pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + e->curstate.sequence;
 
-	f = R_StudioEstimateFrame( e, pseqdesc );
+	f = R_StudioEstimateFrame( e, pseqdesc, m_fDoInterp );
 
-	panim = R_StudioGetAnim( m_pSubModel, pseqdesc );
-	R_StudioCalcRotations( e, pos, q, pseqdesc, panim, f );
+	panim = R_StudioGetAnim( m_pStudioHeader, m_pSubModel, pseqdesc );
+	R_StudioCalcRotations( m_pStudioHeader, m_fDoInterp, e, pos, q, pseqdesc, panim, f );
 	pbones = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
 
 	for( i = 0; i < m_pStudioHeader->numbones; i++ ) 
@@ -1099,126 +1131,127 @@ void R_StudioMergeBones( cl_entity_t *e, model_t *m_pSubModel )
 
 /*
 ====================
-StudioSetupBones
+StudioBuildBones
 
+compute bone transforms from the animation data.
+touches nothing but the passed studiobones_t so it's
+safe to run on the worker threads
 ====================
 */
-void R_StudioSetupBones( cl_entity_t *e )
+static void R_StudioBuildBones( studiobones_t *b )
 {
+	cl_entity_t	*e = b->entity;
+	studiohdr_t	*phdr = b->header;
 	double		f;
 	mstudiobone_t	*pbones;
 	mstudioseqdesc_t	*pseqdesc;
 	mstudioanim_t	*panim;
 	matrix3x4		bonematrix;
-	static vec3_t	pos[MAXSTUDIOBONES];
-	static vec4_t	q[MAXSTUDIOBONES];
-	static vec3_t	pos2[MAXSTUDIOBONES];
-	static vec4_t	q2[MAXSTUDIOBONES];
-	static vec3_t	pos3[MAXSTUDIOBONES];
-	static vec4_t	q3[MAXSTUDIOBONES];
-	static vec3_t	pos4[MAXSTUDIOBONES];
-	static vec4_t	q4[MAXSTUDIOBONES];
+	vec3_t		pos[MAXSTUDIOBONES];
+	vec4_t		q[MAXSTUDIOBONES];
+	vec3_t		pos2[MAXSTUDIOBONES];
+	vec4_t		q2[MAXSTUDIOBONES];
+	vec3_t		pos3[MAXSTUDIOBONES];
+	vec4_t		q3[MAXSTUDIOBONES];
+	vec3_t		pos4[MAXSTUDIOBONES];
+	vec4_t		q4[MAXSTUDIOBONES];
 	int		i, j;
 
-	if( e->curstate.sequence >= m_pStudioHeader->numseq )
-		e->curstate.sequence = 0;
-
-	pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + e->curstate.sequence;
+	pseqdesc = (mstudioseqdesc_t *)((byte *)phdr + phdr->seqindex) + e->curstate.sequence;
 
-	f = R_StudioEstimateFrame( e, pseqdesc );
+	f = R_StudioEstimateFrame( e, pseqdesc, b->interp );
 
-	panim = R_StudioGetAnim( e->model, pseqdesc );
-	R_StudioCalcRotations( e, pos, q, pseqdesc, panim, f );
+	panim = R_StudioGetAnim( phdr, e->model, pseqdesc );
+	R_StudioCalcRotations( phdr, b->interp, e, pos, q, pseqdesc, panim, f );
 
 	if( pseqdesc->numblends > 1 )
 	{
 		float	s;
 		float	dadt;
 
-		panim += m_pStudioHeader->numbones;
-		R_StudioCalcRotations( e, pos2, q2, pseqdesc, panim, f );
+		panim += phdr->numbones;
+		R_StudioCalcRotations( phdr, b->interp, e, pos2, q2, pseqdesc, panim, f );
 
-		dadt = R_StudioEstimateInterpolant( e );
+		dadt = R_StudioEstimateInterpolant( e, b->interp );
 		s = (e->curstate.blending[0] * dadt + e->latched.prevblending[0] * (1.0f - dadt)) / 255.0f;
 
-		R_StudioSlerpBones( q, pos, q2, pos2, s );
+		R_StudioSlerpBones( phdr->numbones, q, pos, q2, pos2, s );
 
 		if( pseqdesc->numblends == 4 )
 		{
-			panim += m_pStudioHeader->numbones;
-			R_StudioCalcRotations( e, pos3, q3, pseqdesc, panim, f );
+			panim += phdr->numbones;
+			R_StudioCalcRotations( phdr, b->interp, e, pos3, q3, pseqdesc, panim, f );
 
-			panim += m_pStudioHeader->numbones;
-			R_StudioCalcRotations( e, pos4, q4, pseqdesc, panim, f );
+			panim += phdr->numbones;
+			R_StudioCalcRotations( phdr, b->interp, e, pos4, q4, pseqdesc, panim, f );
 
 			s = (e->curstate.blending[0] * dadt + e->latched.prevblending[0] * (1.0f - dadt)) / 255.0f;
-			R_StudioSlerpBones( q3, pos3, q4, pos4, s );
+			R_StudioSlerpBones( phdr->numbones, q3, pos3, q4, pos4, s );
 
 			s = (e->curstate.blending[1] * dadt + e->latched.prevblending[1] * (1.0f - dadt)) / 255.0f;
-			R_StudioSlerpBones( q, pos, q3, pos3, s );
+			R_StudioSlerpBones( phdr->numbones, q, pos, q3, pos3, s );
 		}
 	}
 
-	if( m_fDoInterp && e->latched.sequencetime && ( e->latched.sequencetime + 0.2f > RI.refdef.time) && ( e->latched.prevsequence < m_pStudioHeader->numseq ))
+	if( b->interp && e->latched.sequencetime && ( e->latched.sequencetime + 0.2f > RI.refdef.time) && ( e->latched.prevsequence < phdr->numseq ))
 	{
 		// blend from last sequence
-		static vec3_t	pos1b[MAXSTUDIOBONES];
-		static vec4_t	q1b[MAXSTUDIOBONES];
-		float		s;
+		vec3_t	pos1b[MAXSTUDIOBONES];
+		vec4_t	q1b[MAXSTUDIOBONES];
+		float	s;
 
-		pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + e->latched.prevsequence;
-		panim = R_StudioGetAnim( e->model, pseqdesc );
+		pseqdesc = (mstudioseqdesc_t *)((byte *)phdr + phdr->seqindex) + e->latched.prevsequence;
+		panim = R_StudioGetAnim( phdr, e->model, pseqdesc );
 
 		// clip prevframe
-		R_StudioCalcRotations( e, pos1b, q1b, pseqdesc, panim, e->latched.prevframe );
+		R_StudioCalcRotations( phdr, b->interp, e, pos1b, q1b, pseqdesc, panim, e->latched.prevframe );
 
 		if( pseqdesc->numblends > 1 )
 		{
-			panim += m_pStudioHeader->numbones;
-			R_StudioCalcRotations( e, pos2, q2, pseqdesc, panim, e->latched.prevframe );
+			panim += phdr->numbones;
+			R_StudioCalcRotations( phdr, b->interp, e, pos2, q2, pseqdesc, panim, e->latched.prevframe );
 
 			s = (e->latched.prevseqblending[0]) / 255.0f;
-			R_StudioSlerpBones( q1b, pos1b, q2, pos2, s );
+			R_StudioSlerpBones( phdr->numbones, q1b, pos1b, q2, pos2, s );
 
 			if( pseqdesc->numblends == 4 )
 			{
-				panim += m_pStudioHeader->numbones;
-				R_StudioCalcRotations( e, pos3, q3, pseqdesc, panim, e->latched.prevframe );
+				panim += phdr->numbones;
+				R_StudioCalcRotations( phdr, b->interp, e, pos3, q3, pseqdesc, panim, e->latched.prevframe );
 
-				panim += m_pStudioHeader->numbones;
-				R_StudioCalcRotations( e, pos4, q4, pseqdesc, panim, e->latched.prevframe );
+				panim += phdr->numbones;
+				R_StudioCalcRotations( phdr, b->interp, e, pos4, q4, pseqdesc, panim, e->latched.prevframe );
 
 				s = (e->latched.prevseqblending[0]) / 255.0f;
-				R_StudioSlerpBones( q3, pos3, q4, pos4, s );
+				R_StudioSlerpBones( phdr->numbones, q3, pos3, q4, pos4, s );
 
 				s = (e->latched.prevseqblending[1]) / 255.0f;
-				R_StudioSlerpBones( q1b, pos1b, q3, pos3, s );
+				R_StudioSlerpBones( phdr->numbones, q1b, pos1b, q3, pos3, s );
 			}
 		}
 
 		s = 1.0f - ( RI.refdef.time - e->latched.sequencetime ) / 0.2f;
-		R_StudioSlerpBones( q, pos, q1b, pos1b, s );
+		R_StudioSlerpBones( phdr->numbones, q, pos, q1b, pos1b, s );
+		b->storeframe = false;
 	}
 	else
 	{
 		// store prevframe otherwise
-		e->latched.prevframe = f;
+		b->storeframe = true;
 	}
 
-	pbones = (mstudiobone_t *)((byte *)m_pStudioHeader + m_pStudioHeader->boneindex);
+	b->frame = f;
+	pbones = (mstudiobone_t *)((byte *)phdr + phdr->boneindex);
 
 	// calc gait animation
-	if( m_pPlayerInfo && m_pPlayerInfo->gaitsequence != 0 )
+	if( b->playerinfo && b->playerinfo->gaitsequence != 0 )
 	{
-		if( m_pPlayerInfo->gaitsequence >= m_pStudioHeader->numseq ) 
-			m_pPlayerInfo->gaitsequence = 0;
-
-		pseqdesc = (mstudioseqdesc_t *)((byte *)m_pStudioHeader + m_pStudioHeader->seqindex) + m_pPlayerInfo->gaitsequence;
+		pseqdesc = (mstudioseqdesc_t *)((byte *)phdr + phdr->seqindex) + b->playerinfo->gaitsequence;
 
-		panim = R_StudioGetAnim( e->model, pseqdesc );
-		R_StudioCalcRotations( e, pos2, q2, pseqdesc, panim, m_pPlayerInfo->gaitframe );
+		panim = R_StudioGetAnim( phdr, e->model, pseqdesc );
+		R_StudioCalcRotations( phdr, b->interp, e, pos2, q2, pseqdesc, panim, b->playerinfo->gaitframe );
 
-		for( i = 0; i < m_pStudioHeader->numbones; i++ )
+		for( i = 0; i < phdr->numbones; i++ )
 		{
 			for( j = 0; j < LEGS_BONES_COUNT; j++ )
 			{
@@ -1234,26 +1267,273 @@ void R_StudioSetupBones( cl_entity_t *e )
 		}
 	}
 
-	for( i = 0; i < m_pStudioHeader->numbones; i++ ) 
+	for( i = 0; i < phdr->numbones; i++ ) 
 	{
 		Matrix3x4_FromOriginQuat( bonematrix, q[i], pos[i] );
 
 		if( pbones[i].parent == -1 ) 
 		{
-			Matrix3x4_ConcatTransforms( g_bonestransform[i], g_rotationmatrix, bonematrix );
-			Matrix3x4_Copy( g_lighttransform[i], g_bonestransform[i] );
+			Matrix3x4_ConcatTransforms( b->bones[i], b->rotation, bonematrix );
+			Matrix3x4_Copy( b->lights[i], b->bones[i] );
 
 			// apply client-side effects to the transformation matrix
-			R_StudioFxTransform( e, g_bonestransform[i] );
+			R_StudioFxTransform( e, b->bones[i] );
 		} 
 		else
 		{
-			Matrix3x4_ConcatTransforms( g_bonestransform[i], g_bonestransform[pbones[i].parent], bonematrix );
-			Matrix3x4_ConcatTransforms( g_lighttransform[i], g_lighttransform[pbones[i].parent], bonematrix );
+			Matrix3x4_ConcatTransforms( b->bones[i], b->bones[pbones[i].parent], bonematrix );
+			Matrix3x4_ConcatTransforms( b->lights[i], b->lights[pbones[i].parent], bonematrix );
 		}
 	}
 }
 
+/*
+====================
+StudioPreparedSlot
+
+hash lookup of the entity prepared in this pass
+====================
+*/
+static studioprepared_t *R_StudioPreparedSlot( cl_entity_t *e )
+{
+	uint	h;
+
+	if( !g_numPrepared )
+		return NULL;
+
+	for( h = STUDIO_PREPARED_HASH( e ); g_preparedHash[h] != 0; h = ( h + 1 ) & ( STUDIO_PREPARED_HASHSIZE - 1 ))
+	{
+		studioprepared_t	*slot = &g_prepared[g_preparedHash[h] - 1];
+
+		if( slot->b.entity == e )
+			return slot;
+	}
+	return NULL;
+}
+
+/*
+====================
+StudioGetPreparedBones
+
+copy the bones computed by R_StudioPrepareEntities
+if they were built from the same inputs
+====================
+*/
+static qboolean R_StudioGetPreparedBones( cl_entity_t *e )
+{
+	studioprepared_t	*slot = R_StudioPreparedSlot( e );
+
+	if( !slot || !slot->valid )
+		return false;
+
+	slot->valid = false; // use it only once
+
+	if( slot->b.header != m_pStudioHeader || slot->b.interp != m_fDoInterp || m_pPlayerInfo != NULL )
+		return false;
+
+	// entity state was changed between prepare and draw
+	if( Q_memcmp( slot->b.rotation, g_rotationmatrix, sizeof( matrix3x4 )))
+		return false;
+
+	Q_memcpy( g_bonestransform, slot->bones, sizeof( matrix3x4 ) * m_pStudioHeader->numbones );
+	Q_memcpy( g_lighttransform, slot->lights, sizeof( matrix3x4 ) * m_pStudioHeader->numbones );
+
+	if( slot->b.storeframe )
+		e->latched.prevframe = slot->b.frame;
+
+	return true;
+}
+
+/*
+====================
+StudioBuildBonesJob
+
+====================
+*/
+static void R_StudioBuildBonesJob( void *data, int index )
+{
+	studioprepared_t	*slot = (studioprepared_t *)data + index;
+
+	R_StudioBuildBones( &slot->b );
+	slot->valid = true;
+}
+
+/*
+====================
+StudioPrepareEntity
+
+main thread part: set up transform, cull and
+preload animations for the job. Returns false
+if entity should be processed in usual way
+====================
+*/
+static qboolean R_StudioPrepareEntity( cl_entity_t *e, studioprepared_t *slot )
+{
+	studiohdr_t	*phdr;
+	mstudioseqdesc_t	*pseqdesc;
+
+	if( !e->model || e->model->type != mod_studio || e->player )
+		return false;
+
+	// these ones are not cached or need random numbers
+	switch( e->curstate.renderfx )
+	{
+	case kRenderFxDeadPlayer:
+	case kRenderFxDistort:
+	case kRenderFxHologram:
+	case kRenderFxExplode:
+		return false;
+	}
+
+	if( e->curstate.movetype == MOVETYPE_FOLLOW )
+		return false;
+
+	if(( phdr = (studiohdr_t *)Mod_Extradata( e->model )) == NULL )
+		return false;
+
+	if( phdr->numbodyparts == 0 || phdr->numbones > MAXSTUDIOBONES )
+		return false;
+
+	if( e->curstate.sequence >= phdr->numseq )
+		e->curstate.sequence = 0;
+
+	RI.currententity = e;
+	RI.currentmodel = e->model;
+	m_pStudioHeader = phdr;
+	m_fDoInterp = r_studio_lerping->integer && !( e->curstate.effects & EF_NOINTERP );
+
+	R_StudioSetUpTransform( e );
+
+	// don't waste time on culled models
+	if( R_CullStudioModel( e ))
+		return false;
+
+	// sequence groups are loaded from disk on first use, do it here
+	pseqdesc = (mstudioseqdesc_t *)((byte *)phdr + phdr->seqindex) + e->curstate.sequence;
+	R_StudioGetAnim( phdr, e->model, pseqdesc );
+
+	if( m_fDoInterp && e->latched.sequencetime && ( e->latched.sequencetime + 0.2f > RI.refdef.time ) && ( e->latched.prevsequence < phdr->numseq ))
+	{
+		pseqdesc = (mstudioseqdesc_t *)((byte *)phdr + phdr->seqindex) + e->latched.prevsequence;
+		R_StudioGetAnim( phdr, e->model, pseqdesc );
+	}
+
+	slot->b.entity = e;
+	slot->b.header = phdr;
+	slot->b.playerinfo = NULL;
+	slot->b.interp = m_fDoInterp;
+	slot->b.bones = slot->bones;
+	slot->b.lights = slot->lights;
+	Matrix3x4_Copy( slot->b.rotation, g_rotationmatrix );
+	slot->valid = false;
+
+	return true;
+}
+
+/*
+====================
+R_StudioPrepareEntities
+
+compute bones for all visible studio models at once,
+spreading the work across the worker threads.
+GL submission still happens later in R_DrawEntitiesOnList
+====================
+*/
+void R_StudioPrepareEntities( void )
+{
+	cl_entity_t	*e;
+	int		i, count;
+	uint		h;
+
+	R_StudioClearPrepared();
+
+	if( !r_studio_threads->integer || Sys_NumThreads() <= 1 )
+		return;
+
+	// client.dll renderer computes bones by itself
+	if( pStudioDraw != &gStudioDraw || RI.params & RP_ENVVIEW || RI.refdef.onlyClientDraw )
+		return;
+
+	count = tr.num_solid_entities + tr.num_trans_entities;
+	if( count < 2 ) return;
+
+	if( count > g_maxPrepared )
+	{
+		g_prepared = Mem_Realloc( r_temppool, g_prepared, sizeof( studioprepared_t ) * count );
+		g_maxPrepared = count;
+	}
+
+	for( i = 0; i < count; i++ )
+	{
+		if( i < tr.num_solid_entities )
+			e = tr.solid_entities[i];
+		else e = tr.trans_entities[i - tr.num_solid_entities];
+
+		if( !R_StudioPrepareEntity( e, &g_prepared[g_numPrepared] ))
+			continue;
+
+		h = STUDIO_PREPARED_HASH( e );
+		while( g_preparedHash[h] != 0 )
+			h = ( h + 1 ) & ( STUDIO_PREPARED_HASHSIZE - 1 );
+		g_preparedHash[h] = ++g_numPrepared;
+	}
+
+	RI.currententity = NULL;
+	RI.currentmodel = NULL;
+
+	Sys_RunJobs( R_StudioBuildBonesJob, g_prepared, g_numPrepared );
+}
+
+/*
+====================
+R_StudioClearPrepared
+
+forget bones of the previous pass
+====================
+*/
+void R_StudioClearPrepared( void )
+{
+	if( !g_numPrepared )
+		return;
+
+	Q_memset( g_preparedHash, 0, sizeof( g_preparedHash ));
+	g_numPrepared = 0;
+}
+
+/*
+====================
+StudioSetupBones
+
+====================
+*/
+void R_StudioSetupBones( cl_entity_t *e )
+{
+	studiobones_t	b;
+
+	if( e->curstate.sequence >= m_pStudioHeader->numseq )
+		e->curstate.sequence = 0;
+
+	if( m_pPlayerInfo && m_pPlayerInfo->gaitsequence >= m_pStudioHeader->numseq ) 
+		m_pPlayerInfo->gaitsequence = 0;
+
+	// already computed by R_StudioPrepareEntities
+	if( R_StudioGetPreparedBones( e ))
+		return;
+
+	b.entity = e;
+	b.header = m_pStudioHeader;
+	b.playerinfo = m_pPlayerInfo;
+	b.interp = m_fDoInterp;
+	b.bones = g_bonestransform;
+	b.lights = g_lighttransform;
+	Matrix3x4_Copy( b.rotation, g_rotationmatrix );
+
+	R_StudioBuildBones( &b );
+
+	if( b.storeframe )
+		e->latched.prevframe = b.frame;
+}
+
 /*
 ====================
 StudioSaveBones
@@ -1459,7 +1739,8 @@ void R_StudioDynamicLight( cl_entity_t *ent, alight_t *lightinfo )
 	color24		ambient;
 	float		dist, radius2;
 	vec3_t		direction, origin;
-	dlight_t		*dl;
+	dlight_t		*dl, *lights[MAX_DLIGHTS];
+	int		numLights;
 
 	if( !lightinfo ) return;
 
@@ -1509,8 +1790,12 @@ void R_StudioDynamicLight( cl_entity_t *ent, alight_t *lightinfo )
 	if( !ent || !ent->model || !r_dynamic->integer )
 		return;
 
-	for( lnum = 0, dl = cl_dlights; lnum < MAX_DLIGHTS; lnum++, dl++ )
+	numLights = R_LightsInRadius( origin, studio_radius, false, lights );
+
+	for( lnum = 0; lnum < numLights; lnum++ )
 	{
+		dl = lights[lnum];
+
 		if( dl->die < RI.refdef.time || !dl->radius )
 			continue;
 
@@ -1574,7 +1859,8 @@ void R_StudioEntityLight( alight_t *lightinfo )
 	float		dist, radius2;
 	vec3_t		direction, origin;
 	cl_entity_t	*ent;
-	dlight_t		*el;
+	dlight_t		*el, *lights[MAX_ELIGHTS];
+	int		numLights;
 
 	ent = RI.currententity;
 
@@ -1595,8 +1881,12 @@ void R_StudioEntityLight( alight_t *lightinfo )
 	}
 	else Matrix3x4_OriginFromMatrix( g_rotationmatrix, origin );
 
-	for( lnum = 0, el = cl_elights; lnum < MAX_ELIGHTS; lnum++, el++ )
+	numLights = R_LightsInRadius( origin, studio_radius, true, lights );
+
+	for( lnum = 0; lnum < numLights; lnum++ )
 	{
+		el = lights[lnum];
+
 		if( el->die < RI.refdef.time || !el->radius )
 			continue;
 
@@ -2819,7 +3109,7 @@ static void R_StudioClientEvents( void )
 	if( pseqdesc->numevents == 0 || cl.time == cl.oldtime )
 		return;
 
-	f = R_StudioEstimateFrame( e, pseqdesc );	// get start offset
+	f = R_StudioEstimateFrame( e, pseqdesc, m_fDoInterp );	// get start offset
 	if ( e->latched.sequencetime == e->curstate.animtime && !( pseqdesc->flags & STUDIO_LOOPING ) )
 		start = -0.01f;
 	else start = f - e->curstate.framerate * host.frametime * pseqdesc->fps;
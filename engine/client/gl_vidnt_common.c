@@ -483,12 +483,14 @@ void GL_InitCommands( void )
 
 	Cmd_AddCommand( "r_info", R_RenderInfo_f, "display renderer info" );
 	Cmd_AddCommand( "texturelist", R_TextureList_f, "display loaded textures list" );
+	Cmd_AddCommand( "r_decalstress", R_DecalStress_f, "shoot a lot of decals around and time the rendering" );
 }
 
 void GL_RemoveCommands( void )
 {
 	Cmd_RemoveCommand( "r_info");
 	Cmd_RemoveCommand( "texturelist" );
+	Cmd_RemoveCommand( "r_decalstress" );
 }
 
 /*
@@ -156,6 +156,110 @@ int   rgsxlp[MAXLP];
 
 void SX_Profiling_f( void );
 
+/*
+===============================================================================
+
+VECTOR HELPERS
+
+Delay lines are read at least one block behind the write pointer,
+so a block has no sample to sample dependency through the line and
+may be processed four samples at once. Lowpass history is handled
+by keeping previous input in front of the block. Integer math keeps
+output equal to the per-sample code (dsp_profile checks it)
+
+===============================================================================
+*/
+#define DSP_BLOCK		256	// max samples in one vector run
+
+static qboolean		dsp_simd = true;	// dsp_profile switches it to compare results
+
+#if defined( XASH_MIX_SSE2 )
+typedef __m128i		dspvec_t;
+
+#define DSP_Load( p )		_mm_loadu_si128( (const __m128i *)(p) )
+#define DSP_Store( p, x )		_mm_storeu_si128( (__m128i *)(p), (x) )
+#define DSP_Splat( x )		_mm_set1_epi32( x )
+#define DSP_Add( a, b )		_mm_add_epi32( a, b )
+#define DSP_Sub( a, b )		_mm_sub_epi32( a, b )
+#define DSP_Or( a, b )		_mm_or_si128( a, b )
+#define DSP_And( a, b )		_mm_and_si128( a, b )
+#define DSP_Shl( a, n )		_mm_slli_epi32( a, n )
+#define DSP_Shr( a, n )		_mm_srai_epi32( a, n )
+
+// a * b, a must fit into 16 bits and b into 15 bits
+#define DSP_MulShort( a, b )		_mm_madd_epi16( a, b )
+
+_inline dspvec_t DSP_Mul( dspvec_t a, dspvec_t b )
+{
+	__m128i	even = _mm_mul_epu32( a, b );
+	__m128i	odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ));
+
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 )), _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 )));
+}
+
+// same as CLIP, saturation to 16 bits doesn't change the result
+_inline dspvec_t DSP_Clip( dspvec_t x )
+{
+	x = _mm_packs_epi32( x, x );
+	x = _mm_min_epi16( _mm_max_epi16( x, _mm_set1_epi16( -32760 )), _mm_set1_epi16( 32760 ));
+	return _mm_srai_epi32( _mm_unpacklo_epi16( x, x ), 16 );
+}
+
+// all bits set where x is not zero
+_inline dspvec_t DSP_NonZero( dspvec_t x )
+{
+	return _mm_andnot_si128( _mm_cmpeq_epi32( x, _mm_setzero_si128( )), _mm_set1_epi32( -1 ));
+}
+
+_inline void DSP_LoadPairs( const portable_samplepair_t *p, dspvec_t *l, dspvec_t *r )
+{
+	__m128i	a = _mm_shuffle_epi32( _mm_loadu_si128( (const __m128i *)p + 0 ), _MM_SHUFFLE( 3, 1, 2, 0 ));
+	__m128i	b = _mm_shuffle_epi32( _mm_loadu_si128( (const __m128i *)p + 1 ), _MM_SHUFFLE( 3, 1, 2, 0 ));
+
+	*l = _mm_unpacklo_epi64( a, b );
+	*r = _mm_unpackhi_epi64( a, b );
+}
+
+_inline void DSP_StorePairs( portable_samplepair_t *p, dspvec_t l, dspvec_t r )
+{
+	_mm_storeu_si128( (__m128i *)p + 0, _mm_unpacklo_epi32( l, r ));
+	_mm_storeu_si128( (__m128i *)p + 1, _mm_unpackhi_epi32( l, r ));
+}
+#elif defined( XASH_MIX_NEON )
+typedef int32x4_t		dspvec_t;
+
+#define DSP_Load( p )		vld1q_s32( (const int32_t *)(p) )
+#define DSP_Store( p, x )		vst1q_s32( (int32_t *)(p), (x) )
+#define DSP_Splat( x )		vdupq_n_s32( x )
+#define DSP_Add( a, b )		vaddq_s32( a, b )
+#define DSP_Sub( a, b )		vsubq_s32( a, b )
+#define DSP_Or( a, b )		vorrq_s32( a, b )
+#define DSP_And( a, b )		vandq_s32( a, b )
+#define DSP_Shl( a, n )		vshlq_n_s32( a, n )
+#define DSP_Shr( a, n )		vshrq_n_s32( a, n )
+#define DSP_MulShort( a, b )		vmulq_s32( a, b )
+#define DSP_Mul( a, b )		vmulq_s32( a, b )
+#define DSP_Clip( x )		vminq_s32( vmaxq_s32( x, vdupq_n_s32( -32760 )), vdupq_n_s32( 32760 ))
+#define DSP_NonZero( x )		vreinterpretq_s32_u32( vtstq_s32( x, x ))
+
+_inline void DSP_LoadPairs( const portable_samplepair_t *p, dspvec_t *l, dspvec_t *r )
+{
+	int32x4x2_t	v = vld2q_s32( (const int32_t *)p );
+
+	*l = v.val[0];
+	*r = v.val[1];
+}
+
+_inline void DSP_StorePairs( portable_samplepair_t *p, dspvec_t l, dspvec_t r )
+{
+	int32x4x2_t	v;
+
+	v.val[0] = l;
+	v.val[1] = r;
+	vst2q_s32( (int32_t *)p, v );
+}
+#endif
+
 /*
 ============
 SX_ReloadRoomFX
@@ -311,6 +415,58 @@ _inline void DLY_MovePointer(dly_t *dly)
 		dly->idelayoutput = 0;
 }
 
+/*
+============
+DLY_RunLength
+
+how many samples from count can be processed by vector code:
+no crossfade or modulation event inside, pointers don't wrap,
+output pointer stays behind input and feedback fits into 15 bits.
+Result is multiple of 4
+============
+*/
+static int DLY_RunLength( const dly_t *dly, int count )
+{
+	int	n, lag;
+
+	if( !dsp_simd || !dly->lpdelayline || dly->xfade )
+		return 0;
+
+	// DSP_MulShort is exact only for this feedback, cvars are not clamped
+	if( dly->delayfeedback < 0 || dly->delayfeedback > 32767 )
+		return 0;
+
+	lag = (int)(( dly->idelayinput + dly->cdelaysamplesmax - dly->idelayoutput ) % dly->cdelaysamplesmax );
+	n = min( count, DSP_BLOCK );
+	n = min( n, lag );
+	n = min( n, (int)( dly->cdelaysamplesmax - dly->idelayinput ));
+	n = min( n, (int)( dly->cdelaysamplesmax - dly->idelayoutput ));
+
+	// modulation counter must not reach zero
+	if( dly->mod ) n = min( n, dly->modcur - 1 );
+
+	return n & ~3;
+}
+
+/*
+============
+DLY_AdvanceRun
+
+move pointers and modulation counter after a vector run
+============
+*/
+static void DLY_AdvanceRun( dly_t *dly, int count )
+{
+	if(( dly->idelayinput += count ) >= dly->cdelaysamplesmax )
+		dly->idelayinput = 0;
+
+	if(( dly->idelayoutput += count ) >= dly->cdelaysamplesmax )
+		dly->idelayoutput = 0;
+
+	if( dly->mod ) dly->modcur -= count;
+	dly->idelayoutputxf %= dly->cdelaysamplesmax;
+}
+
 
 
 /*
@@ -364,20 +520,14 @@ void DLY_CheckNewStereoDelayVal( )
 
 /*
 =============
-DLY_DoStereoDelay
-
-Do stereo processing
+DLY_DoStereoDelayScalar
 =============
 */
-void DLY_DoStereoDelay( int count )
+static void DLY_DoStereoDelayScalar( portable_samplepair_t *paint, int count )
 {
 	int delay;
 	int samplexf;
 	dly_t *const dly = &rgsxdly[STEREODLY];
-	portable_samplepair_t *paint = paintto;
-
-	if( !dly->lpdelayline )
-		return; // inactive
 
 	for( ; count; count--, paint++ )
 	{
@@ -425,6 +575,63 @@ void DLY_DoStereoDelay( int count )
 	}
 }
 
+#ifdef XASH_MIX_SIMD
+/*
+=============
+DLY_VecStereoDelay
+
+without crossfade delay line just swaps with left channel
+=============
+*/
+static void DLY_VecStereoDelay( portable_samplepair_t *paint, int count )
+{
+	dly_t *const dly = &rgsxdly[STEREODLY];
+	int *in = dly->lpdelayline + dly->idelayinput;
+	int *out = dly->lpdelayline + dly->idelayoutput;
+	dspvec_t l, r;
+	int i;
+
+	for( i = 0; i < count; i += 4 )
+	{
+		DSP_LoadPairs( paint + i, &l, &r );
+		DSP_Store( in + i, l );
+		DSP_StorePairs( paint + i, DSP_Clip( DSP_Load( out + i )), r );
+	}
+
+	DLY_AdvanceRun( dly, count );
+}
+#endif
+
+/*
+=============
+DLY_DoStereoDelay
+
+Do stereo processing
+=============
+*/
+void DLY_DoStereoDelay( int count )
+{
+	dly_t *const dly = &rgsxdly[STEREODLY];
+	portable_samplepair_t *paint = paintto;
+	int n;
+
+	if( !dly->lpdelayline )
+		return; // inactive
+
+	while( count > 0 )
+	{
+#ifdef XASH_MIX_SIMD
+		if(( n = DLY_RunLength( dly, count )) > 0 )
+			DLY_VecStereoDelay( paint, n );
+		else
+#endif
+		DLY_DoStereoDelayScalar( paint, n = 1 );
+
+		paint += n;
+		count -= n;
+	}
+}
+
 
 /*
 =============
@@ -473,20 +680,14 @@ void DLY_CheckNewDelayVal( )
 
 /*
 =============
-DLY_DoDelay
-
-Do delay processing
+DLY_DoDelayScalar
 =============
 */
-void DLY_DoDelay( int count )
+static void DLY_DoDelayScalar( portable_samplepair_t *paint, int count )
 {
 	dly_t * const dly = &rgsxdly[MONODLY];
-	portable_samplepair_t *paint = paintto;
 	int delay;
 
-	if( !dly->lpdelayline || !count )
-		return; // inactive
-
 	for( ; count; count--, paint++ )
 	{
 		delay = dly->lpdelayline[dly->idelayoutput];
@@ -523,6 +724,96 @@ void DLY_DoDelay( int count )
 	}
 }
 
+#ifdef XASH_MIX_SIMD
+/*
+=============
+DLY_VecDelay
+
+first pass builds unfiltered delayed values, silent samples
+are zeroed like in scalar code, second pass applies lowpass
+=============
+*/
+static void DLY_VecDelay( portable_samplepair_t *paint, int count )
+{
+	dly_t * const dly = &rgsxdly[MONODLY];
+	int *in = dly->lpdelayline + dly->idelayinput;
+	int *out = dly->lpdelayline + dly->idelayoutput;
+	int val[DSP_BLOCK + 1], mask[DSP_BLOCK];
+	dspvec_t fb = DSP_Splat( dly->delayfeedback );
+	dspvec_t l, r, d, m, v;
+	int i;
+
+	val[0] = dly->lp1;
+
+	for( i = 0; i < count; i += 4 )
+	{
+		DSP_LoadPairs( paint + i, &l, &r );
+		d = DSP_Load( out + i );
+		m = DSP_NonZero( DSP_Or( d, DSP_Or( l, r )));
+
+		// ( left + right ) / 2, rounded toward zero
+		v = DSP_Add( l, r );
+		v = DSP_Shr( DSP_Sub( v, DSP_Shr( v, 31 )), 1 );
+		v = DSP_Clip( DSP_Add( v, DSP_Shr( DSP_MulShort( d, fb ), 8 )));
+
+		DSP_Store( val + 1 + i, DSP_And( v, m ));
+		DSP_Store( mask + i, m );
+	}
+
+	for( i = 0; i < count; i += 4 )
+	{
+		v = DSP_Load( val + 1 + i );
+
+		// ( lp0 + lp1 + val * 2 ) / 4, where lp1 is val
+		if( dly->lp ) v = DSP_Shr( DSP_Add( DSP_Load( val + i ), DSP_Add( DSP_Shl( v, 1 ), v )), 2 );
+		v = DSP_And( v, DSP_Load( mask + i ));
+		DSP_Store( in + i, v );
+
+		v = DSP_Shr( v, 2 );
+		DSP_LoadPairs( paint + i, &l, &r );
+		DSP_StorePairs( paint + i, DSP_Clip( DSP_Add( l, v )), DSP_Clip( DSP_Add( r, v )));
+	}
+
+	if( dly->lp )
+	{
+		dly->lp0 = val[count - 1];
+		dly->lp1 = val[count];
+	}
+
+	DLY_AdvanceRun( dly, count );
+}
+#endif
+
+/*
+=============
+DLY_DoDelay
+
+Do delay processing
+=============
+*/
+void DLY_DoDelay( int count )
+{
+	dly_t * const dly = &rgsxdly[MONODLY];
+	portable_samplepair_t *paint = paintto;
+	int n;
+
+	if( !dly->lpdelayline || !count )
+		return; // inactive
+
+	while( count > 0 )
+	{
+#ifdef XASH_MIX_SIMD
+		if(( n = DLY_RunLength( dly, count )) > 0 )
+			DLY_VecDelay( paint, n );
+		else
+#endif
+		DLY_DoDelayScalar( paint, n = 1 );
+
+		paint += n;
+		count -= n;
+	}
+}
+
 /*
 ===========
 RVB_SetUpDly
@@ -664,22 +955,97 @@ int RVB_DoReverbForOneDly( dly_t *dly, const int vlr, const portable_samplepair_
 
 }
 
+#ifdef XASH_MIX_SIMD
 /*
 ===========
-RVB_DoReverb
+RVB_VecReverbForOneDly
 
-Do reverberation processing
+add output of dly for count samples to vout
 ===========
 */
-void RVB_DoReverb( int count )
+static void RVB_VecReverbForOneDly( dly_t *dly, const int *vlr, const int *nonzero, int *vout, int count )
+{
+	int *in = dly->lpdelayline + dly->idelayinput;
+	int *out = dly->lpdelayline + dly->idelayoutput;
+	int val[DSP_BLOCK + 1], mask[DSP_BLOCK];
+	dspvec_t fb = DSP_Splat( dly->delayfeedback );
+	dspvec_t d, m, v;
+	int i;
+
+	val[0] = dly->lp0;
+
+	for( i = 0; i < count; i += 4 )
+	{
+		d = DSP_Load( out + i );
+		m = DSP_Or( DSP_Load( nonzero + i ), DSP_NonZero( d ));
+		v = DSP_Clip( DSP_Add( DSP_Load( vlr + i ), DSP_Shr( DSP_MulShort( d, fb ), 8 )));
+
+		DSP_Store( val + 1 + i, DSP_And( v, m ));
+		DSP_Store( mask + i, m );
+	}
+
+	for( i = 0; i < count; i += 4 )
+	{
+		v = DSP_Load( val + 1 + i );
+		if( dly->lp ) v = DSP_Shr( DSP_Add( DSP_Load( val + i ), v ), 1 );
+		v = DSP_And( v, DSP_Load( mask + i ));
+
+		DSP_Store( in + i, v );
+		DSP_Store( vout + i, DSP_Add( DSP_Load( vout + i ), v ));
+	}
+
+	dly->lp0 = val[count];
+	DLY_AdvanceRun( dly, count );
+}
+
+/*
+===========
+RVB_VecReverb
+===========
+*/
+static void RVB_VecReverb( portable_samplepair_t *paint, int count )
+{
+	int vlr[DSP_BLOCK], nonzero[DSP_BLOCK], vout[DSP_BLOCK];
+	dspvec_t l, r, v;
+	int i;
+
+	// DLY_RunLength never gives more, lets compiler see the arrays are filled
+	if( count <= 0 || count > DSP_BLOCK )
+		return;
+
+	for( i = 0; i < count; i += 4 )
+	{
+		DSP_LoadPairs( paint + i, &l, &r );
+		DSP_Store( vlr + i, DSP_Shr( DSP_Add( l, r ), 1 ));
+		DSP_Store( nonzero + i, DSP_NonZero( DSP_Or( l, r )));
+		DSP_Store( vout + i, DSP_Splat( 0 ));
+	}
+
+	RVB_VecReverbForOneDly( &rgsxdly[REVERBPOS], vlr, nonzero, vout, count );
+	RVB_VecReverbForOneDly( &rgsxdly[REVERBPOS+1], vlr, nonzero, vout, count );
+
+	for( i = 0; i < count; i += 4 )
+	{
+		// 11 * voutm >> 6
+		v = DSP_Load( vout + i );
+		v = DSP_Shr( DSP_Add( DSP_Add( DSP_Shl( v, 3 ), DSP_Shl( v, 1 )), v ), 6 );
+
+		DSP_LoadPairs( paint + i, &l, &r );
+		DSP_StorePairs( paint + i, DSP_Clip( DSP_Add( l, v )), DSP_Clip( DSP_Add( r, v )));
+	}
+}
+#endif
+
+/*
+===========
+RVB_DoReverbScalar
+===========
+*/
+static void RVB_DoReverbScalar( portable_samplepair_t *paint, int count )
 {
 	int vlr;
 	dly_t *const dly1 = &rgsxdly[REVERBPOS],
 			  *const dly2 = &rgsxdly[REVERBPOS+1];
-	portable_samplepair_t *paint = paintto;
-
-	if( !dly1->lpdelayline || !count )
-		return;
 
 	for( ; count; count--, paint++ )
 	{
@@ -698,21 +1064,42 @@ void RVB_DoReverb( int count )
 
 /*
 ===========
-RVB_DoAMod
+RVB_DoReverb
 
-Do amplification modulation processing
+Do reverberation processing
 ===========
 */
-void RVB_DoAMod( int count )
+void RVB_DoReverb( int count )
 {
+	dly_t *const dly1 = &rgsxdly[REVERBPOS],
+			  *const dly2 = &rgsxdly[REVERBPOS+1];
 	portable_samplepair_t *paint = paintto;
+	int n;
 
-	if( !sxmod_lowpass->integer && !sxmod_mod->integer )
+	if( !dly1->lpdelayline || !count )
 		return;
 
-	if( !count )
-		return;
+	while( count > 0 )
+	{
+#ifdef XASH_MIX_SIMD
+		if(( n = min( DLY_RunLength( dly1, count ), DLY_RunLength( dly2, count ))) > 0 )
+			RVB_VecReverb( paint, n );
+		else
+#endif
+		RVB_DoReverbScalar( paint, n = 1 );
 
+		paint += n;
+		count -= n;
+	}
+}
+
+/*
+===========
+RVB_DoAModScalar
+===========
+*/
+static void RVB_DoAModScalar( portable_samplepair_t *paint, int count )
+{
 	for( ; count; count--, paint++ )
 	{
 		portable_samplepair_t res = *paint;
@@ -774,6 +1161,109 @@ void RVB_DoAMod( int count )
 	}
 }
 
+#ifdef XASH_MIX_SIMD
+/*
+===========
+RVB_VecAMod
+
+modulation is only vectorized while amplitude
+is settled on its target, it ramps per sample
+===========
+*/
+static void RVB_VecAMod( portable_samplepair_t *paint, int count )
+{
+	int hl[DSP_BLOCK + 5], hr[DSP_BLOCK + 5];
+	qboolean lowpass = ( sxmod_lowpass->value != 0.0f );
+	dspvec_t l, r, ml, mr;
+	int i;
+
+	ml = DSP_Splat( sxamodl );
+	mr = DSP_Splat( sxamodr );
+
+	if( lowpass )
+	{
+		// keep last five inputs in front of the block
+		Q_memcpy( hl, rgsxlp + 0, sizeof( int ) * 5 );
+		Q_memcpy( hr, rgsxlp + 5, sizeof( int ) * 5 );
+
+		for( i = 0; i < count; i += 4 )
+		{
+			DSP_LoadPairs( paint + i, &l, &r );
+			DSP_Store( hl + 5 + i, l );
+			DSP_Store( hr + 5 + i, r );
+		}
+
+		Q_memcpy( rgsxlp + 0, hl + count, sizeof( int ) * 5 );
+		Q_memcpy( rgsxlp + 5, hr + count, sizeof( int ) * 5 );
+	}
+
+	for( i = 0; i < count; i += 4 )
+	{
+		if( lowpass )
+		{
+			l = DSP_Add( DSP_Add( DSP_Add( DSP_Load( hl + i ), DSP_Load( hl + i + 1 )), DSP_Add( DSP_Load( hl + i + 2 ), DSP_Load( hl + i + 3 ))), DSP_Add( DSP_Load( hl + i + 4 ), DSP_Load( hl + i + 5 )));
+			r = DSP_Add( DSP_Add( DSP_Add( DSP_Load( hr + i ), DSP_Load( hr + i + 1 )), DSP_Add( DSP_Load( hr + i + 2 ), DSP_Load( hr + i + 3 ))), DSP_Add( DSP_Load( hr + i + 4 ), DSP_Load( hr + i + 5 )));
+			l = DSP_Shr( l, 2 );
+			r = DSP_Shr( r, 2 );
+		}
+		else DSP_LoadPairs( paint + i, &l, &r );
+
+		if( sxmod_mod->integer )
+		{
+			l = DSP_Shr( DSP_Mul( l, ml ), 8 );
+			r = DSP_Shr( DSP_Mul( r, mr ), 8 );
+		}
+
+		DSP_StorePairs( paint + i, DSP_Clip( l ), DSP_Clip( r ));
+	}
+
+	if( sxmod_mod->integer )
+	{
+		sxmod1cur -= count;
+		while( sxmod1cur < 0 ) sxmod1cur += sxmod1 + 1;
+
+		sxmod2cur -= count;
+		while( sxmod2cur < 0 ) sxmod2cur += sxmod2 + 1;
+	}
+}
+#endif
+
+/*
+===========
+RVB_DoAMod
+
+Do amplification modulation processing
+===========
+*/
+void RVB_DoAMod( int count )
+{
+	portable_samplepair_t *paint = paintto;
+	int n;
+
+	if( !sxmod_lowpass->integer && !sxmod_mod->integer )
+		return;
+
+	if( !count )
+		return;
+
+	while( count > 0 )
+	{
+		n = 0;
+#ifdef XASH_MIX_SIMD
+		// ramping amplitude or new random targets need scalar code
+		if( dsp_simd && ( !sxmod_mod->integer || ( sxmod1 && sxmod2 && sxamodl == sxamodlt && sxamodr == sxamodrt )))
+			n = min( count, DSP_BLOCK ) & ~3;
+
+		if( n > 0 ) RVB_VecAMod( paint, n );
+		else
+#endif
+		RVB_DoAModScalar( paint, n = 1 );
+
+		paint += n;
+		count -= n;
+	}
+}
+
 
 /*
 ===========
@@ -900,13 +1390,107 @@ float DSP_GetGain( int idsp )
 	return 1.0f;
 }
 
+/*
+===========
+SX_SaveState
+
+dsp_profile runs each stage twice from the same state
+===========
+*/
+typedef struct
+{
+	dly_t	dly[MAXDLY];
+	int	*lines[MAXDLY];
+	int	lp[MAXLP];
+	int	amod[4];
+	int	modcur[2];
+} sxstate_t;
+
+static void SX_SaveState( sxstate_t *state )
+{
+	int i;
+
+	Q_memcpy( state->dly, rgsxdly, sizeof( rgsxdly ));
+	Q_memcpy( state->lp, rgsxlp, sizeof( rgsxlp ));
+
+	for( i = 0; i < MAXDLY; i++ )
+	{
+		state->lines[i] = NULL;
+		if( !rgsxdly[i].lpdelayline ) continue;
+		state->lines[i] = Z_Malloc( rgsxdly[i].cdelaysamplesmax * sizeof( int ));
+		Q_memcpy( state->lines[i], rgsxdly[i].lpdelayline, rgsxdly[i].cdelaysamplesmax * sizeof( int ));
+	}
+
+	state->amod[0] = sxamodl;
+	state->amod[1] = sxamodr;
+	state->amod[2] = sxamodlt;
+	state->amod[3] = sxamodrt;
+	state->modcur[0] = sxmod1cur;
+	state->modcur[1] = sxmod2cur;
+}
+
+static void SX_RestoreState( const sxstate_t *state )
+{
+	int i;
+
+	Q_memcpy( rgsxdly, state->dly, sizeof( rgsxdly ));
+	Q_memcpy( rgsxlp, state->lp, sizeof( rgsxlp ));
+
+	for( i = 0; i < MAXDLY; i++ )
+	{
+		if( state->lines[i] )
+			Q_memcpy( rgsxdly[i].lpdelayline, state->lines[i], rgsxdly[i].cdelaysamplesmax * sizeof( int ));
+	}
+
+	sxamodl = state->amod[0];
+	sxamodr = state->amod[1];
+	sxamodlt = state->amod[2];
+	sxamodrt = state->amod[3];
+	sxmod1cur = state->modcur[0];
+	sxmod2cur = state->modcur[1];
+}
+
+static void SX_FreeState( sxstate_t *state )
+{
+	int i;
+
+	for( i = 0; i < MAXDLY; i++ )
+	{
+		if( state->lines[i] )
+			Mem_Free( state->lines[i] );
+	}
+}
+
+/*
+===========
+SX_Profiling_f
+
+time each dsp stage with scalar and vector code
+and compare their output
+===========
+*/
 void SX_Profiling_f( void )
 {
+	static const struct
+	{
+		const char	*name;
+		void		(*func)( int count );
+	} stages[] =
+	{
+	{ "modulation", RVB_DoAMod },
+	{ "reverb", RVB_DoReverb },
+	{ "delay", DLY_DoDelay },
+	{ "stereo delay", DLY_DoStereoDelay },
+	};
 	portable_samplepair_t testbuffer[512];
-	int i;
-	int calls = 10000;
-	double start, end;
+	portable_samplepair_t result[2][512];
+	portable_samplepair_t work[512];
+	int numstages = ARRAYSIZE( stages );
+	int i, j, mode, maxdiff;
+	int calls = 2000;
+	double start, time[2];
 	float oldroom = room_type->value;
+	sxstate_t state;
 
 	for( i = 0; i < 512; i++ )
 	{
@@ -914,6 +1498,8 @@ void SX_Profiling_f( void )
 		testbuffer[i].right = Com_RandomLong( 0, 3000 );
 	}
 
+	S_LockMixer();
+
 	if( Cmd_Argc() > 1 )
 	{
 		Cvar_SetFloat("room_type", atof(Cmd_Argv( 1 )));
@@ -921,17 +1507,49 @@ void SX_Profiling_f( void )
 		CheckNewDspPresets(); // we just need idsp_room immediately, for message below
 	}
 
-	MsgDev( D_INFO, "Profiling 10000 calls to DSP. Sample count is 512, room_type is %i\n", idsp_room );
+	Msg( "Profiling %i calls to each DSP stage. Sample count is 512, room_type is %i\n", calls, idsp_room );
+#ifndef XASH_MIX_SIMD
+	Msg( "Vector code is not compiled in\n" );
+#endif
+	Msg( "stage           scalar, us   vector, us   max diff\n" );
 
+	SX_SaveState( &state );
 
-	start = Sys_DoubleTime();
-	for( ; calls; calls-- )
+	for( i = 0; i <= numstages; i++ )
 	{
-		DSP_Process( idsp_room, testbuffer, 512 );
+		for( mode = 0; mode < 2; mode++ )
+		{
+			dsp_simd = mode;
+			SX_RestoreState( &state );
+
+			start = Sys_DoubleTime();
+			for( j = 0; j < calls; j++ )
+			{
+				Q_memcpy( work, testbuffer, sizeof( work ));
+				paintto = work;
+
+				if( i == numstages )
+					DSP_Process( idsp_room, work, 512 );
+				else stages[i].func( 512 );
+			}
+			time[mode] = Sys_DoubleTime() - start;
+
+			Q_memcpy( result[mode], work, sizeof( work ));
+		}
+
+		for( j = maxdiff = 0; j < 512; j++ )
+		{
+			maxdiff = max( maxdiff, abs( result[0][j].left - result[1][j].left ));
+			maxdiff = max( maxdiff, abs( result[0][j].right - result[1][j].right ));
+		}
+
+		Msg( "%-14s %10.2f   %10.2f   %8i\n", i == numstages ? "total" : stages[i].name,
+			time[0] * 1000000.0 / calls, time[1] * 1000000.0 / calls, maxdiff );
 	}
-	end = Sys_DoubleTime();
 
-	MsgDev( D_INFO, "----------\nTook %.3f seconds.\n", end - start );
+	dsp_simd = true;
+	SX_RestoreState( &state );
+	SX_FreeState( &state );
 
 	if( Cmd_Argc() > 1 )
 	{
@@ -939,5 +1557,7 @@ void SX_Profiling_f( void )
 		SX_ReloadRoomFX();
 		CheckNewDspPresets();
 	}
+
+	S_UnlockMixer();
 }
 #endif // XASH_DEDICATED
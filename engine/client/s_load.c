@@ -17,6 +17,7 @@ GNU General Public License for more details.
 
 #include "common.h"
 #include "sound.h"
+#include "client.h"
 
 // during registration it is possible to have more sounds
 // than could actually be referenced during gameplay,
@@ -24,6 +25,43 @@ GNU General Public License for more details.
 // sure we won't need it.
 #define MAX_SFX		8192
 #define MAX_SFX_HASH	(MAX_SFX/4)
+#define MAX_QUEUED_SOUNDS	128
+#define SOUND_CACHE_VERSION	1		// bump when conversion changes
+
+// conversion settings which are hashed into the cache key
+typedef struct
+{
+	int		version;
+	int		dmaSpeed;
+} sndcacheparms_t;
+
+// converted sound in asset cache, pcm data follows
+typedef struct
+{
+	int		rate;
+	int		width;
+	int		channels;
+	int		loopStart;
+	int		samples;
+	uint		type;
+	uint		flags;
+	uint		size;
+} sndcacheinfo_t;
+
+// play request for a sound which is not loaded yet
+typedef struct
+{
+	sfx_t		*sfx;
+	sound_t		handle;
+	vec3_t		origin;
+	qboolean		hasorigin;
+	int		entnum;
+	int		channel;
+	float		volume;
+	float		attn;
+	int		pitch;
+	int		flags;
+} queuedsound_t;
 
 static int	s_numSfx = 0;
 static sfx_t	s_knownSfx[MAX_SFX];
@@ -32,6 +70,32 @@ static string	s_sentenceImmediateName;	// keep dummy sentence name
 qboolean		s_registering = false;
 int		s_registration_sequence = 0;
 
+static queuedsound_t	s_queue[MAX_QUEUED_SOUNDS];
+static int		s_numQueued;
+
+static struct
+{
+	size_t		size;		// bytes of resident sound data
+	int		loads;
+	int		deferred;		// play requests which waited for loading
+	int		evicted;
+	int		reloaded;		// loads of previously evicted sounds
+} s_cache;
+
+/*
+=================
+S_CacheLimit
+
+sound cache budget in bytes, 0 if unlimited
+=================
+*/
+static size_t S_CacheLimit( void )
+{
+	if( !s_cachesize || s_cachesize->value <= 0.0f )
+		return 0;
+	return (size_t)( s_cachesize->value * 1024.0f * 1024.0f );
+}
+
 /*
 =================
 S_SoundList_f
@@ -56,7 +120,7 @@ void S_SoundList_f( void )
 
 			if( sc->loopStart >= 0 ) Msg( "L" );
 			else Msg( " " );
-			Msg( " (%2db) %s : sound/%s\n", sc->width * 8, Q_memprint( sc->size ), sfx->name );
+			Msg( " (%2db) %s : sound/%s (%i frames ago)\n", sc->width * 8, Q_memprint( sc->size ), sfx->name, host.framecount - sfx->lastUsed );
 			totalSfx++;
 		}
 	}
@@ -64,6 +128,10 @@ void S_SoundList_f( void )
 	Msg( "-------------------------------------------\n" );
 	Msg( "%i total sounds\n", totalSfx );
 	Msg( "%s total memory\n", Q_memprint( totalSize ));
+	if( S_CacheLimit( ))
+		Msg( "%s cache budget\n", Q_memprint( S_CacheLimit( )));
+	Msg( "%i loaded, %i reloaded, %i evicted\n", s_cache.loads, s_cache.reloaded, s_cache.evicted );
+	Msg( "%i sounds waited for loading, %i waiting now\n", s_cache.deferred, s_numQueued );
 	Msg( "\n" );
 }
 
@@ -119,6 +187,184 @@ static wavdata_t *S_CreateDefaultSound( void )
 	return sc;
 }
 
+/*
+=================
+S_ConvertSound
+
+bring odd rates to the ones mixer can handle,
+returns true if sound was changed
+=================
+*/
+static qboolean S_ConvertSound( wavdata_t **sc )
+{
+	int	rate = (*sc)->rate;
+
+	if( rate < SOUND_11k ) // some bad sounds
+		Sound_Process( sc, SOUND_11k, (*sc)->width, SOUND_RESAMPLE );
+#if SOUND_DMA_SPEED > SOUND_11k
+	else if( rate > SOUND_11k && rate < SOUND_22k ) // some bad sounds
+		Sound_Process( sc, SOUND_22k, (*sc)->width, SOUND_RESAMPLE );
+#endif
+
+#if SOUND_DMA_SPEED > SOUND_32k
+	else if( rate > SOUND_22k && rate <= SOUND_32k ) // some bad sounds
+		Sound_Process( sc, SOUND_44k, (*sc)->width, SOUND_RESAMPLE );
+#endif
+	return ( (*sc)->rate != rate );
+}
+
+/*
+=================
+S_WavNeedsConversion
+
+read rate from wav header to see if S_ConvertSound
+will change the sound, returns true if header is unknown
+=================
+*/
+static qboolean S_WavNeedsConversion( const byte *raw, fs_offset_t rawsize )
+{
+	const byte	*p = raw + 12;
+	int		rate, length;
+
+	if( rawsize < 12 || Q_strncmp( (const char *)raw, "RIFF", 4 ) || Q_strncmp( (const char *)raw + 8, "WAVE", 4 ))
+		return true;
+
+	while( p + 8 <= raw + rawsize )
+	{
+		length = p[4] | ( p[5] << 8 ) | ( p[6] << 16 ) | ( p[7] << 24 );
+
+		if( !Q_strncmp( (const char *)p, "fmt ", 4 ))
+		{
+			if( length < 8 || p + 16 > raw + rawsize )
+				return true;
+
+			rate = p[12] | ( p[13] << 8 ) | ( p[14] << 16 ) | ( p[15] << 24 );
+
+			// same ranges as S_ConvertSound has
+			if( rate < SOUND_11k ) return true;
+#if SOUND_DMA_SPEED > SOUND_11k
+			if( rate > SOUND_11k && rate < SOUND_22k ) return true;
+#endif
+#if SOUND_DMA_SPEED > SOUND_32k
+			if( rate > SOUND_22k && rate <= SOUND_32k ) return true;
+#endif
+			return false;
+		}
+
+		if( length < 0 || length > raw + rawsize - p - 8 )
+			break;
+		p += 8 + (( length + 1 ) & ~1 );
+	}
+
+	return true;
+}
+
+/*
+=================
+S_LoadCachedSound
+
+decoded mp3 and resampled wav are kept in asset cache,
+key is made from the file contents so edited sounds
+are converted again
+=================
+*/
+static wavdata_t *S_LoadCachedSound( const char *name )
+{
+	sndcacheparms_t	parms;
+	const sndcacheinfo_t	*info;
+	const byte	*data;
+	assetkey_t	key;
+	assetfile_t	*file;
+	fs_offset_t	rawsize;
+	wavdata_t		*sc;
+	byte		*raw;
+	size_t		size;
+	qboolean		changed;
+
+	raw = FS_LoadFile( va( "sound/%s", name ), &rawsize, false );
+	if( !raw ) raw = FS_LoadFile( name, &rawsize, false );
+	if( !raw )
+	{
+		// let soundlib guess the format
+		if(( sc = FS_LoadSound( name, NULL, 0 )) != NULL )
+			S_ConvertSound( &sc );
+		return sc;
+	}
+
+	// plain wav is never stored, don't look for it in cache
+	if( Q_stricmp( FS_FileExtension( name ), "mp3" ) && !S_WavNeedsConversion( raw, rawsize ))
+	{
+		sc = FS_LoadSound( va( "#%s", name ), raw, rawsize );
+		Mem_Free( raw );
+		return sc;
+	}
+
+	Q_memset( &parms, 0, sizeof( parms ));
+	parms.version = SOUND_CACHE_VERSION;
+	parms.dmaSpeed = SOUND_DMA_SPEED;
+	Asset_MakeKey( &key, raw, rawsize, &parms, sizeof( parms ));
+
+	file = Asset_Open( "snd", &key, &data, &size );
+
+	if( file )
+	{
+		info = (const sndcacheinfo_t *)data;
+
+		if( size >= sizeof( *info ) && info->size == size - sizeof( *info ))
+		{
+			sc = Mem_Alloc( sndpool, sizeof( wavdata_t ));
+			sc->rate = info->rate;
+			sc->width = info->width;
+			sc->channels = info->channels;
+			sc->loopStart = info->loopStart;
+			sc->samples = info->samples;
+			sc->type = info->type;
+			sc->flags = info->flags;
+			sc->size = info->size;
+			sc->buffer = Mem_Alloc( sndpool, sc->size );
+			Q_memcpy( sc->buffer, data + sizeof( *info ), sc->size );
+
+			Asset_Close( file );
+			Mem_Free( raw );
+			return sc;
+		}
+		Asset_Close( file );
+	}
+
+	// '#' makes soundlib to use our buffer instead of loading file again
+	sc = FS_LoadSound( va( "#%s", name ), raw, rawsize );
+	if( !sc )
+	{
+		Mem_Free( raw );
+		return NULL;
+	}
+
+	changed = S_ConvertSound( &sc );
+
+	// plain wav is loaded as fast as cache file
+	if( changed || !Q_stricmp( FS_FileExtension( name ), "mp3" ))
+	{
+		byte	*out = Mem_Alloc( sndpool, sizeof( sndcacheinfo_t ) + sc->size );
+		sndcacheinfo_t	*outinfo = (sndcacheinfo_t *)out;
+
+		outinfo->rate = sc->rate;
+		outinfo->width = sc->width;
+		outinfo->channels = sc->channels;
+		outinfo->loopStart = sc->loopStart;
+		outinfo->samples = sc->samples;
+		outinfo->type = sc->type;
+		outinfo->flags = sc->flags;
+		outinfo->size = sc->size;
+		Q_memcpy( out + sizeof( sndcacheinfo_t ), sc->buffer, sc->size );
+
+		Asset_Store( "snd", &key, out, sizeof( sndcacheinfo_t ) + sc->size );
+		Mem_Free( out );
+	}
+
+	Mem_Free( raw );
+	return sc;
+}
+
 /*
 =================
 S_LoadSound
@@ -127,36 +373,236 @@ S_LoadSound
 wavdata_t *S_LoadSound( sfx_t *sfx )
 {
 	wavdata_t	*sc = NULL;
+	const char	*name;
 
 	if( !sfx ) return NULL;
+
+	sfx->lastUsed = host.framecount;
 	if( sfx->cache ) return sfx->cache; // see if still in memory
 
+	// mixer thread can't use the filesystem, sounds
+	// are loaded on the main thread when they starts
+	if( !Sys_IsMainThread( )) return NULL;
+
 	if( Q_stricmp( sfx->name, "*default" ))
 	{
+		name = ( sfx->name[0] == '*' ) ? sfx->name + 1 : sfx->name;
+
 		// load it from disk
-		if( sfx->name[0] == '*' )
-			sc = FS_LoadSound( sfx->name + 1, NULL, 0 );
-		else sc = FS_LoadSound( sfx->name, NULL, 0 );
+		if( Asset_CacheEnabled( ))
+			sc = S_LoadCachedSound( name );
+		else if(( sc = FS_LoadSound( name, NULL, 0 )) != NULL )
+			S_ConvertSound( &sc );
 	}
 
 	if( !sc ) sc = S_CreateDefaultSound();
-
-	if( sc->rate < SOUND_11k ) // some bad sounds
-		Sound_Process( &sc, SOUND_11k, sc->width, SOUND_RESAMPLE );
-#if SOUND_DMA_SPEED > SOUND_11k
-	else if( sc->rate > SOUND_11k && sc->rate < SOUND_22k ) // some bad sounds
-		Sound_Process( &sc, SOUND_22k, sc->width, SOUND_RESAMPLE );
-#endif
-
-#if SOUND_DMA_SPEED > SOUND_32k
-	else if( sc->rate > SOUND_22k && sc->rate <= SOUND_32k ) // some bad sounds
-		Sound_Process( &sc, SOUND_44k, sc->width, SOUND_RESAMPLE );
-#endif
 	sfx->cache = sc;
 
+	s_cache.size += sc->size + sizeof( wavdata_t );
+	s_cache.loads++;
+	if( sfx->evicted ) s_cache.reloaded++;
+
 	return sfx->cache;
 }
 
+/*
+=================
+S_UnloadSound
+
+release sound data but keep the sfx registered,
+it will be loaded again next time it plays
+=================
+*/
+static void S_UnloadSound( sfx_t *sfx )
+{
+	if( !sfx->cache ) return;
+
+	s_cache.size -= sfx->cache->size + sizeof( wavdata_t );
+	FS_FreeSound( sfx->cache );
+	sfx->cache = NULL;
+}
+
+/*
+=================
+S_TrimSoundCache
+
+unload least recently used sounds until cache
+fits into the budget. Playing sounds are kept
+=================
+*/
+static void S_TrimSoundCache( void )
+{
+	static byte	playing[MAX_SFX];
+	size_t		limit = S_CacheLimit();
+	sfx_t		*sfx, *oldest;
+	channel_t		*ch;
+	int		i, j;
+
+	if( !limit || s_cache.size <= limit )
+		return;
+
+	S_LockMixer();
+
+	Q_memset( playing, 0, s_numSfx );
+
+	for( i = 0, ch = channels; i < MAX_CHANNELS; i++, ch++ )
+	{
+		if( !ch->sfx ) continue;
+		playing[ch->sfx - s_knownSfx] = true;
+
+		if( !ch->isSentence ) continue;
+		for( j = 0; j < CVOXWORDMAX && ch->words[j].sfx; j++ )
+			playing[ch->words[j].sfx - s_knownSfx] = true;
+	}
+
+	for( i = 0; i < s_numQueued; i++ )
+		playing[s_queue[i].sfx - s_knownSfx] = true;
+
+	while( s_cache.size > limit )
+	{
+		oldest = NULL;
+
+		for( i = 0, sfx = s_knownSfx; i < s_numSfx; i++, sfx++ )
+		{
+			if( !sfx->cache || playing[i] )
+				continue;
+
+			if( !oldest || sfx->lastUsed < oldest->lastUsed )
+				oldest = sfx;
+		}
+
+		if( !oldest ) break; // everything is in use
+
+		S_UnloadSound( oldest );
+		oldest->evicted = true;
+		s_cache.evicted++;
+	}
+
+	S_UnlockMixer();
+}
+
+/*
+=================
+S_QueueSound
+
+defer a play request until the sound is loaded,
+returns false if sound must be loaded right now
+=================
+*/
+qboolean S_QueueSound( const vec3_t pos, int ent, int chan, sound_t handle, float fvol, float attn, int pitch, int flags )
+{
+	queuedsound_t	*req;
+	sfx_t		*sfx;
+
+	if( !s_loadtime || s_loadtime->value <= 0.0f || s_registering )
+		return false;
+
+	if( s_numQueued == MAX_QUEUED_SOUNDS )
+		return false;
+
+	sfx = S_GetSfxByHandle( handle );
+
+	// sentences are loaded word by word
+	if( !sfx || sfx->cache || S_TestSoundChar( sfx->name, '!' ))
+		return false;
+
+	req = &s_queue[s_numQueued++];
+	req->sfx = sfx;
+	req->handle = handle;
+	req->hasorigin = ( pos != NULL );
+	if( pos ) VectorCopy( pos, req->origin );
+	req->entnum = ent;
+	req->channel = chan;
+	req->volume = fvol;
+	req->attn = attn;
+	req->pitch = pitch;
+	req->flags = flags;
+	s_cache.deferred++;
+
+	return true;
+}
+
+/*
+=================
+S_CancelQueuedSound
+
+stop request for a sound which is not started yet
+=================
+*/
+void S_CancelQueuedSound( int ent, int chan, sfx_t *sfx )
+{
+	int	i, j;
+
+	for( i = j = 0; i < s_numQueued; i++ )
+	{
+		queuedsound_t	*req = &s_queue[i];
+
+		if( req->entnum == ent && req->channel == chan && ( !sfx || req->sfx == sfx ))
+			continue;
+		s_queue[j++] = *req;
+	}
+	s_numQueued = j;
+}
+
+/*
+=================
+S_ClearLoadQueue
+=================
+*/
+void S_ClearLoadQueue( void )
+{
+	s_numQueued = 0;
+}
+
+/*
+=================
+S_UpdateLoadQueue
+
+load waiting sounds within the per-frame time
+budget and start playing them. At least one
+sound is loaded each frame so queue can't stall
+=================
+*/
+void S_UpdateLoadQueue( void )
+{
+	queuedsound_t	ready[MAX_QUEUED_SOUNDS];
+	int		i, j, numready;
+	double		start, budget;
+
+	if( s_numQueued )
+	{
+		budget = bound( 0.0f, s_loadtime->value, 100.0f ) * 0.001;
+		start = Sys_DoubleTime();
+
+		for( i = 0; i < s_numQueued; i++ )
+		{
+			if( s_queue[i].sfx->cache ) continue;
+			if( i > 0 && ( Sys_DoubleTime() - start ) >= budget )
+				break;
+			S_LoadSound( s_queue[i].sfx );
+		}
+
+		// split off requests which can be started
+		for( i = j = numready = 0; i < s_numQueued; i++ )
+		{
+			if( s_queue[i].sfx->cache )
+				ready[numready++] = s_queue[i];
+			else s_queue[j++] = s_queue[i];
+		}
+		s_numQueued = j;
+
+		for( i = 0; i < numready; i++ )
+		{
+			queuedsound_t	*req = &ready[i];
+
+			S_StartSound( req->hasorigin ? req->origin : NULL, req->entnum, req->channel,
+				req->handle, req->volume, req->attn, req->pitch, req->flags );
+		}
+	}
+
+	S_TrimSoundCache();
+}
+
 // =======================================================================
 // Load a sound
 // =======================================================================
@@ -240,6 +686,7 @@ void S_FreeSound( sfx_t *sfx )
 {
 	sfx_t	*hashSfx;
 	sfx_t	**prev;
+	int	i, j;
 
 	if( !sfx || !sfx->name[0] ) return;
 
@@ -259,7 +706,15 @@ void S_FreeSound( sfx_t *sfx )
 		prev = &hashSfx->hashNext;
 	}
 
-	if( sfx->cache ) FS_FreeSound( sfx->cache );
+	// forget any requests which wait for it
+	for( i = j = 0; i < s_numQueued; i++ )
+	{
+		if( s_queue[i].sfx != sfx )
+			s_queue[j++] = s_queue[i];
+	}
+	s_numQueued = j;
+
+	S_UnloadSound( sfx );
 	Q_memset( sfx, 0, sizeof( *sfx ));
 }
 
@@ -308,17 +763,22 @@ void S_EndRegistration( void )
 	if( !dma.initialized ) return;
 	
 	// free any sounds not from this registration sequence
+	S_LockMixer();
 	for( i = 0, sfx = s_knownSfx; i < s_numSfx; i++, sfx++ )
 	{
 		if( !sfx->name[0] ) continue;
 		if( sfx->touchFrame != s_registration_sequence )
 			S_FreeSound( sfx ); // don't need this sound
 	}
+	S_UnlockMixer();
 
-	// load everything in
+	// load everything in, while it fits into the
+	// cache. Rest of sounds will be loaded on demand
 	for( i = 0, sfx = s_knownSfx; i < s_numSfx; i++, sfx++ )
 	{
 		if( !sfx->name[0] ) continue;
+		if( S_CacheLimit() && s_cache.size >= S_CacheLimit( ))
+			break;
 		S_LoadSound( sfx );
 	}
 	s_registering = false;
@@ -350,7 +810,10 @@ sound_t S_RegisterSound( const char *name )
 	if( !sfx ) return -1;
 
 	sfx->touchFrame = s_registration_sequence;
-	if( !s_registering ) S_LoadSound( sfx );
+
+	// with deferred loading, sound is loaded when it starts playing
+	if( !s_registering && s_loadtime->value <= 0.0f )
+		S_LoadSound( sfx );
 
 	return sfx - s_knownSfx;
 }
@@ -387,6 +850,8 @@ void S_FreeSounds( void )
 	if( !dma.initialized )
 		return;
 
+	S_LockMixer();
+
 	// stop all sounds
 	S_StopAllSounds();
 
@@ -396,7 +861,9 @@ void S_FreeSounds( void )
 
 	Q_memset( s_knownSfx, 0, sizeof( s_knownSfx ));
 	Q_memset( s_sfxHashList, 0, sizeof( s_sfxHashList ));
+	Q_memset( &s_cache, 0, sizeof( s_cache ));
 
 	s_numSfx = 0;
+	S_UnlockMixer();
 }
 #endif // XASH_DEDICATED
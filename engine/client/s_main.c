@@ -37,9 +37,25 @@ listener_t	s_listener;
 int		total_channels;
 int		soundtime;	// sample PAIRS
 int   		paintedtime; 	// sample PAIRS
-static int	trace_count = 0;
 static int	last_trace_chan = 0;
 
+static struct
+{
+	int		traces;		// tracelines since last second
+	int		cached;		// checks answered by cached gain since last second
+	double		time;
+	int		traces_per_sec;
+	int		cached_per_sec;
+} snd_occlusion;
+
+static struct
+{
+	systhread_t	*thread;
+	sysmutex_t	lock;
+	volatile qboolean	quit;
+	int		underruns;	// times the device caught up with the painted samples
+} snd_mixer;
+
 convar_t		*s_volume;
 convar_t		*s_musicvolume;
 convar_t		*s_show;
@@ -59,6 +75,11 @@ convar_t		*s_refdb;
 convar_t		*s_cull;		// cull sounds by geometry
 convar_t		*s_test;		// cvar for testing new effects
 convar_t		*s_phs;
+convar_t		*s_mixthread;
+convar_t		*s_latency;
+convar_t		*s_loadtime;
+convar_t		*s_musicahead;
+convar_t		*s_cachesize;
 
 /*
 =============================================================================
@@ -135,6 +156,26 @@ qboolean S_IsClient( int entnum )
 // next request to play a sound.  If sound is a 
 // word in a sentence, release the sentence.
 // Works for static, dynamic, sentence and stream sounds
+/*
+=================
+S_LockMixer
+
+channels, paintbuffers and streaming state are shared
+with the mixer thread, lock them before any change
+=================
+*/
+void S_LockMixer( void )
+{
+	if( snd_mixer.lock )
+		Sys_LockMutex( snd_mixer.lock );
+}
+
+void S_UnlockMixer( void )
+{
+	if( snd_mixer.lock )
+		Sys_UnlockMutex( snd_mixer.lock );
+}
+
 /*
 =================
 S_FreeChannel
@@ -203,68 +244,98 @@ void S_UpdateSoundFade( void )
 =================
 SND_ChannelOkToTrace
 
-All new sounds must traceline once,
-but cap the max number of tracelines performed per frame
-for longer or looping sounds to SND_TRACE_UPDATE_MAX.
+All new sounds must traceline once, longer or
+looping sounds only when scheduled for this frame
 =================
 */
 qboolean SND_ChannelOkToTrace( channel_t *ch )
 {
-	int 	i, j;
-
 	// always trace first time sound is spatialized
 	if( ch->bfirstpass ) return true;
 
-	// if already traced max channels, return
-	if( trace_count >= SND_TRACE_UPDATE_MAX )
-		return false;
+	if( !ch->bTraced ) return false;
+	ch->bTraced = false;
 
-	// search through all channels starting at g_snd_last_trace_chan index
-	j = last_trace_chan;
+	return true;
+}
 
- 	for( i = 0; i < total_channels; i++ )
-	{
-		if( &( channels[j] ) == ch )
-		{
-			ch->bTraced = true;
-			trace_count++;
-			return true;
-		}
+/*
+=================
+SND_ChannelNeedsTrace
 
-		// wrap channel index
-		if( ++j >= total_channels )
-			j = 0;
+cached obscured gain is valid while source and
+listener stay in place, but not for too long
+=================
+*/
+static qboolean SND_ChannelNeedsTrace( channel_t *ch )
+{
+	wavdata_t	*pSource = ch->sfx->cache;
+
+	if( ch->bfirstpass ) return false; // traced anyway
+
+	// short one-shot sounds are checked once at start
+	if( !ch->isSentence && ch->entchannel != CHAN_STREAM )
+	{
+		if( !ch->use_loop || !pSource || pSource->loopStart == -1 )
+			return false;
 	}
-	
-	// why didn't we find this channel?
-	return false;			
+
+	if( host.realtime - ch->ob_time >= SND_TRACE_MAX_AGE )
+		return true;
+
+	if( VectorDistance2( ch->origin, ch->ob_origin ) > SND_TRACE_MOVE_DIST * SND_TRACE_MOVE_DIST )
+		return true;
+
+	if( VectorDistance2( s_listener.origin, ch->ob_listener ) > SND_TRACE_MOVE_DIST * SND_TRACE_MOVE_DIST )
+		return true;
+
+	snd_occlusion.cached++;
+
+	return false;
 }
 
 /*
 =================
 SND_ChannelTraceReset
 
-reset counters for traceline limiting per audio update
+pick up to SND_TRACE_UPDATE_MAX channels which need new
+obscured check, continuing round-robin from last frame
 =================
 */
 void SND_ChannelTraceReset( void )
 {
-	int	i;
+	int	i, j, count;
+
+	for( i = 0; i < total_channels; i++ )
+		channels[i].bTraced = false;
 
-	// reset search point - make sure we start counting from a new spot 
-	// in channel list each time
-	last_trace_chan += SND_TRACE_UPDATE_MAX;
-	
-	// wrap at total_channels
 	if( last_trace_chan >= total_channels )
-		last_trace_chan = last_trace_chan - total_channels;
+		last_trace_chan = 0;
 
-	// reset traceline counter
-	trace_count = 0;
+	for( i = count = 0, j = last_trace_chan; i < total_channels && count < SND_TRACE_UPDATE_MAX; i++ )
+	{
+		channel_t	*ch = &channels[j];
 
-	// reset channel traceline flag
-	for( i = 0; i < total_channels; i++ )
-		channels[i].bTraced = false; 
+		// wrap channel index
+		if( ++j >= total_channels )
+			j = 0;
+
+		if( !ch->sfx || !SND_ChannelNeedsTrace( ch ))
+			continue;
+
+		ch->bTraced = true;
+		last_trace_chan = j;
+		count++;
+	}
+
+	// update rates for s_info
+	if( host.realtime - snd_occlusion.time >= 1.0 )
+	{
+		snd_occlusion.traces_per_sec = snd_occlusion.traces;
+		snd_occlusion.cached_per_sec = snd_occlusion.cached;
+		snd_occlusion.traces = snd_occlusion.cached = 0;
+		snd_occlusion.time = host.realtime;
+	}
 }
 
 /*
@@ -561,10 +632,16 @@ float SND_GetGainObscured( channel_t *ch, qboolean fplayersound, qboolean floopi
 		return gain;
 	}
 
+	// remember where the check was made
+	VectorCopy( ch->origin, ch->ob_origin );
+	VectorCopy( s_listener.origin, ch->ob_listener );
+	ch->ob_time = host.realtime;
+
 	// set up traceline from player eyes to sound emitting entity origin
 	VectorCopy( ch->origin, endpoint );
 
 	tr = CL_TraceLine( s_listener.origin, endpoint, PM_STUDIO_IGNORE );
+	snd_occlusion.traces++;
 
 	if(( tr.fraction < 1.0f || tr.allsolid || tr.startsolid ) && tr.fraction < 0.99f )
 	{
@@ -619,6 +696,7 @@ float SND_GetGainObscured( channel_t *ch, qboolean fplayersound, qboolean floopi
 		{
 			// UNDONE: some endpoints are in walls - in this case, trace from the wall hit location
 			tr = CL_TraceLine( s_listener.origin, endpoints[i], PM_STUDIO_IGNORE );
+			snd_occlusion.traces++;
 
 			if(( tr.fraction < 1.0f || tr.allsolid || tr.startsolid ) && tr.fraction < 0.99f && !tr.startsolid )
 			{
@@ -860,7 +938,7 @@ it will never be restarted.  Use StartStaticSound (pass CHAN_STATIC to EMIT_SOUN
 SV_StartSound.
 ====================
 */
-void S_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fvol, float attn, int pitch, int flags )
+static void SND_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fvol, float attn, int pitch, int flags )
 {
 	wavdata_t	*pSource;
 	sfx_t	*sfx = NULL;
@@ -879,7 +957,12 @@ void S_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fv
 		if( S_AlterChannel( ent, chan, sfx, vol, pitch, flags ))
 			return;
 
-		if( flags & SND_STOP ) return;
+		if( flags & SND_STOP )
+		{
+			// sound may still wait for loading
+			S_CancelQueuedSound( ent, chan, sfx );
+			return;
+		}
 		// fall through - if we're not trying to stop the sound, 
 		// and we didn't find it (it's not playing), go ahead and start it up
 	}
@@ -890,6 +973,10 @@ void S_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fv
 		return;
 	}
 
+	// not in memory yet, start it when the loader gets to it
+	if( !sfx->cache && S_QueueSound( pos, ent, chan, handle, fvol, attn, pitch, flags ))
+		return;
+
 	if( !pos ) pos = cl.refdef.vieworg;
 
 	// pick a channel to play on
@@ -989,6 +1076,13 @@ void S_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fv
 	}
 }
 
+void S_StartSound( const vec3_t pos, int ent, int chan, sound_t handle, float fvol, float attn, int pitch, int flags )
+{
+	S_LockMixer();
+	SND_StartSound( pos, ent, chan, handle, fvol, attn, pitch, flags );
+	S_UnlockMixer();
+}
+
 /*
 ====================
 S_RestoreSound
@@ -996,7 +1090,7 @@ S_RestoreSound
 Restore a sound effect for the given entity on the given channel
 ====================
 */
-void S_RestoreSound( const vec3_t pos, int ent, int chan, sound_t handle, float fvol, float attn, int pitch, int flags, double sample, double end, int wordIndex )
+static void SND_RestoreSound( const vec3_t pos, int ent, int chan, sound_t handle, float fvol, float attn, int pitch, int flags, double sample, double end, int wordIndex )
 {
 	wavdata_t	*pSource;
 	sfx_t	*sfx = NULL;
@@ -1110,6 +1204,13 @@ void S_RestoreSound( const vec3_t pos, int ent, int chan, sound_t handle, float
 	SND_InitMouth( ent, chan );
 }
 
+void S_RestoreSound( const vec3_t pos, int ent, int chan, sound_t handle, float fvol, float attn, int pitch, int flags, double sample, double end, int wordIndex )
+{
+	S_LockMixer();
+	SND_RestoreSound( pos, ent, chan, handle, fvol, attn, pitch, flags, sample, end, wordIndex );
+	S_UnlockMixer();
+}
+
 /*
 =================
 S_AmbientSound
@@ -1124,7 +1225,7 @@ Pitch changes playback pitch of wave by % above or below 100.  Ignored if pitch
 NOTE: volume is 0.0 - 1.0 and attenuation is 0.0 - 1.0 when passed in.
 =================
 */
-void S_AmbientSound( const vec3_t pos, int ent, sound_t handle, float fvol, float attn, int pitch, int flags )
+static void SND_AmbientSound( const vec3_t pos, int ent, sound_t handle, float fvol, float attn, int pitch, int flags )
 {
 	channel_t	*ch;
 	wavdata_t	*pSource = NULL;
@@ -1214,6 +1315,13 @@ void S_AmbientSound( const vec3_t pos, int ent, sound_t handle, float fvol, floa
 	SND_Spatialize( ch );
 }
 
+void S_AmbientSound( const vec3_t pos, int ent, sound_t handle, float fvol, float attn, int pitch, int flags )
+{
+	S_LockMixer();
+	SND_AmbientSound( pos, ent, handle, fvol, attn, pitch, flags );
+	S_UnlockMixer();
+}
+
 /*
 ==================
 S_StartLocalSound
@@ -1247,6 +1355,8 @@ int S_GetCurrentStaticSounds( soundlist_t *pout, int size )
 	if( !dma.initialized )
 		return 0;
 
+	S_LockMixer();
+
 	for( i = MAX_DYNAMIC_CHANNELS; i < total_channels && sounds_left; i++ )
 	{
 		if( channels[i].entchannel == CHAN_STATIC && channels[i].sfx && channels[i].sfx->name[0] )
@@ -1270,6 +1380,8 @@ int S_GetCurrentStaticSounds( soundlist_t *pout, int size )
 		}
 	}
 
+	S_UnlockMixer();
+
 	return ( size - sounds_left );
 }
 
@@ -1288,6 +1400,8 @@ int S_GetCurrentDynamicSounds( soundlist_t *pout, int size )
 	if( !dma.initialized )
 		return 0;
 
+	S_LockMixer();
+
 	for( i = 0; i < MAX_CHANNELS && sounds_left; i++ )
 	{
 		if( !channels[i].sfx || !channels[i].sfx->name[0] || !Q_stricmp( channels[i].sfx->name, "*default" ))
@@ -1316,6 +1430,8 @@ int S_GetCurrentDynamicSounds( soundlist_t *pout, int size )
 		pout++;
 	}
 
+	S_UnlockMixer();
+
 	return ( size - sounds_left );
 }
 
@@ -1422,7 +1538,11 @@ void S_StopSound( int entnum, int channel, const char *soundname )
 
 	if( !dma.initialized ) return;
 	sfx = S_FindName( soundname, NULL );
+	S_CancelQueuedSound( entnum, channel, sfx );
+
+	S_LockMixer();
 	S_AlterChannel( entnum, channel, sfx, 0, 0, SND_STOP );
+	S_UnlockMixer();
 }
 
 /*
@@ -1435,6 +1555,10 @@ void S_StopAllSounds( void )
 	int	i;
 
 	if( !dma.initialized ) return;
+
+	S_ClearLoadQueue();
+
+	S_LockMixer();
 	total_channels = MAX_DYNAMIC_CHANNELS;	// no statics
 
 	for( i = 0; i < MAX_CHANNELS; i++ ) 
@@ -1456,12 +1580,14 @@ void S_StopAllSounds( void )
 
 	// clear any remaining soundfade
 	Q_memset( &soundfade, 0, sizeof( soundfade ));
+	S_UnlockMixer();
 }
 
 //=============================================================================
 void S_UpdateChannels( void )
 {
 	uint	endtime;
+	float	mixahead;
 	int	samps;
 
 	SNDDMA_BeginPainting();
@@ -1471,10 +1597,24 @@ void S_UpdateChannels( void )
 	// updates DMA time
 	soundtime = SNDDMA_GetSoundtime();
 
+	// device has played out everything what was mixed,
+	// skip the lost part instead of mixing it too late
+	if( paintedtime < soundtime )
+	{
+		if( paintedtime ) snd_mixer.underruns++;
+		paintedtime = soundtime;
+	}
+
+	// mixer thread keeps the buffer filled on its own,
+	// so it only needs to stay ahead for the latency time
+	if( snd_mixer.thread )
+		mixahead = bound( 20, s_latency->integer, 500 ) * 0.001f;
+	else mixahead = s_mixahead->value;
+
 	// soundtime - total samples that have been played out to hardware at dmaspeed
 	// paintedtime - total samples that have been mixed at speed
 	// endtime - target for samples in mixahead buffer at speed
-	endtime = soundtime + s_mixahead->value * SOUND_DMA_SPEED;
+	endtime = soundtime + mixahead * SOUND_DMA_SPEED;
 	samps = dma.samples >> 1;
 
 	if((int)(endtime - soundtime) > samps )
@@ -1487,11 +1627,35 @@ void S_UpdateChannels( void )
 		endtime -= ( endtime - paintedtime ) & 0x3;
 	}
 
+	// take the music decoded by the music thread
+	S_StreamAheadTrack();
+
 	MIX_PaintChannels( endtime );
 
 	SNDDMA_Submit();
 }
 
+/*
+=================
+S_MixerThread
+
+mix ahead from a separate thread so
+slow frames can't starve the device
+=================
+*/
+static void S_MixerThread( void *data )
+{
+	while( !snd_mixer.quit )
+	{
+		Sys_LockMutex( snd_mixer.lock );
+		S_UpdateChannels();
+		Sys_UnlockMutex( snd_mixer.lock );
+
+		// wake up a few times per latency period
+		Sys_Sleep( bound( 1, s_latency->integer / 4, 20 ));
+	}
+}
+
 /*
 =================
 S_ExtraUpdate
@@ -1501,7 +1665,7 @@ Don't let sound skip if going slow
 */
 void S_ExtraUpdate( void )
 {
-	if( !dma.initialized ) return;
+	if( !dma.initialized || snd_mixer.thread ) return;
 	S_UpdateChannels ();
 }
 
@@ -1521,6 +1685,14 @@ void S_RenderFrame( ref_params_t *fd )
 	if( !dma.initialized ) return;
 	if( !fd ) return; // too early
 
+	// load sounds requested since last frame and start them
+	S_UpdateLoadQueue();
+
+	// may open the loop track, so do it before taking the mixer
+	S_StreamBackgroundTrack ();
+
+	S_LockMixer();
+
 	// if the loading plaque is up, clear everything
 	// out to make sure we aren't looping a dirty
 	// dma buffer while loading
@@ -1541,6 +1713,9 @@ void S_RenderFrame( ref_params_t *fd )
 	// update general area ambient sound sources
 	S_UpdateAmbientSounds();
 
+	// choose channels for obscured checks
+	if( s_cull->integer ) SND_ChannelTraceReset();
+
 	combine = NULL;
 
 	// update spatialization for static and dynamic sounds	
@@ -1617,13 +1792,23 @@ void S_RenderFrame( ref_params_t *fd )
 		info.index = 0;
 
 		Con_NXPrintf( &info, "room_type: %i ----(%i)---- painted: %i\n", idsp_room, total - 1, paintedtime );
+		if( s_cull->integer )
+		{
+			info.index = total;
+			Con_NXPrintf( &info, "occlusion: %i traces/sec, %i cached/sec\n", snd_occlusion.traces_per_sec, snd_occlusion.cached_per_sec );
+		}
 	}
 
-	S_StreamBackgroundTrack ();
 	S_StreamSoundTrack ();
 
+	// install new room preset, may reallocate dsp buffers
+	CheckNewDspPresets ();
+
 	// mix some sound
-	S_UpdateChannels ();
+	if( !snd_mixer.thread )
+		S_UpdateChannels ();
+
+	S_UnlockMixer();
 }
 
 /*
@@ -1759,6 +1944,12 @@ void S_SoundInfo_f( void )
 	Msg( "%5d bytes/sec\n", SOUND_DMA_SPEED );
 	Msg( "%5d total_channels\n", total_channels );
 
+	if( snd_mixer.thread )
+		Msg( "mixer thread, %d ms latency\n", (int)bound( 20, s_latency->integer, 500 ));
+	else Msg( "mixing in main thread\n" );
+	Msg( "%5d underruns\n", snd_mixer.underruns );
+	Msg( "%5d occlusion traces/sec, %d cached/sec\n", snd_occlusion.traces_per_sec, snd_occlusion.cached_per_sec );
+
 	S_PrintBackgroundTrackState ();
 }
 
@@ -1788,6 +1979,11 @@ qboolean S_Init( void )
 	s_test = Cvar_Get( "s_test", "0", 0, "engine developer cvar for quick testing of new features" );
 	s_phs = Cvar_Get( "s_phs", "0", CVAR_ARCHIVE, "cull sounds by PHS" );
 	s_khz = Cvar_Get("s_khz", "44", CVAR_ARCHIVE, "set sampling frequency, available values are 11, 22, 44, 48");
+	s_mixthread = Cvar_Get( "s_mixthread", "1", CVAR_ARCHIVE|CVAR_LATCH, "mix sound in a separate thread" );
+	s_latency = Cvar_Get( "s_latency", "50", CVAR_ARCHIVE, "how much sound mixer thread keeps ahead, in milliseconds" );
+	s_loadtime = Cvar_Get( "s_loadtime", "4", CVAR_ARCHIVE, "milliseconds per frame for loading sounds which are not precached, 0 loads them immediately" );
+	s_musicahead = Cvar_Get( "s_musicahead", "3000", CVAR_ARCHIVE, "milliseconds of music decoded ahead in a separate thread, 0 decodes in the main thread" );
+	s_cachesize = Cvar_Get( "s_cachesize", "0", CVAR_ARCHIVE, "sound cache size in megabytes, least recently used sounds are unloaded above it (0 is unlimited)" );
 
 	if( Sys_CheckParm( "-nosound" ))
 	{
@@ -1810,6 +2006,8 @@ qboolean S_Init( void )
 	Cmd_AddCommand( "music", S_Music_f, "start a background track" );
 	Cmd_AddCommand( "soundlist", S_SoundList_f, "display loaded sounds" );
 	Cmd_AddCommand( "s_info", S_SoundInfo_f, "print sound system information" );
+	Cmd_AddCommand( "s_mixbench", S_MixBench_f, "compare speed and output of scalar and vector mixing code" );
+	Cmd_AddCommand( "s_musicbench", S_MusicBench_f, "decode a music track with scalar and vector kernels and print realtime factor" );
 	Cmd_AddCommand( "+voicerecord", Cmd_Null_f, "start voice recording (non-implemented)" );
 	Cmd_AddCommand( "-voicerecord", Cmd_Null_f, "stop voice recording (non-implemented)" );
 	Cmd_AddCommand( "spk", S_SayReliable_f, "reliable play of a specified sentence" );
@@ -1835,6 +2033,21 @@ qboolean S_Init( void )
 	VOX_Init ();
 	AllocDsps ();
 
+	Q_memset( &snd_mixer, 0, sizeof( snd_mixer ));
+
+	if( s_mixthread->integer )
+	{
+		snd_mixer.lock = Sys_CreateMutex();
+		snd_mixer.thread = Sys_CreateThread( S_MixerThread, NULL );
+
+		if( !snd_mixer.thread )
+		{
+			MsgDev( D_WARN, "S_Init: can't start mixer thread\n" );
+			Sys_DestroyMutex( snd_mixer.lock );
+			snd_mixer.lock = NULL;
+		}
+	}
+
 	return true;
 }
 
@@ -1851,11 +2064,21 @@ void S_Shutdown( void )
 	Cmd_RemoveCommand( "music" );
 	Cmd_RemoveCommand( "soundlist" );
 	Cmd_RemoveCommand( "s_info" );
+	Cmd_RemoveCommand( "s_mixbench" );
+	Cmd_RemoveCommand( "s_musicbench" );
 	Cmd_RemoveCommand( "+voicerecord" );
 	Cmd_RemoveCommand( "-voicerecord" );
 	Cmd_RemoveCommand( "spk" );
 	Cmd_RemoveCommand( "speak" );
 
+	if( snd_mixer.thread )
+	{
+		snd_mixer.quit = true;
+		Sys_WaitForThread( snd_mixer.thread );
+		Sys_DestroyMutex( snd_mixer.lock );
+		Q_memset( &snd_mixer, 0, sizeof( snd_mixer ));
+	}
+
 	S_StopAllSounds ();
 	S_FreeSounds ();
 	VOX_Shutdown ();
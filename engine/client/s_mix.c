@@ -44,6 +44,9 @@ paintbuffer_t		paintbuffers[CPAINTBUFFERS];
 
 int			snd_scaletable[SND_SCALE_LEVELS][256];
 
+static qboolean		mix_simd = true;			// s_mixbench switches it to compare results
+static uint		mix_resamplebuffer[PAINTBUFFER_SIZE+1];	// pitch shifted input for vector kernels
+
 void S_InitScaletable( void )
 {
 	int	i, j;
@@ -55,6 +58,347 @@ void S_InitScaletable( void )
 	}
 }
 
+/*
+===============================================================================
+
+VECTOR KERNELS
+
+Mixing stays in integer math, so output of the vector
+kernels matches the scalar code bit to bit (s_mixbench
+checks it). Each loader returns four stereo sample pairs
+as eight interleaved 16-bit values
+
+===============================================================================
+*/
+#ifdef XASH_MIX_SSE2
+typedef __m128i		mixvec_t;
+typedef __m128i		mixvol_t;
+
+_inline mixvol_t MIX_SetVolume( int left, int right )
+{
+	return _mm_set_epi16( right, left, right, left, right, left, right, left );
+}
+
+_inline mixvec_t MIX_LoadStereo16( const short *p )
+{
+	return _mm_loadu_si128( (const __m128i *)p );
+}
+
+_inline mixvec_t MIX_LoadMono16( const short *p )
+{
+	__m128i	x = _mm_loadl_epi64( (const __m128i *)p );
+	return _mm_unpacklo_epi16( x, x );
+}
+
+_inline mixvec_t MIX_LoadStereo8( const byte *p )
+{
+	__m128i	x = _mm_loadl_epi64( (const __m128i *)p );
+	return _mm_srai_epi16( _mm_unpacklo_epi8( x, x ), 8 );
+}
+
+_inline mixvec_t MIX_LoadMono8( const byte *p )
+{
+	__m128i	x = _mm_cvtsi32_si128( *(const int *)p );
+	x = _mm_srai_epi16( _mm_unpacklo_epi8( x, x ), 8 );
+	return _mm_unpacklo_epi16( x, x );
+}
+
+// pbuf[0..3] += ( s * vol ) >> shift
+_inline void MIX_Accumulate( portable_samplepair_t *pbuf, mixvec_t s, mixvol_t vol, int shift )
+{
+	__m128i	lo = _mm_mullo_epi16( s, vol );
+	__m128i	hi = _mm_mulhi_epi16( s, vol );
+	__m128i	count = _mm_cvtsi32_si128( shift );
+	__m128i	*out = (__m128i *)pbuf;
+
+	_mm_storeu_si128( out + 0, _mm_add_epi32( _mm_loadu_si128( out + 0 ), _mm_sra_epi32( _mm_unpacklo_epi16( lo, hi ), count )));
+	_mm_storeu_si128( out + 1, _mm_add_epi32( _mm_loadu_si128( out + 1 ), _mm_sra_epi32( _mm_unpackhi_epi16( lo, hi ), count )));
+}
+
+// low 32 bits of signed 32-bit products, SSE2 has no pmulld
+_inline __m128i MIX_MulLo32( __m128i a, __m128i b )
+{
+	__m128i	even = _mm_mul_epu32( a, b );
+	__m128i	odd = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ));
+
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 )), _mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 )));
+}
+
+// dst[0..1] = src1 + (( src2 * gain ) >> 8 )
+_inline void MIX_AddScaled2( portable_samplepair_t *dst, const portable_samplepair_t *src1, const portable_samplepair_t *src2, int gain )
+{
+	__m128i	a = _mm_loadu_si128( (const __m128i *)src1 );
+	__m128i	b = _mm_loadu_si128( (const __m128i *)src2 );
+
+	b = _mm_srai_epi32( MIX_MulLo32( b, _mm_set1_epi32( gain )), 8 );
+	_mm_storeu_si128( (__m128i *)dst, _mm_add_epi32( a, b ));
+}
+
+// CLIP() for pbuf[0..3]
+_inline void MIX_Clip4( portable_samplepair_t *pbuf )
+{
+	__m128i	*p = (__m128i *)pbuf;
+	__m128i	x = _mm_packs_epi32( _mm_loadu_si128( p + 0 ), _mm_loadu_si128( p + 1 ));
+
+	x = _mm_min_epi16( _mm_max_epi16( x, _mm_set1_epi16( -32760 )), _mm_set1_epi16( 32760 ));
+	_mm_storeu_si128( p + 0, _mm_srai_epi32( _mm_unpacklo_epi16( x, x ), 16 ));
+	_mm_storeu_si128( p + 1, _mm_srai_epi32( _mm_unpackhi_epi16( x, x ), 16 ));
+}
+
+// saturate eight samples down to 16 bit
+_inline void MIX_Saturate8( short *out, const int *in )
+{
+	__m128i	x = _mm_packs_epi32( _mm_loadu_si128( (const __m128i *)in ), _mm_loadu_si128( (const __m128i *)( in + 4 )));
+	_mm_storeu_si128( (__m128i *)out, x );
+}
+
+// signed division by 1 << bits, rounded towards zero like C does
+#define MIX_DIV( x, bits )	_mm_srai_epi32( _mm_add_epi32( x, _mm_srli_epi32( _mm_srai_epi32( x, 31 ), 32 - ( bits ))), bits )
+
+_inline __m128i MIX_LoadPair( const portable_samplepair_t *p )
+{
+	return _mm_loadl_epi64( (const __m128i *)p );
+}
+
+// cubic interpolation of two consecutive sample pairs, see S_Interpolate2xCubic
+_inline __m128i MIX_Cubic( __m128i xm1, __m128i x0, __m128i x1, __m128i x2 )
+{
+	__m128i	a, b, c, t;
+
+	t = _mm_sub_epi32( x0, x1 );
+	a = _mm_add_epi32( _mm_add_epi32( t, t ), t );
+	a = MIX_DIV( _mm_add_epi32( _mm_sub_epi32( a, xm1 ), x2 ), 1 );
+	t = _mm_add_epi32( _mm_add_epi32( _mm_slli_epi32( x0, 2 ), x0 ), x2 );
+	b = _mm_sub_epi32( _mm_add_epi32( _mm_add_epi32( x1, x1 ), xm1 ), MIX_DIV( t, 1 ));
+	c = MIX_DIV( _mm_sub_epi32( x1, xm1 ), 1 );
+
+	t = _mm_add_epi32( MIX_DIV( a, 3 ), MIX_DIV( b, 2 ));
+	return _mm_add_epi32( _mm_add_epi32( t, MIX_DIV( c, 1 )), x0 );
+}
+#endif // XASH_MIX_SSE2
+
+#ifdef XASH_MIX_NEON
+typedef int16x8_t		mixvec_t;
+typedef int16x4_t		mixvol_t;
+
+_inline mixvol_t MIX_SetVolume( int left, int right )
+{
+	int16_t	vol[4];
+
+	vol[0] = vol[2] = left;
+	vol[1] = vol[3] = right;
+	return vld1_s16( vol );
+}
+
+_inline mixvec_t MIX_LoadStereo16( const short *p )
+{
+	return vld1q_s16( p );
+}
+
+_inline mixvec_t MIX_LoadMono16( const short *p )
+{
+	int16x4x2_t	z = vzip_s16( vld1_s16( p ), vld1_s16( p ));
+	return vcombine_s16( z.val[0], z.val[1] );
+}
+
+_inline mixvec_t MIX_LoadStereo8( const byte *p )
+{
+	return vmovl_s8( vld1_s8( (const int8_t *)p ));
+}
+
+_inline mixvec_t MIX_LoadMono8( const byte *p )
+{
+	int32_t		w;
+	int16x4_t		x;
+	int16x4x2_t	z;
+
+	Q_memcpy( &w, p, sizeof( w ));
+	x = vget_low_s16( vmovl_s8( vreinterpret_s8_s32( vdup_n_s32( w ))));
+	z = vzip_s16( x, x );
+	return vcombine_s16( z.val[0], z.val[1] );
+}
+
+_inline void MIX_Accumulate( portable_samplepair_t *pbuf, mixvec_t s, mixvol_t vol, int shift )
+{
+	int32x4_t	count = vdupq_n_s32( -shift );
+	int32_t	*out = (int32_t *)pbuf;
+
+	vst1q_s32( out + 0, vaddq_s32( vld1q_s32( out + 0 ), vshlq_s32( vmull_s16( vget_low_s16( s ), vol ), count )));
+	vst1q_s32( out + 4, vaddq_s32( vld1q_s32( out + 4 ), vshlq_s32( vmull_s16( vget_high_s16( s ), vol ), count )));
+}
+
+_inline void MIX_AddScaled2( portable_samplepair_t *dst, const portable_samplepair_t *src1, const portable_samplepair_t *src2, int gain )
+{
+	int32x4_t	a = vld1q_s32( (const int32_t *)src1 );
+	int32x4_t	b = vld1q_s32( (const int32_t *)src2 );
+
+	b = vshrq_n_s32( vmulq_s32( b, vdupq_n_s32( gain )), 8 );
+	vst1q_s32( (int32_t *)dst, vaddq_s32( a, b ));
+}
+
+_inline void MIX_Clip4( portable_samplepair_t *pbuf )
+{
+	int32_t	*p = (int32_t *)pbuf;
+	int32x4_t	lo = vdupq_n_s32( -32760 );
+	int32x4_t	hi = vdupq_n_s32( 32760 );
+
+	vst1q_s32( p + 0, vminq_s32( vmaxq_s32( vld1q_s32( p + 0 ), lo ), hi ));
+	vst1q_s32( p + 4, vminq_s32( vmaxq_s32( vld1q_s32( p + 4 ), lo ), hi ));
+}
+
+_inline void MIX_Saturate8( short *out, const int *in )
+{
+	int16x4_t	lo = vqmovn_s32( vld1q_s32( (const int32_t *)in ));
+	int16x4_t	hi = vqmovn_s32( vld1q_s32( (const int32_t *)( in + 4 )));
+
+	vst1q_s16( out, vcombine_s16( lo, hi ));
+}
+#endif // XASH_MIX_NEON
+
+#ifdef XASH_MIX_SIMD
+// volume tables of 8-bit paths drop the lowest bits of volume
+#define MIX_VOL8( v )	((( v ) >> SND_SCALE_SHIFT ) << SND_SCALE_SHIFT )
+
+static void S_PaintMonoFrom8Scalar( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount );
+static void S_PaintStereoFrom8Scalar( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount );
+static void S_PaintMonoFrom16Scalar( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount );
+static void S_PaintStereoFrom16Scalar( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount );
+
+static void MIX_VecPaintMono8( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
+{
+	mixvol_t	vol = MIX_SetVolume( MIX_VOL8( volume[0] ), MIX_VOL8( volume[1] ));
+	int	i;
+
+	for( i = 0; i + 4 <= outCount; i += 4 )
+		MIX_Accumulate( pbuf + i, MIX_LoadMono8( pData + i ), vol, 0 );
+
+	if( i < outCount ) S_PaintMonoFrom8Scalar( pbuf + i, volume, pData + i, outCount - i );
+}
+
+static void MIX_VecPaintStereo8( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
+{
+	mixvol_t	vol = MIX_SetVolume( MIX_VOL8( volume[0] ), MIX_VOL8( volume[1] ));
+	int	i;
+
+	for( i = 0; i + 4 <= outCount; i += 4 )
+		MIX_Accumulate( pbuf + i, MIX_LoadStereo8( pData + i * 2 ), vol, 0 );
+
+	if( i < outCount ) S_PaintStereoFrom8Scalar( pbuf + i, volume, pData + i * 2, outCount - i );
+}
+
+static void MIX_VecPaintMono16( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
+{
+	mixvol_t	vol = MIX_SetVolume( volume[0], volume[1] );
+	int	i;
+
+	for( i = 0; i + 4 <= outCount; i += 4 )
+		MIX_Accumulate( pbuf + i, MIX_LoadMono16( pData + i ), vol, 8 );
+
+	if( i < outCount ) S_PaintMonoFrom16Scalar( pbuf + i, volume, pData + i, outCount - i );
+}
+
+static void MIX_VecPaintStereo16( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
+{
+	mixvol_t	vol = MIX_SetVolume( volume[0], volume[1] );
+	int	i;
+
+	for( i = 0; i + 4 <= outCount; i += 4 )
+		MIX_Accumulate( pbuf + i, MIX_LoadStereo16( pData + i * 2 ), vol, 8 );
+
+	if( i < outCount ) S_PaintStereoFrom16Scalar( pbuf + i, volume, pData + i * 2, outCount - i );
+}
+
+/*
+===================
+S_Resample8
+
+pitch shifting for the vector kernels: gather the input
+samples into mix_resamplebuffer with the same fixed point
+stepping as the scalar mixer uses. 8, 16 and 32 bit
+versions are covering mono and stereo sources of both widths
+===================
+*/
+static byte *S_Resample8( const byte *pData, uint sampleFrac, uint rateScale, int outCount )
+{
+	byte	*out = (byte *)mix_resamplebuffer;
+	int	i, sampleIndex = 0;
+
+	for( i = 0; i < outCount; i++ )
+	{
+		out[i] = pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+	}
+	return out;
+}
+
+static word *S_Resample16( const word *pData, uint sampleFrac, uint rateScale, int outCount )
+{
+	word	*out = (word *)mix_resamplebuffer;
+	int	i, sampleIndex = 0;
+
+	for( i = 0; i < outCount; i++ )
+	{
+		out[i] = pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+	}
+	return out;
+}
+
+static uint *S_Resample32( const uint *pData, uint sampleFrac, uint rateScale, int outCount )
+{
+	uint	*out = mix_resamplebuffer;
+	int	i, sampleIndex = 0;
+
+	for( i = 0; i < outCount; i++ )
+	{
+		out[i] = pData[sampleIndex];
+		sampleFrac += rateScale;
+		sampleIndex += FIX_INTPART( sampleFrac );
+		sampleFrac = FIX_FRACPART( sampleFrac );
+	}
+	return out;
+}
+#endif // XASH_MIX_SIMD
+
+/*
+===================
+S_WriteLinearBlast
+
+clamp count values down to 16 bit
+===================
+*/
+static void S_WriteLinearBlast( short *snd_out, const int *snd_p, int count )
+{
+	int	i = 0, val;
+
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		for( ; i + 8 <= count; i += 8 )
+			MIX_Saturate8( snd_out + i, snd_p + i );
+	}
+#endif
+	for( ; i < count; i += 2 )
+	{
+		val = (snd_p[i+0] * 256) >> 8;
+
+		if( val > 0x7fff ) snd_out[i+0] = 0x7fff;
+		else if( val < (short)0x8000 )
+			snd_out[i+0] = (short)0x8000;
+		else snd_out[i+0] = val;
+
+		val = (snd_p[i+1] * 256) >> 8;
+		if( val > 0x7fff ) snd_out[i+1] = 0x7fff;
+		else if( val < (short)0x8000 )
+			snd_out[i+1] = (short)0x8000;
+		else snd_out[i+1] = val;
+	}
+}
+
 /*
 ===================
 S_TransferPaintBuffer
@@ -65,7 +409,7 @@ void S_TransferPaintBuffer( int endtime )
 {
 	int	*snd_p, snd_linear_count;
 	int	lpos, lpaintedtime;
-	int	i, val, sampleMask;
+	int	sampleMask;
 	short	*snd_out;
 	dword	*pbuf;
 
@@ -88,21 +432,7 @@ void S_TransferPaintBuffer( int endtime )
 		snd_linear_count <<= 1;
 
 		// write a linear blast of samples
-		for( i = 0; i < snd_linear_count; i += 2 )
-		{
-			val = (snd_p[i+0] * 256) >> 8;
-
-			if( val > 0x7fff ) snd_out[i+0] = 0x7fff;
-			else if( val < (short)0x8000 )
-				snd_out[i+0] = (short)0x8000;
-			else snd_out[i+0] = val;
-
-			val = (snd_p[i+1] * 256) >> 8;
-			if( val > 0x7fff ) snd_out[i+1] = 0x7fff;
-			else if( val < (short)0x8000 )
-				snd_out[i+1] = (short)0x8000;
-			else snd_out[i+1] = val;
-		}
+		S_WriteLinearBlast( snd_out, snd_p, snd_linear_count );
 
 		snd_p += snd_linear_count;
 		lpaintedtime += (snd_linear_count >> 1);
@@ -217,7 +547,7 @@ CHANNEL MIXING
 
 ===============================================================================
 */
-void S_PaintMonoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
+static void S_PaintMonoFrom8Scalar( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
 {
 	int 	i, data;
 	int	*lscale, *rscale;
@@ -233,7 +563,19 @@ void S_PaintMonoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData, in
 	}
 }
 
-void S_PaintStereoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
+void S_PaintMonoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
+{
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		MIX_VecPaintMono8( pbuf, volume, pData, outCount );
+		return;
+	}
+#endif
+	S_PaintMonoFrom8Scalar( pbuf, volume, pData, outCount );
+}
+
+static void S_PaintStereoFrom8Scalar( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
 {
 	int	*lscale, *rscale;
 	uint	left, right;
@@ -253,7 +595,19 @@ void S_PaintStereoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData,
 	}
 }
 
-void S_PaintMonoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
+void S_PaintStereoFrom8( portable_samplepair_t *pbuf, int *volume, byte *pData, int outCount )
+{
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		MIX_VecPaintStereo8( pbuf, volume, pData, outCount );
+		return;
+	}
+#endif
+	S_PaintStereoFrom8Scalar( pbuf, volume, pData, outCount );
+}
+
+static void S_PaintMonoFrom16Scalar( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
 {
 	int	i, data;
 	int	left, right;
@@ -268,7 +622,19 @@ void S_PaintMonoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData,
 	}
 }
 
-void S_PaintStereoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
+void S_PaintMonoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
+{
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		MIX_VecPaintMono16( pbuf, volume, pData, outCount );
+		return;
+	}
+#endif
+	S_PaintMonoFrom16Scalar( pbuf, volume, pData, outCount );
+}
+
+static void S_PaintStereoFrom16Scalar( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
 {
 	uint	*data;
 	int	left, right;
@@ -289,6 +655,18 @@ void S_PaintStereoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData
 	}
 }
 
+void S_PaintStereoFrom16( portable_samplepair_t *pbuf, int *volume, short *pData, int outCount )
+{
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		MIX_VecPaintStereo16( pbuf, volume, pData, outCount );
+		return;
+	}
+#endif
+	S_PaintStereoFrom16Scalar( pbuf, volume, pData, outCount );
+}
+
 void S_Mix8Mono( portable_samplepair_t *pbuf, int *volume, byte *pData, int inputOffset, uint rateScale, int outCount )
 {
 	int	i, sampleIndex = 0;
@@ -301,6 +679,14 @@ void S_Mix8Mono( portable_samplepair_t *pbuf, int *volume, byte *pData, int inpu
 		S_PaintMonoFrom8( pbuf, volume, pData, outCount );
 		return;
 	}
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		pData = S_Resample8( pData, inputOffset, rateScale, outCount );
+		MIX_VecPaintMono8( pbuf, volume, pData, outCount );
+		return;
+	}
+#endif
 
 	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
 	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
@@ -327,6 +713,14 @@ void S_Mix8Stereo( portable_samplepair_t *pbuf, int *volume, byte *pData, int in
 		S_PaintStereoFrom8( pbuf, volume, pData, outCount );
 		return;
 	}
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		pData = (byte *)S_Resample16( (word *)pData, inputOffset, rateScale, outCount );
+		MIX_VecPaintStereo8( pbuf, volume, pData, outCount );
+		return;
+	}
+#endif
 
 	lscale = snd_scaletable[volume[0] >> SND_SCALE_SHIFT];
 	rscale = snd_scaletable[volume[1] >> SND_SCALE_SHIFT];
@@ -352,6 +746,14 @@ void S_Mix16Mono( portable_samplepair_t *pbuf, int *volume, short *pData, int in
 		S_PaintMonoFrom16( pbuf, volume, pData, outCount );
 		return;
 	}
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		pData = (short *)S_Resample16( (word *)pData, inputOffset, rateScale, outCount );
+		MIX_VecPaintMono16( pbuf, volume, pData, outCount );
+		return;
+	}
+#endif
 
 	for( i = 0; i < outCount; i++ )
 	{
@@ -374,6 +776,14 @@ void S_Mix16Stereo( portable_samplepair_t *pbuf, int *volume, short *pData, int
 		S_PaintStereoFrom16( pbuf, volume, pData, outCount );
 		return;
 	}
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		pData = (short *)S_Resample32( (uint *)pData, inputOffset, rateScale, outCount );
+		MIX_VecPaintStereo16( pbuf, volume, pData, outCount );
+		return;
+	}
+#endif
 
 	for( i = 0; i < outCount; i++ )
 	{
@@ -693,6 +1103,26 @@ void S_Interpolate2xCubic( portable_samplepair_t *pbuffer, portable_samplepair_t
 	// process 'count' samples
 	for( i = 0; i < count; i++)
 	{
+#ifdef XASH_MIX_SSE2
+		// two samples per step once the window i-1..i+3 is inside pbuffer
+		if( mix_simd && i >= 3 && i + 2 <= count )
+		{
+			__m128i	pm1 = MIX_LoadPair( &pbuffer[(i-3) * 2 + 1] );
+			__m128i	p0 = MIX_LoadPair( &pbuffer[(i-2) * 2 + 1] );
+			__m128i	p1 = MIX_LoadPair( &pbuffer[(i-1) * 2 + 1] );
+			__m128i	p2 = MIX_LoadPair( &pbuffer[i * 2 + 1] );
+			__m128i	p3 = MIX_LoadPair( &pbuffer[(i+1) * 2 + 1] );
+			__m128i	v0 = _mm_unpacklo_epi64( p0, p1 );
+			__m128i	y;
+
+			y = MIX_Cubic( _mm_unpacklo_epi64( pm1, p0 ), v0, _mm_unpacklo_epi64( p1, p2 ), _mm_unpacklo_epi64( p2, p3 ));
+			_mm_storeu_si128( (__m128i *)&temppaintbuffer[outpos+0], _mm_unpacklo_epi64( v0, y ));
+			_mm_storeu_si128( (__m128i *)&temppaintbuffer[outpos+2], _mm_unpackhi_epi64( v0, y ));
+			outpos += 4;
+			i++;
+			continue;
+		}
+#endif
 		// get source sample pointer
 		psamp0 = S_GetNextpFilter( i-1, pbuffer, pfiltermem );
 		psamp1 = S_GetNextpFilter( i,   pbuffer, pfiltermem );
@@ -831,13 +1261,51 @@ void MIX_ClearAllPaintBuffers( int SampleCount, qboolean clearFilters )
 	}
 }
 
+// pbuf3 = pbuf1 + pbuf2 * gain / 256
+static void S_MixScaledBuffers( const portable_samplepair_t *pbuf1, const portable_samplepair_t *pbuf2, portable_samplepair_t *pbuf3, int count, int gain )
+{
+	int	i = 0;
+
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		for( ; i + 2 <= count; i += 2 )
+			MIX_AddScaled2( pbuf3 + i, pbuf1 + i, pbuf2 + i, gain );
+	}
+#endif
+	for( ; i < count; i++ )
+	{
+		pbuf3[i].left = pbuf1[i].left + ((pbuf2[i].left * gain) >> 8);
+		pbuf3[i].right = pbuf1[i].right + ((pbuf2[i].right * gain) >> 8);
+	}
+}
+
+// clip all values > 16 bit down to 16 bit
+static void S_ClipBuffer( portable_samplepair_t *pbuf, int count )
+{
+	int	i = 0;
+
+#ifdef XASH_MIX_SIMD
+	if( mix_simd )
+	{
+		for( ; i + 4 <= count; i += 4 )
+			MIX_Clip4( pbuf + i );
+	}
+#endif
+	for( ; i < count; i++ )
+	{
+		pbuf[i].left = CLIP( pbuf[i].left );
+		pbuf[i].right = CLIP( pbuf[i].right );
+	}
+}
+
 // mixes pbuf1 + pbuf2 into pbuf3, count samples
 // fgain is output gain 0-1.0
 // NOTE: pbuf3 may equal pbuf1 or pbuf2!
 void MIX_MixPaintbuffers( int ibuf1, int ibuf2, int ibuf3, int count, float fgain )
 {
 	portable_samplepair_t	*pbuf1, *pbuf2, *pbuf3;
-	int			i, gain;
+	int			gain;
 
 	gain = 256 * fgain;
 	
@@ -858,29 +1326,15 @@ void MIX_MixPaintbuffers( int ibuf1, int ibuf2, int ibuf3, int count, float fgai
 	// pb1 (4ch->2ch) + pb2 (4ch->2ch)	-> pb3 2ch
 
 	// mix front channels
-	for( i = 0; i < count; i++ )
-	{
-		pbuf3[i].left = pbuf1[i].left;
-		pbuf3[i].right = pbuf1[i].right;
-		pbuf3[i].left += (pbuf2[i].left * gain) >> 8;
-		pbuf3[i].right += (pbuf2[i].right * gain) >> 8;
-	}
+	S_MixScaledBuffers( pbuf1, pbuf2, pbuf3, count, gain );
 }
 
 void MIX_CompressPaintbuffer( int ipaint, int count )
 {
-	portable_samplepair_t	*pbuf;
-	paintbuffer_t		*ppaint;
-	int			i;
+	paintbuffer_t	*ppaint;
 
 	ppaint = MIX_GetPPaintFromIPaint( ipaint );
-	pbuf = ppaint->pbuf;
-	
-	for( i = 0; i < count; i++, pbuf++ )
-	{
-		pbuf->left = CLIP( pbuf->left );
-		pbuf->right = CLIP( pbuf->right );
-	}
+	S_ClipBuffer( ppaint->pbuf, count );
 }
 
 void S_MixUpsample( int sampleCount, int filtertype )
@@ -1020,8 +1474,6 @@ void MIX_PaintChannels( int endtime )
 	int	end, count;
 	float	dsp_room_gain;
 
-	CheckNewDspPresets();
-
 	// get dsp preset gain values, update gain crossfaders,
 	// used when mixing dsp processed buffers into paintbuffer
 	dsp_room_gain = DSP_GetGain( idsp_room );	// update crossfader - gain only used in MIX_ScaleChannelVolume
@@ -1061,4 +1513,155 @@ void MIX_PaintChannels( int endtime )
 		paintedtime = end;
 	}
 }
+/*
+===============================================================================
+
+MIXER BENCHMARK
+
+===============================================================================
+*/
+#define MIXBENCH_CHANNELS	32
+#define MIXBENCH_SAMPLES	4096	// stereo 16-bit frames per channel source
+
+typedef struct
+{
+	portable_samplepair_t	room[PAINTBUFFER_SIZE+1];
+	portable_samplepair_t	dry[PAINTBUFFER_SIZE+1];
+	portable_samplepair_t	fltmem[CPAINTFILTERMEM];
+	short			output[PAINTBUFFER_SIZE*2];
+} mixbench_t;
+
+/*
+===================
+S_MixBenchPass
+
+same work as one MIX_PaintChannels step: pitched and unpitched
+channels of every format, 2x cubic upsample of the 22k room
+buffer, room + dry mixing, clipping and 16-bit output
+===================
+*/
+static void S_MixBenchPass( mixbench_t *mb, byte *sources, int pass )
+{
+	const float	pitch[3] = { 1.0f, 0.84f, 1.26f };
+	int		i, ch, count, vol[CCHANVOLUMES];
+	portable_samplepair_t	*pbuf;
+	byte		*pData;
+
+	Q_memset( mb->room, 0, sizeof( mb->room ));
+	Q_memset( mb->dry, 0, sizeof( mb->dry ));
+
+	for( ch = 0; ch < MIXBENCH_CHANNELS; ch++ )
+	{
+		uint	rate = FIX_FLOAT( pitch[ch % 3] );
+		uint	frac = FIX_FLOAT( 0.25f * ( ch & 3 ));
+
+		// half of channels is going to 22k room buffer
+		if( ch & 4 )
+		{
+			pbuf = mb->room;
+			count = PAINTBUFFER_SIZE / 2;
+		}
+		else
+		{
+			pbuf = mb->dry;
+			count = PAINTBUFFER_SIZE;
+		}
+
+		vol[0] = ( 40 + ch * 29 ) & 255;
+		vol[1] = ( 255 - ch * 13 ) & 255;
+		pData = sources + ch * MIXBENCH_SAMPLES * 4 + (( pass * 131 + ch * 17 ) & 1023 ) * 4;
+
+		switch( ch & 3 )
+		{
+		case 0: S_Mix8Mono( pbuf, vol, pData, frac, rate, count ); break;
+		case 1: S_Mix8Stereo( pbuf, vol, pData, frac, rate, count ); break;
+		case 2: S_Mix16Mono( pbuf, vol, (short *)pData, frac, rate, count ); break;
+		case 3: S_Mix16Stereo( pbuf, vol, (short *)pData, frac, rate, count ); break;
+		}
+	}
+
+	// S_MixBufferUpsample2x is skipping interpolation without s_lerping
+	for( i = PAINTBUFFER_SIZE / 2 - 1; i >= 0; i-- )
+		mb->room[i*2+0] = mb->room[i*2+1] = mb->room[i];
+	S_Interpolate2xCubic( mb->room, mb->fltmem, CPAINTFILTERMEM, PAINTBUFFER_SIZE / 2 );
+
+	S_MixScaledBuffers( mb->dry, mb->room, mb->dry, PAINTBUFFER_SIZE, 179 );
+	S_ClipBuffer( mb->dry, PAINTBUFFER_SIZE );
+	S_WriteLinearBlast( mb->output, (int *)mb->dry, PAINTBUFFER_SIZE * 2 );
+}
+
+/*
+===================
+S_MixBench_f
+
+s_mixbench [passes]
+
+mix a fixed channel set with scalar and vector kernels,
+compare the output and print the time of both
+===================
+*/
+void S_MixBench_f( void )
+{
+	mixbench_t	*mb[2];
+	double		start, time[2];
+	int		i, pass, passes, mode, numdiffs, maxdiff;
+	qboolean		oldsimd = mix_simd;
+	uint		seed = 0x1234;
+	byte		*sources;
+
+	passes = ( Cmd_Argc() > 1 ) ? max( 1, Q_atoi( Cmd_Argv( 1 ))) : 1000;
+
+	sources = Z_Malloc( MIXBENCH_CHANNELS * MIXBENCH_SAMPLES * 4 );
+	for( i = 0; i < MIXBENCH_CHANNELS * MIXBENCH_SAMPLES * 4; i++ )
+	{
+		seed = seed * 1103515245 + 12345;
+		sources[i] = ( seed >> 16 ) & 0xFF;
+	}
+
+	mb[0] = Z_Malloc( sizeof( mixbench_t ));
+	mb[1] = Z_Malloc( sizeof( mixbench_t ));
+	time[0] = time[1] = 0.0;
+	numdiffs = maxdiff = 0;
+
+	// mixer thread uses the same buffers and mix_simd
+	S_LockMixer();
+
+	for( pass = 0; pass < passes; pass++ )
+	{
+		// 0 is the scalar reference
+		for( mode = 0; mode < 2; mode++ )
+		{
+			mix_simd = mode;
+			start = Sys_DoubleTime();
+			S_MixBenchPass( mb[mode], sources, pass );
+			time[mode] += Sys_DoubleTime() - start;
+		}
+
+		for( i = 0; i < PAINTBUFFER_SIZE * 2; i++ )
+		{
+			int	diff = abs( mb[0]->output[i] - mb[1]->output[i] );
+
+			if( !diff ) continue;
+			maxdiff = max( maxdiff, diff );
+			numdiffs++;
+		}
+	}
+
+	mix_simd = oldsimd;
+	S_UnlockMixer();
+
+	Msg( "s_mixbench: %i channels, %i passes of %i samples\n", MIXBENCH_CHANNELS, passes, PAINTBUFFER_SIZE );
+	Msg( "scalar: %.4f ms per pass\n", time[0] * 1000.0 / passes );
+#ifdef XASH_MIX_SIMD
+	Msg( "vector: %.4f ms per pass (%.2fx)\n", time[1] * 1000.0 / passes, time[0] / max( time[1], 1e-9 ));
+
+	if( numdiffs ) Msg( "^1output: %i samples differ, max difference %i\n", numdiffs, maxdiff );
+	else Msg( "output: identical\n" );
+#else
+	Msg( "vector kernels are not compiled in\n" );
+#endif
+	Mem_Free( mb[0] );
+	Mem_Free( mb[1] );
+	Mem_Free( sources );
+}
 #endif // XASH_DEDICATED
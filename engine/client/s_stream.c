@@ -19,9 +19,35 @@ GNU General Public License for more details.
 #include "sound.h"
 #include "client.h"
 
+#define MUSIC_CHUNK		4096	// bytes decoded by the music thread at once
+
+// background track decoding ahead in a separate thread
+typedef struct
+{
+	systhread_t	*thread;
+	sysmutex_t	lock;		// guards everything below
+	volatile qboolean	quit;
+
+	stream_t		*stream;		// track which is decoded now
+	wavdata_t		info;		// format of the ring data
+	stream_t		*next;		// loop track, opened ahead by the main thread
+	wavdata_t		nextinfo;
+	stream_t		*finished;	// intro track, main thread should free it
+	qboolean		eof;		// stream is over, waiting for the loop track
+	int		position;		// FS_GetStreamPos after last decoded chunk
+
+	byte		*ring;		// decoded samples
+	int		size;		// ring size in bytes
+	int		head;		// read offset
+	int		fill;		// bytes ready to play
+	qboolean		starved;		// ring ran empty, underrun is counted once
+	int		underruns;
+} musicthread_t;
+
 portable_samplepair_t	s_rawsamples[MAX_RAW_SAMPLES];
 static bg_track_t		s_bgTrack;
 static musicfade_t		musicfade;	// controlled by game dlls
+static musicthread_t	s_music;
 int			s_rawend;
 
 void S_PrintBackgroundTrackState( void )
@@ -32,6 +58,18 @@ void S_PrintBackgroundTrackState( void )
 		Msg( "BackgroundTrack: %s\n", s_bgTrack.current );
 	else if( s_bgTrack.loopName[0] )
 		Msg( "BackgroundTrack: %s [loop]\n", s_bgTrack.loopName );
+
+	if( s_music.thread )
+	{
+		int	fill, size, framerate;
+
+		Sys_LockMutex( s_music.lock );
+		framerate = s_music.info.rate * s_music.info.width * s_music.info.channels;
+		fill = s_music.fill * 1000.0 / framerate;
+		size = s_music.size * 1000.0 / framerate;
+		Msg( "decoded ahead: %i of %i ms, %i underruns\n", fill, size, s_music.underruns );
+		Sys_UnlockMutex( s_music.lock );
+	}
 }
 
 void S_CheckLerpingState( void )
@@ -73,6 +111,216 @@ float S_GetMusicVolume( void )
 	return s_musicvolume->value * scale;
 }
 
+/*
+=================
+S_MusicWrite
+
+append decoded data to the ring, caller checks for space
+=================
+*/
+static void S_MusicWrite( const byte *data, int bytes )
+{
+	int	tail = ( s_music.head + s_music.fill ) % s_music.size;
+	int	count = min( bytes, s_music.size - tail );
+
+	Q_memcpy( s_music.ring + tail, data, count );
+	Q_memcpy( s_music.ring, data + count, bytes - count );
+	s_music.fill += bytes;
+}
+
+/*
+=================
+S_MusicRead
+
+take data from the ring, caller checks for fill
+=================
+*/
+static void S_MusicRead( byte *data, int bytes )
+{
+	int	count = min( bytes, s_music.size - s_music.head );
+
+	Q_memcpy( data, s_music.ring + s_music.head, count );
+	Q_memcpy( data + count, s_music.ring, bytes - count );
+	s_music.head = ( s_music.head + bytes ) % s_music.size;
+	s_music.fill -= bytes;
+}
+
+/*
+=================
+S_MusicThread
+
+Keep the ring filled with decoded samples. Streams are cached
+in memory, so the thread never touches the filesystem and
+music goes on while the main thread is busy with loading
+=================
+*/
+static void S_MusicThread( void *data )
+{
+	byte		chunk[MUSIC_CHUNK];
+	stream_t		*stream;
+	int		r, pos, framesize;
+	qboolean		decode;
+
+	while( !s_music.quit )
+	{
+		Sys_LockMutex( s_music.lock );
+
+		// go to the loop track, if it has other format than
+		// intro, let the consumer drain the ring at first
+		if( s_music.eof && s_music.next && !s_music.finished )
+		{
+			if( !s_music.fill || ( s_music.nextinfo.rate == s_music.info.rate && s_music.nextinfo.width == s_music.info.width
+			&& s_music.nextinfo.channels == s_music.info.channels ))
+			{
+				s_music.finished = s_music.stream;
+				s_music.stream = s_music.next;
+				s_music.info = s_music.nextinfo;
+				s_music.next = NULL;
+				s_music.eof = false;
+			}
+		}
+
+		stream = s_music.stream;
+		framesize = s_music.info.width * s_music.info.channels;
+		decode = !s_music.eof && ( s_music.size - s_music.fill ) >= MUSIC_CHUNK;
+		Sys_UnlockMutex( s_music.lock );
+
+		if( !decode )
+		{
+			Sys_Sleep( 5 );
+			continue;
+		}
+
+		r = FS_ReadStream( stream, MUSIC_CHUNK, chunk );
+		r -= r % framesize;
+		pos = FS_GetStreamPos( stream );
+
+		Sys_LockMutex( s_music.lock );
+		if( r > 0 ) S_MusicWrite( chunk, r );
+		else s_music.eof = true;
+		s_music.position = pos;
+		Sys_UnlockMutex( s_music.lock );
+	}
+}
+
+/*
+=================
+S_StartMusicThread
+
+decode current background track in a separate thread
+=================
+*/
+static void S_StartMusicThread( void )
+{
+	wavdata_t	*info;
+
+	if( s_musicahead->integer <= 0 || !s_bgTrack.stream )
+		return;
+
+	// the thread can't read from disk
+	if( !FS_CacheStream( s_bgTrack.stream ))
+		return;
+
+	info = FS_StreamInfo( s_bgTrack.stream );
+
+	Q_memset( &s_music, 0, sizeof( s_music ));
+	s_music.stream = s_bgTrack.stream;
+	s_music.info = *info;
+	s_music.position = FS_GetStreamPos( s_bgTrack.stream );
+	s_music.starved = true;
+
+	s_music.size = bound( 100, s_musicahead->integer, 10000 ) * info->rate / 1000 * info->width * info->channels;
+	s_music.size = max( s_music.size, MUSIC_CHUNK * 2 );
+	s_music.ring = Mem_Alloc( sndpool, s_music.size );
+
+	s_music.lock = Sys_CreateMutex();
+	s_music.thread = Sys_CreateThread( S_MusicThread, NULL );
+
+	if( !s_music.thread )
+	{
+		MsgDev( D_WARN, "S_StartMusicThread: can't start music thread\n" );
+		Sys_DestroyMutex( s_music.lock );
+		Mem_Free( s_music.ring );
+		Q_memset( &s_music, 0, sizeof( s_music ));
+	}
+}
+
+/*
+=================
+S_StopMusicThread
+
+stop the thread and free all the streams it owns
+=================
+*/
+static void S_StopMusicThread( void )
+{
+	if( !s_music.thread ) return;
+
+	s_music.quit = true;
+	Sys_WaitForThread( s_music.thread );
+	Sys_DestroyMutex( s_music.lock );
+
+	if( s_music.stream ) FS_FreeStream( s_music.stream );
+	if( s_music.next ) FS_FreeStream( s_music.next );
+	if( s_music.finished ) FS_FreeStream( s_music.finished );
+	Mem_Free( s_music.ring );
+
+	Q_memset( &s_music, 0, sizeof( s_music ));
+}
+
+/*
+=================
+S_UpdateMusicThread
+
+free played intro track and open loop track
+ahead of time, so the thread may switch to it
+=================
+*/
+static void S_UpdateMusicThread( void )
+{
+	stream_t	*finished, *next;
+	qboolean	over;
+
+	Sys_LockMutex( s_music.lock );
+	finished = s_music.finished;
+	s_music.finished = NULL;
+	next = s_music.next;
+	over = s_music.eof && !s_music.next && !s_music.fill;
+	Sys_UnlockMutex( s_music.lock );
+
+	if( finished )
+	{
+		FS_FreeStream( finished );
+		s_bgTrack.stream = s_music.stream;
+		Q_strncpy( s_bgTrack.current, s_bgTrack.loopName, sizeof( s_bgTrack.current ));
+		S_CheckLerpingState();
+	}
+
+	if( over && !s_bgTrack.loopName[0] )
+	{
+		S_StopBackgroundTrack();
+		return;
+	}
+
+	if( !next && s_bgTrack.loopName[0] )
+	{
+		next = FS_OpenStream( va( "media/%s", s_bgTrack.loopName ));
+
+		if( !next || !FS_CacheStream( next ))
+		{
+			// play the current track up to end
+			if( next ) FS_FreeStream( next );
+			s_bgTrack.loopName[0] = '\0';
+			return;
+		}
+
+		Sys_LockMutex( s_music.lock );
+		s_music.next = next;
+		s_music.nextinfo = *FS_StreamInfo( next );
+		Sys_UnlockMutex( s_music.lock );
+	}
+}
+
 /*
 =================
 S_StartBackgroundTrack
@@ -113,6 +361,7 @@ void S_StartBackgroundTrack( const char *introTrack, const char *mainTrack, int
 	}
 
 	S_CheckLerpingState();
+	S_StartMusicThread();
 }
 
 void S_StopBackgroundTrack( void )
@@ -122,11 +371,15 @@ void S_StopBackgroundTrack( void )
 	if( !dma.initialized ) return;
 	if( !s_bgTrack.stream ) return;
 
-	FS_FreeStream( s_bgTrack.stream );
+	S_LockMixer();
+	if( s_music.thread )
+		S_StopMusicThread(); // current stream is owned by the thread
+	else FS_FreeStream( s_bgTrack.stream );
 	Q_memset( &s_bgTrack, 0, sizeof( bg_track_t ));
 	Q_memset( &musicfade, 0, sizeof( musicfade ));
 	s_listener.lerping = false;
 	s_rawend = 0;
+	S_UnlockMixer();
 }
 
 void S_StreamSetPause( int pause )
@@ -161,39 +414,57 @@ qboolean S_StreamGetCurrentState( char *currentTrack, char *loopTrack, fs_offset
 	}
 
 	if( position )
-		*position = FS_GetStreamPos( s_bgTrack.stream );
+	{
+		if( s_music.thread )
+		{
+			Sys_LockMutex( s_music.lock );
+			*position = s_music.position;
+			Sys_UnlockMutex( s_music.lock );
+		}
+		else *position = FS_GetStreamPos( s_bgTrack.stream );
+	}
 
 	return true;
 }
 
 /*
 =================
-S_StreamBackgroundTrack
+S_BackgroundTrackPaused
 =================
 */
-void S_StreamBackgroundTrack( void )
+static qboolean S_BackgroundTrackPaused( void )
 {
-	int	bufferSamples;
-	int	fileSamples;
-	byte	raw[MAX_RAW_SAMPLES];
-	int	r, fileBytes;
-
-	if( !dma.initialized ) return;
-	if( !s_bgTrack.stream ) return;
-	if( s_listener.streaming ) return;	// we are playing movie or somewhat
+	if( s_listener.streaming ) return true;	// we are playing movie or somewhat
 
 	// don't bother playing anything if musicvolume is 0
 	if( !s_musicvolume->value || s_listener.paused || s_listener.stream_paused )
-		return;
+		return true;
 
 	if( !cl.background )
 	{
 		// pause music by source type
-		if( s_bgTrack.source == key_game && cls.key_dest == key_menu ) return;
-		if( s_bgTrack.source == key_menu && cls.key_dest != key_menu ) return;
+		if( s_bgTrack.source == key_game && cls.key_dest == key_menu ) return true;
+		if( s_bgTrack.source == key_menu && cls.key_dest != key_menu ) return true;
 	}
 	else if( cls.key_dest == key_console )
-		return;
+		return true;
+
+	return false;
+}
+
+/*
+=================
+S_ReadBackgroundTrack
+
+decode the track in the main thread
+=================
+*/
+static void S_ReadBackgroundTrack( void )
+{
+	int	bufferSamples;
+	int	fileSamples;
+	byte	raw[MAX_RAW_SAMPLES];
+	int	r, fileBytes;
 
 	// see how many samples should be copied into the raw buffer
 	if( s_rawend < soundtime )
@@ -254,6 +525,177 @@ void S_StreamBackgroundTrack( void )
 	}
 }
 
+/*
+=================
+S_StreamBackgroundTrack
+
+called from the main thread each frame
+=================
+*/
+void S_StreamBackgroundTrack( void )
+{
+	if( !dma.initialized ) return;
+	if( !s_bgTrack.stream ) return;
+
+	if( s_music.thread )
+	{
+		// thread does the decoding, mixer takes the samples
+		S_UpdateMusicThread();
+		return;
+	}
+
+	if( S_BackgroundTrackPaused( ))
+		return;
+
+	S_LockMixer();
+	S_ReadBackgroundTrack();
+	S_UnlockMixer();
+}
+
+/*
+=================
+S_StreamAheadTrack
+
+move samples decoded by the music thread into the raw
+buffer, called by the mixer before painting
+=================
+*/
+void S_StreamAheadTrack( void )
+{
+	int	fileSamples, fileBytes;
+	byte	raw[MAX_RAW_SAMPLES];
+	int	framesize;
+
+	if( !s_music.thread || S_BackgroundTrackPaused( ))
+		return;
+
+	// see how many samples should be copied into the raw buffer
+	if( s_rawend < soundtime )
+		s_rawend = soundtime;
+
+	Sys_LockMutex( s_music.lock );
+	framesize = s_music.info.width * s_music.info.channels;
+
+	while( s_rawend < soundtime + MAX_RAW_SAMPLES )
+	{
+		// decide how much data needs to be taken from the ring
+		fileSamples = ( MAX_RAW_SAMPLES - ( s_rawend - soundtime )) * ((float)s_music.info.rate / SOUND_DMA_SPEED );
+		if( fileSamples <= 1 ) break; // no more samples need
+
+		fileBytes = min( fileSamples * framesize, sizeof( raw ));
+		fileBytes = min( fileBytes, s_music.fill );
+		fileBytes -= fileBytes % framesize;
+
+		if( fileBytes <= 0 )
+		{
+			// track start and end are not underruns
+			if( !s_music.starved && !s_music.eof )
+				s_music.underruns++;
+			s_music.starved = true;
+			break;
+		}
+
+		S_MusicRead( raw, fileBytes );
+		S_StreamRawSamples( fileBytes / framesize, s_music.info.rate, s_music.info.width, s_music.info.channels, raw );
+		s_music.starved = false;
+	}
+
+	Sys_UnlockMutex( s_music.lock );
+}
+
+/*
+=================
+S_MusicBench_f
+
+s_musicbench <track>
+
+decode whole track from media folder with scalar and
+vector synthesis kernels, compare the output and print
+how much faster than realtime the decoder runs
+=================
+*/
+void S_MusicBench_f( void )
+{
+	byte		chunk[2][MUSIC_CHUNK];
+	stream_t		*stream[2];
+	double		start, time[2], length;
+	int		i, r[2], mode, total;
+	int		numdiffs, maxdiff;
+	qboolean		oldsimd;
+	wavdata_t		*info;
+
+	if( Cmd_Argc() != 2 )
+	{
+		Msg( "Usage: s_musicbench <track>\n" );
+		return;
+	}
+
+	for( mode = 0; mode < 2; mode++ )
+	{
+		// decode from memory to measure the decoder only
+		stream[mode] = FS_OpenStream( va( "media/%s", Cmd_Argv( 1 )));
+
+		if( !stream[mode] || !FS_CacheStream( stream[mode] ))
+		{
+			Msg( "s_musicbench: couldn't open %s\n", Cmd_Argv( 1 ));
+			if( stream[mode] ) FS_FreeStream( stream[mode] );
+			if( mode ) FS_FreeStream( stream[0] );
+			return;
+		}
+	}
+
+	oldsimd = Sound_SetDecoderSIMD( false );
+	time[0] = time[1] = 0.0;
+	total = numdiffs = maxdiff = 0;
+
+	while( 1 )
+	{
+		// 0 is the scalar reference
+		for( mode = 0; mode < 2; mode++ )
+		{
+			Sound_SetDecoderSIMD( mode );
+			start = Sys_DoubleTime();
+			r[mode] = FS_ReadStream( stream[mode], MUSIC_CHUNK, chunk[mode] );
+			time[mode] += Sys_DoubleTime() - start;
+		}
+
+		if( r[0] <= 0 || r[0] != r[1] )
+			break;
+
+		info = FS_StreamInfo( stream[0] );
+
+		for( i = 0; i < r[0] / info->width; i++ )
+		{
+			int	diff;
+
+			if( info->width == 2 )
+				diff = abs( ((short *)chunk[0])[i] - ((short *)chunk[1])[i] );
+			else diff = abs( chunk[0][i] - chunk[1][i] );
+
+			if( !diff ) continue;
+			maxdiff = max( maxdiff, diff );
+			numdiffs++;
+		}
+		total += r[0];
+	}
+
+	Sound_SetDecoderSIMD( oldsimd );
+
+	info = FS_StreamInfo( stream[0] );
+	length = (double)total / ( info->rate * info->width * info->channels );
+
+	Msg( "s_musicbench: %s, %.1f sec, %i Hz, %i channel(s)\n", Cmd_Argv( 1 ), length, info->rate, info->channels );
+	Msg( "scalar: %.1f ms, %.1fx realtime\n", time[0] * 1000.0, length / max( time[0], 1e-9 ));
+	Msg( "vector: %.1f ms, %.1fx realtime\n", time[1] * 1000.0, length / max( time[1], 1e-9 ));
+
+	if( r[0] != r[1] ) Msg( "^1output: streams have different length\n" );
+	else if( numdiffs ) Msg( "output: %i samples differ, max difference %i\n", numdiffs, maxdiff );
+	else Msg( "output: identical\n" );
+
+	FS_FreeStream( stream[0] );
+	FS_FreeStream( stream[1] );
+}
+
 /*
 =================
 S_StartStreaming
@@ -263,8 +705,10 @@ void S_StartStreaming( void )
 {
 	if( !dma.initialized ) return;
 	// begin streaming movie soundtrack
+	S_LockMixer();
 	s_listener.streaming = true;
 	s_listener.lerping = false;
+	S_UnlockMixer();
 }
 
 /*
@@ -275,9 +719,11 @@ S_StopStreaming
 void S_StopStreaming( void )
 {
 	if( !dma.initialized ) return;
+	S_LockMixer();
 	s_listener.streaming = false;
 	s_listener.lerping = false;
 	s_rawend = 0;
+	S_UnlockMixer();
 }
 
 /*
@@ -381,6 +827,8 @@ void S_StreamRawSamples( int samples, int rate, int width, int channels, const b
 		} \
 	}
 		
+	S_LockMixer();
+
 	if( s_rawend < paintedtime )
 		s_rawend = paintedtime;
 
@@ -394,5 +842,7 @@ void S_StreamRawSamples( int samples, int rate, int width, int channels, const b
 		byte *in = (unsigned char *)data;
 		RESAMPLE_RAW
 	}
+
+	S_UnlockMixer();
 }
 #endif // XASH_DEDICATED
@@ -509,6 +509,9 @@ void VOX_LoadSound( channel_t *pchan, const char *pszin )
 			// find name, if already in cache, mark voxword
 			// so we don't discard when word is done playing
 			rgvoxword[cword].sfx = S_FindName( pathbuffer, &( rgvoxword[cword].fKeepCached ));
+
+			// next words are loaded by the mixer, which can't read files
+			S_LoadSound( rgvoxword[cword].sfx );
 			cword++;
 		}
 		i++;
@@ -20,6 +20,19 @@ extern byte *sndpool;
 
 #include "mathlib.h"
 
+// vector kernels for mixer and dsp
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define XASH_MIX_SSE2
+#elif defined(__ARM_NEON__) || defined(__NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define XASH_MIX_NEON
+#endif
+
+#if defined(XASH_MIX_SSE2) || defined(XASH_MIX_NEON)
+#define XASH_MIX_SIMD
+#endif
+
 // local flags (never sending acorss the net)
 #define SND_LOCALSOUND	(1U << 9)	// not paused, not looped, for internal use
 #define SND_STOP_LOOPING	(1U << 10)	// stop all looping sounds on the entity.
@@ -33,6 +46,8 @@ extern byte *sndpool;
 #define SOUND_44k		44100	// 44khz sample rate
 
 #define SND_TRACE_UPDATE_MAX  	2	// max of N channels may be checked for obscured source per frame
+#define SND_TRACE_MOVE_DIST		16.0f	// source or listener moved this far since last check
+#define SND_TRACE_MAX_AGE		0.5f	// recheck unmoved sources after this time, doors may open
 #define SND_RADIUS_MAX		240.0f	// max sound source radius
 #define SND_RADIUS_MIN		24.0f	// min sound source radius
 #define SND_OBSCURED_LOSS_DB		-2.70f	// dB loss due to obscured sound source
@@ -102,6 +117,9 @@ typedef struct sfx_s
 	int		touchFrame;
 	uint		hashValue;
 	struct sfx_s	*hashNext;
+
+	uint		lastUsed;		// host framecount, for cache eviction
+	qboolean		evicted;		// was dropped from cache at least once
 } sfx_t;
 
 extern portable_samplepair_t	drybuffer[];
@@ -181,8 +199,11 @@ struct channel_s
 	float		ob_gain;		// gain drop if sound source obscured from listener
 	float		ob_gain_target;	// target gain while crossfading between ob_gain & ob_gain_target
 	float		ob_gain_inc;	// crossfade increment
-	qboolean		bTraced;		// true if channel was already checked this frame for obscuring
+	qboolean		bTraced;		// true if channel is scheduled this frame for obscuring check
 	float		radius;		// radius of this sound effect
+	vec3_t		ob_origin;	// source position at last obscuring check
+	vec3_t		ob_listener;	// listener position at last obscuring check
+	double		ob_time;		// host time of last obscuring check
 
 	// sentence mixer
 	int		wordIndex;
@@ -256,6 +277,9 @@ extern convar_t	*s_lerping;
 extern convar_t	*dsp_off;
 extern convar_t	*s_test;
 extern convar_t	*s_phs;
+extern convar_t	*s_loadtime;
+extern convar_t	*s_cachesize;
+extern convar_t	*s_musicahead;
 extern convar_t *s_khz;
 extern convar_t	*dsp_room;
 
@@ -272,6 +296,8 @@ void S_Activate( qboolean active );
 // s_main.c
 //
 void S_FreeChannel( channel_t *ch );
+void S_LockMixer( void );
+void S_UnlockMixer( void );
 
 //
 // s_mix.c
@@ -281,6 +307,7 @@ void MIX_ClearAllPaintBuffers( int SampleCount, qboolean clearFilters );
 void MIX_InitAllPaintbuffers( void );
 void MIX_FreeAllPaintbuffers( void );
 void MIX_PaintChannels( int endtime );
+void S_MixBench_f( void );
 
 // s_load.c
 qboolean S_TestSoundChar( const char *pch, char c );
@@ -288,6 +315,10 @@ char *S_SkipSoundChar( const char *pch );
 sfx_t *S_FindName( const char *name, int *pfInCache );
 sound_t S_RegisterSound( const char *name );
 void S_FreeSound( sfx_t *sfx );
+qboolean S_QueueSound( const vec3_t pos, int ent, int chan, sound_t handle, float fvol, float attn, int pitch, int flags );
+void S_CancelQueuedSound( int ent, int chan, sfx_t *sfx );
+void S_ClearLoadQueue( void );
+void S_UpdateLoadQueue( void );
 
 // s_dsp.c
 qboolean AllocDsps( void );
@@ -324,10 +355,12 @@ void SND_CloseMouth( channel_t *ch );
 //
 void S_StreamSoundTrack( void );
 void S_StreamBackgroundTrack( void );
+void S_StreamAheadTrack( void );
 qboolean S_StreamGetCurrentState( char *currentTrack, char *loopTrack, fs_offset_t *position );
 void S_StopBackgroundTrack( void );
 void S_PrintBackgroundTrackState( void );
 void S_FadeMusicVolume( float fadePercent );
+void S_MusicBench_f( void );
 
 //
 // s_utils.c
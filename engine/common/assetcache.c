@@ -0,0 +1,407 @@
+/*
+assetcache.c - persistent cache of converted sounds and textures
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+
+/*
+=============================================================================
+
+Converted data (resampled PCM, final mip chains) is saved into
+<gamedir>/cache/<type>_<key>.bin. Key is a hash of the source data
+and conversion parameters, so any change of source makes a new key
+and stale entries are never found again, they just age out when the
+cache exceeds fs_assetcache_size. Modification time of an entry is
+updated on each hit, so the least recently used entries go first. Payload follows the header
+unchanged so it may be mapped and passed to the driver as is.
+
+=============================================================================
+*/
+
+#define IDASSETHEADER	(('C'<<24)+('A'<<16)+('S'<<8)+'X')	// little-endian "XSAC"
+#define ASSET_VERSION	1
+#define ASSET_PATH		"cache/"
+#define ASSET_EXT		"bin"
+
+#define PRIME32_1		2654435761U
+#define PRIME32_2		2246822519U
+#define PRIME32_3		3266489917U
+#define PRIME32_4		668265263U
+#define ROTL32( x, r )	(((x) << (r)) | ((x) >> (32 - (r))))
+
+typedef struct
+{
+	int		ident;
+	int		version;
+	assetkey_t	key;
+	uint		size;		// payload size
+	uint		reserved;		// keep payload 16-byte aligned
+} dasset_t;
+
+struct assetfile_s
+{
+	void		*mapped;
+	fs_offset_t	mapsize;
+	byte		*buffer;		// loaded copy when mapping is not possible
+};
+
+typedef struct
+{
+	char		name[MAX_SYSPATH];
+	fs_offset_t	size;
+	fs_offset_t	time;
+} assetentry_t;
+
+static struct
+{
+	qboolean		scanned;		// disk usage is known
+	size_t		disksize;
+	int		hits;
+	int		misses;
+	int		stores;
+	size_t		bytesread;
+	size_t		byteswritten;
+} s_assets;
+
+static convar_t	*fs_assetcache;
+static convar_t	*fs_assetcache_size;
+
+_inline uint Asset_Round( uint acc, uint in )
+{
+	acc += in * PRIME32_2;
+	acc = ROTL32( acc, 13 );
+	return acc * PRIME32_1;
+}
+
+/*
+=================
+Asset_HashData
+
+four independent lanes over 16-byte stripes,
+all of them are kept as the 128-bit key
+=================
+*/
+static void Asset_HashData( uint h[4], const byte *data, size_t size )
+{
+	const byte	*end = data + ( size & ~15 );
+	uint		in[4];
+
+	for( ; data < end; data += 16 )
+	{
+		memcpy( in, data, sizeof( in ));
+		h[0] = Asset_Round( h[0], in[0] );
+		h[1] = Asset_Round( h[1], in[1] );
+		h[2] = Asset_Round( h[2], in[2] );
+		h[3] = Asset_Round( h[3], in[3] );
+	}
+
+	if( size & 15 )
+	{
+		// pad the tail with zeroes, size is mixed in later
+		Q_memset( in, 0, sizeof( in ));
+		memcpy( in, data, size & 15 );
+		h[0] = Asset_Round( h[0], in[0] );
+		h[1] = Asset_Round( h[1], in[1] );
+		h[2] = Asset_Round( h[2], in[2] );
+		h[3] = Asset_Round( h[3], in[3] );
+	}
+}
+
+/*
+=================
+Asset_MakeKey
+
+hash source data with conversion parameters
+=================
+*/
+void Asset_MakeKey( assetkey_t *key, const void *source, size_t size, const void *params, size_t paramsize )
+{
+	uint	h[4] = { PRIME32_1 + PRIME32_2, PRIME32_2, 0, (uint)-(int)PRIME32_1 };
+	int	i;
+
+	Asset_HashData( h, source, size );
+	h[0] ^= (uint)size;
+	h[1] ^= (uint)paramsize;
+
+	if( params && paramsize )
+		Asset_HashData( h, params, paramsize );
+
+	// let every lane depend on the others, then avalanche
+	for( i = 0; i < 4; i++ )
+	{
+		uint	x = h[i] + ROTL32( h[(i+1) & 3], 7 ) + ROTL32( h[(i+2) & 3], 12 ) + ROTL32( h[(i+3) & 3], 18 );
+
+		x ^= x >> 15;
+		x *= PRIME32_2;
+		x ^= x >> 13;
+		x *= PRIME32_3;
+		x ^= x >> 16;
+		key->hash[i] = x ^ ( PRIME32_4 * i );
+	}
+}
+
+static const char *Asset_FileName( const char *type, const assetkey_t *key )
+{
+	return va( ASSET_PATH "%s_%08x%08x%08x%08x." ASSET_EXT, type, key->hash[0], key->hash[1], key->hash[2], key->hash[3] );
+}
+
+static int Asset_CompareTime( const void *a, const void *b )
+{
+	const assetentry_t	*ea = a, *eb = b;
+
+	if( ea->time != eb->time )
+		return ( ea->time < eb->time ) ? -1 : 1;
+	return 0;
+}
+
+/*
+=================
+Asset_TrimCache
+
+delete least recently used entries until cache fits into limit,
+limit is zero to wipe out the whole cache
+=================
+*/
+static void Asset_TrimCache( size_t limit )
+{
+	assetentry_t	*entries;
+	search_t		*t;
+	size_t		total = 0;
+	int		i;
+
+	s_assets.scanned = true;
+	s_assets.disksize = 0;
+
+	t = FS_Search( ASSET_PATH "*." ASSET_EXT, true, true );
+	if( !t ) return;
+
+	entries = Z_Malloc( t->numfilenames * sizeof( assetentry_t ));
+
+	for( i = 0; i < t->numfilenames; i++ )
+	{
+		Q_strncpy( entries[i].name, t->filenames[i], sizeof( entries[i].name ));
+		entries[i].size = FS_FileSize( t->filenames[i], true );
+		entries[i].time = FS_FileTime( t->filenames[i], true );
+		total += entries[i].size;
+	}
+
+	if( total > limit )
+	{
+		qsort( entries, t->numfilenames, sizeof( assetentry_t ), Asset_CompareTime );
+
+		for( i = 0; i < t->numfilenames && total > limit; i++ )
+		{
+			if( FS_Delete( entries[i].name ))
+				total -= entries[i].size;
+		}
+	}
+
+	s_assets.disksize = total;
+	Mem_Free( entries );
+	Mem_Free( t );
+}
+
+static size_t Asset_CacheLimit( void )
+{
+	return (size_t)max( fs_assetcache_size->integer, 0 ) * 1024 * 1024;
+}
+
+/*
+=================
+Asset_CacheEnabled
+=================
+*/
+qboolean Asset_CacheEnabled( void )
+{
+	if( !fs_assetcache || !fs_assetcache->integer )
+		return false;
+
+	if( !s_assets.scanned )
+		Asset_TrimCache( Asset_CacheLimit( ));
+
+	return true;
+}
+
+/*
+=================
+Asset_Open
+
+find converted data in cache, data stays valid
+until Asset_Close. Main thread only
+=================
+*/
+assetfile_t *Asset_Open( const char *type, const assetkey_t *key, const byte **data, size_t *size )
+{
+	const char	*name;
+	assetfile_t	*file;
+	const dasset_t	*hdr;
+	fs_offset_t	filesize;
+	void		*mapped;
+	byte		*buffer = NULL;
+
+	if( !Asset_CacheEnabled( ))
+		return NULL;
+
+	name = Asset_FileName( type, key );
+	mapped = FS_MapFile( name, &filesize );
+
+	if( !mapped )
+	{
+		// filesystem can't map it, try to read
+		buffer = FS_LoadFile( name, &filesize, true );
+
+		if( !buffer )
+		{
+			s_assets.misses++;
+			return NULL;
+		}
+	}
+
+	hdr = mapped ? mapped : (dasset_t *)buffer;
+
+	if( filesize < sizeof( dasset_t ) || hdr->ident != IDASSETHEADER || hdr->version != ASSET_VERSION
+	|| memcmp( &hdr->key, key, sizeof( *key )) || hdr->size != filesize - sizeof( dasset_t ))
+	{
+		MsgDev( D_WARN, "Asset_Open: %s is corrupted, removed\n", name );
+		if( mapped ) FS_UnmapFile( mapped, filesize );
+		if( buffer ) Mem_Free( buffer );
+		FS_Delete( name );
+		s_assets.misses++;
+		return NULL;
+	}
+
+	file = Z_Malloc( sizeof( assetfile_t ));
+	file->mapped = mapped;
+	file->mapsize = filesize;
+	file->buffer = buffer;
+
+	*data = (const byte *)hdr + sizeof( dasset_t );
+	*size = hdr->size;
+
+	s_assets.bytesread += hdr->size;
+	s_assets.hits++;
+
+	// trim goes by modification time
+	FS_Touch( name );
+
+	return file;
+}
+
+/*
+=================
+Asset_Close
+=================
+*/
+void Asset_Close( assetfile_t *file )
+{
+	if( !file ) return;
+
+	if( file->mapped ) FS_UnmapFile( file->mapped, file->mapsize );
+	if( file->buffer ) Mem_Free( file->buffer );
+	Mem_Free( file );
+}
+
+/*
+=================
+Asset_Store
+
+save converted data. Entry is written under a temporary
+name and renamed, so readers never see a partial file
+=================
+*/
+qboolean Asset_Store( const char *type, const assetkey_t *key, const void *data, size_t size )
+{
+	string		name, tempname;
+	dasset_t		hdr;
+	file_t		*f;
+	qboolean		done;
+
+	if( !data || !size || !Asset_CacheEnabled( ))
+		return false;
+
+	Q_strncpy( name, Asset_FileName( type, key ), sizeof( name ));
+	Q_snprintf( tempname, sizeof( tempname ), "%s.tmp", name );
+
+	f = FS_Open( tempname, "wb", true );
+	if( !f ) return false;
+
+	Q_memset( &hdr, 0, sizeof( hdr ));
+	hdr.ident = IDASSETHEADER;
+	hdr.version = ASSET_VERSION;
+	hdr.key = *key;
+	hdr.size = size;
+
+	done = ( FS_Write( f, &hdr, sizeof( hdr )) == sizeof( hdr ));
+	done = done && ( FS_Write( f, data, size ) == size );
+	FS_Close( f );
+
+	if( !done || !FS_Replace( tempname, name ))
+	{
+		MsgDev( D_WARN, "Asset_Store: couldn't write %s\n", name );
+		FS_Delete( tempname );
+		return false;
+	}
+
+	s_assets.byteswritten += size;
+	s_assets.disksize += size + sizeof( hdr );
+	s_assets.stores++;
+
+	if( s_assets.disksize > Asset_CacheLimit( ))
+		Asset_TrimCache( Asset_CacheLimit() * 3 / 4 ); // keep some room for next stores
+
+	return true;
+}
+
+/*
+=================
+Asset_CacheInfo_f
+=================
+*/
+static void Asset_CacheInfo_f( void )
+{
+	if( fs_assetcache->integer && !s_assets.scanned )
+		Asset_TrimCache( Asset_CacheLimit( ));
+
+	Msg( "asset cache: %s\n", fs_assetcache->integer ? "enabled" : "disabled" );
+	Msg( "%s of %s on disk\n", Q_memprint( s_assets.disksize ), Q_memprint( Asset_CacheLimit( )));
+	Msg( "%i hits, %i misses, %i stores\n", s_assets.hits, s_assets.misses, s_assets.stores );
+	Msg( "%s read, %s written\n", Q_memprint( s_assets.bytesread ), Q_memprint( s_assets.byteswritten ));
+}
+
+/*
+=================
+Asset_CacheClear_f
+=================
+*/
+static void Asset_CacheClear_f( void )
+{
+	Asset_TrimCache( 0 );
+	Msg( "asset cache cleared\n" );
+}
+
+/*
+=================
+Asset_Init
+=================
+*/
+void Asset_Init( void )
+{
+	Q_memset( &s_assets, 0, sizeof( s_assets ));
+
+	fs_assetcache = Cvar_Get( "fs_assetcache", "1", CVAR_ARCHIVE, "keep converted sounds and textures on disk for next loads" );
+	fs_assetcache_size = Cvar_Get( "fs_assetcache_size", "512", CVAR_ARCHIVE, "disk space for converted assets, in megabytes" );
+
+	Cmd_AddCommand( "assetcache_info", Asset_CacheInfo_f, "show asset cache usage" );
+	Cmd_AddCommand( "assetcache_clear", Asset_CacheClear_f, "remove all converted assets from disk" );
+}
@@ -137,6 +137,16 @@ typedef enum
 #define MAX_DECALS		512	// touching TE_DECAL messages, etc
 #define MAX_STATIC_ENTITIES	512	// static entities that moved on the client when level is spawn
 
+#define MAX_PRECACHE	2048	// largest precache table (models and sounds)
+#define PRECACHE_HASH_SIZE	1024
+
+typedef struct
+{
+	short		hash[PRECACHE_HASH_SIZE];	// last linked slot for each hash, 0 ends a chain
+	short		next[MAX_PRECACHE];
+	int		count;			// highest linked slot + 1
+} precache_t;
+
 // filesystem flags
 #define FS_STATIC_PATH	1	// FS_ClearSearchPath will be ignore this path
 #define FS_NOWRITE_PATH	2	// default behavior - last added gamedir set as writedir. This flag disables it
@@ -339,6 +349,7 @@ typedef struct host_parm_s
 
 	// list of unique decal indexes
 	signed char		draw_decals[MAX_DECALS][CS_SIZE];
+	precache_t	decal_hash;	// name lookup for draw_decals
 #ifdef XASH_SDL
     SDL_Window*		hWnd;		// main window
 #else
@@ -419,14 +430,19 @@ fs_offset_t FS_Write( file_t *file, const void *data, size_t datasize );
 fs_offset_t FS_Read( file_t *file, void *buffer, size_t buffersize );
 int FS_VPrintf( file_t *file, const char *format, va_list ap );
 int FS_Seek( file_t *file, fs_offset_t offset, int whence );
+qboolean FS_CacheFile( file_t *file );
+void *FS_MapFile( const char *path, fs_offset_t *filesizeptr );
+void FS_UnmapFile( void *data, fs_offset_t size );
 int FS_Printf( file_t *file, const char *format, ... ) _format(2);
 fs_offset_t FS_FileSize( const char *filename, qboolean gamedironly );
 fs_offset_t FS_FileTime( const char *filename, qboolean gamedironly );
 int FS_Print( file_t *file, const char *msg );
 qboolean FS_Rename( const char *oldname, const char *newname );
+qboolean FS_Replace( const char *oldname, const char *newname );
 qboolean FS_FileExists( const char *filename, qboolean gamedironly );
 void FS_FileCopy( file_t *pOutput, file_t *pInput, int fileSize );
 qboolean FS_Delete( const char *path );
+qboolean FS_Touch( const char *path );
 int FS_UnGetc( file_t *file, byte c );
 void FS_StripExtension( char *path );
 fs_offset_t FS_Tell( file_t *file );
@@ -645,9 +661,66 @@ int FS_ReadStream( stream_t *stream, int bytes, void *buffer );
 int FS_SetStreamPos( stream_t *stream, int newpos );
 int FS_GetStreamPos( stream_t *stream );
 void FS_FreeStream( stream_t *stream );
+qboolean FS_CacheStream( stream_t *stream );
+qboolean Sound_SetDecoderSIMD( qboolean enable );
 qboolean Sound_Process( wavdata_t **wav, int rate, int width, uint flags );
 uint Sound_GetApproxWavePlayLen( const char *filepath );
 
+//
+// assetcache.c
+//
+typedef struct assetfile_s	assetfile_t;
+
+typedef struct
+{
+	uint	hash[4];
+} assetkey_t;
+
+void Asset_Init( void );
+qboolean Asset_CacheEnabled( void );
+void Asset_MakeKey( assetkey_t *key, const void *source, size_t size, const void *params, size_t paramsize );
+assetfile_t *Asset_Open( const char *type, const assetkey_t *key, const byte **data, size_t *size );
+void Asset_Close( assetfile_t *file );
+qboolean Asset_Store( const char *type, const assetkey_t *key, const void *data, size_t size );
+
+//
+// compress.c
+//
+int LZ_CompressBound( int size );
+int LZ_Compress( const byte *in, int insize, byte *out, int outsize );
+int LZ_Decompress( const byte *in, int insize, byte *out, int outsize );
+
+//
+// mapcat.c
+//
+#define MAPINFO_ENTITIES	BIT( 0 )		// entities were parsed
+#define MAPINFO_SPAWNPOINTS	BIT( 1 )		// has GI->mp_entity
+#define MAPINFO_GEARBOX	BIT( 2 )		// entities and planes lumps are swapped
+#define MAPINFO_EXTRAHEADER	BIT( 3 )		// paranoia 2 extended header
+#define MAPINFO_GAMEDIR	BIT( 4 )		// found in game directory
+
+typedef struct
+{
+	char	name[64];		// without path and extension
+	char	title[128];	// worldspawn message
+	int	version;		// bsp version, -1 if map can't be read
+	int	mapversion;
+	int	flags;
+	int	filesize;		// file is parsed again when size or time changed
+	int	filetime;
+} mapinfo_t;
+
+qboolean MapCat_Update( qboolean force );
+int MapCat_FindPrefix( const char *prefix, const mapinfo_t **list );
+
+//
+// precache.c
+//
+void Precache_Clear( precache_t *list );
+void Precache_Add( precache_t *list, char (*names)[CS_SIZE], int index );
+int Precache_Find( const precache_t *list, char (*names)[CS_SIZE], const char *name );
+int Precache_FreeSlot( const precache_t *list );
+
 //
 // build.c
 //
@@ -845,6 +918,7 @@ qboolean CL_IsInMenu( void );
 qboolean CL_IsInConsole( void );
 qboolean CL_IsThirdPerson( void );
 qboolean CL_IsIntermission( void );
+float CL_TimeDemoFrameTime( void );
 float CL_GetServerTime( void );
 float CL_GetLerpFrac( void );
 void CL_CharEvent( int key );
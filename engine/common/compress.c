@@ -0,0 +1,246 @@
+/*
+compress.c - fast lz77 block compression
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+
+/*
+=============================================================================
+
+Block layout follows LZ4: each sequence is a token byte (literal count
+in high nibble, match length - 4 in low nibble, 15 means more length
+bytes follow), literals, 16-bit little-endian match offset. Last
+sequence has literals only. Functions keep no state, so they may be
+called from any thread.
+
+=============================================================================
+*/
+
+#define LZ_HASH_BITS	12
+#define LZ_MINMATCH		4
+#define LZ_MFLIMIT		12	// last match must start before this distance to the end
+#define LZ_LASTLITERALS	5	// last bytes are always literals
+#define LZ_MAX_OFFSET	65535
+#define LZ_SKIP_TRIGGER	6	// skip faster through data which doesn't compress
+
+_inline uint LZ_Read32( const byte *p )
+{
+	uint	v;
+
+	memcpy( &v, p, sizeof( v ));
+	return v;
+}
+
+_inline uint LZ_Hash( uint v )
+{
+	return ( v * 2654435761U ) >> ( 32 - LZ_HASH_BITS );
+}
+
+static byte *LZ_WriteLength( byte *op, int length )
+{
+	for( ; length >= 255; length -= 255 )
+		*op++ = 255;
+	*op++ = length;
+	return op;
+}
+
+/*
+=================
+LZ_CompressBound
+
+worst case size of compressed block
+=================
+*/
+int LZ_CompressBound( int size )
+{
+	return size + size / 255 + 16;
+}
+
+/*
+=================
+LZ_Compress
+
+returns compressed size or 0 if output doesn't fit
+=================
+*/
+int LZ_Compress( const byte *in, int insize, byte *out, int outsize )
+{
+	int		table[1<<LZ_HASH_BITS];
+	const byte	*ip = in, *anchor = in;
+	const byte	*iend = in + insize;
+	const byte	*mflimit = iend - LZ_MFLIMIT;
+	const byte	*matchlimit = iend - LZ_LASTLITERALS;
+	byte		*op = out, *oend = out + outsize, *token;
+	int		litlen, matchlen, attempts;
+
+	memset( table, 0xFF, sizeof( table ));
+	attempts = 1 << LZ_SKIP_TRIGGER;
+
+	while( insize > LZ_MFLIMIT && ip < mflimit )
+	{
+		const byte	*match;
+		uint		seq = LZ_Read32( ip );
+		uint		h = LZ_Hash( seq );
+		int		ref = table[h];
+
+		table[h] = ip - in;
+
+		if( ref < 0 || ( ip - in ) - ref > LZ_MAX_OFFSET || LZ_Read32( in + ref ) != seq )
+		{
+			ip += ( attempts++ >> LZ_SKIP_TRIGGER );
+			continue;
+		}
+
+		match = in + ref;
+		attempts = 1 << LZ_SKIP_TRIGGER;
+
+		// catch up with the literals
+		while( ip > anchor && match > in && ip[-1] == match[-1] )
+			ip--, match--;
+
+		for( matchlen = LZ_MINMATCH; ip + matchlen < matchlimit && ip[matchlen] == match[matchlen]; matchlen++ );
+
+		litlen = ip - anchor;
+		if( op + 1 + litlen + litlen / 255 + 1 + 2 + matchlen / 255 + 1 > oend )
+			return 0;
+
+		token = op++;
+
+		if( litlen >= 15 )
+		{
+			*token = 15 << 4;
+			op = LZ_WriteLength( op, litlen - 15 );
+		}
+		else *token = litlen << 4;
+
+		memcpy( op, anchor, litlen );
+		op += litlen;
+
+		*op++ = ( ip - match ) & 0xFF;
+		*op++ = ( ip - match ) >> 8;
+
+		if( matchlen - LZ_MINMATCH >= 15 )
+		{
+			*token |= 15;
+			op = LZ_WriteLength( op, matchlen - LZ_MINMATCH - 15 );
+		}
+		else *token |= matchlen - LZ_MINMATCH;
+
+		ip += matchlen;
+		anchor = ip;
+
+		// fill the table behind the match
+		if( ip < mflimit )
+			table[LZ_Hash( LZ_Read32( ip - 2 ))] = ( ip - 2 ) - in;
+	}
+
+	// last literals
+	litlen = iend - anchor;
+	if( op + 1 + litlen + litlen / 255 + 1 > oend )
+		return 0;
+
+	token = op++;
+
+	if( litlen >= 15 )
+	{
+		*token = 15 << 4;
+		op = LZ_WriteLength( op, litlen - 15 );
+	}
+	else *token = litlen << 4;
+
+	memcpy( op, anchor, litlen );
+	op += litlen;
+
+	return op - out;
+}
+
+/*
+=================
+LZ_Decompress
+
+returns decompressed size or -1 if block is malformed,
+never reads or writes out of the buffers
+=================
+*/
+int LZ_Decompress( const byte *in, int insize, byte *out, int outsize )
+{
+	const byte	*ip = in, *iend = in + insize;
+	byte		*op = out, *oend = out + outsize;
+	int		token, length, offset, s;
+
+	while( ip < iend )
+	{
+		token = *ip++;
+
+		// literals
+		length = token >> 4;
+		if( length == 15 )
+		{
+			do
+			{
+				if( ip >= iend ) return -1;
+				s = *ip++;
+				length += s;
+			} while( s == 255 );
+		}
+
+		if( length > iend - ip || length > oend - op )
+			return -1;
+
+		memcpy( op, ip, length );
+		ip += length;
+		op += length;
+
+		if( ip >= iend ) break; // last sequence
+
+		// match
+		if( iend - ip < 2 ) return -1;
+		offset = ip[0] | ( ip[1] << 8 );
+		ip += 2;
+
+		if( offset == 0 || offset > op - out )
+			return -1;
+
+		length = token & 15;
+		if( length == 15 )
+		{
+			do
+			{
+				if( ip >= iend ) return -1;
+				s = *ip++;
+				length += s;
+			} while( s == 255 );
+		}
+		length += LZ_MINMATCH;
+
+		if( length > oend - op )
+			return -1;
+
+		if( offset >= length )
+		{
+			memcpy( op, op - offset, length );
+			op += length;
+		}
+		else
+		{
+			// overlapped copy repeats the pattern
+			const byte	*match = op - offset;
+
+			while( length-- )
+				*op++ = *match++;
+		}
+	}
+
+	return op - out;
+}
@@ -316,140 +316,68 @@ Prints or complete map filename
 */
 qboolean Cmd_GetMapList( const char *s, char *completedname, int length )
 {
-	search_t		*t;
-	file_t		*f;
+	const mapinfo_t	*list, *info;
 	string		message;
 	string		matchbuf;
-	byte		buf[MAX_SYSPATH]; // 1 kb
-	int		i, nummaps;
+	char		buf[64];
+	int		i, count, nummaps;
 
-	t = FS_Search( va( "maps/%s*.bsp", s ), true, con_gamemaps->integer );
-	if( !t ) return false;
+	MapCat_Update( false );
 
-	FS_FileBase( t->filenames[0], matchbuf ); 
-	Q_strncpy( completedname, matchbuf, length );
-	if( t->numfilenames == 1 ) return true;
+	count = MapCat_FindPrefix( s, &list );
 
-	for( i = 0, nummaps = 0; i < t->numfilenames; i++ )
+	// count maps which are visible with current con_gamemaps
+	for( i = nummaps = 0, info = NULL; i < count; i++ )
 	{
-		char		entfilename[CS_SIZE];
-		int		ver = -1, mapver = -1, lumpofs = 0, lumplen = 0;
-		const char	*ext = FS_FileExtension( t->filenames[i] ); 
-		char		*ents = NULL, *pfile;
-		qboolean		paranoia = false;
-		qboolean		gearbox = false;
-			
-		if( Q_stricmp( ext, "bsp" )) continue;
-		Q_strncpy( message, "^1error^7", sizeof( message ));
-		f = FS_Open( t->filenames[i], "rb", con_gamemaps->integer );
-	
-		if( f )
-		{
-			dheader_t	*header;
-			dextrahdr_t	*hdrext;
-
-			Q_memset( buf, 0, sizeof( buf ));
-			FS_Read( f, buf, sizeof( buf ));
-			header = (dheader_t *)buf;
-			ver = header->version;
-                              
-			switch( ver )
-			{
-			case Q1BSP_VERSION:
-			case HLBSP_VERSION:
-			case XTBSP_VERSION:
-				if( header->lumps[LUMP_ENTITIES].fileofs <= 1024 && !(header->lumps[LUMP_ENTITIES].filelen % sizeof(dplane_t)))
-				{
-					lumpofs = header->lumps[LUMP_PLANES].fileofs;
-					lumplen = header->lumps[LUMP_PLANES].filelen;
-					gearbox = true;
-				}
-				else
-				{
-					lumpofs = header->lumps[LUMP_ENTITIES].fileofs;
-					lumplen = header->lumps[LUMP_ENTITIES].filelen;
-					gearbox = false;
-				}
-				break;
-			}
-
-			if( ver == XTBSP_VERSION )
-				hdrext = (dextrahdr_t *)((byte *)buf + sizeof( dheader31_t ));
-			else hdrext = (dextrahdr_t *)((byte *)buf + sizeof( dheader_t ));
-
-			if( hdrext->id == IDEXTRAHEADER && hdrext->version == EXTRA_VERSION )
-				paranoia = true;
+		if( con_gamemaps->integer && !( list[i].flags & MAPINFO_GAMEDIR ))
+			continue;
+		if( !info ) info = &list[i];
+		nummaps++;
+	}
 
-			Q_strncpy( entfilename, t->filenames[i], sizeof( entfilename ));
-			FS_StripExtension( entfilename );
-			FS_DefaultExtension( entfilename, ".ent" );
-			ents = (char *)FS_LoadFile( entfilename, NULL, true );
+	if( !nummaps ) return false;
 
-			if( !ents && lumplen >= 10 )
-			{
-				FS_Seek( f, lumpofs, SEEK_SET );
-				ents = (char *)Mem_Alloc( host.mempool, lumplen + 1 );
-				FS_Read( f, ents, lumplen );
-			}
+	Q_strncpy( matchbuf, info->name, sizeof( matchbuf ));
+	Q_strncpy( completedname, matchbuf, length );
+	if( nummaps == 1 ) return true;
 
-			if( ents )
-			{
-				// if there are entities to parse, a missing message key just
-				// means there is no title, so clear the message string now
-				char	token[2048];
+	for( i = 0; i < count; i++ )
+	{
+		info = &list[i];
 
-				message[0] = 0;
-				pfile = ents;
+		if( con_gamemaps->integer && !( info->flags & MAPINFO_GAMEDIR ))
+			continue;
 
-				while(( pfile = COM_ParseFile( pfile, token )) != NULL )
-				{
-					if( !Q_strcmp( token, "{" )) continue;
-					else if(!Q_strcmp( token, "}" )) break;
-					else if(!Q_strcmp( token, "message" ))
-					{
-						// get the message contents
-						pfile = COM_ParseFile( pfile, message );
-					}
-					else if(!Q_strcmp( token, "mapversion" ))
-					{
-						// get the message contents
-						pfile = COM_ParseFile( pfile, token );
-						mapver = Q_atoi( token );
-					}
-				}
-				Mem_Free( ents );
-			}
-		}
+		if( info->flags & MAPINFO_ENTITIES )
+			Q_strncpy( message, info->title, sizeof( message ));
+		else Q_strncpy( message, "^1error^7", sizeof( message ));
 
-		if( f ) FS_Close(f);
-		FS_FileBase( t->filenames[i], matchbuf );
+		Q_strncpy( matchbuf, info->name, sizeof( matchbuf ));
 
-		switch( ver )
+		switch( info->version )
 		{
 		case Q1BSP_VERSION:
-			if( mapver == 220 ) Q_strncpy( (char *)buf, "Half-Life Alpha", sizeof( buf ));
-			else Q_strncpy( (char *)buf, "Quake", sizeof( buf ));
+			if( info->mapversion == 220 ) Q_strncpy( buf, "Half-Life Alpha", sizeof( buf ));
+			else Q_strncpy( buf, "Quake", sizeof( buf ));
 			break;
 		case HLBSP_VERSION:
-			if( gearbox ) Q_strncpy( (char *)buf, "Blue-Shift", sizeof( buf ));
-			else if( paranoia ) Q_strncpy( (char *)buf, "Paranoia 2", sizeof( buf ));
-			else Q_strncpy( (char *)buf, "Half-Life", sizeof( buf ));
+			if( info->flags & MAPINFO_GEARBOX ) Q_strncpy( buf, "Blue-Shift", sizeof( buf ));
+			else if( info->flags & MAPINFO_EXTRAHEADER ) Q_strncpy( buf, "Paranoia 2", sizeof( buf ));
+			else Q_strncpy( buf, "Half-Life", sizeof( buf ));
 			break;
 		case XTBSP_VERSION:
-			if( paranoia ) Q_strncpy( (char *)buf, "Paranoia 2", sizeof( buf ));
-			else Q_strncpy( (char *)buf, "Xash3D", sizeof( buf ));
+			if( info->flags & MAPINFO_EXTRAHEADER ) Q_strncpy( buf, "Paranoia 2", sizeof( buf ));
+			else Q_strncpy( buf, "Xash3D", sizeof( buf ));
 			break;
 		default:
-			Q_strncpy( (char *)buf, "??", sizeof( buf ));
+			Q_strncpy( buf, "??", sizeof( buf ));
 			break;
 		}
 
 		Msg( "%16s (%s) ^3%s^7\n", matchbuf, buf, message );
-		nummaps++;
 	}
 
 	Msg( "\n^3 %i maps found.\n", nummaps );
-	Mem_Free( t );
 
 	// cut shortestMatch to the amount common with s
 	for( i = 0; matchbuf[i]; i++ )
@@ -1007,12 +935,10 @@ qboolean Cmd_GetGamesList( const char *s, char *completedname, int length )
 
 qboolean Cmd_CheckMapsList_R( qboolean fRefresh, qboolean onlyingamedir )
 {
-	byte	buf[MAX_SYSPATH];
-	char	*buffer;
-	string	result;
-	int	i, size;
-	search_t	*t;
-	file_t	*f;
+	const mapinfo_t	*list;
+	char		*buffer;
+	string		result;
+	int		i, count, size;
 
 	if( FS_FileSize( "maps.lst", onlyingamedir ) > 0 && !fRefresh )
 	{
@@ -1020,116 +946,26 @@ qboolean Cmd_CheckMapsList_R( qboolean fRefresh, qboolean onlyingamedir )
 		return true; // exists
 	}
 
-	t = FS_Search( "maps/*.bsp", false, onlyingamedir );
+	// only new or changed maps are read
+	MapCat_Update( true );
 
-	if( !t )
-	{
-		if( onlyingamedir )
-		{
-			// mod doesn't contain any maps (probably this is a bot)
-			return Cmd_CheckMapsList_R( fRefresh, false );
-		}
+	count = MapCat_FindPrefix( "", &list );
+	buffer = Mem_Alloc( host.mempool, count * sizeof( result ) + 1 );
 
-		return false;
-	}
-
-	buffer = Mem_Alloc( host.mempool, t->numfilenames * 2 * sizeof( result ));
-
-	for( i = 0; i < t->numfilenames; i++ )
+	for( i = size = 0; i < count; i++ )
 	{
-		char		*ents = NULL, *pfile;
-		int		ver = -1, lumpofs = 0, lumplen = 0;
-		string		mapname, message, entfilename;
-		const char	*ext = FS_FileExtension( t->filenames[i] ); 
-
-		if( Q_stricmp( ext, "bsp" )) continue;
-		f = FS_Open( t->filenames[i], "rb", onlyingamedir );
-		FS_FileBase( t->filenames[i], mapname );
+		if( onlyingamedir && !( list[i].flags & MAPINFO_GAMEDIR ))
+			continue;
 
-		if( f )
+		if( list[i].flags & MAPINFO_SPAWNPOINTS )
 		{
-			int	num_spawnpoints = 0;
-			dheader_t	*header;
-
-			Q_memset( buf, 0, MAX_SYSPATH );
-			FS_Read( f, buf, MAX_SYSPATH );
-			ver = *(uint *)buf;
-                              
-			switch( ver )
-			{
-			case Q1BSP_VERSION:
-			case HLBSP_VERSION:
-			case XTBSP_VERSION:
-				header = (dheader_t *)buf;
-				if( header->lumps[LUMP_ENTITIES].fileofs <= 1024 )
-				{
-					lumpofs = header->lumps[LUMP_PLANES].fileofs;
-					lumplen = header->lumps[LUMP_PLANES].filelen;
-				}
-				else
-				{
-					lumpofs = header->lumps[LUMP_ENTITIES].fileofs;
-					lumplen = header->lumps[LUMP_ENTITIES].filelen;
-				}
-				break;
-			}
-
-			Q_strncpy( entfilename, t->filenames[i], sizeof( entfilename ));
-			FS_StripExtension( entfilename );
-			FS_DefaultExtension( entfilename, ".ent" );
-			ents = (char *)FS_LoadFile( entfilename, NULL, true );
-
-			if( !ents && lumplen >= 10 )
-			{
-				FS_Seek( f, lumpofs, SEEK_SET );
-				ents = (char *)Mem_Alloc( host.mempool, lumplen + 1 );
-				FS_Read( f, ents, lumplen );
-			}
-
-			if( ents )
-			{
-				// if there are entities to parse, a missing message key just
-				// means there is no title, so clear the message string now
-				char	token[2048];
-				qboolean	worldspawn = true;
-
-				Q_strncpy( message, "No Title", MAX_STRING );
-				pfile = ents;
-
-				while(( pfile = COM_ParseFile( pfile, token )) != NULL )
-				{
-					if( token[0] == '}' && worldspawn )
-						worldspawn = false;
-					else if( !Q_strcmp( token, "message" ) && worldspawn )
-					{
-						// get the message contents
-						pfile = COM_ParseFile( pfile, message );
-					}
-					else if( !Q_strcmp( token, "classname" ))
-					{
-						pfile = COM_ParseFile( pfile, token );
-						if( !Q_strcmp( token, GI->mp_entity ))
-							num_spawnpoints++;
-					}
-					if( num_spawnpoints ) break; // valid map
-				}
-				Mem_Free( ents );
-			}
-
-			if( f ) FS_Close( f );
-
-			if( num_spawnpoints )
-			{
-				// format: mapname "maptitle"\n
-				Q_sprintf( result, "%s \"%s\"\n", mapname, message );
-				Q_strcat( buffer, result ); // add new string
-			}
+			// format: mapname "maptitle"\n
+			Q_snprintf( result, sizeof( result ), "%s \"%s\"\n", list[i].name, list[i].title[0] ? list[i].title : "No Title" );
+			Q_strcpy( buffer + size, result ); // add new string
+			size += Q_strlen( result );
 		}
 	}
 
-	if( t ) Mem_Free( t ); // free search result
-	size = Q_strlen( buffer );
-
 	if( !size )
 	{
           	if( buffer ) Mem_Free( buffer );
@@ -1140,7 +976,7 @@ qboolean Cmd_CheckMapsList_R( qboolean fRefresh, qboolean onlyingamedir )
 	}
 
 	// write generated maps.lst
-	if( FS_WriteFile( "maps.lst", buffer, Q_strlen( buffer )))
+	if( FS_WriteFile( "maps.lst", buffer, size ))
 	{
           	if( buffer ) Mem_Free( buffer );
 		return true;
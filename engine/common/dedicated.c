@@ -112,6 +112,11 @@ qboolean CL_IsIntermission( void )
 	return false;
 }
 
+float CL_TimeDemoFrameTime( void )
+{
+	return 0.0f;
+}
+
 qboolean CL_IsPlaybackDemo( void )
 {
 	return false;
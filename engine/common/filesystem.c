@@ -25,8 +25,11 @@ GNU General Public License for more details.
 #ifdef _WIN32
 #include <io.h>
 #include <direct.h>
+#include <sys/utime.h>
 #else
+#include <utime.h>
 #include <dirent.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <unistd.h>
 #endif
@@ -71,6 +74,7 @@ struct file_s
 						// Contents buffer
 	fs_offset_t	buff_ind, buff_len;		// buffer current index and length
 	byte		buff[FILE_BUFF_SIZE];	// intermediate buffer
+	byte		*cache;			// whole file contents, see FS_CacheFile
 };
 
 byte		*fs_mempool;
@@ -2348,6 +2352,8 @@ int FS_Close( file_t *file )
 	if( close( file->handle ))
 		return EOF;
 
+	if( file->cache )
+		Mem_Free( file->cache );
 	Mem_Free( file );
 	return 0;
 }
@@ -2383,6 +2389,25 @@ fs_offset_t FS_Write( file_t *file, const void *data, size_t datasize )
 	return result;
 }
 
+/*
+====================
+FS_SysRead
+
+read count bytes at the current position
+====================
+*/
+static fs_offset_t FS_SysRead( file_t *file, void *buffer, fs_offset_t count )
+{
+	if( file->cache )
+	{
+		Q_memcpy( buffer, file->cache + file->position, count );
+		return count;
+	}
+
+	lseek( file->handle, file->offset + file->position, SEEK_SET );
+	return read( file->handle, buffer, count );
+}
+
 /*
 ====================
 FS_Read
@@ -2432,8 +2457,7 @@ fs_offset_t FS_Read( file_t *file, void *buffer, size_t buffersize )
 	{
 		if( count > (fs_offset_t)buffersize )
 			count = (fs_offset_t)buffersize;
-		lseek( file->handle, file->offset + file->position, SEEK_SET );
-		nb = read (file->handle, &((byte *)buffer)[done], count );
+		nb = FS_SysRead( file, &((byte *)buffer)[done], count );
 
 		if( nb > 0 )
 		{
@@ -2447,8 +2471,7 @@ fs_offset_t FS_Read( file_t *file, void *buffer, size_t buffersize )
 	{
 		if( count > (fs_offset_t)sizeof( file->buff ))
 			count = (fs_offset_t)sizeof( file->buff );
-		lseek( file->handle, file->offset + file->position, SEEK_SET );
-		nb = read( file->handle, file->buff, count );
+		nb = FS_SysRead( file, file->buff, count );
 
 		if( nb > 0 )
 		{
@@ -2466,6 +2489,121 @@ fs_offset_t FS_Read( file_t *file, void *buffer, size_t buffersize )
 	return done;
 }
 
+/*
+====================
+FS_CacheFile
+
+Read whole file into memory, so FS_Read and FS_Seek
+don't touch the shared pak handle anymore and the file
+may be read by another thread. Must be called from the
+main thread, file is closed as usual
+====================
+*/
+qboolean FS_CacheFile( file_t *file )
+{
+	fs_offset_t	done, nb;
+
+	if( !file ) return false;
+	if( file->cache ) return true;
+
+	file->cache = Mem_Alloc( fs_mempool, file->real_length + 1 );
+	lseek( file->handle, file->offset, SEEK_SET );
+
+	for( done = 0; done < file->real_length; done += nb )
+	{
+		nb = read( file->handle, file->cache + done, file->real_length - done );
+
+		if( nb <= 0 )
+		{
+			Mem_Free( file->cache );
+			file->cache = NULL;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+====================
+FS_MapFile
+
+map a file from the game directory into memory,
+mapping is read-only. Returns NULL if file is missing
+or can't be mapped
+====================
+*/
+void *FS_MapFile( const char *path, fs_offset_t *filesizeptr )
+{
+	char		real_path[MAX_SYSPATH];
+	void		*data = NULL;
+	fs_offset_t	size;
+#ifdef _WIN32
+	HANDLE		file, mapping;
+	LARGE_INTEGER	length;
+#else
+	struct stat	buf;
+	int		handle;
+#endif
+	if( filesizeptr ) *filesizeptr = 0;
+	if( !path || !*path ) return NULL;
+
+	Q_snprintf( real_path, sizeof( real_path ), "%s%s", fs_gamedir, path );
+	COM_FixSlashes( real_path );
+#ifdef _WIN32
+	file = CreateFile( real_path, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( file == INVALID_HANDLE_VALUE ) return NULL;
+
+	if( !GetFileSizeEx( file, &length ) || length.QuadPart <= 0 || length.HighPart )
+	{
+		CloseHandle( file );
+		return NULL;
+	}
+
+	size = (fs_offset_t)length.LowPart;
+	mapping = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+
+	if( mapping )
+	{
+		data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+		CloseHandle( mapping ); // view keeps the mapping alive
+	}
+	CloseHandle( file );
+#else
+	handle = open( real_path, O_RDONLY );
+	if( handle < 0 ) return NULL;
+
+	if( fstat( handle, &buf ) < 0 || buf.st_size <= 0 )
+	{
+		close( handle );
+		return NULL;
+	}
+
+	size = buf.st_size;
+	data = mmap( NULL, size, PROT_READ, MAP_PRIVATE, handle, 0 );
+	if( data == MAP_FAILED ) data = NULL;
+	close( handle ); // mapping keeps the file alive
+#endif
+	if( data && filesizeptr ) *filesizeptr = size;
+
+	return data;
+}
+
+/*
+====================
+FS_UnmapFile
+====================
+*/
+void FS_UnmapFile( void *data, fs_offset_t size )
+{
+	if( !data ) return;
+#ifdef _WIN32
+	UnmapViewOfFile( data );
+#else
+	munmap( data, size );
+#endif
+}
+
 /*
 ====================
 FS_Print
@@ -2598,7 +2736,7 @@ int FS_Seek( file_t *file, fs_offset_t offset, int whence )
 	// Purge cached data
 	FS_Purge( file );
 
-	if( lseek( file->handle, file->offset + offset, SEEK_SET ) == -1 )
+	if( !file->cache && lseek( file->handle, file->offset + offset, SEEK_SET ) == -1 )
 		return -1;
 	file->position = offset;
 
@@ -3020,6 +3158,58 @@ qboolean FS_Rename( const char *oldname, const char *newname )
 	return (iRet == 0);
 }
 
+/*
+==================
+FS_Replace
+
+rename file over existing one in a single step,
+target is never missing if this fails or crashes
+==================
+*/
+qboolean FS_Replace( const char *oldname, const char *newname )
+{
+	char	oldpath[MAX_SYSPATH], newpath[MAX_SYSPATH];
+
+	if( !oldname || !newname || !*oldname || !*newname )
+		return false;
+
+	Q_snprintf( oldpath, sizeof( oldpath ), "%s%s", fs_gamedir, oldname );
+	Q_snprintf( newpath, sizeof( newpath ), "%s%s", fs_gamedir, newname );
+
+	COM_FixSlashes( oldpath );
+	COM_FixSlashes( newpath );
+
+#ifdef _WIN32
+	// rename() fails on windows if target exists
+	return MoveFileEx( oldpath, newpath, MOVEFILE_REPLACE_EXISTING ) ? true : false;
+#else
+	return ( rename( oldpath, newpath ) == 0 );
+#endif
+}
+
+/*
+==================
+FS_Touch
+
+set modification time of file from gamefolder to now
+==================
+*/
+qboolean FS_Touch( const char *path )
+{
+	char	real_path[MAX_SYSPATH];
+
+	if( !path || !*path )
+		return false;
+
+	Q_snprintf( real_path, sizeof( real_path ), "%s%s", fs_gamedir, path );
+	COM_FixSlashes( real_path );
+#ifdef _WIN32
+	return ( _utime( real_path, NULL ) == 0 );
+#else
+	return ( utime( real_path, NULL ) == 0 );
+#endif
+}
+
 /*
 ==================
 FS_Delete
@@ -361,11 +361,10 @@ qboolean Host_RegisterDecal( const char *name )
 
 	FS_FileBase( name, shortname );
 
-	for( i = 1; i < MAX_DECALS && host.draw_decals[i][0]; i++ )
-	{
-		if( !Q_stricmp( (char *)host.draw_decals[i], shortname ))
-			return true;
-	}
+	if( Precache_Find( &host.decal_hash, (char (*)[CS_SIZE])host.draw_decals, shortname ))
+		return true;
+
+	i = Precache_FreeSlot( &host.decal_hash );
 
 	if( i == MAX_DECALS )
 	{
@@ -375,6 +374,7 @@ qboolean Host_RegisterDecal( const char *name )
 
 	// register new decal
 	Q_strncpy( (char *)host.draw_decals[i], shortname, sizeof( host.draw_decals[i] ));
+	Precache_Add( &host.decal_hash, (char (*)[CS_SIZE])host.draw_decals, i );
 	num_decals++;
 
 	return true;
@@ -391,6 +391,7 @@ void Host_InitDecals( void )
 	int	i;
 
 	Q_memset( host.draw_decals, 0, sizeof( host.draw_decals ));
+	Precache_Clear( &host.decal_hash );
 	num_decals = 0;
 
 	// lookup all decals in decals.wad
@@ -533,7 +534,16 @@ Returns false if the time is too short to run a frame
 qboolean Host_FilterTime( float time )
 {
 	static double	oldtime;
-	float		fps;
+	float		fps, step;
+
+	// timedemo runs as fast as possible with a fixed step
+	if(( step = CL_TimeDemoFrameTime( )) > 0.0f )
+	{
+		host.realtime += step;
+		host.frametime = host.realframetime = step;
+		oldtime = host.realtime;
+		return true;
+	}
 
 	host.realtime += time;
 
@@ -584,6 +594,9 @@ void Host_Autosleep( void )
 {
 	int sleeptime = host_sleeptime->value;
 
+	if( CL_TimeDemoFrameTime( ) > 0.0f )
+		return; // never sleep in timedemo
+
 	if( Host_IsDedicated() )
 	{
 		// let the dedicated server some sleep
@@ -948,13 +961,15 @@ void Host_InitCommon( int argc, const char** argv, const char *progname, qboolea
 	Cmd_AddCommand( "memlist", Host_MemStats_f, "prints memory pool information" );
 	Cmd_AddCommand( "userconfigd", Host_Userconfigd_f, "execute all scripts from userconfig.d" );
 	cmd_scripting = Cvar_Get( "cmd_scripting", "0", CVAR_ARCHIVE, "enable simple condition checking and variable operations" );
-	
+
+	Sys_InitThreads();
 	FS_Init();
 	Image_Init();
 	Sound_Init();
 
 	FS_LoadGameInfo( NULL );
 	Q_strncpy( host.gamefolder, GI->gamefolder, sizeof( host.gamefolder ));
+	Asset_Init();
 
 
 	if( GI->secure )
@@ -977,6 +992,7 @@ void Host_FreeCommon( void )
 	Sound_Shutdown();
 	Netchan_Shutdown();
 	FS_Shutdown();
+	Sys_ShutdownThreads();
 
 	Mem_FreePool( &host.mempool );
 }
@@ -0,0 +1,444 @@
+/*
+mapcat.c - incremental catalog of installed maps
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "bspfile.h"
+
+/*
+=============================================================================
+
+Catalog keeps title, version and spawnpoint flag of every map, sorted
+by name, so prefix lookup is a binary search. It's saved as maps.cat
+into the game directory. A map is read again only when size or time
+of its bsp is changed. Files are read on the main thread (filesystem
+isn't thread-safe), entity lumps are parsed by the job threads.
+
+=============================================================================
+*/
+
+#define IDMAPCATHEADER	(('T'<<24)+('C'<<16)+('M'<<8)+'X')	// little-endian "XMCT"
+#define MAPCAT_VERSION	1
+#define MAPCAT_FILE		"maps.cat"
+#define MAPCAT_BATCH	64	// maps loaded into memory at once
+#define MAPCAT_RESCAN_TIME	1.0	// don't scan filesystem more often on lookups
+
+typedef struct
+{
+	int		ident;
+	int		version;
+	int		nummaps;
+	int		reserved;
+} dmapcat_t;
+
+typedef struct
+{
+	mapinfo_t		*info;
+	char		*ents;		// loaded by main thread
+} mapjob_t;
+
+static struct
+{
+	string		gamefolder;	// catalog belongs to this game
+	mapinfo_t		*maps;
+	int		nummaps;
+	double		lastScan;
+	qboolean		loaded;
+} mapcat;
+
+static int MapCat_Compare( const void *a, const void *b )
+{
+	return Q_stricmp( ((const mapinfo_t *)a)->name, ((const mapinfo_t *)b)->name );
+}
+
+/*
+=================
+MapCat_Find
+
+binary search by name
+=================
+*/
+static mapinfo_t *MapCat_Find( mapinfo_t *maps, int nummaps, const char *name )
+{
+	int	left = 0, right = nummaps - 1;
+
+	while( left <= right )
+	{
+		int	mid = ( left + right ) / 2;
+		int	cmp = Q_stricmp( maps[mid].name, name );
+
+		if( !cmp ) return &maps[mid];
+		if( cmp < 0 ) left = mid + 1;
+		else right = mid - 1;
+	}
+
+	return NULL;
+}
+
+/*
+=================
+MapCat_Load
+
+read saved catalog of current game
+=================
+*/
+static void MapCat_Load( void )
+{
+	dmapcat_t		*hdr;
+	fs_offset_t	size;
+	byte		*buffer;
+
+	if( mapcat.maps ) Mem_Free( mapcat.maps );
+	mapcat.maps = NULL;
+	mapcat.nummaps = 0;
+	mapcat.lastScan = 0.0;
+	mapcat.loaded = true;
+	Q_strncpy( mapcat.gamefolder, GI->gamefolder, sizeof( mapcat.gamefolder ));
+
+	buffer = FS_LoadFile( MAPCAT_FILE, &size, true );
+	if( !buffer ) return;
+
+	hdr = (dmapcat_t *)buffer;
+
+	if( size < sizeof( dmapcat_t ) || hdr->ident != IDMAPCATHEADER || hdr->version != MAPCAT_VERSION
+	|| hdr->nummaps < 0 || hdr->nummaps != ( size - sizeof( dmapcat_t )) / sizeof( mapinfo_t ))
+	{
+		MsgDev( D_WARN, "MapCat_Load: %s is corrupted\n", MAPCAT_FILE );
+		Mem_Free( buffer );
+		return;
+	}
+
+	if( hdr->nummaps )
+	{
+		mapcat.maps = Mem_Alloc( host.mempool, hdr->nummaps * sizeof( mapinfo_t ));
+		Q_memcpy( mapcat.maps, buffer + sizeof( dmapcat_t ), hdr->nummaps * sizeof( mapinfo_t ));
+		mapcat.nummaps = hdr->nummaps;
+	}
+
+	Mem_Free( buffer );
+}
+
+/*
+=================
+MapCat_Save
+=================
+*/
+static void MapCat_Save( void )
+{
+	dmapcat_t	*hdr;
+	int	size;
+
+	size = sizeof( dmapcat_t ) + mapcat.nummaps * sizeof( mapinfo_t );
+	hdr = Mem_Alloc( host.mempool, size );
+	hdr->ident = IDMAPCATHEADER;
+	hdr->version = MAPCAT_VERSION;
+	hdr->nummaps = mapcat.nummaps;
+
+	if( mapcat.nummaps )
+		Q_memcpy( hdr + 1, mapcat.maps, mapcat.nummaps * sizeof( mapinfo_t ));
+
+	if( !FS_WriteFile( MAPCAT_FILE, hdr, size ))
+		MsgDev( D_WARN, "MapCat_Save: couldn't write %s\n", MAPCAT_FILE );
+	Mem_Free( hdr );
+}
+
+/*
+=================
+MapCat_ReadMap
+
+read bsp header and entities, returns
+entities string for the parser
+=================
+*/
+static char *MapCat_ReadMap( mapinfo_t *info, const char *filename )
+{
+	byte		buf[MAX_SYSPATH];
+	string		entfilename;
+	int		lumpofs = 0, lumplen = 0;
+	dextrahdr_t	*hdrext;
+	dheader_t		*header;
+	char		*ents;
+	file_t		*f;
+
+	f = FS_Open( filename, "rb", false );
+	if( !f ) return NULL;
+
+	Q_memset( buf, 0, sizeof( buf ));
+	FS_Read( f, buf, sizeof( buf ));
+	header = (dheader_t *)buf;
+	info->version = header->version;
+
+	switch( info->version )
+	{
+	case Q1BSP_VERSION:
+	case HLBSP_VERSION:
+	case XTBSP_VERSION:
+		if( header->lumps[LUMP_ENTITIES].fileofs <= 1024 && !(header->lumps[LUMP_ENTITIES].filelen % sizeof(dplane_t)))
+		{
+			lumpofs = header->lumps[LUMP_PLANES].fileofs;
+			lumplen = header->lumps[LUMP_PLANES].filelen;
+			info->flags |= MAPINFO_GEARBOX;
+		}
+		else
+		{
+			lumpofs = header->lumps[LUMP_ENTITIES].fileofs;
+			lumplen = header->lumps[LUMP_ENTITIES].filelen;
+		}
+		break;
+	}
+
+	if( info->version == XTBSP_VERSION )
+		hdrext = (dextrahdr_t *)((byte *)buf + sizeof( dheader31_t ));
+	else hdrext = (dextrahdr_t *)((byte *)buf + sizeof( dheader_t ));
+
+	if( hdrext->id == IDEXTRAHEADER && hdrext->version == EXTRA_VERSION )
+		info->flags |= MAPINFO_EXTRAHEADER;
+
+	Q_strncpy( entfilename, filename, sizeof( entfilename ));
+	FS_StripExtension( entfilename );
+	FS_DefaultExtension( entfilename, ".ent" );
+	ents = (char *)FS_LoadFile( entfilename, NULL, true );
+
+	if( !ents && lumplen >= 10 )
+	{
+		FS_Seek( f, lumpofs, SEEK_SET );
+		ents = (char *)Mem_Alloc( host.mempool, lumplen + 1 );
+		FS_Read( f, ents, lumplen );
+	}
+
+	FS_Close( f );
+
+	return ents;
+}
+
+/*
+=================
+MapCat_ParseJob
+
+extract worldspawn message and look for
+spawnpoints, runs on the job threads
+=================
+*/
+static void MapCat_ParseJob( void *data, int index )
+{
+	mapjob_t	*job = (mapjob_t *)data + index;
+	mapinfo_t	*info = job->info;
+	char	token[2048];
+	qboolean	worldspawn = true;
+	char	*pfile = job->ents;
+
+	if( !pfile ) return;
+
+	info->flags |= MAPINFO_ENTITIES;
+
+	while(( pfile = COM_ParseFile( pfile, token )) != NULL )
+	{
+		if( token[0] == '}' && worldspawn )
+			worldspawn = false;
+		else if( !Q_strcmp( token, "message" ) && worldspawn )
+		{
+			// get the message contents
+			pfile = COM_ParseFile( pfile, token );
+			Q_strncpy( info->title, token, sizeof( info->title ));
+		}
+		else if( !Q_strcmp( token, "mapversion" ) && worldspawn )
+		{
+			pfile = COM_ParseFile( pfile, token );
+			info->mapversion = Q_atoi( token );
+		}
+		else if( !Q_strcmp( token, "classname" ))
+		{
+			pfile = COM_ParseFile( pfile, token );
+			if( !Q_strcmp( token, GI->mp_entity ))
+				info->flags |= MAPINFO_SPAWNPOINTS;
+		}
+
+		if(( info->flags & MAPINFO_SPAWNPOINTS ) && !worldspawn )
+			break; // valid map
+	}
+}
+
+/*
+=================
+MapCat_ReadMaps
+
+read changed maps in batches, so
+all entities never stay in memory
+=================
+*/
+static void MapCat_ReadMaps( mapinfo_t **pending, char **filenames, int count )
+{
+	mapjob_t	jobs[MAPCAT_BATCH];
+	int	i, j, numjobs;
+
+	for( i = 0; i < count; i += numjobs )
+	{
+		numjobs = min( count - i, MAPCAT_BATCH );
+
+		for( j = 0; j < numjobs; j++ )
+		{
+			jobs[j].info = pending[i + j];
+			jobs[j].ents = MapCat_ReadMap( jobs[j].info, filenames[i + j] );
+		}
+
+		Sys_RunJobs( MapCat_ParseJob, jobs, numjobs );
+
+		for( j = 0; j < numjobs; j++ )
+		{
+			if( jobs[j].ents )
+				Mem_Free( jobs[j].ents );
+		}
+	}
+}
+
+/*
+=================
+MapCat_Update
+
+bring catalog in sync with maps on disk. Unless forced,
+filesystem is not scanned again for a second.
+Returns true if something was changed
+=================
+*/
+qboolean MapCat_Update( qboolean force )
+{
+	search_t		*t, *gamedir;
+	mapinfo_t		*maps, *info, *old, **pending;
+	char		**pendingnames;
+	int		i, nummaps, numpending = 0;
+	qboolean		changed;
+	double		start;
+
+	if( !mapcat.loaded || Q_stricmp( mapcat.gamefolder, GI->gamefolder ))
+		MapCat_Load();
+
+	start = Sys_DoubleTime();
+
+	if( !force && mapcat.lastScan && start - mapcat.lastScan < MAPCAT_RESCAN_TIME )
+		return false;
+
+	t = FS_Search( "maps/*.bsp", true, false );
+	gamedir = FS_Search( "maps/*.bsp", true, true );
+
+	nummaps = t ? t->numfilenames : 0;
+	maps = nummaps ? Mem_Alloc( host.mempool, nummaps * sizeof( mapinfo_t )) : NULL;
+	pending = nummaps ? Mem_Alloc( host.mempool, nummaps * sizeof( mapinfo_t* )) : NULL;
+	pendingnames = nummaps ? Mem_Alloc( host.mempool, nummaps * sizeof( char* )) : NULL;
+
+	for( i = nummaps = 0; t && i < t->numfilenames; i++ )
+	{
+		if( Q_stricmp( FS_FileExtension( t->filenames[i] ), "bsp" ))
+			continue;
+
+		info = &maps[nummaps++];
+		FS_FileBase( t->filenames[i], info->name );
+		info->filesize = FS_FileSize( t->filenames[i], false );
+		info->filetime = FS_FileTime( t->filenames[i], false );
+
+		old = MapCat_Find( mapcat.maps, mapcat.nummaps, info->name );
+
+		if( old && old->filesize == info->filesize && old->filetime == info->filetime )
+		{
+			*info = *old;
+			continue;
+		}
+
+		// new or changed map
+		info->version = -1;
+		pending[numpending] = info;
+		pendingnames[numpending] = t->filenames[i];
+		numpending++;
+	}
+
+	MapCat_ReadMaps( pending, pendingnames, numpending );
+	qsort( maps, nummaps, sizeof( mapinfo_t ), MapCat_Compare );
+
+	for( i = 0; i < nummaps; i++ )
+		maps[i].flags &= ~MAPINFO_GAMEDIR;
+
+	for( i = 0; gamedir && i < gamedir->numfilenames; i++ )
+	{
+		string	name;
+
+		FS_FileBase( gamedir->filenames[i], name );
+		if(( info = MapCat_Find( maps, nummaps, name )) != NULL )
+			info->flags |= MAPINFO_GAMEDIR;
+	}
+
+	// removed maps or moved between directories are changes too
+	changed = ( numpending || nummaps != mapcat.nummaps );
+	for( i = 0; !changed && i < nummaps; i++ )
+		changed = ( maps[i].flags != mapcat.maps[i].flags );
+
+	if( mapcat.maps ) Mem_Free( mapcat.maps );
+	mapcat.maps = maps;
+	mapcat.nummaps = nummaps;
+	mapcat.lastScan = Sys_DoubleTime();
+
+	if( changed ) MapCat_Save();
+
+	if( pending ) Mem_Free( pending );
+	if( pendingnames ) Mem_Free( pendingnames );
+	if( gamedir ) Mem_Free( gamedir );
+	if( t ) Mem_Free( t );
+
+	if( changed )
+		MsgDev( D_INFO, "map catalog: %i maps, %i read in %.1f ms\n", nummaps, numpending, ( mapcat.lastScan - start ) * 1000.0 );
+
+	return changed;
+}
+
+/*
+=================
+MapCat_FindPrefix
+
+returns number of maps which names are starting
+with prefix, list points to the first of them
+=================
+*/
+int MapCat_FindPrefix( const char *prefix, const mapinfo_t **list )
+{
+	int	len = Q_strlen( prefix );
+	int	left = 0, right = mapcat.nummaps, first;
+
+	*list = NULL;
+
+	// lower bound of prefix
+	while( left < right )
+	{
+		int	mid = ( left + right ) / 2;
+
+		if( Q_strnicmp( mapcat.maps[mid].name, prefix, len ) < 0 )
+			left = mid + 1;
+		else right = mid;
+	}
+
+	first = left;
+
+	// upper bound of prefix
+	for( right = mapcat.nummaps; left < right; )
+	{
+		int	mid = ( left + right ) / 2;
+
+		if( Q_strnicmp( mapcat.maps[mid].name, prefix, len ) <= 0 )
+			left = mid + 1;
+		else right = mid;
+	}
+
+	if( left == first )
+		return 0;
+
+	*list = &mapcat.maps[first];
+	return left - first;
+}
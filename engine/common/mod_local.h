@@ -128,6 +128,9 @@ void Mod_BuildSurfacePolygons( msurface_t *surf, mextrasurf_t *info );
 void Mod_AmbientLevels( const vec3_t p, byte *pvolumes );
 byte *Mod_CompressVis( const byte *in, size_t *size );
 byte *Mod_DecompressVis( const byte *in );
+void Mod_MergeVis( byte *out, const byte *in, int size );
+void Mod_ClearVisCache( void );
+void Mod_VisCacheInfo( int *hits, int *misses, int *numrows );
 modtype_t Mod_GetType( int handle );
 model_t *Mod_Handle( int handle );
 struct wadlist_s *Mod_WadList( void );
@@ -24,6 +24,37 @@ GNU General Public License for more details.
 #include "client.h"
 
 #define MAX_SIDE_VERTS		512	// per one polygon
+#define VIS_CACHE_SIZE		(1024 * 1024)	// memory for decompressed vis rows
+#define VIS_CACHE_MIN_ROWS		64
+
+// vector kernel for vis merges
+#if defined(__SSE2__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define XASH_VIS_SSE2
+#elif defined(__ARM_NEON__) || defined(__NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define XASH_VIS_NEON
+#endif
+
+typedef struct
+{
+	int		key;		// leafnum * 2 + type, -1 if slot is empty
+	int		prev, next;	// LRU order, head is most recently used
+} visrow_t;
+
+// decompressed pvs and phs rows of the world
+static struct
+{
+	model_t		*model;
+	int		rowbytes;		// padded to 16 bytes, tail is zero
+	int		numrows;
+	byte		*rows;
+	visrow_t		*slots;
+	int		*lookup;		// slot for each key or -1
+	int		head;
+	int		hits;
+	int		misses;
+} vis_cache;
 
 world_static_t	world;
 
@@ -314,6 +345,189 @@ mleaf_t *Mod_PointInLeaf( const vec3_t p, mnode_t *node )
 	return NULL;
 }
 
+/*
+===================
+Mod_MergeVis
+
+OR vis row into fat row, size is in bytes
+===================
+*/
+void Mod_MergeVis( byte *out, const byte *in, int size )
+{
+	int	i = 0;
+
+#if defined( XASH_VIS_SSE2 )
+	for( ; i + 16 <= size; i += 16 )
+	{
+		__m128i	v = _mm_or_si128( _mm_loadu_si128( (const __m128i *)( out + i )), _mm_loadu_si128( (const __m128i *)( in + i )));
+		_mm_storeu_si128( (__m128i *)( out + i ), v );
+	}
+#elif defined( XASH_VIS_NEON )
+	for( ; i + 16 <= size; i += 16 )
+		vst1q_u8( out + i, vorrq_u8( vld1q_u8( out + i ), vld1q_u8( in + i )));
+#endif
+	for( ; i < size; i++ )
+		out[i] |= in[i];
+}
+
+/*
+===================
+Mod_ClearVisCache
+
+world was changed or freed
+===================
+*/
+void Mod_ClearVisCache( void )
+{
+	if( vis_cache.rows ) Mem_Free( vis_cache.rows );
+	if( vis_cache.slots ) Mem_Free( vis_cache.slots );
+	if( vis_cache.lookup ) Mem_Free( vis_cache.lookup );
+	Q_memset( &vis_cache, 0, sizeof( vis_cache ));
+}
+
+/*
+===================
+Mod_InitVisCache
+===================
+*/
+static void Mod_InitVisCache( model_t *model )
+{
+	int	i, numkeys;
+
+	Mod_ClearVisCache();
+
+	vis_cache.model = model;
+	vis_cache.rowbytes = ((( model->numleafs + 31 ) >> 3 ) + 15 ) & ~15;
+	vis_cache.numrows = max( VIS_CACHE_SIZE / vis_cache.rowbytes, VIS_CACHE_MIN_ROWS );
+	numkeys = ( model->numleafs + 1 ) * 2;
+
+	vis_cache.rows = Mem_Alloc( host.mempool, vis_cache.numrows * vis_cache.rowbytes );
+	vis_cache.slots = Mem_Alloc( host.mempool, vis_cache.numrows * sizeof( visrow_t ));
+	vis_cache.lookup = Mem_Alloc( host.mempool, numkeys * sizeof( int ));
+
+	for( i = 0; i < numkeys; i++ )
+		vis_cache.lookup[i] = -1;
+
+	// link all slots in a ring
+	for( i = 0; i < vis_cache.numrows; i++ )
+	{
+		vis_cache.slots[i].key = -1;
+		vis_cache.slots[i].prev = ( i + vis_cache.numrows - 1 ) % vis_cache.numrows;
+		vis_cache.slots[i].next = ( i + 1 ) % vis_cache.numrows;
+	}
+	vis_cache.head = 0;
+}
+
+/*
+===================
+Mod_TouchVisRow
+
+make slot most recently used
+===================
+*/
+static void Mod_TouchVisRow( int slot )
+{
+	visrow_t	*row = &vis_cache.slots[slot];
+	visrow_t	*head;
+
+	if( slot == vis_cache.head )
+		return;
+
+	// unlink
+	vis_cache.slots[row->prev].next = row->next;
+	vis_cache.slots[row->next].prev = row->prev;
+
+	// insert before the old head
+	head = &vis_cache.slots[vis_cache.head];
+	row->next = vis_cache.head;
+	row->prev = head->prev;
+	vis_cache.slots[head->prev].next = slot;
+	head->prev = slot;
+	vis_cache.head = slot;
+}
+
+/*
+===================
+Mod_CachedVis
+
+returned row stays valid until the next
+numrows - 1 lookups of other rows
+===================
+*/
+static byte *Mod_CachedVis( mleaf_t *leaf, model_t *model, int type )
+{
+	const byte	*in = ( type == DVIS_PHS ) ? leaf->compressed_pas : leaf->compressed_vis;
+	int		leafnum = leaf - model->leafs;
+	int		key, slot, row, c;
+	byte		*out, *end;
+
+	// submodels and half-loaded world are not cached
+	if( model != worldmodel || world.loading || leafnum < 0 || leafnum > model->numleafs )
+		return Mod_DecompressVis( in );
+
+	if( vis_cache.model != model )
+		Mod_InitVisCache( model );
+
+	key = leafnum * 2 + ( type == DVIS_PHS );
+	slot = vis_cache.lookup[key];
+
+	if( slot != -1 )
+	{
+		vis_cache.hits++;
+		Mod_TouchVisRow( slot );
+		return vis_cache.rows + slot * vis_cache.rowbytes;
+	}
+
+	// take least recently used slot
+	vis_cache.misses++;
+	slot = vis_cache.slots[vis_cache.head].prev;
+	if( vis_cache.slots[slot].key != -1 )
+		vis_cache.lookup[vis_cache.slots[slot].key] = -1;
+	vis_cache.slots[slot].key = key;
+	vis_cache.lookup[key] = slot;
+	Mod_TouchVisRow( slot );
+
+	out = vis_cache.rows + slot * vis_cache.rowbytes;
+	row = ( model->numleafs + 7 ) >> 3;
+	end = out + row;
+	Q_memset( out, 0, vis_cache.rowbytes );
+
+	if( !in )
+	{
+		// no vis info, so make all visible
+		Q_memset( out, 0xff, row );
+		return out;
+	}
+
+	// same as Mod_DecompressVis but never runs out of the row
+	while( out < end )
+	{
+		if( *in )
+		{
+			*out++ = *in++;
+			continue;
+		}
+
+		c = min( in[1], end - out );
+		in += 2;
+		out += c; // already zeroed
+	}
+
+	return vis_cache.rows + slot * vis_cache.rowbytes;
+}
+
+/*
+===================
+Mod_VisCacheInfo
+===================
+*/
+void Mod_VisCacheInfo( int *hits, int *misses, int *numrows )
+{
+	if( hits ) *hits = vis_cache.hits;
+	if( misses ) *misses = vis_cache.misses;
+	if( numrows ) *numrows = vis_cache.numrows;
+}
+
 /*
 ==================
 Mod_LeafPVS
@@ -324,7 +538,7 @@ byte *Mod_LeafPVS( mleaf_t *leaf, model_t *model )
 {
 	if( !model || !leaf || leaf == model->leafs || !model->visdata )
 		return Mod_DecompressVis( NULL );
-	return Mod_DecompressVis( leaf->compressed_vis );
+	return Mod_CachedVis( leaf, model, DVIS_PVS );
 }
 
 /*
@@ -337,7 +551,7 @@ byte *Mod_LeafPHS( mleaf_t *leaf, model_t *model )
 {
 	if( !model || !leaf || leaf == model->leafs || !model->visdata )
 		return Mod_DecompressVis( NULL );
-	return Mod_DecompressVis( leaf->compressed_pas );
+	return Mod_CachedVis( leaf, model, DVIS_PHS );
 }
 
 /*
@@ -568,6 +782,7 @@ void Mod_ClearAll( qboolean keep_playermodel )
 
 	// g-cont. may just leave unchanged?
 	if( !keep_playermodel ) cm_nummodels = 0;
+	Mod_ClearVisCache();
 }
 
 void Mod_ClearUserData( void )
@@ -3091,6 +3306,7 @@ void Mod_LoadWorld( const char *name, uint *checksum, qboolean force )
 	// purge all submodels
 	Mod_FreeModel( &cm_models[0] );
 	Mem_EmptyPool( com_studiocache );
+	Mod_ClearVisCache();
 	world.load_sequence++;	// now all models are invalid
 
 	// load the newmap
@@ -3103,6 +3319,7 @@ void Mod_LoadWorld( const char *name, uint *checksum, qboolean force )
 		
 	// calc Potentially Hearable Set and compress it
 	Mod_CalcPHS();
+	Mod_ClearVisCache();
 }
 
 /*
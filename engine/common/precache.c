@@ -0,0 +1,121 @@
+/*
+precache.c - hashed lookup of precache names
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+
+/*
+=============================================================================
+
+Names stay in the usual [max][CS_SIZE] tables, precache_t only keeps
+hash chains of table indexes, so index assignment doesn't change.
+Zeroed precache_t is an empty index, so it's wiped together with the
+structure it lives in. Slot 0 is never used, so 0 ends a chain.
+
+=============================================================================
+*/
+
+/*
+=================
+Precache_Clear
+=================
+*/
+void Precache_Clear( precache_t *list )
+{
+	Q_memset( list, 0, sizeof( *list ));
+}
+
+/*
+=================
+Precache_Rebuild
+
+slot was rewritten, link whole table again
+=================
+*/
+static void Precache_Rebuild( precache_t *list, char (*names)[CS_SIZE] )
+{
+	int	i, count = list->count;
+
+	Precache_Clear( list );
+
+	for( i = 1; i < count; i++ )
+	{
+		if( names[i][0] )
+			Precache_Add( list, names, i );
+	}
+
+	list->count = count;
+}
+
+/*
+=================
+Precache_Add
+
+link table slot after the name was written
+=================
+*/
+void Precache_Add( precache_t *list, char (*names)[CS_SIZE], int index )
+{
+	uint	hash;
+
+	if( index <= 0 || index >= MAX_PRECACHE || !names[index][0] )
+		return;
+
+	if( index < list->count )
+	{
+		Precache_Rebuild( list, names );
+		return;
+	}
+
+	hash = Com_HashKey( names[index], PRECACHE_HASH_SIZE );
+	list->next[index] = list->hash[hash];
+	list->hash[hash] = index;
+	list->count = index + 1;
+}
+
+/*
+=================
+Precache_Find
+
+returns first slot with this name or 0
+=================
+*/
+int Precache_Find( const precache_t *list, char (*names)[CS_SIZE], const char *name )
+{
+	int	i, found = 0;
+
+	if( !name || !name[0] )
+		return 0;
+
+	for( i = list->hash[Com_HashKey( name, PRECACHE_HASH_SIZE )]; i; i = list->next[i] )
+	{
+		// newest slots are first in chain, keep the lowest as linear search did
+		if(( !found || i < found ) && !Q_stricmp( names[i], name ))
+			found = i;
+	}
+
+	return found;
+}
+
+/*
+=================
+Precache_FreeSlot
+
+slots are filled in order, so next free slot is after the last one
+=================
+*/
+int Precache_FreeSlot( const precache_t *list )
+{
+	return max( list->count, 1 );
+}
@@ -8,8 +8,51 @@
 
 #include "mpg123.h"
 
+#ifdef MPG_SIMD
+/*
+ * one butterfly pass over n inputs, four pairs at once:
+ * out[i] = in[i] + in[n-1-i]
+ * out[n-1-i] = (in[i] - in[n-1-i]) * costab[i], operands swapped if flip
+ * does the same float operations as the scalar code, so results are equal
+ */
+static void dct64_butterfly( float *out, float *in, const float *costab, int n, int flip )
+{
+  mpgvec_t lo, hi, diff;
+  int i;
+
+  for( i = 0; i < n / 2; i += 4 )
+  {
+    lo = VEC_LOAD( in + i );
+    hi = VEC_REV( VEC_LOAD( in + n - 4 - i ));
+    diff = flip ? VEC_SUB( hi, lo ) : VEC_SUB( lo, hi );
+    VEC_STORE( out + i, VEC_ADD( lo, hi ));
+    VEC_STORE( out + n - 4 - i, VEC_REV( VEC_MUL( diff, VEC_LOAD( costab + i ))));
+  }
+}
+
+/* first three passes, the last two are too narrow for vectors */
+static void dct64_vec( struct StaticData *psd, float *b1, float *b2, float *samples )
+{
+  dct64_butterfly( b1, samples, psd->pnts[0], 32, 0 );
+
+  dct64_butterfly( b2 + 0x00, b1 + 0x00, psd->pnts[1], 16, 0 );
+  dct64_butterfly( b2 + 0x10, b1 + 0x10, psd->pnts[1], 16, 1 );
+
+  dct64_butterfly( b1 + 0x00, b2 + 0x00, psd->pnts[2], 8, 0 );
+  dct64_butterfly( b1 + 0x08, b2 + 0x08, psd->pnts[2], 8, 1 );
+  dct64_butterfly( b1 + 0x10, b2 + 0x10, psd->pnts[2], 8, 0 );
+  dct64_butterfly( b1 + 0x18, b2 + 0x18, psd->pnts[2], 8, 1 );
+}
+#endif
+
 static void dct64_1( struct StaticData *psd, float *out0, float *out1, float *b1, float *b2, float *samples )
 {
+#ifdef MPG_SIMD
+ if( synth_simd )
+  dct64_vec( psd, b1, b2, samples );
+ else
+#endif
+ {
  {
   register float *costab = psd->pnts[0];
 
@@ -140,6 +183,7 @@ static void dct64_1( struct StaticData *psd, float *out0, float *out1, float *b1
   b1[0x1B] = b2[0x1B] + b2[0x1C];
   b1[0x1C] = (b2[0x1C] - b2[0x1B]) * costab[3];
  }
+ }
 
  {
   register float const cos0 = psd->pnts[3][0];
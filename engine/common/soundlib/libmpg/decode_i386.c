@@ -23,6 +23,85 @@
   else if( (sum) < -32768.0) { *(samples) = -0x8000; (clip)++; } \
   else { *(samples) = sum; }
 
+int synth_simd = 1;
+
+#ifdef MPG_SIMD
+/*
+ * vector version of the synthesis window. Sums are added
+ * in other order than the scalar code does, so samples
+ * may differ from the scalar output by one
+ */
+
+/* four outputs of the first half, odd taps are subtracted */
+static void synth_sums_fwd( const float *window, const float *b0, float *sums )
+{
+  mpgvec_t acc[4];
+  int j;
+
+  for( j = 0; j < 4; j++, window += 0x20, b0 += 0x10 )
+  {
+    acc[j] = VEC_MUL( VEC_LOAD( window + 0x0 ), VEC_LOAD( b0 + 0x0 ));
+    acc[j] = VEC_ADD( acc[j], VEC_MUL( VEC_LOAD( window + 0x4 ), VEC_LOAD( b0 + 0x4 )));
+    acc[j] = VEC_ADD( acc[j], VEC_MUL( VEC_LOAD( window + 0x8 ), VEC_LOAD( b0 + 0x8 )));
+    acc[j] = VEC_ADD( acc[j], VEC_MUL( VEC_LOAD( window + 0xC ), VEC_LOAD( b0 + 0xC )));
+  }
+
+  VEC_TRANSPOSE( acc[0], acc[1], acc[2], acc[3] );
+  VEC_STORE( sums, VEC_ADD( VEC_SUB( acc[0], acc[1] ), VEC_SUB( acc[2], acc[3] )));
+}
+
+/* four outputs of the second half: window[-1] ... window[-15], window[0] against b0[0] ... b0[15] */
+static void synth_sums_rev( const float *window, const float *b0, float *sums )
+{
+  mpgvec_t acc[4], last;
+  int j;
+
+  for( j = 0; j < 4; j++, window -= 0x20, b0 -= 0x10 )
+  {
+    last = VEC_SETLO( VEC_LOAD( window - 0x10 ), window[0] );
+    acc[j] = VEC_MUL( VEC_REV( VEC_LOAD( window - 0x4 )), VEC_LOAD( b0 + 0x0 ));
+    acc[j] = VEC_ADD( acc[j], VEC_MUL( VEC_REV( VEC_LOAD( window - 0x8 )), VEC_LOAD( b0 + 0x4 )));
+    acc[j] = VEC_ADD( acc[j], VEC_MUL( VEC_REV( VEC_LOAD( window - 0xC )), VEC_LOAD( b0 + 0x8 )));
+    acc[j] = VEC_ADD( acc[j], VEC_MUL( VEC_REV( last ), VEC_LOAD( b0 + 0xC )));
+  }
+
+  VEC_TRANSPOSE( acc[0], acc[1], acc[2], acc[3] );
+  VEC_STORE( sums, VEC_SUB( VEC_ZERO(), VEC_ADD( VEC_ADD( acc[0], acc[1] ), VEC_ADD( acc[2], acc[3] ))));
+}
+
+static int synth_window_vec( float *window, float *b0, int bo1, short *samples )
+{
+  float sums[33]; /* last group of the second half computes one extra sum */
+  int j, clip = 0;
+
+  for( j = 0; j < 16; j += 4 )
+    synth_sums_fwd( window + j * 0x20, b0 + j * 0x10, sums + j );
+
+  window += 0x200;
+  b0 += 0x100;
+
+  sums[16]  = window[0x0] * b0[0x0];
+  sums[16] += window[0x2] * b0[0x2];
+  sums[16] += window[0x4] * b0[0x4];
+  sums[16] += window[0x6] * b0[0x6];
+  sums[16] += window[0x8] * b0[0x8];
+  sums[16] += window[0xA] * b0[0xA];
+  sums[16] += window[0xC] * b0[0xC];
+  sums[16] += window[0xE] * b0[0xE];
+
+  window += (bo1<<1) - 0x20;
+  b0 -= 0x10;
+
+  for( j = 0; j < 16; j += 4 )
+    synth_sums_rev( window - j * 0x20, b0 - j * 0x10, sums + 17 + j );
+
+  for( j = 0; j < 32; j++, samples += 2 )
+    WRITE_SAMPLE(samples,sums[j],clip);
+
+  return clip;
+}
+#endif
+
 int synth_1to1_mono(struct StaticData * psd, struct mpstr * gmp, float *bandPtr,unsigned char *samples,int *pnt)
 {
   short samples_tmp[64];
@@ -81,6 +160,15 @@ int synth_1to1(struct StaticData * psd, struct mpstr * gmp, float *bandPtr,int c
 
   gmp->synth_bo = bo;
 
+#ifdef MPG_SIMD
+  if( synth_simd )
+  {
+    clip = synth_window_vec( psd->decwin + 16 - bo1, b0, bo1, samples );
+    *pnt += 128;
+    return clip;
+  }
+#endif
+
   {
     register int j;
     float *window = psd->decwin + 16 - bo1;
@@ -25,6 +25,7 @@ extern int read_mpeg_stream( mpeg_t *mpg, const char *data, int bufsize );
 extern int set_current_pos( mpeg_t *mpg, int newpos, int (*pfnSeek)( void*, int, int ), void *file );
 extern int get_current_pos( mpeg_t *mpg, int curpos );
 extern void close_decoder( mpeg_t *mpg );
+extern int synth_simd;
 
 #ifdef __cplusplus
 }
@@ -48,6 +48,46 @@
 // Pre Shift fo 16 to 8 bit converter table
 #define AUSHIFT		(3)
 
+/* vector kernels for dct64 and synthesis window */
+#if defined(__SSE__) || defined(_M_X64) || ( defined(_M_IX86_FP) && _M_IX86_FP >= 1 )
+#include <xmmintrin.h>
+#define MPG_SSE
+typedef __m128		mpgvec_t;
+#define VEC_LOAD( p )	_mm_loadu_ps( p )
+#define VEC_STORE( p, v )	_mm_storeu_ps( (p), (v) )
+#define VEC_ADD( a, b )	_mm_add_ps( (a), (b) )
+#define VEC_SUB( a, b )	_mm_sub_ps( (a), (b) )
+#define VEC_MUL( a, b )	_mm_mul_ps( (a), (b) )
+#define VEC_REV( v )	_mm_shuffle_ps( (v), (v), _MM_SHUFFLE( 0, 1, 2, 3 ))
+#define VEC_SETLO( v, f )	_mm_move_ss( (v), _mm_set_ss( f ))
+#define VEC_ZERO()		_mm_setzero_ps()
+#define VEC_TRANSPOSE( a, b, c, d )	_MM_TRANSPOSE4_PS( a, b, c, d )
+#elif defined(__ARM_NEON__) || defined(__NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MPG_NEON
+typedef float32x4_t		mpgvec_t;
+#define VEC_LOAD( p )	vld1q_f32( p )
+#define VEC_STORE( p, v )	vst1q_f32( (p), (v) )
+#define VEC_ADD( a, b )	vaddq_f32( (a), (b) )
+#define VEC_SUB( a, b )	vsubq_f32( (a), (b) )
+#define VEC_MUL( a, b )	vmulq_f32( (a), (b) )
+#define VEC_REV( v )	vcombine_f32( vrev64_f32( vget_high_f32( v )), vrev64_f32( vget_low_f32( v )))
+#define VEC_SETLO( v, f )	vsetq_lane_f32( (f), (v), 0 )
+#define VEC_ZERO()		vdupq_n_f32( 0.0f )
+#define VEC_TRANSPOSE( a, b, c, d ) \
+{ \
+  float32x4x2_t ab = vtrnq_f32( a, b ), cd = vtrnq_f32( c, d ); \
+  a = vcombine_f32( vget_low_f32( ab.val[0] ), vget_low_f32( cd.val[0] )); \
+  b = vcombine_f32( vget_low_f32( ab.val[1] ), vget_low_f32( cd.val[1] )); \
+  c = vcombine_f32( vget_high_f32( ab.val[0] ), vget_high_f32( cd.val[0] )); \
+  d = vcombine_f32( vget_high_f32( ab.val[1] ), vget_high_f32( cd.val[1] )); \
+}
+#endif
+
+#if defined(MPG_SSE) || defined(MPG_NEON)
+#define MPG_SIMD
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -237,6 +277,7 @@ extern void make_decode_tables( struct StaticData *psd, int scaleval );
 extern void dct64( struct StaticData *psd, float*, float*, float* );
 
 extern const int freqs[9];
+extern int synth_simd;	/* use vector kernels if they are compiled in */
 
 #ifdef __cplusplus
 }
@@ -270,6 +270,20 @@ int FS_SetStreamPos( stream_t *stream, int newpos )
 	return stream->format->setposfunc( stream, newpos );
 }
 
+/*
+================
+FS_CacheStream
+
+read the whole stream file into memory, so
+the stream can be decoded from another thread
+================
+*/
+qboolean FS_CacheStream( stream_t *stream )
+{
+	if( !stream ) return false;
+	return FS_CacheFile( stream->file );
+}
+
 /*
 ================
 FS_FreeStream
@@ -47,6 +47,7 @@ int read_mpeg_stream( mpeg_t *mpg, const char *data, int bufsize );
 extern int set_current_pos( mpeg_t *mpg, int newpos, int (*pfnSeek)( void*, int, int ), void *file );
 int get_current_pos( mpeg_t *mpg, int curpos );
 void close_decoder( mpeg_t *mpg );
+extern int synth_simd;
 
 /*
 =================================================================
@@ -338,3 +339,19 @@ void Stream_FreeMPG( stream_t *stream )
 
 	Mem_Free( stream );
 }
+
+/*
+=================
+Sound_SetDecoderSIMD
+
+switch vector kernels of mpeg synthesis,
+returns previous state
+=================
+*/
+qboolean Sound_SetDecoderSIMD( qboolean enable )
+{
+	qboolean	old = synth_simd;
+
+	synth_simd = enable;
+	return old;
+}
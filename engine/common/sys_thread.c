@@ -0,0 +1,450 @@
+/*
+sys_thread.c - worker threads and parallel jobs
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#include "port.h"
+#include "common.h"
+#include "mathlib.h"
+
+#define MAX_JOB_THREADS	16
+
+#ifdef _WIN32
+#define THREAD_RESULT		DWORD WINAPI
+#define Atomic_Increment( x )		InterlockedIncrement( (LONG volatile *)(x) )
+#else
+#define THREAD_RESULT		void *
+#define Atomic_Increment( x )		__sync_add_and_fetch( (x), 1 )
+#endif
+
+typedef struct
+{
+	sysjob_t		func;
+	void		*data;
+	int		count;
+	volatile int	next;		// next unclaimed job index
+	volatile int	checkedin;	// workers which have finished this batch
+	int		generation;	// bumped for each new batch
+	qboolean		quit;
+} jobbatch_t;
+
+static struct
+{
+	int		numthreads;	// worker threads, main thread is not counted
+	qboolean		initialized;
+	jobbatch_t	batch;
+#ifdef _WIN32
+	HANDLE		threads[MAX_JOB_THREADS];
+	HANDLE		wake;		// semaphore, released once per worker for each batch
+	HANDLE		finished;		// auto-reset event, set by the last worker
+#else
+	pthread_t		threads[MAX_JOB_THREADS];
+	pthread_mutex_t	lock;
+	pthread_cond_t	wake;
+	pthread_cond_t	finished;
+#endif
+} sys_jobs;
+
+struct systhread_s
+{
+	systhreadfunc_t	func;
+	void		*data;
+#ifdef _WIN32
+	HANDLE		handle;
+#else
+	pthread_t		handle;
+#endif
+};
+
+#ifdef _WIN32
+static DWORD		sys_mainthread;
+#else
+static pthread_t		sys_mainthread;
+#endif
+static qboolean		sys_mainthread_set;
+
+/*
+================
+Sys_CPUCount
+
+returns number of logical processors
+================
+*/
+static int Sys_CPUCount( void )
+{
+#ifdef _WIN32
+	SYSTEM_INFO	info;
+
+	GetSystemInfo( &info );
+	return info.dwNumberOfProcessors;
+#elif defined( _SC_NPROCESSORS_ONLN )
+	return sysconf( _SC_NPROCESSORS_ONLN );
+#else
+	return 1;
+#endif
+}
+
+/*
+================
+Sys_RunBatch
+
+claim and run jobs until the batch is drained
+================
+*/
+static void Sys_RunBatch( jobbatch_t *batch )
+{
+	int	i;
+
+	while(( i = Atomic_Increment( &batch->next ) - 1 ) < batch->count )
+		batch->func( batch->data, i );
+}
+
+/*
+================
+Sys_WorkerThread
+================
+*/
+static THREAD_RESULT Sys_WorkerThread( void *arg )
+{
+	jobbatch_t	*batch = &sys_jobs.batch;
+#ifdef _WIN32
+	while( 1 )
+	{
+		WaitForSingleObject( sys_jobs.wake, INFINITE );
+
+		if( batch->quit )
+			break;
+
+		Sys_RunBatch( batch );
+
+		if( Atomic_Increment( &batch->checkedin ) == sys_jobs.numthreads )
+			SetEvent( sys_jobs.finished );
+	}
+	return 0;
+#else
+	int		generation = 0;
+
+	while( 1 )
+	{
+		pthread_mutex_lock( &sys_jobs.lock );
+		while( batch->generation == generation && !batch->quit )
+			pthread_cond_wait( &sys_jobs.wake, &sys_jobs.lock );
+		generation = batch->generation;
+		pthread_mutex_unlock( &sys_jobs.lock );
+
+		if( batch->quit )
+			break;
+
+		Sys_RunBatch( batch );
+
+		if( Atomic_Increment( &batch->checkedin ) == sys_jobs.numthreads )
+		{
+			pthread_mutex_lock( &sys_jobs.lock );
+			pthread_cond_signal( &sys_jobs.finished );
+			pthread_mutex_unlock( &sys_jobs.lock );
+		}
+	}
+	return NULL;
+#endif
+}
+
+/*
+================
+Sys_InitThreads
+
+start worker threads. Count may be forced with -threads <n>,
+-threads 0 disables the workers at all
+================
+*/
+void Sys_InitThreads( void )
+{
+	char	count[16];
+	int	i, numthreads;
+
+	if( Sys_GetParmFromCmdLine( "-threads", count ))
+		numthreads = Q_atoi( count );
+	else numthreads = Sys_CPUCount() - 1; // leave one core for the main thread
+
+	numthreads = bound( 0, numthreads, MAX_JOB_THREADS );
+	Q_memset( &sys_jobs, 0, sizeof( sys_jobs ));
+
+#ifdef _WIN32
+	sys_mainthread = GetCurrentThreadId();
+#else
+	sys_mainthread = pthread_self();
+#endif
+	sys_mainthread_set = true;
+
+	if( numthreads > 0 )
+	{
+#ifdef _WIN32
+		sys_jobs.wake = CreateSemaphore( NULL, 0, MAX_JOB_THREADS, NULL );
+		sys_jobs.finished = CreateEvent( NULL, FALSE, FALSE, NULL );
+#else
+		pthread_mutex_init( &sys_jobs.lock, NULL );
+		pthread_cond_init( &sys_jobs.wake, NULL );
+		pthread_cond_init( &sys_jobs.finished, NULL );
+#endif
+		for( i = 0; i < numthreads; i++ )
+		{
+#ifdef _WIN32
+			sys_jobs.threads[i] = CreateThread( NULL, 0, Sys_WorkerThread, NULL, 0, NULL );
+			if( !sys_jobs.threads[i] ) break;
+#else
+			if( pthread_create( &sys_jobs.threads[i], NULL, Sys_WorkerThread, NULL ))
+				break;
+#endif
+			sys_jobs.numthreads++;
+		}
+
+		if( sys_jobs.numthreads != numthreads )
+			MsgDev( D_WARN, "Sys_InitThreads: started %i of %i worker threads\n", sys_jobs.numthreads, numthreads );
+		sys_jobs.initialized = true;
+	}
+
+	Cvar_Get( "sys_threads", va( "%i", sys_jobs.numthreads ), CVAR_READ_ONLY, "number of worker threads" );
+	MsgDev( D_NOTE, "Sys_InitThreads: %i worker threads\n", sys_jobs.numthreads );
+}
+
+/*
+================
+Sys_ShutdownThreads
+================
+*/
+void Sys_ShutdownThreads( void )
+{
+	int	i;
+
+	if( !sys_jobs.initialized )
+		return;
+
+#ifdef _WIN32
+	sys_jobs.batch.quit = true;
+	ReleaseSemaphore( sys_jobs.wake, sys_jobs.numthreads, NULL );
+	WaitForMultipleObjects( sys_jobs.numthreads, sys_jobs.threads, TRUE, INFINITE );
+
+	for( i = 0; i < sys_jobs.numthreads; i++ )
+		CloseHandle( sys_jobs.threads[i] );
+	CloseHandle( sys_jobs.wake );
+	CloseHandle( sys_jobs.finished );
+#else
+	pthread_mutex_lock( &sys_jobs.lock );
+	sys_jobs.batch.quit = true;
+	pthread_cond_broadcast( &sys_jobs.wake );
+	pthread_mutex_unlock( &sys_jobs.lock );
+
+	for( i = 0; i < sys_jobs.numthreads; i++ )
+		pthread_join( sys_jobs.threads[i], NULL );
+
+	pthread_cond_destroy( &sys_jobs.wake );
+	pthread_cond_destroy( &sys_jobs.finished );
+	pthread_mutex_destroy( &sys_jobs.lock );
+#endif
+	Q_memset( &sys_jobs, 0, sizeof( sys_jobs ));
+}
+
+/*
+================
+Sys_NumThreads
+
+returns count of threads which will run the jobs,
+including the calling thread
+================
+*/
+int Sys_NumThreads( void )
+{
+	return sys_jobs.numthreads + 1;
+}
+
+/*
+================
+Sys_RunJobs
+
+call func( data, i ) for each i in [0, count) spreading
+the calls across all worker threads. Calling thread takes
+part in the work and returns when every job is completed.
+Jobs must not touch engine state which is not owned by them
+================
+*/
+void Sys_RunJobs( sysjob_t func, void *data, int count )
+{
+	jobbatch_t	*batch = &sys_jobs.batch;
+	int		i;
+
+	if( count <= 0 ) return;
+
+	if( !sys_jobs.initialized || count == 1 )
+	{
+		for( i = 0; i < count; i++ )
+			func( data, i );
+		return;
+	}
+
+	batch->func = func;
+	batch->data = data;
+	batch->count = count;
+	batch->next = 0;
+	batch->checkedin = 0;
+#ifdef _WIN32
+	batch->generation++;
+	ReleaseSemaphore( sys_jobs.wake, sys_jobs.numthreads, NULL );
+
+	Sys_RunBatch( batch );
+
+	WaitForSingleObject( sys_jobs.finished, INFINITE );
+#else
+	pthread_mutex_lock( &sys_jobs.lock );
+	batch->generation++;
+	pthread_cond_broadcast( &sys_jobs.wake );
+	pthread_mutex_unlock( &sys_jobs.lock );
+
+	Sys_RunBatch( batch );
+
+	pthread_mutex_lock( &sys_jobs.lock );
+	while( batch->checkedin < sys_jobs.numthreads )
+		pthread_cond_wait( &sys_jobs.finished, &sys_jobs.lock );
+	pthread_mutex_unlock( &sys_jobs.lock );
+#endif
+}
+
+/*
+================
+Sys_IsMainThread
+
+filesystem and memory pools are only safe
+to use from the main thread
+================
+*/
+qboolean Sys_IsMainThread( void )
+{
+	if( !sys_mainthread_set )
+		return true;
+#ifdef _WIN32
+	return GetCurrentThreadId() == sys_mainthread;
+#else
+	return pthread_equal( pthread_self(), sys_mainthread );
+#endif
+}
+
+static THREAD_RESULT Sys_ThreadStart( void *arg )
+{
+	systhread_t	*thread = arg;
+
+	thread->func( thread->data );
+	return 0;
+}
+
+/*
+================
+Sys_CreateThread
+
+start a long living thread which runs func( data ),
+returns NULL if thread can't be created
+================
+*/
+systhread_t *Sys_CreateThread( systhreadfunc_t func, void *data )
+{
+	systhread_t	*thread = Z_Malloc( sizeof( *thread ));
+
+	thread->func = func;
+	thread->data = data;
+#ifdef _WIN32
+	thread->handle = CreateThread( NULL, 0, Sys_ThreadStart, thread, 0, NULL );
+	if( thread->handle ) return thread;
+#else
+	if( !pthread_create( &thread->handle, NULL, Sys_ThreadStart, thread ))
+		return thread;
+#endif
+	Mem_Free( thread );
+	return NULL;
+}
+
+/*
+================
+Sys_WaitForThread
+
+wait until thread function returns and release the thread
+================
+*/
+void Sys_WaitForThread( systhread_t *thread )
+{
+	if( !thread ) return;
+#ifdef _WIN32
+	WaitForSingleObject( thread->handle, INFINITE );
+	CloseHandle( thread->handle );
+#else
+	pthread_join( thread->handle, NULL );
+#endif
+	Mem_Free( thread );
+}
+
+/*
+================
+Sys_CreateMutex
+
+mutex is recursive, so the owner may lock it again
+================
+*/
+sysmutex_t Sys_CreateMutex( void )
+{
+#ifdef _WIN32
+	CRITICAL_SECTION	*cs = Z_Malloc( sizeof( *cs ));
+
+	InitializeCriticalSection( cs );
+	return cs;
+#else
+	pthread_mutex_t	*mutex = Z_Malloc( sizeof( *mutex ));
+	pthread_mutexattr_t	attr;
+
+	pthread_mutexattr_init( &attr );
+	pthread_mutexattr_settype( &attr, PTHREAD_MUTEX_RECURSIVE );
+	pthread_mutex_init( mutex, &attr );
+	pthread_mutexattr_destroy( &attr );
+	return mutex;
+#endif
+}
+
+void Sys_DestroyMutex( sysmutex_t mutex )
+{
+	if( !mutex ) return;
+#ifdef _WIN32
+	DeleteCriticalSection( mutex );
+#else
+	pthread_mutex_destroy( mutex );
+#endif
+	Mem_Free( mutex );
+}
+
+void Sys_LockMutex( sysmutex_t mutex )
+{
+#ifdef _WIN32
+	EnterCriticalSection( mutex );
+#else
+	pthread_mutex_lock( mutex );
+#endif
+}
+
+void Sys_UnlockMutex( sysmutex_t mutex )
+{
+#ifdef _WIN32
+	LeaveCriticalSection( mutex );
+#else
+	pthread_mutex_unlock( mutex );
+#endif
+}
@@ -117,6 +117,26 @@ void Sys_CloseLog( void );
 void Sys_Quit( void );
 int Sys_LogFileNo( void );
 
+//
+// sys_thread.c
+//
+typedef void (*sysjob_t)( void *data, int index );
+typedef void (*systhreadfunc_t)( void *data );
+typedef struct systhread_s systhread_t;
+typedef void *sysmutex_t;
+
+void Sys_InitThreads( void );
+void Sys_ShutdownThreads( void );
+int Sys_NumThreads( void );
+void Sys_RunJobs( sysjob_t func, void *data, int count );
+qboolean Sys_IsMainThread( void );
+systhread_t *Sys_CreateThread( systhreadfunc_t func, void *data );
+void Sys_WaitForThread( systhread_t *thread );
+sysmutex_t Sys_CreateMutex( void );
+void Sys_DestroyMutex( sysmutex_t mutex );
+void Sys_LockMutex( sysmutex_t mutex );
+void Sys_UnlockMutex( sysmutex_t mutex );
+
 //
 // sys_con.c
 //
@@ -65,6 +65,10 @@ typedef struct server_physics_api_s
 	// static allocations
 	void	*(*pfnMemAlloc)( size_t cb, const char *filename, const int fileline );
 	void	(*pfnMemFree)( void *mem, const char *filename, const int fileline );
+
+	// spatial queries, edicts are sorted by number, the same as pfnFindEntityInSphere returns them
+	int	(*pfnEntitiesInSphere)( const float *org, float radius, edict_t **list, int maxcount );
+	int	(*pfnEntitiesInBox)( const float *mins, const float *maxs, edict_t **list, int maxcount );
 } server_physics_api_t;
 
 // physic callbacks
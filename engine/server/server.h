@@ -54,6 +54,7 @@ extern int SV_UPDATE_BACKUP;
 
 #define MAX_PUSHED_ENTS	256
 #define MAX_CAMERAS		32
+#define MAX_MULTICAST_REFS	256			// shared messages queued per client
 
 #define DVIS_PVS		0
 #define DVIS_PHS		1
@@ -137,6 +138,10 @@ typedef struct server_s
 	char		sound_precache[MAX_SOUNDS][CS_SIZE];
 	char		files_precache[MAX_CUSTOM][CS_SIZE];
 	char		event_precache[MAX_EVENTS][CS_SIZE];
+	precache_t	model_hash;	// name lookup for precache tables
+	precache_t	sound_hash;
+	precache_t	files_hash;
+	precache_t	event_hash;
 
 	sv_static_entity_t	static_entities[MAX_STATIC_ENTITIES];
 	int		num_static_entities;
@@ -190,6 +195,15 @@ typedef struct
 	int  		first_entity;		// into the circular sv_packet_entities[]
 } client_frame_t;
 
+typedef struct mcchunk_s	mcchunk_t;
+
+typedef struct
+{
+	mcchunk_t		*chunk;
+	int		offset;
+	int		numbits;
+} mcref_t;
+
 typedef struct sv_client_s
 {
 	cl_state_t	state;
@@ -248,6 +262,11 @@ typedef struct sv_client_s
 	sizebuf_t		datagram;
 	byte		datagram_buf[NET_MAX_PAYLOAD];
 
+	// shared multicast payloads, written after the datagram
+	mcref_t		multicast[MAX_MULTICAST_REFS];
+	int		nummulticast;
+	int		multicastbits;
+
 	client_frame_t	*frames;			// updates can be delta'd from here
 	event_state_t	events;
 
@@ -318,6 +337,19 @@ typedef struct
 	vec3_t		finalpos;
 } sv_interp_t;
 
+// interned strings, see sv_strings.c
+typedef struct
+{
+	char		*base;			// offset 0 is empty string
+	int		*buckets;			// hash chains
+	int		size;
+	int		used;
+	int		peak;
+	int		numstrings;
+	int		requests;			// since last clear
+	int		overflows;
+} stringpool_t;
+
 typedef struct
 {
 	// user messages stuff
@@ -358,7 +390,8 @@ typedef struct
 	NEW_DLL_FUNCTIONS	dllFuncs2;		// new dll exported funcs (may be NULL)
 	physics_interface_t	physFuncs;		// physics interface functions (Xash3D extension)
 	byte		*mempool;			// server premamnent pool: edicts etc
-	byte		*stringspool;		// for engine strings
+	byte		*stringspool;		// for engine strings which don't fit into pool
+	stringpool_t	strings;			// for engine strings
 
 	SAVERESTOREDATA	SaveData;			// shared struct, used for save data
 } svgame_static_t;
@@ -458,6 +491,12 @@ extern	convar_t		*sv_log_onefile;
 extern	convar_t		*mp_logecho;
 extern	convar_t		*mp_logfile;
 extern	convar_t		*sv_fixmulticast;
+extern	convar_t		*sv_save_compress;
+extern	convar_t		*sv_save_async;
+extern	convar_t		*sv_levelcache;
+extern	convar_t		*sv_skipidle;
+extern	convar_t		*sv_entcache;
+extern	convar_t		*sv_stringpool_size;
 
 //===========================================================
 //
@@ -491,6 +530,7 @@ void SV_ActivateServer( void );
 void SV_DeactivateServer( void );
 void SV_LevelInit( const char *pMapName, char const *pOldLevel, char const *pLandmarkName, qboolean loadGame );
 qboolean SV_SpawnServer( const char *server, const char *startspot );
+void SV_SpawnPhase( const char *name );
 
 //
 // sv_phys.c
@@ -506,6 +546,7 @@ void SV_Impact( edict_t *e1, edict_t *e2, trace_t *trace );
 qboolean SV_CanPushed( edict_t *ent );
 void SV_FreeOldEntities( void );
 void SV_CheckAllEnts( void );
+void SV_ThinkBench_f( void );
 
 //
 // sv_move.c
@@ -588,6 +629,14 @@ void SV_SetModel( edict_t *ent, const char *name );
 void SV_CopyTraceToGlobal( trace_t *trace );
 void SV_SetMinMaxSize( edict_t *e, const float *min, const float *max );
 edict_t* SV_FindEntityByString( edict_t *pStartEdict, const char *pszField, const char *pszValue );
+void SV_InitEntityIndex( void );
+void SV_ShutdownEntityIndex( void );
+void SV_TouchEntityIndex( int entnum );
+void SV_UpdateEntityIndex( void );
+int SV_EntitiesInSphere( const float *org, float radius, edict_t **list, int maxcount );
+int SV_EntitiesInBox( const float *mins, const float *maxs, edict_t **list, int maxcount );
+void SV_SphereBench_f( void );
+void SV_VisBench_f( void );
 void SV_PlaybackEventFull( int flags, const edict_t *pInvoker, word eventindex, float delay, float *origin,
 	float *angles, float fparam1, float fparam2, int iparam1, int iparam2, int bparam1, int bparam2 );
 void SV_PlaybackReliableEvent( sizebuf_t *msg, word eventindex, float delay, event_args_t *args );
@@ -596,6 +645,9 @@ void SV_WriteEntityPatch( const char *filename );
 char *SV_ReadEntityScript( const char *filename, int *flags );
 float SV_AngleMod( float ideal, float current, float speed );
 void SV_SpawnEntities( const char *mapname, char *entities );
+qboolean SV_IsEdictKey( const char *keyname, const char *value );
+qboolean SV_ApplyEdictKeys( edict_t *ent, KeyValueData *pkvd, int numpairs, const char *classname );
+qboolean SV_SpawnParsedEdict( edict_t *ent );
 edict_t* SV_AllocPrivateData( edict_t *ent, string_t className );
 string_t SV_AllocString( const char *szValue );
 string_t SV_MakeString( const char *szValue );
@@ -634,6 +686,36 @@ int SV_LoadGameState( char const *level, qboolean createPlayers );
 void SV_LoadAdjacentEnts( const char *pOldLevel, const char *pLandmarkName );
 const char *SV_GetLatestSave( void );
 void SV_InitSaveRestore( void );
+void SV_UpdateSaves( void );
+void SV_FlushSaves( void );
+void SV_SaveBench_f( void );
+
+//
+// sv_strings.c
+//
+void SV_InitStringPool( stringpool_t *pool, byte *mempool, int size );
+void SV_FreeStringPool( stringpool_t *pool );
+void SV_ClearStringPool( stringpool_t *pool );
+int SV_PoolString( stringpool_t *pool, const char *s );
+void SV_StringsInfo_f( void );
+void SV_StringBench_f( void );
+
+//
+// sv_entcache.c
+//
+qboolean SV_LoadFromTemplate( const char *mapname, char *entities, int *inhibited );
+void SV_EntCacheInfo_f( void );
+
+//
+// sv_multicast.c
+//
+qboolean SV_StoreMulticast( sizebuf_t *msg, mcref_t *ref );
+void SV_AddMulticast( sv_client_t *cl, const mcref_t *ref );
+void SV_FlushMulticast( sv_client_t *cl, sizebuf_t *msg );
+void SV_WriteDatagram( sv_client_t *cl, sizebuf_t *msg );
+void SV_ClearDatagram( sv_client_t *cl );
+void SV_FreeMulticast( void );
+void SV_MulticastInfo_f( void );
 
 //
 // sv_pmove.c
@@ -646,6 +728,11 @@ void SV_GetTrueMinMax( sv_client_t *cl, int edictnum, vec3_t mins, vec3_t maxs )
 //
 void SV_ClearWorld( void );
 void SV_UnlinkEdict( edict_t *ent );
+void SV_LinkSpatial( edict_t *ent );
+void SV_UnlinkSpatial( edict_t *ent );
+void SV_UpdateSpatialIndex( void );
+int SV_AreaEdicts( const vec3_t mins, const vec3_t maxs, int **list );
+int SV_SphereEdicts( const vec3_t org, float radius, int **list );
 qboolean SV_HeadnodeVisible( mnode_t *node, byte *visbits, int *lastleaf );
 void SV_ClipMoveToEntity( edict_t *ent, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, trace_t *trace );
 void SV_CustomClipMoveToEntity( edict_t *ent, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, trace_t *trace );
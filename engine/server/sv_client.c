@@ -214,6 +214,9 @@ gotnewcl:
 	if( sv_maxclients->integer == 1 ) // save physinfo for singleplayer
 		Q_strncpy( physinfostr, newcl->physinfo, sizeof( physinfostr ));
 
+	// reconnecting client may still hold multicast references
+	if( newcl != &temp ) SV_ClearDatagram( newcl );
+
 	*newcl = temp;
 
 	if( sv_maxclients->integer == 1 ) // restore physinfo for singleplayer
@@ -491,6 +494,7 @@ void SV_DropClient( sv_client_t *drop )
 
 	// throw away any residual garbage in the channel.
 	Netchan_Clear( &drop->netchan );
+	SV_ClearDatagram( drop );
 
 	// Clean client data on disconnect
 	Q_memset( drop->userinfo, 0, MAX_INFO_STRING );
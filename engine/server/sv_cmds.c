@@ -1033,12 +1033,20 @@ void SV_InitOperatorCommands( void )
 	Cmd_AddCommand( "entpatch", SV_EntPatch_f, "write entity patch to allow external editing" );
 	Cmd_AddCommand( "edicts_info", SV_EdictsInfo_f, "show info about edicts" );
 	Cmd_AddCommand( "entity_info", SV_EntityInfo_f, "show more info about edicts" );
+	Cmd_AddCommand( "strings_info", SV_StringsInfo_f, "show usage of engine string pool" );
+	Cmd_AddCommand( "stringbench", SV_StringBench_f, "simulate hours of map cycles and check string pool growth" );
+	Cmd_AddCommand( "spherebench", SV_SphereBench_f, "time radius searches against the linear walk" );
+	Cmd_AddCommand( "visbench", SV_VisBench_f, "time fat pvs building for moving clients with and without caches" );
+	Cmd_AddCommand( "multicast_info", SV_MulticastInfo_f, "show usage of shared multicast buffers" );
+	Cmd_AddCommand( "entcache_info", SV_EntCacheInfo_f, "show cached entity lumps" );
+	Cmd_AddCommand( "thinkbench", SV_ThinkBench_f, "time entity physics of next frames with and without skipping idle entities" );
 	Cmd_AddCommand( "save", SV_Save_f, "save the game to a file" );
 	Cmd_AddCommand( "load", SV_Load_f, "load a saved game file" );
 	Cmd_AddCommand( "savequick", SV_QuickSave_f, "save the game to the quicksave" );
 	Cmd_AddCommand( "loadquick", SV_QuickLoad_f, "load a quick-saved game file" );
 	Cmd_AddCommand( "killsave", SV_DeleteSave_f, "delete a saved game file and saveshot" );
 	Cmd_AddCommand( "autosave", SV_AutoSave_f, "save the game to 'autosave' file" );
+	Cmd_AddCommand( "savebench", SV_SaveBench_f, "measure save and load times of current game" );
 	if( Host_IsDedicated() )
 	{
 		Cmd_AddCommand( "say", SV_ConSay_f, "send a chat message to everyone on the server" );
@@ -1077,6 +1085,13 @@ void SV_KillOperatorCommands( void )
 	Cmd_RemoveCommand( "entpatch" );
 	Cmd_RemoveCommand( "edicts_info" );
 	Cmd_RemoveCommand( "entity_info" );
+	Cmd_RemoveCommand( "strings_info" );
+	Cmd_RemoveCommand( "stringbench" );
+	Cmd_RemoveCommand( "spherebench" );
+	Cmd_RemoveCommand( "visbench" );
+	Cmd_RemoveCommand( "multicast_info" );
+	Cmd_RemoveCommand( "thinkbench" );
+	Cmd_RemoveCommand( "entcache_info" );
 
 	if( Host_IsDedicated() )
 	{
@@ -1092,5 +1107,6 @@ void SV_KillOperatorCommands( void )
 		Cmd_RemoveCommand( "loadquick" );
 		Cmd_RemoveCommand( "killsave" );
 		Cmd_RemoveCommand( "autosave" );
+		Cmd_RemoveCommand( "savebench" );
 	}
 }
@@ -0,0 +1,353 @@
+/*
+sv_entcache.c - pre-tokenized entity lumps
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "server.h"
+
+/*
+=============================================================================
+
+Entity lump is tokenized once per map and kept as a template: interned
+keynames go first, then a block for each entity { numpairs, classname,
+size } with pairs { key offset, value length, value }. Template is found
+by map name, CRC and length of the text, so an edited .ent patch builds
+a new one. Lumps which have syntax errors are never cached, they go to
+the text parser which reports the error.
+
+=============================================================================
+*/
+
+#define MAX_ENT_TEMPLATES	4
+#define ENTKEY_HASH_SIZE	256	// must be power of two
+#define MAX_ENT_PAIRS	256	// same limit as SV_ParseEdict
+
+typedef struct
+{
+	int		numpairs;
+	int		classname;	// pair index or -1
+	int		size;		// with pairs and values
+} entblock_t;
+
+typedef struct
+{
+	int		key;		// offset of interned keyname
+	int		length;		// value length with terminator, value is padded to 4 bytes
+} entpair_t;
+
+typedef struct
+{
+	char		name[64];
+	dword		checksum;
+	int		textlen;
+	int		version;		// underscore keys are dropped on quake maps
+	int		lastUsed;
+
+	byte		*data;
+	int		size;
+	int		keysize;		// blocks follow the keys
+	int		maxblock;
+	int		numentities;
+} enttemplate_t;
+
+typedef struct
+{
+	byte		*data;
+	int		size;
+	int		maxsize;
+} entbuffer_t;
+
+static enttemplate_t	sv_templates[MAX_ENT_TEMPLATES];
+static int		sv_templatesequence;
+static int		sv_templatehits;
+static int		sv_templatemisses;
+
+/*
+=============
+SV_TemplateAlloc
+
+returns offset of the new space, buffer may move
+=============
+*/
+static int SV_TemplateAlloc( entbuffer_t *buf, int size )
+{
+	int	offset = buf->size;
+
+	size = ( size + 3 ) & ~3;
+
+	if( buf->size + size > buf->maxsize )
+	{
+		buf->maxsize = max( buf->maxsize * 2, buf->size + size + 4096 );
+		buf->data = Mem_Realloc( host.mempool, buf->data, buf->maxsize );
+	}
+
+	buf->size += size;
+
+	return offset;
+}
+
+/*
+=============
+SV_InternKey
+
+interned keys are { int next; char name[] }
+=============
+*/
+static int SV_InternKey( entbuffer_t *keys, int *hash, const char *keyname )
+{
+	int	bucket = Com_HashKey( keyname, ENTKEY_HASH_SIZE );
+	int	offset, length;
+
+	// Com_HashKey ignores case, keys are compared as is
+	for( offset = hash[bucket]; offset >= 0; offset = *(int *)( keys->data + offset ))
+	{
+		if( !Q_strcmp( (char *)keys->data + offset + sizeof( int ), keyname ))
+			return offset + sizeof( int );
+	}
+
+	length = Q_strlen( keyname ) + 1;
+	offset = SV_TemplateAlloc( keys, sizeof( int ) + length );
+	*(int *)( keys->data + offset ) = hash[bucket];
+	Q_memcpy( keys->data + offset + sizeof( int ), keyname, length );
+	hash[bucket] = offset;
+
+	return offset + sizeof( int );
+}
+
+/*
+=============
+SV_BuildTemplate
+
+tokenize the lump in the same way as SV_LoadFromFile does
+=============
+*/
+static qboolean SV_BuildTemplate( enttemplate_t *t, char *entities )
+{
+	entbuffer_t	keys, blocks;
+	int		hash[ENTKEY_HASH_SIZE];
+	char		token[2048];
+	string		keyname;
+	entblock_t	*block;
+	entpair_t		*pair;
+	int		blockofs, pairofs;
+	int		numpairs, classname;
+
+	Q_memset( &keys, 0, sizeof( keys ));
+	Q_memset( &blocks, 0, sizeof( blocks ));
+	memset( hash, 0xFF, sizeof( hash ));
+
+	while(( entities = COM_ParseFile( entities, token )) != NULL )
+	{
+		if( token[0] != '{' )
+			goto failed;
+
+		blockofs = SV_TemplateAlloc( &blocks, sizeof( entblock_t ));
+		numpairs = 0;
+		classname = -1;
+
+		while( 1 )
+		{
+			if(( entities = COM_ParseFile( entities, token )) == NULL )
+				goto failed;
+			if( token[0] == '}' ) break;
+
+			Q_strncpy( keyname, token, sizeof( keyname ));
+
+			if(( entities = COM_ParseFile( entities, token )) == NULL || token[0] == '}' )
+				goto failed;
+
+			if( !SV_IsEdictKey( keyname, token ))
+				continue;
+
+			// text parser leaves the rest of entity unparsed
+			if( numpairs + 1 >= MAX_ENT_PAIRS )
+				goto failed;
+
+			pairofs = SV_TemplateAlloc( &blocks, sizeof( entpair_t ) + Q_strlen( token ) + 1 );
+			pair = (entpair_t *)( blocks.data + pairofs );
+			pair->key = SV_InternKey( &keys, hash, keyname );
+			pair->length = Q_strlen( token ) + 1;
+			Q_memcpy( pair + 1, token, pair->length );
+
+			if( !Q_strcmp( keyname, "classname" ) && classname == -1 )
+				classname = numpairs;
+			numpairs++;
+		}
+
+		block = (entblock_t *)( blocks.data + blockofs );
+		block->numpairs = numpairs;
+		block->classname = classname;
+		block->size = blocks.size - blockofs;
+		t->maxblock = max( t->maxblock, block->size );
+		t->numentities++;
+	}
+
+	// keys and blocks go into one allocation
+	t->keysize = keys.size;
+	t->size = keys.size + blocks.size;
+	t->data = Mem_Alloc( host.mempool, max( t->size, 1 ));
+	if( keys.size ) Q_memcpy( t->data, keys.data, keys.size );
+	if( blocks.size ) Q_memcpy( t->data + keys.size, blocks.data, blocks.size );
+
+	if( keys.data ) Mem_Free( keys.data );
+	if( blocks.data ) Mem_Free( blocks.data );
+
+	return true;
+failed:
+	if( keys.data ) Mem_Free( keys.data );
+	if( blocks.data ) Mem_Free( blocks.data );
+
+	return false;
+}
+
+static void SV_FreeTemplate( enttemplate_t *t )
+{
+	if( t->data ) Mem_Free( t->data );
+	Q_memset( t, 0, sizeof( *t ));
+}
+
+/*
+=============
+SV_EntityTemplate
+
+find template for this lump or build a new one
+=============
+*/
+static enttemplate_t *SV_EntityTemplate( const char *mapname, char *entities )
+{
+	enttemplate_t	*t, *slot = NULL;
+	dword		checksum;
+	int		i, textlen;
+
+	textlen = Q_strlen( entities );
+	CRC32_Init( &checksum );
+	CRC32_ProcessBuffer( &checksum, entities, textlen );
+	CRC32_Final( &checksum );
+
+	for( i = 0, t = sv_templates; i < MAX_ENT_TEMPLATES; i++, t++ )
+	{
+		if( t->data && t->checksum == checksum && t->textlen == textlen && t->version == world.version && !Q_stricmp( t->name, mapname ))
+		{
+			t->lastUsed = ++sv_templatesequence;
+			sv_templatehits++;
+			return t;
+		}
+
+		if( !slot || !t->data || ( slot->data && t->lastUsed < slot->lastUsed ))
+			slot = t;
+	}
+
+	sv_templatemisses++;
+	SV_FreeTemplate( slot );
+
+	if( !SV_BuildTemplate( slot, entities ))
+	{
+		SV_FreeTemplate( slot );
+		return NULL;
+	}
+
+	Q_strncpy( slot->name, mapname, sizeof( slot->name ));
+	slot->checksum = checksum;
+	slot->textlen = textlen;
+	slot->version = world.version;
+	slot->lastUsed = ++sv_templatesequence;
+
+	return slot;
+}
+
+/*
+=============
+SV_LoadFromTemplate
+
+spawn entities from pre-tokenized lump,
+returns false if lump must be parsed as text
+=============
+*/
+qboolean SV_LoadFromTemplate( const char *mapname, char *entities, int *inhibited )
+{
+	KeyValueData	pkvd[MAX_ENT_PAIRS];
+	enttemplate_t	*t;
+	entblock_t	*block;
+	entpair_t		*pair;
+	const char	*classname;
+	byte		*scratch, *p;
+	edict_t		*ent;
+	int		i, j;
+
+	if( !sv_entcache->integer )
+		return false;
+
+	if(( t = SV_EntityTemplate( mapname, entities )) == NULL )
+		return false;
+
+	SV_SpawnPhase( "entity lump" );
+
+	// game dll gets a copy of values, template stays untouched
+	scratch = Mem_Alloc( host.mempool, max( t->maxblock, 1 ));
+	p = t->data + t->keysize;
+
+	for( i = 0; i < t->numentities; i++, p += block->size )
+	{
+		block = (entblock_t *)p;
+		Q_memcpy( scratch, p, block->size );
+		pair = (entpair_t *)( scratch + sizeof( entblock_t ));
+		classname = NULL;
+
+		for( j = 0; j < block->numpairs; j++ )
+		{
+			pkvd[j].szKeyName = (char *)t->data + pair->key;
+			pkvd[j].szValue = (char *)( pair + 1 );
+			pkvd[j].szClassName = NULL;
+			pkvd[j].fHandled = false;
+
+			if( j == block->classname )
+				classname = pkvd[j].szValue;
+
+			pair = (entpair_t *)((byte *)( pair + 1 ) + (( pair->length + 3 ) & ~3 ));
+		}
+
+		ent = i ? SV_AllocEdict() : EDICT_NUM( 0 ); // world is already initialized
+
+		if( !SV_ApplyEdictKeys( ent, pkvd, block->numpairs, classname ))
+			continue;
+
+		if( SV_SpawnParsedEdict( ent ))
+			(*inhibited)++;
+	}
+
+	Mem_Free( scratch );
+
+	return true;
+}
+
+/*
+=============
+SV_EntCacheInfo_f
+=============
+*/
+void SV_EntCacheInfo_f( void )
+{
+	enttemplate_t	*t;
+	size_t		total = 0;
+	int		i;
+
+	for( i = 0, t = sv_templates; i < MAX_ENT_TEMPLATES; i++, t++ )
+	{
+		if( !t->data ) continue;
+		Msg( "%-20s %5i entities, %s\n", t->name, t->numentities, Q_memprint( t->size ));
+		total += t->size;
+	}
+
+	Msg( "%s used, %i hits, %i misses\n", Q_memprint( total ), sv_templatehits, sv_templatemisses );
+}
@@ -636,8 +636,12 @@ void SV_SendClientDatagram( sv_client_t *cl )
 	// copy the accumulated multicast datagram
 	// for this client out to the message
 	if( BF_CheckOverflow( &cl->datagram )) MsgDev( D_WARN, "datagram overflowed for %s\n", cl->name );
-	else BF_WriteBits( &msg, BF_GetData( &cl->datagram ), BF_GetNumBitsWritten( &cl->datagram ));
-	BF_Clear( &cl->datagram );
+	else
+	{
+		BF_WriteBits( &msg, BF_GetData( &cl->datagram ), BF_GetNumBitsWritten( &cl->datagram ));
+		SV_FlushMulticast( cl, &msg );
+	}
+	SV_ClearDatagram( cl );
 
 	if( BF_CheckOverflow( &msg ))
 	{	
@@ -659,6 +663,8 @@ void SV_UpdateToReliableMessages( void )
 {
 	int		i;
 	sv_client_t	*cl;
+	mcref_t		datagram, spectator;
+	qboolean		hasdatagram, hasspectator;
 
 	// check for changes to be sent over the reliable streams to all clients
 	for( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ )
@@ -705,6 +711,10 @@ void SV_UpdateToReliableMessages( void )
 		BF_Clear( &sv.spectator_datagram );
 	}
 
+	// server datagrams are stored once and shared by all clients
+	hasdatagram = BF_GetNumBitsWritten( &sv.datagram ) && SV_StoreMulticast( &sv.datagram, &datagram );
+	hasspectator = BF_GetNumBitsWritten( &sv.spectator_datagram ) && SV_StoreMulticast( &sv.spectator_datagram, &spectator );
+
 	// now send the reliable and server datagrams to all clients.
 	for( i = 0, cl = svs.clients; i < sv_maxclients->integer; i++, cl++ )
 	{
@@ -712,11 +722,14 @@ void SV_UpdateToReliableMessages( void )
 			continue;	// reliables go to all connected or spawned
 
 		BF_WriteBits( &cl->netchan.message, BF_GetData( &sv.reliable_datagram ), BF_GetNumBitsWritten( &sv.reliable_datagram ));
-		BF_WriteBits( &cl->datagram, BF_GetData( &sv.datagram ), BF_GetNumBitsWritten( &sv.datagram ));
+
+		if( hasdatagram ) SV_AddMulticast( cl, &datagram );
+		else if( BF_GetNumBitsWritten( &sv.datagram )) SV_WriteDatagram( cl, &sv.datagram );
 
 		if( cl->hltv_proxy )
 		{
-			BF_WriteBits( &cl->datagram, BF_GetData( &sv.spectator_datagram ), BF_GetNumBitsWritten( &sv.spectator_datagram ));
+			if( hasspectator ) SV_AddMulticast( cl, &spectator );
+			else if( BF_GetNumBitsWritten( &sv.spectator_datagram )) SV_WriteDatagram( cl, &sv.spectator_datagram );
 		}
 	}
 
@@ -779,7 +792,7 @@ void SV_SendClientMessages( void )
 		if( BF_CheckOverflow( &cl->netchan.message ))
 		{
 			BF_Clear( &cl->netchan.message );
-			BF_Clear( &cl->datagram );
+			SV_ClearDatagram( cl );
 			SV_BroadcastPrintf( PRINT_HIGH, "%s overflowed\n", cl->name );
 			MsgDev( D_WARN, "reliable overflow for %s\n", cl->name );
 			SV_DropClient( cl );
@@ -33,6 +33,24 @@ static vec3_t viewPoint[MAX_CLIENTS];
 static byte *bitvector;
 static int fatbytes;
 
+#define MAX_FAT_LEAFS	32
+
+// fat set only depends on leafs within 8 units
+// of view point, so it's rebuilt when they change
+typedef struct
+{
+	int		sequence;		// world.load_sequence, 0 is empty
+	int		numleafs;
+	short		leafs[MAX_FAT_LEAFS];
+	byte		bits[MAX_MAP_LEAFS/8];
+} fatcache_t;
+
+static fatcache_t	fatcache[MAX_CLIENTS][2];	// pvs and phs
+static byte	*fatresult[2];		// last returned sets, portal passes merge into them
+static int	fathits, fatmisses;
+static int	viewLeafnum[MAX_CLIENTS];	// leaf of viewPoint
+static int	viewLeafSequence[MAX_CLIENTS];
+
 // exports
 typedef void (__cdecl *LINK_ENTITY_FUNC)( entvars_t *pev );
 typedef void (__stdcall *GIVEFNPTRSTODLL)( enginefuncs_t* engfuncs, globalvars_t *pGlobals );
@@ -72,7 +90,7 @@ entavrs table for FindEntityByString
 */
 TYPEDESCRIPTION *SV_GetEntvarsDescirption( int number )
 {
-	if( number < 0 && number >= ENTVARS_COUNT )
+	if( number < 0 || number >= ENTVARS_COUNT )
 		return NULL;
 	return &gEntvarsDescription[number];
 }
@@ -235,7 +253,9 @@ qboolean SV_CheckClientVisiblity( sv_client_t *cl, const byte *mask )
 		viewOrg = cl->pViewEntity->v.origin;
 
 	// -1 is because pvs rows are 1 based, not 0 based like leafs
-	leafnum = Mod_PointLeafnum( viewOrg ) - 1;
+	if( viewOrg == viewPoint[clientnum] && viewLeafSequence[clientnum] == world.load_sequence )
+		leafnum = viewLeafnum[clientnum] - 1;
+	else leafnum = Mod_PointLeafnum( viewOrg ) - 1;
 	if( leafnum == -1 || (mask[leafnum>>3] & (1U << ( leafnum & 7 ))))
 		return true; // visible from player view or camera view
 
@@ -277,8 +297,10 @@ qboolean SV_Send( int dest, const vec3_t origin, const edict_t *ent )
 	sv_client_t	*cl, *current = svs.clients;
 	qboolean		reliable = false;
 	qboolean		specproxy = false;
+	sv_client_t	*recipients[MAX_CLIENTS];
 	int		numsends = 0;
 	mleaf_t		*leaf;
+	mcref_t		ref;
 
 	switch( dest )
 	{
@@ -362,10 +384,31 @@ qboolean SV_Send( int dest, const vec3_t origin, const edict_t *ent )
 		if( !SV_CheckClientVisiblity( cl, mask ))
 			continue;
 
-		if( specproxy ) BF_WriteBits( &sv.spectator_datagram, BF_GetData( &sv.multicast ), BF_GetNumBitsWritten( &sv.multicast ));
-		else if( reliable ) BF_WriteBits( &cl->netchan.message, BF_GetData( &sv.multicast ), BF_GetNumBitsWritten( &sv.multicast ));
-		else BF_WriteBits( &cl->datagram, BF_GetData( &sv.multicast ), BF_GetNumBitsWritten( &sv.multicast ));
-		numsends++;
+		recipients[numsends++] = cl;
+	}
+
+	if( specproxy || reliable )
+	{
+		// reliable stream has it's own order, copy as before
+		for( j = 0; j < numsends; j++ )
+		{
+			if( specproxy ) BF_WriteBits( &sv.spectator_datagram, BF_GetData( &sv.multicast ), BF_GetNumBitsWritten( &sv.multicast ));
+			else BF_WriteBits( &recipients[j]->netchan.message, BF_GetData( &sv.multicast ), BF_GetNumBitsWritten( &sv.multicast ));
+		}
+	}
+	else if( numsends )
+	{
+		// encode once, clients will hold a reference
+		if( SV_StoreMulticast( &sv.multicast, &ref ))
+		{
+			for( j = 0; j < numsends; j++ )
+				SV_AddMulticast( recipients[j], &ref );
+		}
+		else
+		{
+			for( j = 0; j < numsends; j++ )
+				SV_WriteDatagram( recipients[j], &sv.multicast );
+		}
 	}
 
 	BF_Clear( &sv.multicast );
@@ -545,6 +588,36 @@ crosses a waterline.
 
 =============================================================================
 */
+static void SV_FatLeafs_r( const vec3_t org, mnode_t *node, short *leafs, int *numleafs )
+{
+	float	d;
+
+	while( 1 )
+	{
+		// if this is a leaf, accumulate the pvs bits
+		if( node->contents < 0 )
+		{
+			if( node->contents != CONTENTS_SOLID )
+			{
+				if( *numleafs < MAX_FAT_LEAFS )
+					leafs[*numleafs] = (mleaf_t *)node - sv.worldmodel->leafs;
+				(*numleafs)++;
+			}
+			return;
+		}
+	
+		d = PlaneDiff( org, node->plane );
+		if( d > 8.0f ) node = node->children[0];
+		else if( d < -8.0f ) node = node->children[1];
+		else
+		{
+			// go down both
+			SV_FatLeafs_r( org, node->children[0], leafs, numleafs );
+			node = node->children[1];
+		}
+	}
+}
+
 static void SV_AddToFatPVS( const vec3_t org, int type, mnode_t *node )
 {
 	byte	*vis;
@@ -558,7 +631,6 @@ static void SV_AddToFatPVS( const vec3_t org, int type, mnode_t *node )
 			if( node->contents != CONTENTS_SOLID )
 			{
 				mleaf_t	*leaf;
-				int	i;
 
 				leaf = (mleaf_t *)node;			
 
@@ -568,8 +640,7 @@ static void SV_AddToFatPVS( const vec3_t org, int type, mnode_t *node )
 					vis = Mod_LeafPHS( leaf, sv.worldmodel );
 				else vis = Mod_DecompressVis( NULL ); // get full visibility
 
-				for( i = 0; i < fatbytes; i++ )
-					bitvector[i] |= vis[i];
+				Mod_MergeVis( bitvector, vis, fatbytes );
 			}
 			return;
 		}
@@ -588,19 +659,56 @@ static void SV_AddToFatPVS( const vec3_t org, int type, mnode_t *node )
 
 /*
 ==============
-SV_BoxInPVS
+SV_FatVis
 
-check brush boxes in fat pvs
+build fat set for view point into the client cache,
+or return the cached one if view leafs are the same
 ==============
 */
-static qboolean SV_BoxInPVS( const vec3_t org, const vec3_t absmin, const vec3_t absmax )
+static byte *SV_FatVis( fatcache_t *cache, const vec3_t org, int type )
 {
-	mleaf_t	*leaf = Mod_PointInLeaf( org, sv.worldmodel->nodes );
-	byte	*vis = Mod_LeafPVS( leaf, sv.worldmodel );
+	short	leafs[MAX_FAT_LEAFS];
+	int	i, numleafs = 0;
 
-	if( !Mod_BoxVisible( absmin, absmax, vis ))
-		return false;
-	return true;
+	SV_FatLeafs_r( org, sv.worldmodel->nodes, leafs, &numleafs );
+
+	if( numleafs > MAX_FAT_LEAFS )
+	{
+		// too much leafs to remember
+		cache->sequence = 0;
+		fatmisses++;
+		bitvector = ( type == DVIS_PHS ) ? fatphs : fatpvs;
+		Q_memset( bitvector, 0, fatbytes );
+		SV_AddToFatPVS( org, type, sv.worldmodel->nodes );
+		return bitvector;
+	}
+
+	if( cache->sequence == world.load_sequence && cache->numleafs == numleafs && !memcmp( cache->leafs, leafs, numleafs * sizeof( short )))
+	{
+		fathits++;
+		return cache->bits;
+	}
+
+	fatmisses++;
+	Q_memset( cache->bits, 0, fatbytes );
+
+	for( i = 0; i < numleafs; i++ )
+	{
+		mleaf_t	*leaf = sv.worldmodel->leafs + leafs[i];
+		byte	*vis;
+
+		if( type == DVIS_PHS )
+			vis = Mod_LeafPHS( leaf, sv.worldmodel );
+		else vis = Mod_LeafPVS( leaf, sv.worldmodel );
+
+		Mod_MergeVis( cache->bits, vis, fatbytes );
+	}
+
+	Q_memcpy( cache->leafs, leafs, numleafs * sizeof( short ));
+	cache->numleafs = numleafs;
+	cache->sequence = world.load_sequence;
+
+	return cache->bits;
 }
 
 /*
@@ -841,6 +949,9 @@ void SV_InitEdict( edict_t *pEdict )
 
 	pEdict->v.pContainingEntity = pEdict; // make cross-links for consistency
 	pEdict->free = false;
+
+	SV_TouchEntityIndex( NUM_FOR_EDICT( pEdict ));
+	SV_LinkSpatial( pEdict );
 }
 
 void SV_FreeEdict( edict_t *pEdict )
@@ -886,6 +997,8 @@ void SV_FreeEdict( edict_t *pEdict )
 	VectorClear(pEdict->v.angles);
 	VectorClear(pEdict->v.origin);
 	pEdict->free = true;
+
+	SV_UnlinkSpatial( pEdict );
 }
 
 edict_t *SV_AllocEdict( void )
@@ -1150,11 +1263,8 @@ int pfnModelIndex( const char *m )
 	if( !m || !m[0] )
 		return 0;
 
-	for( i = 1; i < MAX_MODELS && sv.model_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.model_precache[i], m ))
-			return i;
-	}
+	if(( i = Precache_Find( &sv.model_hash, sv.model_precache, m )) != 0 )
+		return i;
 
 	MsgDev( D_ERROR, "SV_ModelIndex: %s not precached\n", m );
 	return 0; 
@@ -1316,6 +1426,270 @@ void pfnChangePitch( edict_t* ent )
 	ent->v.angles[PITCH] = SV_AngleMod( ent->v.idealpitch, ent->v.angles[PITCH], ent->v.pitch_speed );	
 }
 
+/*
+=============================================================================
+
+FindEntityByString index
+
+Game dlls search by classname, targetname, target and netname in loops,
+so these fields are indexed by string hash. Index is updated once per
+frame for the fields which were changed. Edicts allocated since update
+are checked directly and every candidate is compared with its current
+value, so a search never returns an edict which doesn't match. The one
+case where result differs from the linear scan: if a field of an edict
+that existed at the last update was changed during this frame, the edict
+isn't found by its new value until the next update. Game dlls set these
+fields on spawn, which goes through the allocated edicts check.
+
+=============================================================================
+*/
+#define FINDINDEX_FIELDS	4
+#define FINDINDEX_HASH_SIZE	65536
+#define MAX_FINDINDEX_DIRTY	256		// more allocations until next update disable the index
+
+typedef struct
+{
+	uint		hash;
+	int		entnum;
+} findentry_t;
+
+typedef struct
+{
+	const char	*fieldName;
+	int		fieldOffset;
+	string_t		*values;			// what the index was built from
+	findentry_t	*entries;			// sorted by hash, then by edict number
+	int		numentries;
+} findindex_t;
+
+static struct
+{
+	findindex_t	fields[FINDINDEX_FIELDS];
+	int		numvalues;		// edicts covered by the last update
+	int		dirty[MAX_FINDINDEX_DIRTY];	// edicts allocated since update
+	int		numdirty;
+	qboolean		initialized;
+} sv_findindex;
+
+static int SV_FindIndexCompare( const void *a, const void *b )
+{
+	const findentry_t	*ea = a, *eb = b;
+
+	if( ea->hash != eb->hash )
+		return ( ea->hash < eb->hash ) ? -1 : 1;
+	return ea->entnum - eb->entnum;
+}
+
+_inline string_t SV_FindIndexValue( edict_t *ed, int fieldOffset )
+{
+	return *(string_t *)&((byte *)&ed->v)[fieldOffset];
+}
+
+/*
+=============
+SV_InitEntityIndex
+
+called when edicts are allocated
+=============
+*/
+void SV_InitEntityIndex( void )
+{
+	static const char	*fieldNames[FINDINDEX_FIELDS] = { "classname", "targetname", "target", "netname" };
+	static const int	fieldOffsets[FINDINDEX_FIELDS] =
+	{
+		(int)(size_t)&((entvars_t *)0)->classname,
+		(int)(size_t)&((entvars_t *)0)->targetname,
+		(int)(size_t)&((entvars_t *)0)->target,
+		(int)(size_t)&((entvars_t *)0)->netname,
+	};
+	int	i;
+
+	Q_memset( &sv_findindex, 0, sizeof( sv_findindex ));
+
+	for( i = 0; i < FINDINDEX_FIELDS; i++ )
+	{
+		findindex_t	*index = &sv_findindex.fields[i];
+
+		index->fieldName = fieldNames[i];
+		index->fieldOffset = fieldOffsets[i];
+		index->values = Mem_Alloc( svgame.mempool, sizeof( string_t ) * svgame.globals->maxEntities );
+		index->entries = Mem_Alloc( svgame.mempool, sizeof( findentry_t ) * svgame.globals->maxEntities );
+	}
+
+	// nothing is indexed until first update
+	sv_findindex.numdirty = MAX_FINDINDEX_DIRTY + 1;
+	sv_findindex.initialized = true;
+}
+
+/*
+=============
+SV_ShutdownEntityIndex
+=============
+*/
+void SV_ShutdownEntityIndex( void )
+{
+	// arrays are freed with svgame.mempool
+	Q_memset( &sv_findindex, 0, sizeof( sv_findindex ));
+}
+
+/*
+=============
+SV_TouchEntityIndex
+
+edict was allocated, its fields will be
+set before the next index update
+=============
+*/
+void SV_TouchEntityIndex( int entnum )
+{
+	if( sv_findindex.numdirty < MAX_FINDINDEX_DIRTY )
+		sv_findindex.dirty[sv_findindex.numdirty] = entnum;
+	if( sv_findindex.numdirty <= MAX_FINDINDEX_DIRTY )
+		sv_findindex.numdirty++;
+}
+
+/*
+=============
+SV_UpdateEntityIndex
+
+per-frame check of indexed fields, index of a
+field is built again only if one of them changed
+=============
+*/
+void SV_UpdateEntityIndex( void )
+{
+	int	i, e, numvalues;
+
+	if( !sv_findindex.initialized )
+		return;
+
+	numvalues = max( svgame.numEntities, sv_findindex.numvalues );
+
+	for( i = 0; i < FINDINDEX_FIELDS; i++ )
+	{
+		findindex_t	*index = &sv_findindex.fields[i];
+		qboolean		changed = false;
+
+		for( e = 0; e < numvalues; e++ )
+		{
+			edict_t	*ed = EDICT_NUM( e );
+			string_t	value = 0;
+
+			if( e < svgame.numEntities && !ed->free )
+				value = SV_FindIndexValue( ed, index->fieldOffset );
+
+			if( index->values[e] != value )
+			{
+				index->values[e] = value;
+				changed = true;
+			}
+		}
+
+		if( !changed ) continue;
+
+		for( e = index->numentries = 0; e < svgame.numEntities; e++ )
+		{
+			const char	*t;
+
+			if( !index->values[e] ) continue;
+
+			t = STRING( index->values[e] );
+			if( !t || !*t ) continue;
+
+			index->entries[index->numentries].hash = Com_HashKey( t, FINDINDEX_HASH_SIZE );
+			index->entries[index->numentries].entnum = e;
+			index->numentries++;
+		}
+
+		qsort( index->entries, index->numentries, sizeof( findentry_t ), SV_FindIndexCompare );
+	}
+
+	sv_findindex.numvalues = svgame.numEntities;
+	sv_findindex.numdirty = 0;
+}
+
+/*
+=============
+SV_FindEntityMatch
+
+same conditions as linear search has
+=============
+*/
+static qboolean SV_FindEntityMatch( int e, int fieldOffset, const char *pszValue )
+{
+	edict_t		*ed;
+	const char	*t;
+
+	if( e >= svgame.numEntities )
+		return false;
+
+	ed = EDICT_NUM( e );
+	if( !SV_IsValidEdict( ed )) return false;
+
+	if( e <= sv_maxclients->integer && !SV_ClientFromEdict( ed, ( sv_maxclients->integer != 1 )))
+		return false;
+
+	t = STRING( SV_FindIndexValue( ed, fieldOffset ));
+	if( t == NULL || t == svgame.globals->pStringBase )
+		return false;
+
+	return !Q_strcmp( t, pszValue );
+}
+
+/*
+=============
+SV_FindIndexedEntity
+
+returns number of the next matched edict after e,
+0 if there is no one, -1 if index can't be used
+=============
+*/
+static int SV_FindIndexedEntity( findindex_t *index, int e, const char *pszValue )
+{
+	int	left = 0, right = index->numentries;
+	int	i, found = 0;
+	uint	hash;
+
+	if( !sv_findindex.initialized || sv_findindex.numdirty > MAX_FINDINDEX_DIRTY )
+		return -1;
+
+	hash = Com_HashKey( pszValue, FINDINDEX_HASH_SIZE );
+
+	// first entry with the same hash after start edict
+	while( left < right )
+	{
+		int	mid = ( left + right ) / 2;
+		const findentry_t	*entry = &index->entries[mid];
+
+		if( entry->hash < hash || ( entry->hash == hash && entry->entnum <= e ))
+			left = mid + 1;
+		else right = mid;
+	}
+
+	for( i = left; i < index->numentries && index->entries[i].hash == hash; i++ )
+	{
+		if( SV_FindEntityMatch( index->entries[i].entnum, index->fieldOffset, pszValue ))
+		{
+			found = index->entries[i].entnum;
+			break;
+		}
+	}
+
+	// new edicts may be before the indexed one
+	for( i = 0; i < sv_findindex.numdirty; i++ )
+	{
+		int	d = sv_findindex.dirty[i];
+
+		if( d <= e || ( found && d >= found ))
+			continue;
+
+		if( SV_FindEntityMatch( d, index->fieldOffset, pszValue ))
+			found = d;
+	}
+
+	return found;
+}
+
 /*
 =========
 SV_FindEntityByString
@@ -1332,6 +1706,21 @@ edict_t* SV_FindEntityByString( edict_t *pStartEdict, const char *pszField, cons
 	if( pStartEdict ) e = NUM_FOR_EDICT( pStartEdict );
 	if( !pszValue || !*pszValue ) return svgame.edicts;
 
+	if( sv_findindex.initialized )
+	{
+		for( index = 0; index < FINDINDEX_FIELDS; index++ )
+		{
+			if( !Q_strcmp( pszField, sv_findindex.fields[index].fieldName ))
+			{
+				int	found = SV_FindIndexedEntity( &sv_findindex.fields[index], e, pszValue );
+
+				if( found >= 0 ) return EDICT_NUM( found );
+				break; // index is out of date
+			}
+		}
+		index = 0;
+	}
+
 	while(( desc = SV_GetEntvarsDescirption( index++ )) != NULL )
 	{
 		if( !Q_strcmp( pszField, desc->fieldName ))
@@ -1392,17 +1781,51 @@ int pfnGetEntityIllum( edict_t* pEnt )
 
 /*
 =================
-pfnFindEntityInSphere
+SV_EntityInSphere
 
-return NULL instead of world!
+box distance test used by all sphere searches
 =================
 */
-edict_t *pfnFindEntityInSphere( edict_t *pStartEdict, const float *org, float flRadius )
+static qboolean SV_EntityInSphere( edict_t *ent, int e, const float *org, float radiusSquared )
 {
-	edict_t	*ent;
 	float	distSquared;
 	float	eorg;
-	int	j, e = 0;
+	int	j;
+
+	if( !SV_IsValidEdict( ent ))
+		return false;
+
+	// ignore clients that not in a game
+	if( e <= sv_maxclients->integer && !SV_ClientFromEdict( ent, true ))
+		return false;
+
+	distSquared = 0.0f;
+
+	for( j = 0; j < 3 && distSquared <= radiusSquared; j++ )
+	{
+		if( org[j] < ent->v.absmin[j] )
+			eorg = org[j] - ent->v.absmin[j];
+		else if( org[j] > ent->v.absmax[j] )
+			eorg = org[j] - ent->v.absmax[j];
+		else eorg = 0;
+
+		distSquared += eorg * eorg;
+	}
+
+	return ( distSquared <= radiusSquared );
+}
+
+/*
+=================
+SV_FindEntityInSphereLinear
+
+walk through all the edicts
+=================
+*/
+static edict_t *SV_FindEntityInSphereLinear( edict_t *pStartEdict, const float *org, float flRadius )
+{
+	edict_t	*ent;
+	int	e = 0;
 
 	flRadius *= flRadius;
 
@@ -1413,32 +1836,205 @@ edict_t *pfnFindEntityInSphere( edict_t *pStartEdict, const float *org, float fl
 	{
 		ent = EDICT_NUM( e );
 
-		if( !SV_IsValidEdict( ent ))
-			continue;
+		if( SV_EntityInSphere( ent, e, org, flRadius ))
+			return ent;
+	}
 
-		// ignore clients that not in a game
-		if( e <= sv_maxclients->integer && !SV_ClientFromEdict( ent, true ))
-			continue;
+	return EDICT_NUM( 0 );
+}
+
+/*
+=================
+pfnFindEntityInSphere
+
+return NULL instead of world!
+=================
+*/
+edict_t *pfnFindEntityInSphere( edict_t *pStartEdict, const float *org, float flRadius )
+{
+	int	*list;
+	int	count, left, right;
+	int	e = 0;
+
+	count = SV_SphereEdicts( org, flRadius, &list );
+	if( count < 0 ) return SV_FindEntityInSphereLinear( pStartEdict, org, flRadius );
+
+	flRadius *= flRadius;
+
+	if( SV_IsValidEdict( pStartEdict ))
+		e = NUM_FOR_EDICT( pStartEdict );
+
+	// find first candidate after the start edict
+	for( left = 0, right = count; left < right; )
+	{
+		int	mid = ( left + right ) >> 1;
+
+		if( list[mid] <= e ) left = mid + 1;
+		else right = mid;
+	}
+
+	for( ; left < count; left++ )
+	{
+		edict_t	*ent = EDICT_NUM( list[left] );
+
+		if( SV_EntityInSphere( ent, list[left], org, flRadius ))
+			return ent;
+	}
+
+	return EDICT_NUM( 0 );
+}
+
+/*
+=================
+SV_EntitiesInSphere
+
+all edicts which pfnFindEntityInSphere would return, in the same order
+=================
+*/
+int SV_EntitiesInSphere( const float *org, float radius, edict_t **list, int maxcount )
+{
+	int	*touched;
+	int	i, count, numents = 0;
+	float	radiusSquared = radius * radius;
 
-		distSquared = 0.0f;
+	count = SV_SphereEdicts( org, radius, &touched );
 
-		for( j = 0; j < 3 && distSquared <= flRadius; j++ )
+	if( count < 0 )
+	{
+		// no world yet, check everything
+		for( i = 1; i < svgame.numEntities && numents < maxcount; i++ )
 		{
-			if( org[j] < ent->v.absmin[j] )
-				eorg = org[j] - ent->v.absmin[j];
-			else if( org[j] > ent->v.absmax[j] )
-				eorg = org[j] - ent->v.absmax[j];
-			else eorg = 0;
+			if( SV_EntityInSphere( EDICT_NUM( i ), i, org, radiusSquared ))
+				list[numents++] = EDICT_NUM( i );
+		}
+
+		return numents;
+	}
+
+	for( i = 0; i < count && numents < maxcount; i++ )
+	{
+		if( SV_EntityInSphere( EDICT_NUM( touched[i] ), touched[i], org, radiusSquared ))
+			list[numents++] = EDICT_NUM( touched[i] );
+	}
+
+	return numents;
+}
+
+/*
+=================
+SV_EntityInBox
+=================
+*/
+static qboolean SV_EntityInBox( edict_t *ent, int e, const float *mins, const float *maxs )
+{
+	if( !SV_IsValidEdict( ent ))
+		return false;
+
+	// ignore clients that not in a game
+	if( e <= sv_maxclients->integer && !SV_ClientFromEdict( ent, true ))
+		return false;
+
+	return BoundsIntersect( mins, maxs, ent->v.absmin, ent->v.absmax );
+}
 
-			distSquared += eorg * eorg;
+/*
+=================
+SV_EntitiesInBox
+
+all valid edicts which boxes touch the given box, sorted by number
+=================
+*/
+int SV_EntitiesInBox( const float *mins, const float *maxs, edict_t **list, int maxcount )
+{
+	int	*touched;
+	int	i, count, numents = 0;
+
+	count = SV_AreaEdicts( mins, maxs, &touched );
+
+	if( count < 0 )
+	{
+		for( i = 1; i < svgame.numEntities && numents < maxcount; i++ )
+		{
+			if( SV_EntityInBox( EDICT_NUM( i ), i, mins, maxs ))
+				list[numents++] = EDICT_NUM( i );
 		}
 
-		if( distSquared > flRadius )
-			continue;
-		return ent;
+		return numents;
 	}
 
-	return EDICT_NUM( 0 );
+	for( i = 0; i < count && numents < maxcount; i++ )
+	{
+		if( SV_EntityInBox( EDICT_NUM( touched[i] ), touched[i], mins, maxs ))
+			list[numents++] = EDICT_NUM( touched[i] );
+	}
+
+	return numents;
+}
+
+/*
+=================
+SV_SphereBench_f
+
+radius damage at origins of map entities,
+compare with the linear search
+=================
+*/
+void SV_SphereBench_f( void )
+{
+	int	i, e, numents, numtests, numfound = 0;
+	double	start, linearTime = 0.0, indexTime = 0.0;
+	float	radius;
+	edict_t	*ent, *found;
+	uint	checksum[2] = { 0, 0 };
+	int	pass;
+
+	if( sv.state != ss_active )
+	{
+		Msg( "spherebench: server is not running\n" );
+		return;
+	}
+
+	numtests = ( Cmd_Argc() > 1 ) ? Q_atoi( Cmd_Argv( 1 )) : 200;
+	numtests = bound( 1, numtests, 100000 );
+	radius = ( Cmd_Argc() > 2 ) ? Q_atof( Cmd_Argv( 2 )) : 384.0f;
+
+	for( numents = 0, i = 1; i < svgame.numEntities; i++ )
+	{
+		if( SV_IsValidEdict( EDICT_NUM( i )))
+			numents++;
+	}
+
+	if( !numents ) return;
+
+	for( pass = 0; pass < 2; pass++ )
+	{
+		start = Sys_DoubleTime();
+
+		for( i = 0, e = 1; i < numtests; i++, e++ )
+		{
+			// explode at the next valid entity
+			while( !SV_IsValidEdict( EDICT_NUM( e % svgame.numEntities )))
+				e++;
+			ent = EDICT_NUM( e % svgame.numEntities );
+
+			for( found = NULL; ; )
+			{
+				if( pass ) found = pfnFindEntityInSphere( found, ent->v.origin, radius );
+				else found = SV_FindEntityInSphereLinear( found, ent->v.origin, radius );
+				if( found == EDICT_NUM( 0 )) break;
+
+				checksum[pass] = checksum[pass] * 31 + NUM_FOR_EDICT( found );
+				if( pass ) numfound++;
+			}
+		}
+
+		if( pass ) indexTime = Sys_DoubleTime() - start;
+		else linearTime = Sys_DoubleTime() - start;
+	}
+
+	Msg( "%i explosions, radius %g, %i of %i edicts valid, %i hits\n", numtests, radius, numents, svgame.numEntities, numfound );
+	Msg( "linear %.2f ms, indexed %.2f ms\n", linearTime * 1000.0, indexTime * 1000.0 );
+	if( checksum[0] != checksum[1] ) Msg( "^1indexed search returns different edicts^7\n" );
 }
 
 /*
@@ -1455,7 +2051,7 @@ int SV_CheckClientPVS( int check, qboolean bMergePVS )
 	mleaf_t		*leaf;
 	vec3_t		view;
 	sv_client_t	*cl;
-	int		i, j, k;
+	int		i, k;
 	int		pvsbytes;
 
 	// cycle to the next one
@@ -1507,8 +2103,7 @@ int SV_CheckClientPVS( int check, qboolean bMergePVS )
 		if( leaf == NULL ) continue; // skip outside cameras
 		pvs = Mod_LeafPVS( leaf, sv.worldmodel );
 
-		for( j = 0; j < pvsbytes; j++ )
-			clientpvs[j] |= pvs[j];
+		Mod_MergeVis( clientpvs, pvs, pvsbytes );
 	}
 
 	return i;
@@ -1587,6 +2182,7 @@ edict_t *pfnEntitiesInPVS( edict_t *pview )
 	edict_t	*chain;
 	edict_t	*pEdict, *pEdict2;
 	vec3_t	viewpoint;
+	byte	*vis;
 	int	i;
 
 	if( !SV_IsValidEdict( pview ))
@@ -1594,6 +2190,9 @@ edict_t *pfnEntitiesInPVS( edict_t *pview )
 
 	VectorAdd( pview->v.origin, pview->v.view_ofs, viewpoint );
 
+	// viewpoint is the same for all edicts, decompress pvs once
+	vis = Mod_LeafPVS( Mod_PointInLeaf( viewpoint, sv.worldmodel->nodes ), sv.worldmodel );
+
 	for( chain = EDICT_NUM( 0 ), i = 1; i < svgame.numEntities; i++ )
 	{
 		pEdict = EDICT_NUM( i );
@@ -1618,7 +2217,7 @@ edict_t *pfnEntitiesInPVS( edict_t *pview )
 			pEdict2 = pEdict;
 		}
 
-		if( SV_BoxInPVS( viewpoint, pEdict2->v.absmin, pEdict2->v.absmax ))
+		if( Mod_BoxVisible( pEdict2->v.absmin, pEdict2->v.absmax, vis ))
 		{
 			pEdict->v.chain = chain;
 			chain = pEdict;
@@ -2448,11 +3047,8 @@ int pfnDecalIndex( const char *m )
 	if( !m || !m[0] )
 		return 0;
 
-	for( i = 1; i < MAX_DECALS && host.draw_decals[i][0]; i++ )
-	{
-		if( !Q_stricmp( (char *)host.draw_decals[i], m ))
-			return i;
-	}
+	if(( i = Precache_Find( &host.decal_hash, (char (*)[CS_SIZE])host.draw_decals, m )) != 0 )
+		return i;
 
 	// throw warning (this can happens if decal not present in decals.wad)
 	MsgDev( D_WARN, "Can't find decal %s\n", m );
@@ -2950,32 +3546,34 @@ void pfnFreeEntPrivateData( edict_t *pEdict )
 	SV_FreePrivateData( pEdict );
 }
 
-#ifdef __amd64__
-char g_stringbase[65536];
-char *pLastsStr = g_stringbase;
-#endif
-
 /*
 =============
 SV_AllocString
 
-allocate new engine string
+allocate new engine string, equal
+strings share the same string_t
 =============
 */
 string_t SV_AllocString( const char *szValue )
 {
-	const char *newString;
+	int	offset;
 
 	if( svgame.physFuncs.pfnAllocString != NULL )
 		return svgame.physFuncs.pfnAllocString( szValue );
-#ifdef __amd64__
-	newString = pLastsStr;
-	pLastsStr += Q_strcpy(pLastsStr,szValue) + 1;
 
-	return newString - g_stringbase;
+	offset = SV_PoolString( &svgame.strings, szValue );
+#ifdef __amd64__
+	// string_t is an offset from the pool on 64-bit
+	if( offset < 0 ) Host_Error( "SV_AllocString: string pool overflow (sv_stringpool_size is %i kb)\n", sv_stringpool_size->integer );
+	return offset;
 #else
-	newString = _copystring( svgame.stringspool, szValue, __FILE__, __LINE__ );
-	return newString - svgame.globals->pStringBase;
+	{
+		const char *newString;
+
+		if( offset >= 0 ) newString = svgame.strings.base + offset;
+		else newString = _copystring( svgame.stringspool, szValue, __FILE__, __LINE__ );
+		return newString - svgame.globals->pStringBase;
+	}
 #endif
 }
 
@@ -3941,7 +4539,6 @@ byte *pfnSetFatPVS( const float *org )
 	ASSERT( svs.currentPlayerNum >= 0 && svs.currentPlayerNum < MAX_CLIENTS );
 
 	fatbytes = (sv.worldmodel->numleafs+31)>>3;
-	bitvector = fatpvs;
 
 	// portals can't change viewpoint!
 	if(!( sv.hostflags & SVF_PORTALPASS ))
@@ -3964,16 +4561,21 @@ byte *pfnSetFatPVS( const float *org )
 		else VectorCopy( org, viewPos );
 
 		// build a new PVS frame
-		Q_memset( bitvector, 0, fatbytes );
-
-		SV_AddToFatPVS( viewPos, DVIS_PVS, sv.worldmodel->nodes );
+		bitvector = SV_FatVis( &fatcache[svs.currentPlayerNum][DVIS_PVS], viewPos, DVIS_PVS );
 		VectorCopy( viewPos, viewPoint[svs.currentPlayerNum] );
+		viewLeafnum[svs.currentPlayerNum] = Mod_PointLeafnum( viewPos );
+		viewLeafSequence[svs.currentPlayerNum] = world.load_sequence;
 	}
 	else
 	{
+		if( fatresult[DVIS_PVS] && fatresult[DVIS_PVS] != fatpvs )
+			Q_memcpy( fatpvs, fatresult[DVIS_PVS], fatbytes );
+		bitvector = fatpvs;
 		SV_AddToFatPVS( org, DVIS_PVS, sv.worldmodel->nodes );
 	}
 
+	fatresult[DVIS_PVS] = bitvector;
+
 	return bitvector;
 }
 
@@ -3993,7 +4595,6 @@ byte *pfnSetFatPAS( const float *org )
 	ASSERT( svs.currentPlayerNum >= 0 && svs.currentPlayerNum < MAX_CLIENTS );
 
 	fatbytes = (sv.worldmodel->numleafs+31)>>3;
-	bitvector = fatphs;
 
 	// portals can't change viewpoint!
 	if(!( sv.hostflags & SVF_PORTALPASS ))
@@ -4016,19 +4617,154 @@ byte *pfnSetFatPAS( const float *org )
 		else VectorCopy( org, viewPos );
 
 		// build a new PHS frame
-		Q_memset( bitvector, 0, fatbytes );
-
-		SV_AddToFatPVS( viewPos, DVIS_PHS, sv.worldmodel->nodes );
+		bitvector = SV_FatVis( &fatcache[svs.currentPlayerNum][DVIS_PHS], viewPos, DVIS_PHS );
 	}
 	else
 	{
 		// merge PVS
+		if( fatresult[DVIS_PHS] && fatresult[DVIS_PHS] != fatphs )
+			Q_memcpy( fatphs, fatresult[DVIS_PHS], fatbytes );
+		bitvector = fatphs;
 		SV_AddToFatPVS( org, DVIS_PHS, sv.worldmodel->nodes );
 	}
 
+	fatresult[DVIS_PHS] = bitvector;
+
 	return bitvector;
 }
 
+/*
+=============
+SV_VisBenchFat_r
+
+fat pvs without any caches, as it was built before
+=============
+*/
+static void SV_VisBenchFat_r( const vec3_t org, mnode_t *node, byte *out, int rowbytes )
+{
+	byte	*vis;
+	float	d;
+	int	i;
+
+	while( node->contents >= 0 )
+	{
+		d = PlaneDiff( org, node->plane );
+		if( d > 8.0f ) node = node->children[0];
+		else if( d < -8.0f ) node = node->children[1];
+		else
+		{
+			SV_VisBenchFat_r( org, node->children[0], out, rowbytes );
+			node = node->children[1];
+		}
+	}
+
+	if( node->contents == CONTENTS_SOLID )
+		return;
+
+	vis = Mod_DecompressVis( ((mleaf_t *)node)->compressed_vis );
+	for( i = 0; i < rowbytes; i++ )
+		out[i] |= vis[i];
+}
+
+/*
+=============
+SV_VisBench_f
+
+clients walk through random leafs of current map,
+fat pvs is built for each of them every frame
+=============
+*/
+void SV_VisBench_f( void )
+{
+	int		numclients, numframes, frame, pass, cl, i;
+	int		hits, rowhits = 0, numrows, mismatches = 0;
+	int		reused = 0, built = 0;
+	int		rowbytes;
+	uint		seed;
+	double		start, time[3];
+	vec3_t		*org;
+	fatcache_t	*caches;
+	byte		*bits;
+
+	if( sv.state != ss_active || !sv.worldmodel->visdata || sv.worldmodel->numleafs < 2 )
+	{
+		Msg( "visbench: map with vis data is not running\n" );
+		return;
+	}
+
+	numframes = ( Cmd_Argc() > 1 ) ? Q_atoi( Cmd_Argv( 1 )) : 1000;
+	numframes = bound( 1, numframes, 100000 );
+	numclients = MAX_CLIENTS;
+
+	fatbytes = (sv.worldmodel->numleafs+31)>>3;
+	rowbytes = (sv.worldmodel->numleafs+7)>>3;
+	org = Mem_Alloc( host.mempool, numclients * sizeof( vec3_t ));
+	caches = Mem_Alloc( host.mempool, numclients * sizeof( fatcache_t ));
+	bits = Mem_Alloc( host.mempool, numclients * fatbytes );
+
+	// uncached, cached, then compare both
+	for( pass = 0; pass < 3; pass++ )
+	{
+		Q_memset( caches, 0, numclients * sizeof( fatcache_t ));
+		Mod_VisCacheInfo( &hits, NULL, NULL );
+		fathits = fatmisses = 0;
+		start = Sys_DoubleTime();
+		seed = 1;
+
+		for( frame = 0; frame < numframes; frame++ )
+		{
+			for( cl = 0; cl < numclients; cl++ )
+			{
+				byte	*out = bits + cl * fatbytes;
+
+				// client enters another leaf each 20 frames
+				if(( frame + cl ) % 20 == 0 )
+				{
+					mleaf_t	*leaf;
+
+					seed = seed * 1103515245 + 12345;
+					leaf = sv.worldmodel->leafs + 1 + ( seed >> 8 ) % ( sv.worldmodel->numleafs - 1 );
+
+					for( i = 0; i < 3; i++ )
+						org[cl][i] = ( leaf->minmaxs[i] + leaf->minmaxs[i+3] ) * 0.5f;
+				}
+				else if( frame == 0 ) VectorClear( org[cl] );
+
+				if( pass != 1 )
+				{
+					Q_memset( out, 0, fatbytes );
+					SV_VisBenchFat_r( org[cl], sv.worldmodel->nodes, out, fatbytes );
+				}
+
+				if( pass == 1 ) SV_FatVis( &caches[cl], org[cl], DVIS_PVS );
+				else if( pass == 2 && memcmp( out, SV_FatVis( &caches[cl], org[cl], DVIS_PVS ), rowbytes ))
+					mismatches++;
+			}
+		}
+
+		time[pass] = Sys_DoubleTime() - start;
+
+		if( pass == 1 )
+		{
+			Mod_VisCacheInfo( &rowhits, NULL, NULL );
+			rowhits -= hits;
+			reused = fathits;
+			built = fatmisses;
+		}
+	}
+
+	Msg( "%i leafs, %i clients, %i frames\n", sv.worldmodel->numleafs, numclients, numframes );
+	Msg( "uncached %.2f ms, cached %.2f ms\n", time[0] * 1000.0, time[1] * 1000.0 );
+
+	Mod_VisCacheInfo( NULL, NULL, &numrows );
+	Msg( "%i rows in cache, %i row hits, %i of %i fat sets reused\n", numrows, rowhits, reused, reused + built );
+	if( mismatches ) Msg( "^1%i fat sets differ^7\n", mismatches );
+
+	Mem_Free( bits );
+	Mem_Free( caches );
+	Mem_Free( org );
+}
+
 /*
 =============
 pfnCheckVisibility
@@ -4608,6 +5344,88 @@ static enginefuncs_t gEngfuncs =
 	pfnCheckParm,
 };
 
+/*
+====================
+SV_ApplyEdictKeys
+
+Allocates private data for the parsed edict and
+passes keyvalues to the game dll. Returns false
+if entity can't be created
+====================
+*/
+qboolean SV_ApplyEdictKeys( edict_t *ent, KeyValueData *pkvd, int numpairs, const char *classname )
+{
+	char		anglesname[] = "angles";
+	char		lightname[] = "light_level";
+	KeyValueData	kvd;
+	string		angles;
+	int		i;
+
+	ent = SV_AllocPrivateData( ent, ALLOC_STRING( classname ));
+
+	if( !SV_IsValidEdict( ent ) || ent->v.flags & FL_KILLME )
+		return false;
+
+	for( i = 0; i < numpairs; i++ )
+	{
+		kvd = pkvd[i];
+
+		if( !Q_strcmp( kvd.szKeyName, "angle" ))
+		{
+			float	flYawAngle = Q_atof( kvd.szValue );
+
+			kvd.szKeyName = anglesname; // will be replace with 'angles'
+			kvd.szValue = angles;
+
+			if( flYawAngle >= 0.0f )
+				Q_snprintf( angles, sizeof( angles ), "%g %g %g", ent->v.angles[0], flYawAngle, ent->v.angles[2] );
+			else if( flYawAngle == -1.0f )
+				Q_strncpy( angles, "-90 0 0", sizeof( angles ));
+			else if( flYawAngle == -2.0f )
+				Q_strncpy( angles, "90 0 0", sizeof( angles ));
+			else Q_strncpy( angles, "0 0 0", sizeof( angles )); // technically an error
+		}
+
+		if( !Q_strcmp( kvd.szKeyName, "light" ))
+			kvd.szKeyName = lightname;
+
+		if( !kvd.fHandled )
+		{
+			kvd.szClassName = (char *)classname;
+			svgame.dllFuncs.pfnKeyValue( ent, &kvd );
+		}
+	}
+
+	return true;
+}
+
+/*
+====================
+SV_IsEdictKey
+
+keys which are dropped by engine
+====================
+*/
+qboolean SV_IsEdictKey( const char *keyname, const char *value )
+{
+	// ignore attempts to set key ""
+	if( !keyname[0] ) return false;
+
+	// "wad" field is completely ignored in Xash3D
+	if( !Q_strcmp( keyname, "wad" ))
+		return false;
+
+	// keynames with a leading underscore are used for utility comments,
+	// and are immediately discarded by engine
+	if( world.version == Q1BSP_VERSION && keyname[0] == '_' )
+		return false;
+
+	// ignore attempts to set value ""
+	if( !value[0] ) return false;
+
+	return true;
+}
+
 /*
 ====================
 SV_ParseEdict
@@ -4622,6 +5440,7 @@ qboolean SV_ParseEdict( char **pfile, edict_t *ent )
 	int		i, numpairs = 0;
 	const char	*classname = NULL;
 	char		token[2048];
+	qboolean		result;
 
 	// go through all the dictionary pairs
 	while( 1 )
@@ -4642,21 +5461,9 @@ qboolean SV_ParseEdict( char **pfile, edict_t *ent )
 		if( token[0] == '}' )
 			Host_Error( "ED_ParseEdict: closing brace without data\n" );
 
-		// ignore attempts to set key ""
-		if( !keyname[0] ) continue;
-
-		// "wad" field is completely ignored in Xash3D
-		if( !Q_strcmp( keyname, "wad" ))
-			continue;
-
-		// keynames with a leading underscore are used for utility comments,
-		// and are immediately discarded by engine
-		if( world.version == Q1BSP_VERSION && keyname[0] == '_' )
+		if( !SV_IsEdictKey( keyname, token ))
 			continue;
 
-		// ignore attempts to set value ""
-		if( !token[0] ) continue;
-
 		// create keyvalue strings
 		pkvd[numpairs].szClassName = (char *)classname;	// unknown at this moment
 		pkvd[numpairs].szKeyName = copystring( keyname );
@@ -4667,57 +5474,39 @@ qboolean SV_ParseEdict( char **pfile, edict_t *ent )
 			classname = pkvd[numpairs].szValue;
 		if( ++numpairs >= 256 ) break;
 	}
-	
-	ent = SV_AllocPrivateData( ent, ALLOC_STRING( classname ));
 
-	if( !SV_IsValidEdict( ent ) || ent->v.flags & FL_KILLME )
-	{
-		// release allocated strings
-		for( i = 0; i < numpairs; i++ )
-		{
-			Mem_Free( pkvd[i].szKeyName );
-			Mem_Free( pkvd[i].szValue );
-		}
-		return false;
-	}
+	result = SV_ApplyEdictKeys( ent, pkvd, numpairs, classname );
 
+	// no reason to keep this data
 	for( i = 0; i < numpairs; i++ )
 	{
-		if( !Q_strcmp( pkvd[i].szKeyName, "angle" ))
-		{
-			float	flYawAngle = Q_atof( pkvd[i].szValue );
-
-			Mem_Free( pkvd[i].szKeyName ); // will be replace with 'angles'
-			Mem_Free( pkvd[i].szValue );	// release old value, so we don't need these
-			pkvd[i].szKeyName = copystring( "angles" );
+		Mem_Free( pkvd[i].szKeyName );
+		Mem_Free( pkvd[i].szValue );
+	}
 
-			if( flYawAngle >= 0.0f )
-				pkvd[i].szValue = copystring( va( "%g %g %g", ent->v.angles[0], flYawAngle, ent->v.angles[2] ));
-			else if( flYawAngle == -1.0f )
-				pkvd[i].szValue = copystring( "-90 0 0" );
-			else if( flYawAngle == -2.0f )
-				pkvd[i].szValue = copystring( "90 0 0" );
-			else pkvd[i].szValue = copystring( "0 0 0" ); // technically an error
-		}
+	return result;
+}
 
-		if( !Q_strcmp( pkvd[i].szKeyName, "light" ))
-		{
-			Mem_Free( pkvd[i].szKeyName );
-			pkvd[i].szKeyName = copystring( "light_level" );
-		}
+/*
+====================
+SV_SpawnParsedEdict
 
-		if( !pkvd[i].fHandled )
-		{
-			pkvd[i].szClassName = (char *)classname;
-			svgame.dllFuncs.pfnKeyValue( ent, &pkvd[i] );
-		}
+returns true if game rejected the spawn
+====================
+*/
+qboolean SV_SpawnParsedEdict( edict_t *ent )
+{
+	if( svgame.dllFuncs.pfnSpawn( ent ) != -1 )
+		return false;
 
-		// no reason to keep this data
-		Mem_Free( pkvd[i].szKeyName );
-		Mem_Free( pkvd[i].szValue );
+	// game rejected the spawn
+	if( !( ent->v.flags & FL_KILLME ))
+	{
+		SV_FreeEdict( ent );
+		return true;
 	}
 
-	return true;
+	return false;
 }
 
 /*
@@ -4746,6 +5535,10 @@ void SV_LoadFromFile( const char *mapname, char *entities )
 	{
 		inhibited = 0;
 
+		// the same lump was parsed before, nothing to tokenize
+		if( SV_LoadFromTemplate( mapname, entities, &inhibited ))
+			entities = NULL;
+
 		// parse ents
 		while(( entities = COM_ParseFile( entities, token )) != NULL )
 		{
@@ -4762,15 +5555,8 @@ void SV_LoadFromFile( const char *mapname, char *entities )
 			if( !SV_ParseEdict( &entities, ent ))
 				continue;
 
-			if( svgame.dllFuncs.pfnSpawn( ent ) == -1 )
-			{
-				// game rejected the spawn
-				if( !( ent->v.flags & FL_KILLME ))
-				{
-					SV_FreeEdict( ent );
-					inhibited++;
-				}
-			}
+			if( SV_SpawnParsedEdict( ent ))
+				inhibited++;
 		}
 
 		MsgDev( D_INFO, "SV_LoadFromFile: %i entities inhibited\n", inhibited );
@@ -4779,6 +5565,7 @@ void SV_LoadFromFile( const char *mapname, char *entities )
 	// reset world origin and angles for some reason
 	VectorClear( svgame.edicts->v.origin );
 	VectorClear( svgame.edicts->v.angles );
+	SV_SpawnPhase( "spawn" );
 }
 
 /*
@@ -4849,10 +5636,14 @@ void SV_UnloadProgs( void )
 	Delta_Shutdown ();
 
 	Mem_FreePool( &svgame.stringspool );
+	SV_ShutdownEntityIndex();
 
 	if( svgame.dllFuncs2.pfnGameShutdown != NULL )
 		svgame.dllFuncs2.pfnGameShutdown ();
 
+	// pStringBase points into the pool, game dll may use STRING() on shutdown
+	SV_FreeStringPool( &svgame.strings );
+
 	// now we can unload cvars
 	Cvar_FullSet( "host_gameloaded", "0", CVAR_INIT );
 	Cvar_FullSet( "sv_background", "0", CVAR_READ_ONLY );
@@ -4995,8 +5786,9 @@ qboolean SV_LoadProgs( const char *name )
 
 	// grab function SV_SaveGameComment
 	SV_InitSaveRestore ();
+	SV_InitStringPool( &svgame.strings, svgame.mempool, sv_stringpool_size->integer * 1024 );
 #ifdef __amd64__
-	svgame.globals->pStringBase = g_stringbase; // setup string base
+	svgame.globals->pStringBase = svgame.strings.base; // setup string base
 #else
 	svgame.globals->pStringBase = "";
 #endif
@@ -5004,6 +5796,7 @@ qboolean SV_LoadProgs( const char *name )
 	svgame.globals->maxClients = sv_maxclients->integer;
 	svgame.edicts = Mem_Alloc( svgame.mempool, sizeof( edict_t ) * svgame.globals->maxEntities );
 	svgame.numEntities = svgame.globals->maxClients + 1; // clients + world
+	SV_InitEntityIndex();
 
 	for( i = 0, e = svgame.edicts; i < svgame.globals->maxEntities; i++, e++ )
 		e->free = true; // mark all edicts as freed
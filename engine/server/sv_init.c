@@ -35,11 +35,10 @@ int SV_ModelIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_MODELS && sv.model_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.model_precache[i], name ))
-			return i;
-	}
+	if(( i = Precache_Find( &sv.model_hash, sv.model_precache, name )) != 0 )
+		return i;
+
+	i = Precache_FreeSlot( &sv.model_hash );
 
 	if( i == MAX_MODELS )
 	{
@@ -49,6 +48,7 @@ int SV_ModelIndex( const char *filename )
 
 	// register new model
 	Q_strncpy( sv.model_precache[i], name, sizeof( sv.model_precache[i] ));
+	Precache_Add( &sv.model_hash, sv.model_precache, i );
 
 	if( sv.state != ss_loading )
 	{	
@@ -73,11 +73,10 @@ int SV_SoundIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_SOUNDS && sv.sound_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.sound_precache[i], name ))
-			return i;
-	}
+	if(( i = Precache_Find( &sv.sound_hash, sv.sound_precache, name )) != 0 )
+		return i;
+
+	i = Precache_FreeSlot( &sv.sound_hash );
 
 	if( i == MAX_SOUNDS )
 	{
@@ -87,6 +86,7 @@ int SV_SoundIndex( const char *filename )
 
 	// register new sound
 	Q_strncpy( sv.sound_precache[i], name, sizeof( sv.sound_precache[i] ));
+	Precache_Add( &sv.sound_hash, sv.sound_precache, i );
 
 	if( sv.state != ss_loading )
 	{	
@@ -110,11 +110,10 @@ int SV_EventIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_EVENTS && sv.event_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.event_precache[i], name ))
-			return i;
-	}
+	if(( i = Precache_Find( &sv.event_hash, sv.event_precache, name )) != 0 )
+		return i;
+
+	i = Precache_FreeSlot( &sv.event_hash );
 
 	if( i == MAX_EVENTS )
 	{
@@ -124,6 +123,7 @@ int SV_EventIndex( const char *filename )
 
 	// register new event
 	Q_strncpy( sv.event_precache[i], name, sizeof( sv.event_precache[i] ));
+	Precache_Add( &sv.event_hash, sv.event_precache, i );
 
 	if( sv.state != ss_loading )
 	{
@@ -147,11 +147,10 @@ int SV_GenericIndex( const char *filename )
 	Q_strncpy( name, filename, sizeof( name ));
 	COM_FixSlashes( name );
 
-	for( i = 1; i < MAX_CUSTOM && sv.files_precache[i][0]; i++ )
-	{
-		if( !Q_stricmp( sv.files_precache[i], name ))
-			return i;
-	}
+	if(( i = Precache_Find( &sv.files_hash, sv.files_precache, name )) != 0 )
+		return i;
+
+	i = Precache_FreeSlot( &sv.files_hash );
 
 	if( i == MAX_CUSTOM )
 	{
@@ -168,6 +167,7 @@ int SV_GenericIndex( const char *filename )
 
 	// register new generic resource
 	Q_strncpy( sv.files_precache[i], name, sizeof( sv.files_precache[i] ));
+	Precache_Add( &sv.files_hash, sv.files_precache, i );
 
 	return i;
 }
@@ -265,6 +265,66 @@ void SV_FreeOldEntities( void )
 	for( ; EDICT_NUM( svgame.numEntities - 1 )->free; svgame.numEntities-- );
 }
 
+#define MAX_SPAWN_PHASES	16
+
+static struct
+{
+	double		start;
+	double		last;
+	const char	*names[MAX_SPAWN_PHASES];
+	double		times[MAX_SPAWN_PHASES];
+	int		numphases;
+} sv_spawntimes;
+
+/*
+================
+SV_SpawnPhase
+
+mark end of map loading phase,
+NULL starts a new map
+================
+*/
+void SV_SpawnPhase( const char *name )
+{
+	double	now = Sys_DoubleTime();
+
+	if( !name )
+	{
+		sv_spawntimes.start = now;
+		sv_spawntimes.numphases = 0;
+	}
+	else if( sv_spawntimes.numphases < MAX_SPAWN_PHASES )
+	{
+		sv_spawntimes.names[sv_spawntimes.numphases] = name;
+		sv_spawntimes.times[sv_spawntimes.numphases] = now - sv_spawntimes.last;
+		sv_spawntimes.numphases++;
+	}
+
+	sv_spawntimes.last = now;
+}
+
+/*
+================
+SV_PrintSpawnTimes
+================
+*/
+static void SV_PrintSpawnTimes( void )
+{
+	char	text[MAX_SYSPATH];
+	int	i;
+
+	if( !sv_spawntimes.numphases )
+		return;
+
+	text[0] = '\0';
+
+	for( i = 0; i < sv_spawntimes.numphases; i++ )
+		Q_strncat( text, va( "%s%s %.1f", i ? ", " : "", sv_spawntimes.names[i], sv_spawntimes.times[i] * 1000.0 ), sizeof( text ));
+
+	MsgDev( D_INFO, "%s spawned in %.1f ms (%s)\n", sv.name, ( sv_spawntimes.last - sv_spawntimes.start ) * 1000.0, text );
+	sv_spawntimes.numphases = 0;
+}
+
 /*
 ================
 SV_ActivateServer
@@ -293,9 +353,11 @@ void SV_ActivateServer( void )
 
 	// Activate the DLL server code
 	svgame.dllFuncs.pfnServerActivate( svgame.edicts, svgame.numEntities, svgame.globals->maxClients );
+	SV_SpawnPhase( "activate" );
 
 	// create a baseline for more efficient communications
 	SV_CreateBaseline();
+	SV_SpawnPhase( "baselines" );
 
 	// check and count all files that marked by user as unmodified (typically is a player models etc)
 	sv.num_consistency_resources = SV_TransferConsistencyInfo();
@@ -325,6 +387,9 @@ void SV_ActivateServer( void )
 		SV_Physics();
 	}
 
+	SV_SpawnPhase( "settle frames" );
+	SV_PrintSpawnTimes();
+
 	// invoke to refresh all movevars
 	Q_memset( &svgame.oldmovevars, 0, sizeof( movevars_t ));
 	svgame.globals->changelevel = false; // changelevel ends here
@@ -405,6 +470,7 @@ void SV_DeactivateServer( void )
 	SV_ClearPhysEnts ();
 
 	Mem_EmptyPool( svgame.stringspool );
+	SV_ClearStringPool( &svgame.strings );
 
 	svgame.dllFuncs.pfnServerDeactivate();
 
@@ -472,6 +538,7 @@ void SV_LevelInit( const char *pMapName, char const *pOldLevel, char const *pLan
 
 	// relese all intermediate entities
 	SV_FreeOldEntities ();
+	SV_SpawnPhase( "level init" );
 }
 
 /*
@@ -488,6 +555,8 @@ qboolean SV_SpawnServer( const char *mapname, const char *startspot )
 	qboolean	loadgame, paused;
 	qboolean	background, changelevel;
 
+	SV_SpawnPhase( NULL );
+
 	// save state
 	loadgame = sv.loadgame;
 	background = sv.background;
@@ -508,6 +577,7 @@ qboolean SV_SpawnServer( const char *mapname, const char *startspot )
 	if( !svs.initialized )
 		return false;
 
+	SV_SpawnPhase( "init game" );
 	svgame.globals->changelevel = false; // will be restored later if needed
 	svs.timestart = Sys_DoubleTime();
 	svs.spawncount++; // any partially connected client will be restarted
@@ -579,15 +649,19 @@ qboolean SV_SpawnServer( const char *mapname, const char *startspot )
 	else sv.startspot[0] = '\0';
 
 	Q_snprintf( sv.model_precache[1], sizeof( sv.model_precache[0] ), "maps/%s.bsp", sv.name );
+	Precache_Add( &sv.model_hash, sv.model_precache, 1 );
 	Mod_LoadWorld( sv.model_precache[1], &sv.checksum, false );
 	sv.worldmodel = Mod_Handle( 1 ); // get world pointer
 
 	for( i = 1; i < sv.worldmodel->numsubmodels; i++ )
 	{
 		Q_sprintf( sv.model_precache[i+1], "*%i", i );
+		Precache_Add( &sv.model_hash, sv.model_precache, i+1 );
 		Mod_RegisterModel( sv.model_precache[i+1], i+1 );
 	}
 
+	SV_SpawnPhase( "world" );
+
 	// precache and static commands can be issued during map initialization
 	sv.state = ss_loading;
 
@@ -598,6 +672,7 @@ qboolean SV_SpawnServer( const char *mapname, const char *startspot )
 
 	// tell dlls about new level started
 	svgame.dllFuncs.pfnParmsNewLevel();
+	SV_SpawnPhase( "clear world" );
 
 	return true;
 }
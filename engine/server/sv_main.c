@@ -90,6 +90,12 @@ convar_t	*sv_trace_messages;
 convar_t	*sv_master;
 convar_t	*sv_corpse_solid;
 convar_t	*sv_fixmulticast;
+convar_t	*sv_save_compress;
+convar_t	*sv_save_async;
+convar_t	*sv_levelcache;
+convar_t	*sv_stringpool_size;
+convar_t	*sv_skipidle;
+convar_t	*sv_entcache;
 
 // sky variables
 convar_t	*sv_skycolor_r;
@@ -613,6 +619,9 @@ Host_ServerFrame
 */
 void Host_ServerFrame( void )
 {
+	// complete savegame written in background
+	SV_UpdateSaves ();
+
 	// if server is not active, do nothing
 	if( !svs.initialized )
 	{
@@ -893,6 +902,12 @@ void SV_Init( void )
 	sv_master = Cvar_Get( "sv_master", MASTERSERVER_ADR, CVAR_ARCHIVE, "master server address" );
 	sv_corpse_solid = Cvar_Get( "sv_corpse_solid", "0", CVAR_ARCHIVE, "make corpses solid" );
 	sv_fixmulticast = Cvar_Get( "sv_fixmulticast", "1", CVAR_ARCHIVE, "do not send multicast to not spawned clients" );
+	sv_save_compress = Cvar_Get( "sv_save_compress", "1", CVAR_ARCHIVE, "compress savegames" );
+	sv_save_async = Cvar_Get( "sv_save_async", "1", CVAR_ARCHIVE, "write savegames in background thread" );
+	sv_levelcache = Cvar_Get( "sv_levelcache", "8", CVAR_ARCHIVE, "number of visited levels kept in memory for changelevel" );
+	sv_stringpool_size = Cvar_Get( "sv_stringpool_size", "1024", CVAR_ARCHIVE, "memory for game dll strings in kilobytes, used on next game load" );
+	sv_entcache = Cvar_Get( "sv_entcache", "1", CVAR_ARCHIVE, "keep tokenized entity lumps of recent maps for restarts" );
+	sv_skipidle = Cvar_Get( "sv_skipidle", "1", CVAR_ARCHIVE, "don't run physics for entities which neither move nor think this frame" );
 
 	Cmd_AddCommand( "download_resources", SV_DownloadResources_f, "try to download missing resources to server");
 
@@ -960,6 +975,9 @@ before Sys_Quit or Sys_Error
 */
 void SV_Shutdown( qboolean reconnect )
 {
+	// don't lose savegame which is written yet
+	SV_FlushSaves ();
+
 	// already freed
 	if( !SV_Active( )) // library may be loaded
 	{
@@ -993,6 +1011,8 @@ void SV_Shutdown( qboolean reconnect )
 		svs.clients = NULL;
 	}
 
+	SV_FreeMulticast();
+
 	if( svs.baselines )
 	{
 		Z_Free( svs.baselines );
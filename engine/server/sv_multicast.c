@@ -0,0 +1,260 @@
+/*
+sv_multicast.c - shared unreliable message payloads
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "server.h"
+
+/*
+=============================================================================
+
+Unreliable multicast is encoded once into a chunk of the frame arena,
+each recipient keeps only a reference { chunk, offset, bits } which is
+written out by SV_SendClientDatagram. References always follow the
+bits already written into cl->datagram, so message order is kept.
+Chunk is reused when the last reference to it is released.
+
+=============================================================================
+*/
+
+#define MULTICAST_CHUNK_SIZE	0x10000
+#define MAX_MULTICAST_CHUNKS	64	// 4 mb, writes go direct when all chunks are busy
+
+struct mcchunk_s
+{
+	struct mcchunk_s	*next;		// free list
+	struct mcchunk_s	*chain;		// all allocated chunks
+	int		refcount;
+	int		used;
+	byte		data[MULTICAST_CHUNK_SIZE];
+};
+
+static struct
+{
+	mcchunk_t		*current;		// chunk for new payloads, arena holds a reference
+	mcchunk_t		*free;
+	mcchunk_t		*chain;
+	int		numchunks;
+
+	size_t		bytesstored;
+	size_t		bytesreferenced;
+	int		fallbacks;
+} sv_mc;
+
+/*
+=============
+SV_ReleaseChunk
+=============
+*/
+static void SV_ReleaseChunk( mcchunk_t *chunk )
+{
+	if( --chunk->refcount > 0 )
+		return;
+
+	chunk->used = 0;
+	chunk->next = sv_mc.free;
+	sv_mc.free = chunk;
+}
+
+/*
+=============
+SV_NewChunk
+=============
+*/
+static mcchunk_t *SV_NewChunk( void )
+{
+	mcchunk_t	*chunk;
+
+	if( sv_mc.free )
+	{
+		chunk = sv_mc.free;
+		sv_mc.free = chunk->next;
+	}
+	else
+	{
+		if( sv_mc.numchunks >= MAX_MULTICAST_CHUNKS )
+			return NULL;
+
+		chunk = Mem_Alloc( host.mempool, sizeof( mcchunk_t ));
+		chunk->chain = sv_mc.chain;
+		sv_mc.chain = chunk;
+		sv_mc.numchunks++;
+	}
+
+	chunk->next = NULL;
+	chunk->refcount = 1;
+	chunk->used = 0;
+
+	return chunk;
+}
+
+/*
+=============
+SV_StoreMulticast
+
+copy message into the arena once, returns false
+when arena is full and message must be written direct
+=============
+*/
+qboolean SV_StoreMulticast( sizebuf_t *msg, mcref_t *ref )
+{
+	int	size = ( BF_GetNumBytesWritten( msg ) + 3 ) & ~3;
+
+	if( size > MULTICAST_CHUNK_SIZE )
+		return false;
+
+	// nobody else uses current chunk, start it over while it's in cache
+	if( sv_mc.current && sv_mc.current->refcount == 1 )
+		sv_mc.current->used = 0;
+
+	if( !sv_mc.current || sv_mc.current->used + size > MULTICAST_CHUNK_SIZE )
+	{
+		if( sv_mc.current )
+			SV_ReleaseChunk( sv_mc.current );
+
+		if(( sv_mc.current = SV_NewChunk( )) == NULL )
+		{
+			sv_mc.fallbacks++;
+			return false;
+		}
+	}
+
+	ref->chunk = sv_mc.current;
+	ref->offset = sv_mc.current->used;
+	ref->numbits = BF_GetNumBitsWritten( msg );
+
+	Q_memcpy( sv_mc.current->data + ref->offset, BF_GetData( msg ), BF_GetNumBytesWritten( msg ));
+	sv_mc.current->used += size;
+	sv_mc.bytesstored += size;
+
+	return true;
+}
+
+/*
+=============
+SV_FlushMulticast
+
+write pending references into msg and release them
+=============
+*/
+void SV_FlushMulticast( sv_client_t *cl, sizebuf_t *msg )
+{
+	mcref_t	*ref;
+	int	i;
+
+	for( i = 0, ref = cl->multicast; i < cl->nummulticast; i++, ref++ )
+	{
+		BF_WriteBits( msg, ref->chunk->data + ref->offset, ref->numbits );
+		SV_ReleaseChunk( ref->chunk );
+	}
+
+	cl->nummulticast = 0;
+	cl->multicastbits = 0;
+}
+
+/*
+=============
+SV_AddMulticast
+
+client gets a reference instead of a copy
+=============
+*/
+void SV_AddMulticast( sv_client_t *cl, const mcref_t *ref )
+{
+	if( BF_CheckOverflow( &cl->datagram ))
+		return;
+
+	// same overflow as if it was written into datagram
+	if( BF_GetNumBitsWritten( &cl->datagram ) + cl->multicastbits + ref->numbits > BF_GetMaxBits( &cl->datagram ))
+	{
+		cl->datagram.bOverflow = true;
+		return;
+	}
+
+	if( cl->nummulticast == MAX_MULTICAST_REFS )
+		SV_FlushMulticast( cl, &cl->datagram );
+
+	cl->multicast[cl->nummulticast++] = *ref;
+	cl->multicastbits += ref->numbits;
+	ref->chunk->refcount++;
+	sv_mc.bytesreferenced += BitByte( ref->numbits );
+}
+
+/*
+=============
+SV_WriteDatagram
+
+direct write into client datagram,
+pending references must go first
+=============
+*/
+void SV_WriteDatagram( sv_client_t *cl, sizebuf_t *msg )
+{
+	if( cl->nummulticast )
+		SV_FlushMulticast( cl, &cl->datagram );
+
+	BF_WriteBits( &cl->datagram, BF_GetData( msg ), BF_GetNumBitsWritten( msg ));
+}
+
+/*
+=============
+SV_ClearDatagram
+
+throw away everything queued for client
+=============
+*/
+void SV_ClearDatagram( sv_client_t *cl )
+{
+	int	i;
+
+	for( i = 0; i < cl->nummulticast; i++ )
+		SV_ReleaseChunk( cl->multicast[i].chunk );
+
+	cl->nummulticast = 0;
+	cl->multicastbits = 0;
+	BF_Clear( &cl->datagram );
+}
+
+/*
+=============
+SV_FreeMulticast
+
+called on server shutdown,
+client references are freed with svs.clients
+=============
+*/
+void SV_FreeMulticast( void )
+{
+	mcchunk_t	*chunk, *next;
+
+	for( chunk = sv_mc.chain; chunk; chunk = next )
+	{
+		next = chunk->chain;
+		Mem_Free( chunk );
+	}
+
+	Q_memset( &sv_mc, 0, sizeof( sv_mc ));
+}
+
+/*
+=============
+SV_MulticastInfo_f
+=============
+*/
+void SV_MulticastInfo_f( void )
+{
+	Msg( "%i chunks, %s allocated\n", sv_mc.numchunks, Q_memprint( sv_mc.numchunks * sizeof( mcchunk_t )));
+	Msg( "%s stored, %s referenced by clients\n", Q_memprint( sv_mc.bytesstored ), Q_memprint( sv_mc.bytesreferenced ));
+	if( sv_mc.fallbacks ) Msg( "^1arena was full %i times^7\n", sv_mc.fallbacks );
+}
@@ -1669,6 +1669,15 @@ void SV_Physics_None( edict_t *ent )
 	SV_RunThink( ent );
 }
 
+static struct
+{
+	int	frames;		// frames left to measure
+	int	numframes[2];
+	double	time[2];		// entity loop time without and with skipping
+	int	visited[2];
+	int	skipped;
+} sv_thinkbench;
+
 //============================================================================
 static void SV_Physics_Entity( edict_t *ent )
 {
@@ -1733,6 +1742,83 @@ static void SV_Physics_Entity( edict_t *ent )
 		SV_FreeEdict( ent );
 }
 
+/*
+================
+SV_EntityIsIdle
+
+SV_Physics_Entity would do nothing with this
+entity: it doesn't move and doesn't think this frame.
+Fields are read at visit time, so entities woken up
+by others earlier in the frame still run in order
+================
+*/
+_inline qboolean SV_EntityIsIdle( edict_t *ent )
+{
+	if( ent->v.flags & ( FL_ONGROUND|FL_BASEVELOCITY|FL_KILLME ))
+		return false;
+
+	if( !VectorIsNull( ent->v.basevelocity ))
+		return false;
+
+	switch( ent->v.movetype )
+	{
+	case MOVETYPE_NONE:
+		// same test as SV_RunThink
+		return ( ent->v.nextthink <= 0.0f || ent->v.nextthink > sv.time + host.frametime );
+	case MOVETYPE_PUSH:
+		// SV_Physics_Pusher gets zero movetime and doesn't think
+		return ( ent->v.nextthink <= ent->v.ltime && VectorIsNull( ent->v.velocity ) && VectorIsNull( ent->v.avelocity ));
+	}
+
+	return false;
+}
+
+/*
+================
+SV_ThinkBench_f
+
+time the entity loop of next frames, idle
+entities are skipped on even frames only
+================
+*/
+void SV_ThinkBench_f( void )
+{
+	if( sv.state != ss_active )
+	{
+		Msg( "thinkbench: server is not active\n" );
+		return;
+	}
+
+	Q_memset( &sv_thinkbench, 0, sizeof( sv_thinkbench ));
+	sv_thinkbench.frames = ( Cmd_Argc() > 1 ) ? Q_atoi( Cmd_Argv( 1 )) : 200;
+	sv_thinkbench.frames = bound( 2, sv_thinkbench.frames, 100000 ) & ~1;
+	Msg( "thinkbench: measuring %i frames\n", sv_thinkbench.frames );
+}
+
+/*
+================
+SV_ThinkBenchFrame
+
+collect one frame, print results after last
+================
+*/
+static void SV_ThinkBenchFrame( double time, int skipidle, int visited, int skipped )
+{
+	sv_thinkbench.time[skipidle] += time;
+	sv_thinkbench.visited[skipidle] += visited;
+	sv_thinkbench.skipped += skipped;
+
+	if( --sv_thinkbench.frames > 0 )
+		return;
+
+	Msg( "%i entities, %.1f%% idle\n", svgame.numEntities, sv_thinkbench.skipped * 100.0 / max( sv_thinkbench.visited[1], 1 ));
+	Msg( "all entities: %.3f ms per frame\n", sv_thinkbench.time[0] * 1000.0 / max( sv_thinkbench.numframes[0], 1 ));
+
+	if( sv_thinkbench.numframes[1] )
+		Msg( "skip idle: %.3f ms per frame\n", sv_thinkbench.time[1] * 1000.0 / sv_thinkbench.numframes[1] );
+	else Msg( "idle entities were not skipped (sv_skipidle is 0 or game dll runs own physics)\n" );
+}
+
 /*
 ================
 SV_Physics
@@ -1742,15 +1828,31 @@ SV_Physics
 void SV_Physics( void )
 {
 	edict_t	*ent;
-	int    	i;
+	int    	i, visited = 0, skipped = 0;
+	qboolean	skipidle;
+	double	start = 0.0;
 	
 	SV_CheckAllEnts ();
 
 	svgame.globals->time = sv.time;
 
+	// catch up with string fields and boxes changed during last frame
+	SV_UpdateEntityIndex();
+	SV_UpdateSpatialIndex();
+
 	// let the progs know that a new frame has started
 	svgame.dllFuncs.pfnStartFrame();
 
+	// dll physics and retouch must see every entity
+	skipidle = sv_skipidle->integer && !svgame.physFuncs.SV_PhysicsEntity && svgame.globals->force_retouch == 0.0f;
+
+	if( sv_thinkbench.frames > 0 )
+	{
+		skipidle = skipidle && !( sv_thinkbench.frames & 1 );
+		sv_thinkbench.numframes[skipidle]++;
+		start = Sys_DoubleTime();
+	}
+
 	// treat each object in turn
 	for( i = 0; i < svgame.numEntities; i++ )
 	{
@@ -1762,9 +1864,20 @@ void SV_Physics( void )
 		if( i > 0 && i <= svgame.globals->maxClients )
                    		continue;
 
+		visited++;
+
+		if( skipidle && SV_EntityIsIdle( ent ))
+		{
+			skipped++;
+			continue;
+		}
+
 		SV_Physics_Entity( ent );
 	}
 
+	if( sv_thinkbench.frames > 0 )
+		SV_ThinkBenchFrame( Sys_DoubleTime() - start, skipidle, visited, skipped );
+
 	if( svgame.physFuncs.SV_EndFrame != NULL )
 		svgame.physFuncs.SV_EndFrame();
 
@@ -1953,6 +2066,8 @@ static server_physics_api_t gPhysicsAPI =
 	GL_TextureData,
 	pfnMem_Alloc,
 	pfnMem_Free,
+	SV_EntitiesInSphere,
+	SV_EntitiesInBox,
 };
 
 /*
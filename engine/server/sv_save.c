@@ -30,10 +30,14 @@ half-life implementation of saverestore system
 #define SAVEFILE_HEADER		(('V'<<24)+('L'<<16)+('A'<<8)+'V')	// little-endian "VALV"
 #define SAVEGAME_HEADER		(('V'<<24)+('A'<<16)+('S'<<8)+'J')	// little-endian "JSAV"
 #define SAVEGAME_VERSION		0x0065				// Version 0.65
+#define SAVEGAME_VERSION_LZ		0x0066				// 0.65 layout packed into blocks
 #define CLIENT_SAVEGAME_VERSION	0x0068				// Version 0.68
 
 #define SAVE_AGED_COUNT		1
 #define SAVENAME_LENGTH		128				// matches with MAX_OSPATH
+#define SAVE_BLOCK_SIZE		(256 * 1024)			// unpacked size of compressed block
+#define SAVE_COPY_SIZE		(64 * 1024)
+#define MAX_LEVEL_STATES		16				// upper limit for sv_levelcache
 
 #define LUMP_DECALS_OFFSET		0
 #define LUMP_STATIC_OFFSET		1
@@ -102,6 +106,55 @@ typedef struct
 	float	time;
 } SAVE_LIGHTSTYLE;
 
+// savegame which is packed and written by background thread
+typedef struct
+{
+	string		name;		// e.g. save/quick.sav
+	string		tempname;		// renamed to name when completed
+	file_t		*file;		// opened on the main thread
+	byte		*data;		// everything after the version tag
+	int		size;
+	byte		*packed;		// block compression buffer
+	qboolean		compress;
+	qboolean		rawfile;		// level state image, written as is
+	systhread_t	*thread;
+	volatile qboolean	done;
+	qboolean		failed;
+	int		written;		// file size
+	double		writeTime;	// measured by the writer
+} savejob_t;
+
+// reads both plain and compressed savegames
+typedef struct
+{
+	file_t		*file;
+	int		ident;
+	int		version;
+	byte		*block;		// unpacked block
+	byte		*packed;
+	int		blocksize;
+	int		blockpos;
+} savefile_t;
+
+// image of save/<map>.hl1 for recently visited level,
+// disk copy is written behind by the save writer
+typedef struct
+{
+	string		name;		// map name
+	byte		*data;
+	int		size;
+	int		lastUsed;
+} levelstate_t;
+
+static savejob_t	*sv_savejob;
+static int	sv_lastsavesize;		// for benchmark
+static double	sv_lastsavetime;
+
+static levelstate_t	sv_levelstates[MAX_LEVEL_STATES];
+static int	sv_levelsequence;
+static int	sv_levelhits;		// for changelevel report
+static int	sv_levelmisses;
+
 static TYPEDESCRIPTION gGameHeader[] =
 {
 	DEFINE_ARRAY( GAME_HEADER, mapName, FIELD_CHARACTER, 32 ),
@@ -572,11 +625,103 @@ void RestoreSound( soundlist_t *entry )
 	BF_WriteBytes( &sv.signon, &entry->forcedEnd, sizeof( entry->forcedEnd ));
 }
 
+/*
+=============
+SV_FindLevelState
+
+returns cached image of save/<level>.hl1
+=============
+*/
+static levelstate_t *SV_FindLevelState( const char *level )
+{
+	int	i;
+
+	for( i = 0; i < MAX_LEVEL_STATES; i++ )
+	{
+		if( sv_levelstates[i].data && !Q_stricmp( sv_levelstates[i].name, level ))
+		{
+			sv_levelstates[i].lastUsed = ++sv_levelsequence;
+			return &sv_levelstates[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void SV_FreeLevelState( levelstate_t *state )
+{
+	if( state->data ) Mem_Free( state->data );
+	Q_memset( state, 0, sizeof( *state ));
+}
+
+/*
+=============
+SV_StoreLevelState
+
+keep level image in memory, cache owns the data from now.
+Least recently used levels are dropped, they are on disk anyway
+=============
+*/
+static void SV_StoreLevelState( const char *level, byte *data, int size )
+{
+	levelstate_t	*state, *oldest = NULL;
+	int		i, count = 0, limit;
+
+	limit = bound( 0, sv_levelcache->integer, MAX_LEVEL_STATES );
+
+	if(( state = SV_FindLevelState( level )) != NULL )
+		SV_FreeLevelState( state );
+
+	if( !limit )
+	{
+		Mem_Free( data );
+		return;
+	}
+
+	for( i = 0; i < MAX_LEVEL_STATES; i++ )
+	{
+		if( !sv_levelstates[i].data )
+		{
+			if( !state ) state = &sv_levelstates[i];
+			continue;
+		}
+
+		if( !oldest || sv_levelstates[i].lastUsed < oldest->lastUsed )
+			oldest = &sv_levelstates[i];
+		count++;
+	}
+
+	// drop old levels when limit was changed or reached
+	while( count >= limit && oldest )
+	{
+		if( !state ) state = oldest;
+		SV_FreeLevelState( oldest );
+		count--;
+
+		for( oldest = NULL, i = 0; i < MAX_LEVEL_STATES; i++ )
+		{
+			if( sv_levelstates[i].data && ( !oldest || sv_levelstates[i].lastUsed < oldest->lastUsed ))
+				oldest = &sv_levelstates[i];
+		}
+	}
+
+	Q_strncpy( state->name, level, sizeof( state->name ));
+	state->data = data;
+	state->size = size;
+	state->lastUsed = ++sv_levelsequence;
+}
+
 void SV_ClearSaveDir( void )
 {
 	search_t	*t;
 	int	i;
 
+	// level files may be still written
+	SV_FlushSaves();
+
+	for( i = 0; i < MAX_LEVEL_STATES; i++ )
+		SV_FreeLevelState( &sv_levelstates[i] );
+
 	// just delete all HL? files
 	t = FS_Search( "save/*.hl?", true, true );	// lookup only in gamedir
 	if( !t ) return; // already empty
@@ -701,50 +846,424 @@ void SV_AgeSaveList( const char *pName, int count )
 	}
 }
 
-void SV_DirectoryCopy( const char *pPath, file_t *pFile )
+/*
+=============
+SaveFile_Open
+
+open savegame and read its header, caller
+should check the version before reading
+=============
+*/
+static qboolean SaveFile_Open( savefile_t *pFile, const char *name )
 {
-	search_t	*t;
-	file_t	*pCopy;
-	int	i, fileSize;
-	char	szName[SAVENAME_LENGTH];
+	Q_memset( pFile, 0, sizeof( *pFile ));
 
-	t = FS_Search( pPath, true, true );
-	if( !t ) return;
+	pFile->file = FS_Open( name, "rb", true );
+	if( !pFile->file ) return false;
 
-	for( i = 0; i < t->numfilenames; i++ )
+	FS_Read( pFile->file, &pFile->ident, sizeof( int ));
+	FS_Read( pFile->file, &pFile->version, sizeof( int ));
+
+	if( pFile->ident == SAVEGAME_HEADER && pFile->version == SAVEGAME_VERSION_LZ )
 	{
-		Q_memset( szName, 0, SAVENAME_LENGTH );
-		fileSize = FS_FileSize( t->filenames[i], true );
-		pCopy = FS_Open( t->filenames[i], "rb", true );
+		pFile->block = Mem_Alloc( host.mempool, SAVE_BLOCK_SIZE );
+		pFile->packed = Mem_Alloc( host.mempool, LZ_CompressBound( SAVE_BLOCK_SIZE ));
+	}
+
+	return true;
+}
+
+/*
+=============
+SaveFile_Supported
+=============
+*/
+static qboolean SaveFile_Supported( savefile_t *pFile )
+{
+	if( pFile->ident != SAVEGAME_HEADER )
+		return false;
+	return ( pFile->version == SAVEGAME_VERSION || pFile->version == SAVEGAME_VERSION_LZ );
+}
+
+/*
+=============
+SaveFile_ReadBlock
+
+unpack next block of compressed savegame
+=============
+*/
+static qboolean SaveFile_ReadBlock( savefile_t *pFile )
+{
+	int	rawSize = 0, packedSize = 0;
+
+	pFile->blocksize = pFile->blockpos = 0;
+
+	FS_Read( pFile->file, &rawSize, sizeof( int ));
+	FS_Read( pFile->file, &packedSize, sizeof( int ));
+
+	if( rawSize <= 0 ) return false; // end of file
+
+	if( rawSize > SAVE_BLOCK_SIZE || packedSize <= 0 || packedSize > LZ_CompressBound( SAVE_BLOCK_SIZE ))
+	{
+		MsgDev( D_ERROR, "SaveFile_ReadBlock: bad block size %i (%i)\n", rawSize, packedSize );
+		return false;
+	}
+
+	if( packedSize == rawSize )
+	{
+		// stored without compression
+		if( FS_Read( pFile->file, pFile->block, rawSize ) != rawSize )
+			return false;
+	}
+	else
+	{
+		if( FS_Read( pFile->file, pFile->packed, packedSize ) != packedSize )
+			return false;
+
+		if( LZ_Decompress( pFile->packed, packedSize, pFile->block, rawSize ) != rawSize )
+		{
+			MsgDev( D_ERROR, "SaveFile_ReadBlock: corrupted block\n" );
+			return false;
+		}
+	}
+
+	pFile->blocksize = rawSize;
+	return true;
+}
+
+/*
+=============
+SaveFile_Read
+
+read data that follows the version tag,
+returns number of bytes read
+=============
+*/
+static int SaveFile_Read( savefile_t *pFile, void *buffer, int size )
+{
+	byte	*out = buffer;
+	int	count, total = 0;
+
+	if( !pFile->block )
+		return FS_Read( pFile->file, buffer, size );
+
+	while( total < size )
+	{
+		if( pFile->blockpos == pFile->blocksize && !SaveFile_ReadBlock( pFile ))
+			break;
+
+		count = min( size - total, pFile->blocksize - pFile->blockpos );
+		Q_memcpy( out + total, pFile->block + pFile->blockpos, count );
+		pFile->blockpos += count;
+		total += count;
+	}
+
+	return total;
+}
+
+/*
+=============
+SaveFile_Close
+=============
+*/
+static void SaveFile_Close( savefile_t *pFile )
+{
+	if( pFile->file ) FS_Close( pFile->file );
+	if( pFile->block ) Mem_Free( pFile->block );
+	if( pFile->packed ) Mem_Free( pFile->packed );
+	Q_memset( pFile, 0, sizeof( *pFile ));
+}
+
+/*
+=============
+SV_SaveWriterThread
+
+pack and write the snapshot, runs without
+touching any engine state except the job
+=============
+*/
+static void SV_SaveWriterThread( void *data )
+{
+	savejob_t	*job = (savejob_t *)data;
+	double	start = Sys_DoubleTime();
+	int	tag, pos, rawSize, packedSize;
+	int	written = 0, expected = 0;
+
+	if( !job->rawfile )
+	{
+		tag = SAVEGAME_HEADER;
+		written += FS_Write( job->file, &tag, sizeof( int ));
+		tag = job->compress ? SAVEGAME_VERSION_LZ : SAVEGAME_VERSION;
+		written += FS_Write( job->file, &tag, sizeof( int ));
+		expected += sizeof( int ) * 2;
+	}
+
+	if( job->compress )
+	{
+		for( pos = 0; pos < job->size; pos += rawSize )
+		{
+			rawSize = min( job->size - pos, SAVE_BLOCK_SIZE );
+			packedSize = LZ_Compress( job->data + pos, rawSize, job->packed, LZ_CompressBound( SAVE_BLOCK_SIZE ));
+
+			// keep the block as is if it doesn't compress
+			if( packedSize <= 0 || packedSize >= rawSize )
+				packedSize = rawSize;
+
+			written += FS_Write( job->file, &rawSize, sizeof( int ));
+			written += FS_Write( job->file, &packedSize, sizeof( int ));
+			written += FS_Write( job->file, ( packedSize == rawSize ) ? job->data + pos : job->packed, packedSize );
+			expected += sizeof( int ) * 2 + packedSize;
+		}
+
+		// end of blocks
+		rawSize = packedSize = 0;
+		written += FS_Write( job->file, &rawSize, sizeof( int ));
+		written += FS_Write( job->file, &packedSize, sizeof( int ));
+		expected += sizeof( int ) * 2;
+	}
+	else
+	{
+		written += FS_Write( job->file, job->data, job->size );
+		expected += job->size;
+	}
+
+	job->failed = ( written != expected );
+	job->written = written;
+	job->writeTime = Sys_DoubleTime() - start;
+	job->done = true;
+}
+
+/*
+=============
+SV_FinishSave
+
+close and rename the written savegame,
+wait for the writer if it is still working
+=============
+*/
+static void SV_FinishSave( qboolean wait )
+{
+	savejob_t	*job = sv_savejob;
+
+	if( !job ) return;
+	if( !job->done && !wait ) return;
+
+	Sys_WaitForThread( job->thread );
+	FS_Close( job->file );
+
+	// old save stays in place until the new one replaces it
+	if( !job->failed )
+		job->failed = !FS_Replace( job->tempname, job->name );
+
+	if( job->failed )
+	{
+		MsgDev( D_ERROR, "SV_SaveGame: couldn't write %s\n", job->name );
+		FS_Delete( job->tempname );
+	}
+	else MsgDev( D_NOTE, "SV_SaveGame: %s written, %s in %.1f ms\n", job->name, Q_memprint( job->written ), job->writeTime * 1000.0 );
+
+	if( !job->rawfile )
+	{
+		sv_lastsavesize = job->written;
+		sv_lastsavetime = job->writeTime;
+	}
+
+	if( job->packed ) Mem_Free( job->packed );
+	Mem_Free( job->data );
+	Mem_Free( job );
+	sv_savejob = NULL;
+}
+
+/*
+=============
+SV_UpdateSaves
+
+called each frame to complete background saves
+=============
+*/
+void SV_UpdateSaves( void )
+{
+	SV_FinishSave( false );
+}
+
+/*
+=============
+SV_FlushSaves
+
+must be called before anything reads or
+renames the savegames
+=============
+*/
+void SV_FlushSaves( void )
+{
+	SV_FinishSave( true );
+}
+
+/*
+=============
+SV_WriteSaveFile
+
+hand the snapshot over to the writer thread,
+job owns the data from now. Raw files are
+written without savegame header and packing
+=============
+*/
+static qboolean SV_WriteSaveFile( const char *name, byte *data, int size, qboolean rawfile )
+{
+	savejob_t	*job;
+
+	SV_FlushSaves(); // one save at time
+
+	job = Mem_Alloc( host.mempool, sizeof( savejob_t ));
+	Q_strncpy( job->name, name, sizeof( job->name ));
+	Q_snprintf( job->tempname, sizeof( job->tempname ), "%s.tmp", name );
+	job->data = data;
+	job->size = size;
+	job->compress = ( sv_save_compress->integer && !rawfile ) ? true : false;
+	job->rawfile = rawfile;
+
+	job->file = FS_Open( job->tempname, "wb", true );
+
+	if( !job->file )
+	{
+		MsgDev( D_ERROR, "SV_SaveGame: couldn't create %s\n", job->tempname );
+		Mem_Free( job->data );
+		Mem_Free( job );
+		return false;
+	}
+
+	if( job->compress )
+		job->packed = Mem_Alloc( host.mempool, LZ_CompressBound( SAVE_BLOCK_SIZE ));
+
+	sv_savejob = job;
+
+	if( sv_save_async->integer )
+		job->thread = Sys_CreateThread( SV_SaveWriterThread, job );
+
+	if( !job->thread )
+	{
+		// write it right now
+		SV_SaveWriterThread( job );
+		SV_FlushSaves();
+	}
+
+	return true;
+}
+
+/*
+=============
+SV_DirectoryLevelState
+
+level file which is also kept in memory
+=============
+*/
+static levelstate_t *SV_DirectoryLevelState( const char *filename )
+{
+	string	level;
+
+	if( Q_stricmp( FS_FileExtension( filename ), "hl1" ))
+		return NULL;
+
+	FS_FileBase( filename, level );
+	return SV_FindLevelState( level );
+}
+
+/*
+=============
+SV_DirectorySize
+
+size of level files with their directory entries
+=============
+*/
+static int SV_DirectorySize( search_t *t )
+{
+	levelstate_t	*state;
+	int		i, size = 0;
+
+	for( i = 0; t && i < t->numfilenames; i++ )
+	{
+		size += SAVENAME_LENGTH + sizeof( int );
+
+		if(( state = SV_DirectoryLevelState( t->filenames[i] )) != NULL )
+			size += state->size;
+		else size += FS_FileSize( t->filenames[i], true );
+	}
+	return size;
+}
+
+/*
+=============
+SV_DirectoryCopy
+
+put level files into savegame snapshot,
+returns pointer behind the last file
+=============
+*/
+static byte *SV_DirectoryCopy( search_t *t, byte *out )
+{
+	levelstate_t	*state;
+	file_t		*pCopy;
+	int		i, fileSize;
+
+	for( i = 0; t && i < t->numfilenames; i++ )
+	{
+		state = SV_DirectoryLevelState( t->filenames[i] );
+		fileSize = state ? state->size : FS_FileSize( t->filenames[i], true );
 
 		// filename can only be as long as a map name + extension
-		Q_strncpy( szName, FS_FileWithoutPath( t->filenames[i] ), SAVENAME_LENGTH );		
-		FS_Write( pFile, szName, SAVENAME_LENGTH );
-		FS_Write( pFile, &fileSize, sizeof( int ));
-		FS_FileCopy( pFile, pCopy, fileSize );
-		FS_Close( pCopy );
+		Q_memset( out, 0, SAVENAME_LENGTH );
+		Q_strncpy( (char *)out, FS_FileWithoutPath( t->filenames[i] ), SAVENAME_LENGTH );
+		out += SAVENAME_LENGTH;
+		Q_memcpy( out, &fileSize, sizeof( int ));
+		out += sizeof( int );
+
+		if( state )
+		{
+			// same contents as on disk
+			Q_memcpy( out, state->data, fileSize );
+			out += fileSize;
+			continue;
+		}
+
+		pCopy = FS_Open( t->filenames[i], "rb", true );
+		if( !pCopy || FS_Read( pCopy, out, fileSize ) != fileSize )
+			MsgDev( D_ERROR, "SV_DirectoryCopy: couldn't read %s\n", t->filenames[i] );
+		if( pCopy ) FS_Close( pCopy );
+		out += fileSize;
 	}
 
-	Mem_Free( t );
+	return out;
 }
 
-void SV_DirectoryExtract( file_t *pFile, int fileCount )
+void SV_DirectoryExtract( savefile_t *pFile, int fileCount )
 {
 	char	szName[SAVENAME_LENGTH], fileName[SAVENAME_LENGTH];
-	int	i, fileSize;
+	int	i, fileSize, size;
 	file_t	*pCopy;
+	byte	*buffer;
+
+	buffer = Mem_Alloc( host.mempool, SAVE_COPY_SIZE );
 
 	for( i = 0; i < fileCount; i++ )
 	{
 		// filename can only be as long as a map name + extension
-		FS_Read( pFile, fileName, SAVENAME_LENGTH );
-		FS_Read( pFile, &fileSize, sizeof( int ));
+		SaveFile_Read( pFile, fileName, SAVENAME_LENGTH );
+		SaveFile_Read( pFile, &fileSize, sizeof( int ));
+		fileName[SAVENAME_LENGTH - 1] = '\0';
 		Q_snprintf( szName, sizeof( szName ), "save/%s", fileName );
 
 		pCopy = FS_Open( szName, "wb", true );
-		FS_FileCopy( pCopy, pFile, fileSize );
-		FS_Close( pCopy );
+
+		for( ; fileSize > 0; fileSize -= size )
+		{
+			size = SaveFile_Read( pFile, buffer, min( fileSize, SAVE_COPY_SIZE ));
+			if( size <= 0 ) break; // truncated
+			if( pCopy ) FS_Write( pCopy, buffer, size );
+		}
+		if( pCopy ) FS_Close( pCopy );
 	}
+
+	Mem_Free( buffer );
 }
 
 void SV_SaveFinish( SAVERESTOREDATA *pSaveData )
@@ -869,41 +1388,69 @@ void SV_SaveGameStateGlobals( SAVERESTOREDATA *pSaveData )
 SAVERESTOREDATA *SV_LoadSaveData( const char *level )
 {
 	string			name;
-	file_t			*pFile;
+	levelstate_t		*state;
 	SaveFileSectionsInfo_t	sectionsInfo;
 	SAVERESTOREDATA		*pSaveData;
 	char			*pszTokenList;
 	int			i, id, size, version;
+	byte			*data;
+	fs_offset_t		fileSize;
 	
 	Q_snprintf( name, sizeof( name ), "save/%s.hl1", level );
-	MsgDev( D_INFO, "Loading game from %s...\n", name );
 
-	pFile = FS_Open( name, "rb", true );
-	if( !pFile )
+	if(( state = SV_FindLevelState( level )) != NULL )
+	{
+		MsgDev( D_INFO, "Loading game from %s (cached)...\n", name );
+		data = state->data;
+		fileSize = state->size;
+		sv_levelhits++;
+	}
+	else
+	{
+		MsgDev( D_INFO, "Loading game from %s...\n", name );
+
+		SV_FlushSaves(); // file may be still written
+		data = FS_LoadFile( name, &fileSize, true );
+		if( !data )
+		{
+			MsgDev( D_INFO, "ERROR: couldn't open.\n" );
+			return NULL;
+		}
+
+		// next visit of this level will use the memory copy
+		if( sv_levelcache->integer > 0 )
+		{
+			SV_StoreLevelState( level, data, fileSize );
+			state = SV_FindLevelState( level );
+		}
+		sv_levelmisses++;
+	}
+
+	if( fileSize < sizeof( int ) * 2 + sizeof( sectionsInfo ))
 	{
-		MsgDev( D_INFO, "ERROR: couldn't open.\n" );
+		if( !state ) Mem_Free( data );
 		return NULL;
 	}
 
 	// Read the header
-	FS_Read( pFile, &id, sizeof( int ));
-	FS_Read( pFile, &version, sizeof( int ));
+	Q_memcpy( &id, data, sizeof( int ));
+	Q_memcpy( &version, data + sizeof( int ), sizeof( int ));
+	Q_memcpy( &sectionsInfo, data + sizeof( int ) * 2, sizeof( sectionsInfo ));
+	size = fileSize - sizeof( int ) * 2 - sizeof( sectionsInfo );
 
 	// is this a valid save?
-	if( id != SAVEFILE_HEADER || version != SAVEGAME_VERSION )
+	if( id != SAVEFILE_HEADER || version != SAVEGAME_VERSION || SumBytes( &sectionsInfo ) < 0 || SumBytes( &sectionsInfo ) > size )
 	{
-		FS_Close( pFile );
+		if( !state ) Mem_Free( data );
 		return NULL;
 	}
 
 	// Read the sections info and the data
-	FS_Read( pFile, &sectionsInfo, sizeof( sectionsInfo ));
-
 	pSaveData = Mem_Alloc( host.mempool, sizeof(SAVERESTOREDATA) + SumBytes( &sectionsInfo ));
 	Q_strncpy( pSaveData->szCurrentMapName, level, sizeof( pSaveData->szCurrentMapName ));
 	
-	FS_Read( pFile, (char *)(pSaveData + 1), SumBytes( &sectionsInfo ));
-	FS_Close( pFile );
+	Q_memcpy( (char *)(pSaveData + 1), data + sizeof( int ) * 2 + sizeof( sectionsInfo ), SumBytes( &sectionsInfo ));
+	if( !state ) Mem_Free( data ); // cache is disabled
 	
 	// Parse the symbol table
 	pszTokenList = (char *)(pSaveData + 1);	// Skip past the CSaveRestoreData structure
@@ -1441,9 +1988,11 @@ SAVERESTOREDATA *SV_SaveGameState( void )
 	SaveFileSections_t		sections;
 	SAVERESTOREDATA		*pSaveData;
 	ENTITYTABLE		*pTable;
-	file_t			*pFile;
+	levelstate_t		*state;
+	string			name;
 	int			i, numents;
-	int			id, version;
+	int			id, version, size;
+	byte			*data, *out;
 
 	pSaveData = SV_SaveInit( 0 );
 
@@ -1502,21 +2051,42 @@ SAVERESTOREDATA *SV_SaveGameState( void )
 	id = SAVEFILE_HEADER;
 	version = SAVEGAME_VERSION;
 
-	// output to disk
-	pFile = FS_Open( va( "save/%s.hl1", sv.name ), "wb", true );
-	if( !pFile ) return NULL;
+	// build the file image
+	size = sizeof( int ) * 2 + sizeof( sectionsInfo ) + SumBytes( &sectionsInfo );
+	out = data = Mem_Alloc( host.mempool, size );
 
 	// write the header
-	FS_Write( pFile, &id, sizeof( int ));
-	FS_Write( pFile, &version, sizeof( int ));
+	Q_memcpy( out, &id, sizeof( int ));
+	out += sizeof( int );
+	Q_memcpy( out, &version, sizeof( int ));
+	out += sizeof( int );
 
 	// Write out the tokens and table FIRST so they are loaded in the right order,
 	// then write out the rest of the data in the file.
-	FS_Write( pFile, &sectionsInfo, sizeof( sectionsInfo ));
-	FS_Write( pFile, sections.pSymbols, sectionsInfo.nBytesSymbols );
-	FS_Write( pFile, sections.pDataHeaders, sectionsInfo.nBytesDataHeaders );
-	FS_Write( pFile, sections.pData, sectionsInfo.nBytesData );
-	FS_Close( pFile );
+	Q_memcpy( out, &sectionsInfo, sizeof( sectionsInfo ));
+	out += sizeof( sectionsInfo );
+	Q_memcpy( out, sections.pSymbols, sectionsInfo.nBytesSymbols );
+	out += sectionsInfo.nBytesSymbols;
+	Q_memcpy( out, sections.pDataHeaders, sectionsInfo.nBytesDataHeaders );
+	out += sectionsInfo.nBytesDataHeaders;
+	Q_memcpy( out, sections.pData, sectionsInfo.nBytesData );
+
+	if( sv_levelcache->integer > 0 )
+	{
+		// next level restores it from memory, writer gets a copy
+		out = Mem_Alloc( host.mempool, size );
+		Q_memcpy( out, data, size );
+		SV_StoreLevelState( sv.name, out, size );
+	}
+	else if(( state = SV_FindLevelState( sv.name )) != NULL )
+	{
+		SV_FreeLevelState( state ); // cache was disabled
+	}
+
+	// output to disk in background
+	Q_snprintf( name, sizeof( name ), "save/%s.hl1", sv.name );
+	if( !SV_WriteSaveFile( name, data, size, true ))
+		return NULL;
 
 	SV_EntityPatchWrite( pSaveData, sv.name );
 
@@ -1911,6 +2481,7 @@ void SV_ChangeLevel( qboolean loadfromsavedgame, const char *mapname, const char
 	string		_startspot;
 	char		*startspot;
 	SAVERESTOREDATA	*pSaveData = NULL;
+	double		startTime, saveEnd, spawnEnd, restoreEnd;
 	
 	if( sv.state != ss_active )
 	{
@@ -1936,6 +2507,9 @@ void SV_ChangeLevel( qboolean loadfromsavedgame, const char *mapname, const char
 	sv.changelevel = true;	// NOTE: this is used to indicate changelevel for classic Quake changelevel
 				// because demos wan't properly update clock on a new level while recording
 
+	startTime = Sys_DoubleTime();
+	sv_levelhits = sv_levelmisses = 0;
+
 	if( loadfromsavedgame )
 	{
 		// smooth transition in-progress
@@ -1946,12 +2520,16 @@ void SV_ChangeLevel( qboolean loadfromsavedgame, const char *mapname, const char
 		sv.loadgame = true;
 	}
 
+	saveEnd = Sys_DoubleTime();
+
 	SV_InactivateClients ();
 	SV_DeactivateServer ();
 
 	if( !SV_SpawnServer( level, startspot ))
 		return;
 
+	spawnEnd = Sys_DoubleTime();
+
 	if( loadfromsavedgame )
 	{
 		// Finish saving gamestate
@@ -1967,21 +2545,41 @@ void SV_ChangeLevel( qboolean loadfromsavedgame, const char *mapname, const char
 		SV_LevelInit( level, NULL, NULL, false );
 	}
 
+	restoreEnd = Sys_DoubleTime();
+
 	SV_ActivateServer ();
+
+	MsgDev( D_INFO, "changelevel %s -> %s: save %.1f ms, spawn %.1f ms, restore %.1f ms, total %.1f ms, %i levels cached, %i loaded\n",
+		oldlevel, level, ( saveEnd - startTime ) * 1000.0, ( spawnEnd - saveEnd ) * 1000.0, ( restoreEnd - spawnEnd ) * 1000.0,
+		( Sys_DoubleTime() - startTime ) * 1000.0, sv_levelhits, sv_levelmisses );
 }
 
+/*
+=============
+SV_SaveGameSlot
+
+take a snapshot of game state and level files,
+the savegame is packed and written in background
+=============
+*/
 int SV_SaveGameSlot( const char *pSaveName, const char *pSaveComment )
 {
 	string		hlPath, name;
 	char		*pTokenData;
 	SAVERESTOREDATA	*pSaveData;
 	GAME_HEADER	gameHeader;
-	int		i, tag, tokenSize;
-	file_t		*pFile;
+	int		i, tag, tokenSize, size;
+	search_t		*t;
+	byte		*data, *out;
+
+	SV_FlushSaves();
 
 	pSaveData = SV_SaveGameState();
 	if( !pSaveData ) return 0;
 
+	// current level must be on disk to be listed
+	SV_FlushSaves();
+
 	Q_memset( &gameHeader, 0, sizeof( GAME_HEADER ) );
 
 	SV_SaveFinish( pSaveData );
@@ -2016,60 +2614,53 @@ int SV_SaveGameSlot( const char *pSaveName, const char *pSaveComment )
 	Q_snprintf( name, sizeof( name ), "save/%s.sav", pSaveName );
 	MsgDev( D_INFO, "Saving game to %s...\n", name );
 
-	Cbuf_AddText( va( "saveshot \"%s\"\n", pSaveName ));
-
-	// output to disk
 	if( !Q_stricmp( pSaveName, "quick" ) || !Q_stricmp( pSaveName, "autosave" ))
 		SV_AgeSaveList( pSaveName, SAVE_AGED_COUNT );
 
-	pFile = FS_Open( name, "wb", true );
+	// level files must be listed in the same order as they were counted
+	t = FS_Search( hlPath, true, true );
+	size = sizeof( int ) * 3 + tokenSize + SaveRestore_GetCurPos( pSaveData ) + SV_DirectorySize( t );
+	out = data = Mem_Alloc( host.mempool, size );
 
-	tag = SAVEGAME_HEADER;
-	FS_Write( pFile, &tag, sizeof( int ));
-	tag = SAVEGAME_VERSION;
-	FS_Write( pFile, &tag, sizeof( int ));
 	tag = SaveRestore_GetCurPos( pSaveData );
-	FS_Write( pFile, &tag, sizeof( int )); // does not include token table
+	Q_memcpy( out, &tag, sizeof( int )); // does not include token table
+	out += sizeof( int );
 
 	// write out the tokens first so we can load them before we load the entities
 	tag = pSaveData->tokenCount;
-	FS_Write( pFile, &tag, sizeof( int ));
-	FS_Write( pFile, &tokenSize, sizeof( int ));
-	FS_Write( pFile, pTokenData, tokenSize );
+	Q_memcpy( out, &tag, sizeof( int ));
+	out += sizeof( int );
+	Q_memcpy( out, &tokenSize, sizeof( int ));
+	out += sizeof( int );
+	Q_memcpy( out, pTokenData, tokenSize );
+	out += tokenSize;
 
 	// save gamestate
-	FS_Write( pFile, SaveRestore_GetBuffer( pSaveData ), SaveRestore_GetCurPos( pSaveData ));
+	Q_memcpy( out, SaveRestore_GetBuffer( pSaveData ), SaveRestore_GetCurPos( pSaveData ));
+	out += SaveRestore_GetCurPos( pSaveData );
 
-	SV_DirectoryCopy( hlPath, pFile );
-	FS_Close( pFile );
+	SV_DirectoryCopy( t, out );
+	if( t ) Mem_Free( t );
 	SV_SaveFinish( pSaveData );
 
-	return 1;
+	return SV_WriteSaveFile( name, data, size, false );
 }
 
-int SV_SaveReadHeader( file_t *pFile, GAME_HEADER *pHeader, int readGlobalState )
+int SV_SaveReadHeader( savefile_t *pFile, GAME_HEADER *pHeader, int readGlobalState )
 {
-	int		i, tag, size, tokenCount, tokenSize;
+	int		i, size, tokenCount, tokenSize;
 	char		*pszTokenList;
 	SAVERESTOREDATA	*pSaveData;
 
-	FS_Read( pFile, &tag, sizeof( int ));
-	if( tag != SAVEGAME_HEADER )
-	{
-		FS_Close( pFile );
+	if( !SaveFile_Supported( pFile ))
 		return 0;
-	}
-		
-	FS_Read( pFile, &tag, sizeof( int ));
-	if( tag != SAVEGAME_VERSION )
-	{
-		FS_Close( pFile );
-		return 0;
-	}
 
-	FS_Read( pFile, &size, sizeof( int ));
-	FS_Read( pFile, &tokenCount, sizeof( int ));
-	FS_Read( pFile, &tokenSize, sizeof( int ));
+	SaveFile_Read( pFile, &size, sizeof( int ));
+	SaveFile_Read( pFile, &tokenCount, sizeof( int ));
+	SaveFile_Read( pFile, &tokenSize, sizeof( int ));
+
+	if( size < 0 || tokenCount < 0 || tokenSize < 0 )
+		return 0;
 
 	pSaveData = Mem_Alloc( host.mempool, sizeof( SAVERESTOREDATA ) + tokenSize + size );
 	pSaveData->connectionCount = 0;
@@ -2077,7 +2668,7 @@ int SV_SaveReadHeader( file_t *pFile, GAME_HEADER *pHeader, int readGlobalState
 
 	if( tokenSize > 0 )
 	{
-		FS_Read( pFile, pszTokenList, tokenSize );
+		SaveFile_Read( pFile, pszTokenList, tokenSize );
 
 		SaveRestore_InitSymbolTable( pSaveData, (char **)Mem_Alloc( host.mempool, tokenCount * sizeof( char* )), tokenCount );
 
@@ -2102,7 +2693,7 @@ int SV_SaveReadHeader( file_t *pFile, GAME_HEADER *pHeader, int readGlobalState
 
 	// pszTokenList now points after token data
 	SaveRestore_Init( pSaveData, (char *)(pszTokenList), size );
-	FS_Read( pFile, SaveRestore_GetBuffer( pSaveData ), size );
+	SaveFile_Read( pFile, SaveRestore_GetBuffer( pSaveData ), size );
 
 	if( readGlobalState )
 		svgame.dllFuncs.pfnResetGlobalState();
@@ -2119,7 +2710,7 @@ int SV_SaveReadHeader( file_t *pFile, GAME_HEADER *pHeader, int readGlobalState
 
 qboolean SV_LoadGame( const char *pName )
 {
-	file_t		*pFile;
+	savefile_t	file;
 	qboolean		validload = false;
 	GAME_HEADER	gameHeader;
 	string		name;
@@ -2128,6 +2719,7 @@ qboolean SV_LoadGame( const char *pName )
 		return false;
 
 	Q_snprintf( name, sizeof( name ), "save/%s.sav", pName );
+	SV_FlushSaves();
 
 	// silently ignore if missed
 	if( !FS_FileExists( name, true ))
@@ -2149,16 +2741,14 @@ qboolean SV_LoadGame( const char *pName )
 	if( !svs.initialized ) SV_InitGame ();
 	if( !svs.initialized ) return false;
 
-	pFile = FS_Open( name, "rb", true );
-
-	if( pFile )
+	if( SaveFile_Open( &file, name ))
 	{
-		if( SV_SaveReadHeader( pFile, &gameHeader, 1 ))
+		if( SV_SaveReadHeader( &file, &gameHeader, 1 ))
 		{
-			SV_DirectoryExtract( pFile, gameHeader.mapCount );
+			SV_DirectoryExtract( &file, gameHeader.mapCount );
 			validload = true;
 		}
-		FS_Close( pFile );
+		SaveFile_Close( &file );
 	}
 	else MsgDev( D_ERROR, "File not found or failed to open.\n" );
 
@@ -2243,7 +2833,10 @@ void SV_SaveGame( const char *pName )
 	comment[0] = '\0';
 
 	SV_BuildSaveComment( comment, sizeof( comment ));
-	SV_SaveGameSlot( savename, comment );
+	if( !SV_SaveGameSlot( savename, comment ))
+		return;
+
+	Cbuf_AddText( va( "saveshot \"%s\"\n", savename ));
 
 	// HACKHACK: send usermessage from engine
 	if( Q_stricmp( pName, "autosave" ) && svgame.gmsgHudText != -1 )
@@ -2260,6 +2853,85 @@ void SV_SaveGame( const char *pName )
 	}
 }
 
+/*
+==================
+SV_SaveBench_f
+
+save current game with and without compression,
+time the main thread stall, background writing
+and reading the savegame back
+==================
+*/
+void SV_SaveBench_f( void )
+{
+	static const char	*modes[2] = { "plain", "compressed" };
+	int		i, j, count, oldCompress, oldAsync;
+	double		start, stall[2], write[2], read[2];
+	int		size[2];
+	GAME_HEADER	gameHeader;
+	savefile_t	file;
+	char		comment[80];
+	byte		*buffer;
+
+	if( Cmd_Argc() > 2 )
+	{
+		Msg( "Usage: savebench [count]\n" );
+		return;
+	}
+
+	if( !SV_IsValidSave( ))
+		return;
+
+	count = ( Cmd_Argc() == 2 ) ? bound( 1, Q_atoi( Cmd_Argv( 1 )), 100 ) : 5;
+	oldCompress = sv_save_compress->integer;
+	oldAsync = sv_save_async->integer;
+	buffer = Mem_Alloc( host.mempool, SAVE_COPY_SIZE );
+
+	SV_BuildSaveComment( comment, sizeof( comment ));
+	Cvar_SetFloat( "sv_save_async", 1.0f );
+
+	for( i = 0; i < 2; i++ )
+	{
+		Cvar_SetFloat( "sv_save_compress", (float)i );
+		stall[i] = write[i] = read[i] = 0.0;
+		size[i] = 0;
+
+		for( j = 0; j < count; j++ )
+		{
+			start = Sys_DoubleTime();
+			if( !SV_SaveGameSlot( "savebench", comment ))
+				break;
+			stall[i] += Sys_DoubleTime() - start;
+
+			SV_FlushSaves();
+			write[i] += sv_lastsavetime;
+			size[i] = sv_lastsavesize;
+
+			// read everything back without touching the game
+			start = Sys_DoubleTime();
+			if( SaveFile_Open( &file, "save/savebench.sav" ))
+			{
+				if( SV_SaveReadHeader( &file, &gameHeader, 0 ))
+					while( SaveFile_Read( &file, buffer, SAVE_COPY_SIZE ) > 0 );
+				SaveFile_Close( &file );
+			}
+			read[i] += Sys_DoubleTime() - start;
+		}
+	}
+
+	Cvar_SetFloat( "sv_save_compress", (float)oldCompress );
+	Cvar_SetFloat( "sv_save_async", (float)oldAsync );
+	FS_Delete( "save/savebench.sav" );
+	Mem_Free( buffer );
+
+	Msg( "savebench: %i saves of %s\n", count, sv.name );
+	for( i = 0; i < 2; i++ )
+	{
+		Msg( "%-10s %8s  stall %6.2f ms  write %6.2f ms  read %6.2f ms\n", modes[i], Q_memprint( size[i] ),
+			stall[i] * 1000.0 / count, write[i] * 1000.0 / count, read[i] * 1000.0 / count );
+	}
+}
+
 /* 
 ================== 
 SV_GetLatestSave
@@ -2269,11 +2941,14 @@ used for reload game after player death
 */
 const char *SV_GetLatestSave( void )
 {
-	search_t	*f = FS_Search( "save/*.sav", true, true );	// lookup only in gamedir
+	search_t	*f;
 	int	i, found = 0;
 	int	newest = 0, ft;
 	string	savename;	
 
+	SV_FlushSaves();
+
+	f = FS_Search( "save/*.sav", true, true );	// lookup only in gamedir
 	if( !f ) return NULL;
 
 	for( i = 0; i < f->numfilenames; i++ )
@@ -2305,75 +2980,76 @@ qboolean SV_GetComment( const char *savename, char *comment )
 	int	i, tag, size, nNumberOfFields, nFieldSize, tokenSize, tokenCount;
 	char	*pData, *pSaveData, *pFieldName, **pTokenList;
 	string	name, description;
-	file_t	*f;
+	savefile_t	file;
+	savefile_t	*f = &file;
 	short shortpool;
 
-	f = FS_Open( savename, "rb", true );
-	if( !f )
+	SV_FlushSaves();
+
+	if( !SaveFile_Open( f, savename ))
 	{
 		// just not exist - clear comment
 		Q_strncpy( comment, "", MAX_STRING );
 		return 0;
 	}
 
-	FS_Read( f, &tag, sizeof( int ));
-	if( tag != SAVEGAME_HEADER )
+	if( f->ident != SAVEGAME_HEADER )
 	{
 		// invalid header
 		Q_strncpy( comment, "<corrupted>", MAX_STRING );
-		FS_Close( f );
+		SaveFile_Close( f );
 		return 0;
 	}
-		
-	FS_Read( f, &tag, sizeof( int ));
+
+	tag = f->version;
 
 	if( tag == 0x0071 )
 	{
 		Q_strncpy( comment, "Gold Source <unsupported>", MAX_STRING );
-		FS_Close( f );
+		SaveFile_Close( f );
 		return 0;
 	}
 
 	if( tag < SAVEGAME_VERSION )
 	{
 		Q_strncpy( comment, "<old version>", MAX_STRING );
-		FS_Close( f );
+		SaveFile_Close( f );
 		return 0;
 	}
 
-	if( tag > SAVEGAME_VERSION )
+	if( !SaveFile_Supported( f ))
 	{
 		// old xash version ?
 		Q_strncpy( comment, "<unknown version>", MAX_STRING );
-		FS_Close( f );
+		SaveFile_Close( f );
 		return 0;
 	}
 
 	name[0] = '\0';
 	comment[0] = '\0';
 
-	FS_Read( f, &size, sizeof( int ));
-	FS_Read( f, &tokenCount, sizeof( int ));	// These two ints are the token list
-	FS_Read( f, &tokenSize, sizeof( int ));
-	size += tokenSize;
+	SaveFile_Read( f, &size, sizeof( int ));
+	SaveFile_Read( f, &tokenCount, sizeof( int ));	// These two ints are the token list
+	SaveFile_Read( f, &tokenSize, sizeof( int ));
 
 	// sanity check.
 	if( tokenCount < 0 || tokenCount > ( 1024 * 1024 * 32 ))
 	{
 		Q_strncpy( comment, "<corrupted>", MAX_STRING );
-		FS_Close( f );
+		SaveFile_Close( f );
 		return 0;
 	}
 
-	if( tokenSize < 0 || tokenSize > ( 1024 * 1024 * 32 ))
+	if( tokenSize < 0 || tokenSize > ( 1024 * 1024 * 32 ) || size < 0 )
 	{
 		Q_strncpy( comment, "<corrupted>", MAX_STRING );
-		FS_Close( f );
+		SaveFile_Close( f );
 		return 0;
 	}
+	size += tokenSize;
 
 	pSaveData = (char *)Mem_Alloc( host.mempool, size );
-	FS_Read( f, pSaveData, size );
+	SaveFile_Read( f, pSaveData, size );
 	pData = pSaveData;
 
 	// allocate a table for the strings, and parse the table
@@ -2403,7 +3079,7 @@ qboolean SV_GetComment( const char *savename, char *comment )
 		Q_strncpy( comment, "<missing GameHeader>", MAX_STRING );
 		if( pTokenList ) Mem_Free( pTokenList );
 		if( pSaveData ) Mem_Free( pSaveData );
-		FS_Close( f );
+		SaveFile_Close( f );
 		return 0;
 	}
 
@@ -2443,7 +3119,7 @@ qboolean SV_GetComment( const char *savename, char *comment )
 	// delete the string table we allocated
 	if( pTokenList ) Mem_Free( pTokenList );
 	if( pSaveData ) Mem_Free( pSaveData );
-	FS_Close( f );	
+	SaveFile_Close( f );	
 
 	if( Q_strlen( name ) > 0 && Q_strlen( description ) > 0 )
 	{
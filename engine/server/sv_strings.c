@@ -0,0 +1,249 @@
+/*
+sv_strings.c - interned engine strings
+Copyright (C) 2026 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "server.h"
+
+/*
+=============================================================================
+
+Every string is stored once in a fixed buffer, so equal strings share
+the same string_t and respawning entities don't use more memory. Each
+entry is { int next, uint hash, chars }, next is offset of the next
+entry in the same hash chain. Offset 0 is always an empty string.
+Pool is cleared between maps, as the game dll strings always were.
+
+=============================================================================
+*/
+
+#define STRINGPOOL_HASH_SIZE	8192	// must be power of two
+#define STRINGPOOL_ENTRY	( sizeof( int ) * 2 )
+
+_inline uint SV_HashString( const char *s, int *length )
+{
+	const byte	*p = (const byte *)s;
+	uint		hash = 2166136261U;
+
+	for( ; *p; p++ )
+		hash = ( hash ^ *p ) * 16777619U;
+
+	*length = (const char *)p - s;
+	return hash;
+}
+
+/*
+=============
+SV_InitStringPool
+=============
+*/
+void SV_InitStringPool( stringpool_t *pool, byte *mempool, int size )
+{
+	Q_memset( pool, 0, sizeof( *pool ));
+	pool->size = max( size, 4096 );
+	pool->base = Mem_Alloc( mempool, pool->size );
+	pool->buckets = Mem_Alloc( mempool, STRINGPOOL_HASH_SIZE * sizeof( int ));
+	SV_ClearStringPool( pool );
+}
+
+/*
+=============
+SV_FreeStringPool
+=============
+*/
+void SV_FreeStringPool( stringpool_t *pool )
+{
+	if( pool->base ) Mem_Free( pool->base );
+	if( pool->buckets ) Mem_Free( pool->buckets );
+	Q_memset( pool, 0, sizeof( *pool ));
+}
+
+/*
+=============
+SV_ClearStringPool
+
+forget all strings, buffer stays at the same address
+=============
+*/
+void SV_ClearStringPool( stringpool_t *pool )
+{
+	if( !pool->base ) return;
+
+	Q_memset( pool->buckets, 0, STRINGPOOL_HASH_SIZE * sizeof( int ));
+	pool->base[0] = '\0';
+	pool->used = sizeof( int ); // keep entries aligned
+	pool->numstrings = 0;
+	pool->requests = 0;
+	pool->overflows = 0;
+}
+
+/*
+=============
+SV_PoolString
+
+returns offset of the string in the pool
+or -1 if pool is full
+=============
+*/
+int SV_PoolString( stringpool_t *pool, const char *s )
+{
+	int	offset, length, entrysize;
+	uint	hash, bucket;
+
+	if( !s || !*s ) return 0;
+
+	pool->requests++;
+	hash = SV_HashString( s, &length );
+	bucket = hash & ( STRINGPOOL_HASH_SIZE - 1 );
+
+	for( offset = pool->buckets[bucket]; offset; )
+	{
+		char	*entry = pool->base + offset;
+		uint	entryhash;
+
+		Q_memcpy( &entryhash, entry + sizeof( int ), sizeof( uint ));
+
+		if( entryhash == hash && !Q_strcmp( entry + STRINGPOOL_ENTRY, s ))
+			return offset + STRINGPOOL_ENTRY;
+
+		Q_memcpy( &offset, entry, sizeof( int ));
+	}
+
+	entrysize = ( STRINGPOOL_ENTRY + length + 1 + 3 ) & ~3;
+
+	if( pool->used + entrysize > pool->size )
+	{
+		pool->overflows++;
+		return -1;
+	}
+
+	offset = pool->used;
+	Q_memcpy( pool->base + offset, &pool->buckets[bucket], sizeof( int ));
+	Q_memcpy( pool->base + offset + sizeof( int ), &hash, sizeof( uint ));
+	Q_memcpy( pool->base + offset + STRINGPOOL_ENTRY, s, length + 1 );
+
+	pool->buckets[bucket] = offset;
+	pool->used += entrysize;
+	pool->peak = max( pool->peak, pool->used );
+	pool->numstrings++;
+
+	return offset + STRINGPOOL_ENTRY;
+}
+
+/*
+=============
+SV_StringsInfo_f
+=============
+*/
+void SV_StringsInfo_f( void )
+{
+	stringpool_t	*pool = &svgame.strings;
+
+	if( !pool->base )
+	{
+		Msg( "string pool is not allocated\n" );
+		return;
+	}
+
+	Msg( "%s of %s used, peak %s\n", Q_memprint( pool->used ), Q_memprint( pool->size ), Q_memprint( pool->peak ));
+	Msg( "%i unique strings, %i requests since map start\n", pool->numstrings, pool->requests );
+	if( pool->overflows ) Msg( "^1%i strings didn't fit^7\n", pool->overflows );
+}
+
+/*
+=============
+SV_StringBenchSpawn
+
+strings which game dll allocates
+for typical entity on spawn
+=============
+*/
+static int SV_StringBenchSpawn( stringpool_t *pool, int map, int ent, size_t *requested )
+{
+	string	str;
+	int	i, failed = 0;
+
+	for( i = 0; i < 3; i++ )
+	{
+		switch( i )
+		{
+		case 0: Q_snprintf( str, sizeof( str ), "monster_class%02i", ent % 48 ); break;
+		case 1: Q_snprintf( str, sizeof( str ), "map%02i_target%03i", map, ent % 320 ); break;
+		case 2: Q_snprintf( str, sizeof( str ), "models/map%02i/prop%03i.mdl", map % 4, ent % 160 ); break;
+		}
+
+		*requested += Q_strlen( str ) + 1;
+		if( SV_PoolString( pool, str ) < 0 )
+			failed++;
+	}
+
+	return failed;
+}
+
+/*
+=============
+SV_StringBench_f
+
+simulate hours of server uptime: map cycle each 20 minutes,
+800 entities spawned on map start and 10 respawns per second
+=============
+*/
+void SV_StringBench_f( void )
+{
+	int		hours, cycles, cycle, i, failed = 0;
+	int		firstPeak = 0, lastUsed = 0, maxGrowth = 0;
+	int		used[12];
+	size_t		requested = 0;
+	stringpool_t	pool;
+	double		start, time;
+
+	hours = ( Cmd_Argc() > 1 ) ? Q_atoi( Cmd_Argv( 1 )) : 8;
+	hours = bound( 1, hours, 1000 );
+	cycles = hours * 3;
+
+	SV_InitStringPool( &pool, host.mempool, sv_stringpool_size->integer * 1024 );
+	start = Sys_DoubleTime();
+
+	for( cycle = 0; cycle < cycles; cycle++ )
+	{
+		int	map = cycle % ARRAYSIZE( used );
+
+		SV_ClearStringPool( &pool );
+
+		for( i = 0; i < 800; i++ )
+			failed += SV_StringBenchSpawn( &pool, map, i, &requested );
+
+		for( i = 0; i < 20 * 60 * 10; i++ )
+			failed += SV_StringBenchSpawn( &pool, map, i % 800, &requested );
+
+		// same map in next rotation must use the same memory
+		if( cycle >= ARRAYSIZE( used ))
+			maxGrowth = max( maxGrowth, pool.used - used[map] );
+		used[map] = pool.used;
+
+		if( !cycle ) firstPeak = pool.peak;
+		lastUsed = pool.used;
+	}
+
+	time = Sys_DoubleTime() - start;
+
+	Msg( "%i hours, %i map cycles, %s requested in %.1f ms\n", hours, cycles, Q_memprint( requested ), time * 1000.0 );
+	Msg( "pool peak %s, after first map %s, after last map %s\n", Q_memprint( pool.peak ), Q_memprint( firstPeak ), Q_memprint( lastUsed ));
+
+	if( failed ) Msg( "^1%i strings didn't fit into pool^7\n", failed );
+	else if( maxGrowth > 0 ) Msg( "^1memory grows by %s per map rotation^7\n", Q_memprint( maxGrowth ));
+	else Msg( "no memory growth\n" );
+
+	SV_FreeStringPool( &pool );
+}
@@ -356,6 +356,337 @@ hull_t *SV_HullForStudioModel( edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t of
 /*
 ===============================================================================
 
+SPATIAL QUERIES
+
+===============================================================================
+*/
+#define SPATIAL_DEPTH	8
+#define SPATIAL_NODES	(( 2 << SPATIAL_DEPTH ) - 1 )
+
+// area nodes only hold solid and trigger edicts and are too coarse
+// for radius searches, so all valid edicts are kept in a deeper tree
+// built the same way. Each edict remembers the box it was linked with
+typedef struct
+{
+	int		axis;		// -1 = leaf node
+	float		dist;
+	int		children[2];
+	link_t		edicts;
+} spatialnode_t;
+
+typedef struct
+{
+	link_t		link;		// linked into node when prev != NULL
+	vec3_t		absmin;
+	vec3_t		absmax;
+} spatialedict_t;
+
+static struct
+{
+	spatialnode_t	nodes[SPATIAL_NODES];
+	int		numnodes;
+	spatialedict_t	*edicts;		// [maxEntities]
+	int		maxEntities;
+	int		generation;	// changed when any edict is moved
+
+	// last sphere is cached, radius damage
+	// asks for the same sphere until world
+	int		*sphere;
+	int		spherecount;
+	int		spheregen;
+	vec3_t		sphereorg;
+	float		sphereradius;
+
+	int		*touched;		// box query buffer
+} sv_spatial;
+
+/*
+===============
+SV_CreateSpatialNode
+===============
+*/
+static int SV_CreateSpatialNode( int depth, vec3_t mins, vec3_t maxs )
+{
+	spatialnode_t	*node;
+	vec3_t		size;
+	vec3_t		mins1, maxs1;
+	vec3_t		mins2, maxs2;
+	int		nodenum;
+
+	nodenum = sv_spatial.numnodes++;
+	node = &sv_spatial.nodes[nodenum];
+	ClearLink( &node->edicts );
+
+	if( depth == SPATIAL_DEPTH )
+	{
+		node->axis = -1;
+		node->children[0] = node->children[1] = -1;
+		return nodenum;
+	}
+
+	VectorSubtract( maxs, mins, size );
+	if( size[0] > size[1] )
+		node->axis = 0;
+	else node->axis = 1;
+
+	node->dist = 0.5f * ( maxs[node->axis] + mins[node->axis] );
+	VectorCopy( mins, mins1 );
+	VectorCopy( mins, mins2 );
+	VectorCopy( maxs, maxs1 );
+	VectorCopy( maxs, maxs2 );
+
+	maxs1[node->axis] = mins2[node->axis] = node->dist;
+	node->children[0] = SV_CreateSpatialNode( depth+1, mins2, maxs2 );
+	node->children[1] = SV_CreateSpatialNode( depth+1, mins1, maxs1 );
+
+	return nodenum;
+}
+
+/*
+===============
+SV_ClearSpatialIndex
+
+build the tree for new world and link all valid edicts
+===============
+*/
+static void SV_ClearSpatialIndex( void )
+{
+	int	i;
+
+	if( sv_spatial.maxEntities != svgame.globals->maxEntities )
+	{
+		if( sv_spatial.edicts ) Mem_Free( sv_spatial.edicts );
+		if( sv_spatial.sphere ) Mem_Free( sv_spatial.sphere );
+		if( sv_spatial.touched ) Mem_Free( sv_spatial.touched );
+
+		sv_spatial.maxEntities = svgame.globals->maxEntities;
+		sv_spatial.edicts = Mem_Alloc( host.mempool, sv_spatial.maxEntities * sizeof( spatialedict_t ));
+		sv_spatial.sphere = Mem_Alloc( host.mempool, sv_spatial.maxEntities * sizeof( int ));
+		sv_spatial.touched = Mem_Alloc( host.mempool, sv_spatial.maxEntities * sizeof( int ));
+	}
+	else Q_memset( sv_spatial.edicts, 0, sv_spatial.maxEntities * sizeof( spatialedict_t ));
+
+	sv_spatial.numnodes = 0;
+	sv_spatial.generation++;
+	SV_CreateSpatialNode( 0, sv.worldmodel->mins, sv.worldmodel->maxs );
+
+	for( i = 1; i < svgame.numEntities; i++ )
+	{
+		edict_t	*ent = EDICT_NUM( i );
+
+		if( !ent->free ) SV_LinkSpatial( ent );
+	}
+}
+
+/*
+===============
+SV_UnlinkSpatial
+===============
+*/
+void SV_UnlinkSpatial( edict_t *ent )
+{
+	spatialedict_t	*se;
+	int		e;
+
+	if( !sv_spatial.numnodes ) return;
+
+	e = NUM_FOR_EDICT( ent );
+	if( e <= 0 || e >= sv_spatial.maxEntities )
+		return;
+
+	se = &sv_spatial.edicts[e];
+	if( !se->link.prev ) return;
+
+	RemoveLink( &se->link );
+	se->link.prev = se->link.next = NULL;
+	sv_spatial.generation++;
+}
+
+/*
+===============
+SV_LinkSpatial
+
+put edict into the node its current box fits into
+===============
+*/
+void SV_LinkSpatial( edict_t *ent )
+{
+	spatialnode_t	*node;
+	spatialedict_t	*se;
+	int		e;
+
+	if( !sv_spatial.numnodes ) return;
+
+	e = NUM_FOR_EDICT( ent );
+	if( e <= 0 || e >= sv_spatial.maxEntities )
+		return; // don't add the world
+
+	se = &sv_spatial.edicts[e];
+
+	if( se->link.prev )
+	{
+		// most relinks don't move anything
+		if( VectorCompare( se->absmin, ent->v.absmin ) && VectorCompare( se->absmax, ent->v.absmax ))
+			return;
+		RemoveLink( &se->link );
+	}
+
+	VectorCopy( ent->v.absmin, se->absmin );
+	VectorCopy( ent->v.absmax, se->absmax );
+
+	node = sv_spatial.nodes;
+
+	while( node->axis != -1 )
+	{
+		if( se->absmin[node->axis] > node->dist )
+			node = &sv_spatial.nodes[node->children[0]];
+		else if( se->absmax[node->axis] < node->dist )
+			node = &sv_spatial.nodes[node->children[1]];
+		else break; // crosses the node
+	}
+
+	InsertLinkBefore( &se->link, &node->edicts );
+	sv_spatial.generation++;
+}
+
+/*
+===============
+SV_UpdateSpatialIndex
+
+game dll may change absbox without relink,
+catch up once per frame
+===============
+*/
+void SV_UpdateSpatialIndex( void )
+{
+	spatialedict_t	*se;
+	edict_t		*ent;
+	int		i;
+
+	if( !sv_spatial.numnodes ) return;
+
+	for( i = 1; i < svgame.numEntities; i++ )
+	{
+		ent = EDICT_NUM( i );
+		se = &sv_spatial.edicts[i];
+
+		if( ent->free )
+		{
+			if( se->link.prev ) SV_UnlinkSpatial( ent );
+			continue;
+		}
+
+		if( !se->link.prev || !VectorCompare( se->absmin, ent->v.absmin ) || !VectorCompare( se->absmax, ent->v.absmax ))
+			SV_LinkSpatial( ent );
+	}
+}
+
+static int SV_CompareEdictNums( const void *a, const void *b )
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+===============
+SV_SpatialQuery_r
+===============
+*/
+static int SV_SpatialQuery_r( spatialnode_t *node, const vec3_t mins, const vec3_t maxs, int *list, int count )
+{
+	spatialedict_t	*se;
+	link_t		*l;
+
+	while( 1 )
+	{
+		for( l = node->edicts.next; l != &node->edicts; l = l->next )
+		{
+			se = (spatialedict_t *)l; // link is the first member
+
+			if( BoundsIntersect( mins, maxs, se->absmin, se->absmax ))
+				list[count++] = se - sv_spatial.edicts;
+		}
+
+		if( node->axis == -1 ) break;
+
+		if( mins[node->axis] > node->dist )
+			node = &sv_spatial.nodes[node->children[0]];
+		else if( maxs[node->axis] < node->dist )
+			node = &sv_spatial.nodes[node->children[1]];
+		else
+		{
+			// recurse down both sides
+			count = SV_SpatialQuery_r( &sv_spatial.nodes[node->children[0]], mins, maxs, list, count );
+			node = &sv_spatial.nodes[node->children[1]];
+		}
+	}
+
+	return count;
+}
+
+/*
+===============
+SV_AreaEdicts
+
+numbers of all valid edicts which boxes touch the given box,
+sorted in ascending order. Returns -1 when there is no world yet
+===============
+*/
+int SV_AreaEdicts( const vec3_t mins, const vec3_t maxs, int **list )
+{
+	int	count;
+
+	if( !sv_spatial.numnodes )
+		return -1;
+
+	count = SV_SpatialQuery_r( sv_spatial.nodes, mins, maxs, sv_spatial.touched, 0 );
+	qsort( sv_spatial.touched, count, sizeof( int ), SV_CompareEdictNums );
+	*list = sv_spatial.touched;
+
+	return count;
+}
+
+/*
+===============
+SV_SphereEdicts
+
+same for bounding box of the sphere, list stays
+valid until any edict is moved, linked or freed
+===============
+*/
+int SV_SphereEdicts( const vec3_t org, float radius, int **list )
+{
+	vec3_t	mins, maxs;
+	int	i;
+
+	if( !sv_spatial.numnodes )
+		return -1;
+
+	radius = fabs( radius );
+
+	if( sv_spatial.spheregen != sv_spatial.generation || sv_spatial.sphereradius != radius || !VectorCompare( sv_spatial.sphereorg, org ))
+	{
+		for( i = 0; i < 3; i++ )
+		{
+			mins[i] = org[i] - radius;
+			maxs[i] = org[i] + radius;
+		}
+
+		sv_spatial.spherecount = SV_SpatialQuery_r( sv_spatial.nodes, mins, maxs, sv_spatial.sphere, 0 );
+		qsort( sv_spatial.sphere, sv_spatial.spherecount, sizeof( int ), SV_CompareEdictNums );
+
+		VectorCopy( org, sv_spatial.sphereorg );
+		sv_spatial.sphereradius = radius;
+		sv_spatial.spheregen = sv_spatial.generation;
+	}
+
+	*list = sv_spatial.sphere;
+
+	return sv_spatial.spherecount;
+}
+
+/*
+===============================================================================
+
 ENTITY AREA CHECKING
 
 ===============================================================================
@@ -433,6 +764,7 @@ void SV_ClearWorld( void )
 	sv_numareanodes = 0;
 
 	SV_CreateAreaNode( 0, sv.worldmodel->mins, sv.worldmodel->maxs );
+	SV_ClearSpatialIndex();
 }
 
 /*
@@ -628,6 +960,7 @@ void SV_LinkEdict( edict_t *ent, qboolean touch_triggers )
 
 	// set the abs box
 	svgame.dllFuncs.pfnSetAbsBox( ent );
+	SV_LinkSpatial( ent );
 
 	if( ent->v.movetype == MOVETYPE_FOLLOW && SV_IsValidEdict( ent->v.aiment ))
 	{